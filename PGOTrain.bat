@@ -0,0 +1,13 @@
+rem Run from a Developer Command Prompt, the instrumented binaries need pgort140.dll.
+call Premake5 vs2022
+if exist build\pgo rmdir /s /q build\pgo
+mkdir build\pgo
+msbuild build\VulkanTest.sln /m /p:Configuration=PGOInstrument /p:Platform=x64
+if errorlevel 1 exit /b 1
+
+pushd VulkanTest
+..\build\bin\PGOInstrument\Benchmark.exe --frames 2000 > nul
+..\build\bin\PGOInstrument\MathBenchmark.exe --samples 10 > nul
+popd
+
+msbuild build\VulkanTest.sln /m /p:Configuration=PGOOptimize /p:Platform=x64
@@ -0,0 +1,16 @@
+#!/bin/sh
+# Builds the PGOInstrument configuration, trains it with the benchmarks, then builds PGOOptimize from the profiles.
+set -e
+cd "$(dirname "$0")"
+
+premake5 gmake2
+rm -rf build/pgo
+make -C build config=pgoinstrument_x64 -j"$(nproc)"
+
+# Run from VulkanTest/ so Data/ is found.
+cd VulkanTest
+../build/bin/PGOInstrument/Benchmark --frames 2000 > /dev/null
+../build/bin/PGOInstrument/MathBenchmark --samples 10 > /dev/null
+cd ..
+
+make -C build config=pgooptimize_x64 -j"$(nproc)"
@@ -0,0 +1,3 @@
+#!/bin/sh
+# Generates makefiles in build/, then "make -C build config=release_x64".  Run the executables from VulkanTest/ so Data/ is found.
+premake5 gmake2 "$@"
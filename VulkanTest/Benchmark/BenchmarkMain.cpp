@@ -0,0 +1,473 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+
+// Renders scripted scenes headless for a fixed number of frames and writes the timings as JSON.
+// Usage: Benchmark [--scenario name] [--frames count] [--warmup count] [--out results.json]
+// Every scenario builds its scene from fixed seeds and runs on a fresh VulkanInterface, so runs can be compared.
+
+#if _WIN32
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "CPUProfiler.h"
+#include "Platform.h"
+#include "Structs.h"
+#include "VulkanBuffer.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanInterface.h"
+#include "VulkanMesh.h"
+#include "VulkanTransferQueue.h"
+
+static const uint32 BENCHMARK_WIDTH = 1280;
+static const uint32 BENCHMARK_HEIGHT = 720;
+static const uint32 BENCHMARK_GRID_SIZE = 32; // Vertices per side of the generated meshes.
+static const uint32 BENCHMARK_UPLOAD_SIZE = 256*1024;
+
+enum BenchmarkKind
+{
+    BenchmarkKind_Cubes,         // m_Count cubes, one draw each.
+    BenchmarkKind_Instances,     // One cube drawn m_Count times.
+    BenchmarkKind_Meshes,        // m_Count generated grid meshes, one draw each.
+    BenchmarkKind_UploadBurst,   // Create, fill and destroy m_Count device local buffers every frame.
+    BenchmarkKind_PipelineStorm, // Create and destroy m_Count pipelines every frame.
+};
+
+struct BenchmarkScenario
+{
+    const char* m_Name;
+    BenchmarkKind m_Kind;
+    uint32 m_Count;
+};
+
+static const BenchmarkScenario g_Scenarios[] =
+{
+    { "cubes_1",          BenchmarkKind_Cubes,         1    },
+    { "cubes_256",        BenchmarkKind_Cubes,         256  },
+    { "cubes_1024",       BenchmarkKind_Cubes,         1024 },
+    { "instances_1024",   BenchmarkKind_Instances,     1024 },
+    { "instances_65536",  BenchmarkKind_Instances,     65536 },
+    { "meshes_64",        BenchmarkKind_Meshes,        64   },
+    { "meshes_256",       BenchmarkKind_Meshes,        256  },
+    { "upload_burst_16",  BenchmarkKind_UploadBurst,   16   },
+    { "pipeline_storm_4", BenchmarkKind_PipelineStorm, 4    },
+};
+static const uint32 g_ScenarioCount = sizeof( g_Scenarios ) / sizeof( g_Scenarios[0] );
+
+struct BenchmarkTimes
+{
+    double m_AverageMS;
+    double m_MinMS;
+    double m_MaxMS;
+    double m_MedianMS;
+    double m_P95MS;
+    double m_P99MS;
+};
+
+struct BenchmarkResult
+{
+    const BenchmarkScenario* m_pScenario;
+    uint32 m_FrameCount;
+
+    BenchmarkTimes m_CPUFrame;
+
+    // From the GPU profiler's "Main Pass" scope, covers at most GPU_PROFILER_HISTORY frames.
+    bool m_HasGPUTimes;
+    GPUScopeStats m_GPUMainPass;
+
+    RenderStats m_LastFrameStats;
+
+    uint64 m_PeakDeviceMemory;
+    uint32 m_PeakDeviceAllocations;
+    uint64 m_PeakProcessMemory;
+};
+
+// Deterministic so generated scenes are identical between runs and machines.
+static uint32 g_RandomState;
+
+static void SeedRandom(uint32 seed)
+{
+    g_RandomState = seed;
+}
+
+static float RandomFloat()
+{
+    g_RandomState = g_RandomState * 1664525 + 1013904223;
+    return (g_RandomState >> 8) / (float)(1 << 24);
+}
+
+static uint64 GetPeakProcessMemory()
+{
+#if _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if( getrusage( RUSAGE_SELF, &usage ) == 0 )
+        return (uint64)usage.ru_maxrss * 1024; // Kilobytes on Linux.
+    return 0;
+#endif
+}
+
+static void CalculateTimes(double* frameTimesMS, uint32 count, BenchmarkTimes* pTimes)
+{
+    memset( pTimes, 0, sizeof( BenchmarkTimes ) );
+    if( count == 0 )
+        return;
+
+    std::sort( frameTimesMS, frameTimesMS + count );
+
+    double total = 0;
+    for( uint32 i=0; i<count; i++ )
+    {
+        total += frameTimesMS[i];
+    }
+
+    pTimes->m_AverageMS = total / count;
+    pTimes->m_MinMS = frameTimesMS[0];
+    pTimes->m_MaxMS = frameTimesMS[count-1];
+    pTimes->m_MedianMS = frameTimesMS[count/2];
+    pTimes->m_P95MS = frameTimesMS[(count-1) * 95 / 100];
+    pTimes->m_P99MS = frameTimesMS[(count-1) * 99 / 100];
+}
+
+// A bumpy grid in the XY plane, -1 to 1, with a seeded height and color per vertex.
+static VulkanMesh* CreateGridMesh(VulkanInterface* pInterface)
+{
+    const uint32 size = BENCHMARK_GRID_SIZE;
+
+    VertexFormat* vertices = new VertexFormat[size*size];
+    for( uint32 y=0; y<size; y++ )
+    {
+        for( uint32 x=0; x<size; x++ )
+        {
+            VertexFormat& vertex = vertices[y*size + x];
+            vertex.pos[0] = x / (float)(size-1) * 2.0f - 1.0f;
+            vertex.pos[1] = y / (float)(size-1) * 2.0f - 1.0f;
+            vertex.pos[2] = RandomFloat() * 0.1f;
+            vertex.color[0] = (unsigned char)(RandomFloat() * 255);
+            vertex.color[1] = (unsigned char)(RandomFloat() * 255);
+            vertex.color[2] = (unsigned char)(RandomFloat() * 255);
+            vertex.color[3] = 255;
+        }
+    }
+
+    uint32 indexCount = (size-1) * (size-1) * 6;
+    uint32* indices = new uint32[indexCount];
+    uint32 index = 0;
+    for( uint32 y=0; y<size-1; y++ )
+    {
+        for( uint32 x=0; x<size-1; x++ )
+        {
+            uint32 corner = y*size + x;
+            indices[index++] = corner;
+            indices[index++] = corner + size;
+            indices[index++] = corner + size + 1;
+            indices[index++] = corner;
+            indices[index++] = corner + size + 1;
+            indices[index++] = corner + 1;
+        }
+    }
+
+    VulkanMesh* pMesh = new VulkanMesh();
+    pMesh->Create( pInterface, vertices, size*size, indices, indexCount );
+
+    Vector3 center;
+    float radius;
+    VulkanMesh::CalculateBoundingSphere( vertices, size*size, sizeof( VertexFormat ), 0, &center, &radius );
+    pMesh->SetBounds( center, radius );
+
+    delete[] vertices;
+    delete[] indices;
+
+    return pMesh;
+}
+
+static void UploadBurst(VulkanInterface* pInterface, uint32 bufferCount, const unsigned char* pData)
+{
+    PROFILE_FUNCTION();
+
+    VulkanTransferQueue* pTransferQueue = pInterface->GetTransferQueue();
+
+    // Destroyed right away, the deletion queue holds on to them until the uploads and frames using them are done.
+    for( uint32 i=0; i<bufferCount; i++ )
+    {
+        VulkanBuffer buffer;
+        buffer.Create( pInterface, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, nullptr, BENCHMARK_UPLOAD_SIZE,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+        pTransferQueue->Upload( &buffer, 0, pData, BENCHMARK_UPLOAD_SIZE, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT );
+        buffer.Destroy();
+    }
+
+    pTransferQueue->Flush();
+}
+
+static void PipelineStorm(VulkanInterface* pInterface, uint32 pipelineCount)
+{
+    PROFILE_FUNCTION();
+
+    for( uint32 i=0; i<pipelineCount; i++ )
+    {
+        VkPipeline pipeline = pInterface->CreatePipeline();
+        pInterface->GetDeletionQueue()->Defer( VK_OBJECT_TYPE_PIPELINE, (uint64)pipeline );
+    }
+}
+
+static void RunScenario(const BenchmarkScenario* pScenario, uint32 warmupFrames, uint32 frameCount, BenchmarkResult* pResult)
+{
+    PROFILE_SCOPE( pScenario->m_Name );
+
+    memset( pResult, 0, sizeof( BenchmarkResult ) );
+    pResult->m_pScenario = pScenario;
+    pResult->m_FrameCount = frameCount;
+
+    VulkanInterface* pInterface = new VulkanInterface();
+    pInterface->CreateHeadless( BENCHMARK_WIDTH, BENCHMARK_HEIGHT );
+
+    // Measure raw throughput, only the frames in flight limit the CPU.
+    pInterface->SetFramePacing( FramePacingMode_Off );
+
+    // Build the scene.
+    SeedRandom( 12345 );
+
+    VulkanMesh** meshes = new VulkanMesh*[MAX_DRAWS_PER_FRAME];
+    uint32 meshCount = 0;
+
+    switch( pScenario->m_Kind )
+    {
+    case BenchmarkKind_Cubes:
+    case BenchmarkKind_UploadBurst:
+    case BenchmarkKind_PipelineStorm:
+        meshCount = pScenario->m_Kind == BenchmarkKind_Cubes ? pScenario->m_Count : 1;
+        for( uint32 i=0; i<meshCount; i++ )
+        {
+            meshes[i] = new VulkanMesh();
+            meshes[i]->CreateCube( pInterface );
+        }
+        break;
+
+    case BenchmarkKind_Instances:
+        meshCount = 1;
+        meshes[0] = new VulkanMesh();
+        meshes[0]->CreateCube( pInterface );
+        pInterface->SetInstanceCount( pScenario->m_Count );
+        break;
+
+    case BenchmarkKind_Meshes:
+        meshCount = pScenario->m_Count;
+        for( uint32 i=0; i<meshCount; i++ )
+        {
+            meshes[i] = CreateGridMesh( pInterface );
+        }
+        break;
+    }
+
+    assert( meshCount <= MAX_DRAWS_PER_FRAME );
+    pInterface->SetupCommandBuffers( meshes, meshCount );
+
+    unsigned char* pUploadData = nullptr;
+    if( pScenario->m_Kind == BenchmarkKind_UploadBurst )
+    {
+        pUploadData = new unsigned char[BENCHMARK_UPLOAD_SIZE];
+        for( uint32 i=0; i<BENCHMARK_UPLOAD_SIZE; i++ )
+        {
+            pUploadData[i] = (unsigned char)(RandomFloat() * 255);
+        }
+    }
+
+    // Warm up, this also waits for the scene's geometry to become resident.
+    pInterface->GetTransferQueue()->WaitIdle();
+    for( uint32 i=0; i<warmupFrames; i++ )
+    {
+        pInterface->Render();
+        pInterface->Present();
+    }
+
+    // Measure.
+    double* frameTimesMS = new double[frameCount];
+    for( uint32 i=0; i<frameCount; i++ )
+    {
+        int64 startTime = CPUProfiler::GetTimeNanoseconds();
+
+        if( pScenario->m_Kind == BenchmarkKind_UploadBurst )
+            UploadBurst( pInterface, pScenario->m_Count, pUploadData );
+        if( pScenario->m_Kind == BenchmarkKind_PipelineStorm )
+            PipelineStorm( pInterface, pScenario->m_Count );
+
+        pInterface->Render();
+        pInterface->Present();
+
+        frameTimesMS[i] = (CPUProfiler::GetTimeNanoseconds() - startTime) / 1000000.0;
+
+        if( pInterface->GetPeakDeviceMemory() > pResult->m_PeakDeviceMemory )
+            pResult->m_PeakDeviceMemory = pInterface->GetPeakDeviceMemory();
+        if( pInterface->GetDeviceAllocationCount() > pResult->m_PeakDeviceAllocations )
+            pResult->m_PeakDeviceAllocations = pInterface->GetDeviceAllocationCount();
+    }
+
+    // Let the GPU finish so the profiler has resolved the last frames.
+    pInterface->WaitForGPU( pInterface->GetLastSubmitValue() );
+    pInterface->Render();
+    pInterface->Present();
+
+    CalculateTimes( frameTimesMS, frameCount, &pResult->m_CPUFrame );
+    pResult->m_HasGPUTimes = pInterface->GetGPUProfiler()->GetScopeStats( "Main Pass", &pResult->m_GPUMainPass );
+    pResult->m_LastFrameStats = pInterface->GetRenderStats();
+    pResult->m_PeakProcessMemory = GetPeakProcessMemory();
+
+    delete[] frameTimesMS;
+    delete[] pUploadData;
+
+    // Clean up.
+    for( uint32 i=0; i<meshCount; i++ )
+    {
+        meshes[i]->Destroy();
+        delete meshes[i];
+    }
+    delete[] meshes;
+
+    pInterface->Destroy();
+    delete pInterface;
+}
+
+static void WriteTimes(FILE* file, const char* name, const BenchmarkTimes& times)
+{
+    fprintf( file, "      \"%s\": { \"avg_ms\": %0.4f, \"min_ms\": %0.4f, \"max_ms\": %0.4f, \"median_ms\": %0.4f, \"p95_ms\": %0.4f, \"p99_ms\": %0.4f },\n",
+             name, times.m_AverageMS, times.m_MinMS, times.m_MaxMS, times.m_MedianMS, times.m_P95MS, times.m_P99MS );
+}
+
+static void WriteResults(FILE* file, BenchmarkResult* results, uint32 resultCount, uint32 warmupFrames)
+{
+    fprintf( file, "{\n" );
+    fprintf( file, "  \"width\": %u,\n", BENCHMARK_WIDTH );
+    fprintf( file, "  \"height\": %u,\n", BENCHMARK_HEIGHT );
+    fprintf( file, "  \"warmup_frames\": %u,\n", warmupFrames );
+    fprintf( file, "  \"scenarios\": [\n" );
+
+    for( uint32 i=0; i<resultCount; i++ )
+    {
+        BenchmarkResult& result = results[i];
+
+        fprintf( file, "    {\n" );
+        fprintf( file, "      \"name\": \"%s\",\n", result.m_pScenario->m_Name );
+        fprintf( file, "      \"frames\": %u,\n", result.m_FrameCount );
+        WriteTimes( file, "cpu_frame", result.m_CPUFrame );
+
+        if( result.m_HasGPUTimes )
+        {
+            GPUScopeStats& gpu = result.m_GPUMainPass;
+            fprintf( file, "      \"gpu_main_pass\": { \"avg_ms\": %0.4f, \"min_ms\": %0.4f, \"max_ms\": %0.4f, \"median_ms\": %0.4f, \"p95_ms\": %0.4f, \"p99_ms\": %0.4f },\n",
+                     gpu.m_AverageMS, gpu.m_MinMS, gpu.m_MaxMS, gpu.m_MedianMS, gpu.m_P95MS, gpu.m_P99MS );
+        }
+        else
+        {
+            fprintf( file, "      \"gpu_main_pass\": null,\n" );
+        }
+
+        fprintf( file, "      \"draws\": %u,\n", result.m_LastFrameStats.m_DrawCount );
+        fprintf( file, "      \"triangles\": %u,\n", result.m_LastFrameStats.m_TrianglesDrawn );
+        fprintf( file, "      \"peak_device_memory_bytes\": %llu,\n", (unsigned long long)result.m_PeakDeviceMemory );
+        fprintf( file, "      \"peak_device_allocations\": %u,\n", result.m_PeakDeviceAllocations );
+        fprintf( file, "      \"peak_process_memory_bytes\": %llu\n", (unsigned long long)result.m_PeakProcessMemory );
+        fprintf( file, "    }%s\n", i+1 < resultCount ? "," : "" );
+    }
+
+    fprintf( file, "  ]\n" );
+    fprintf( file, "}\n" );
+}
+
+int main(int argc, char** argv)
+{
+    PROFILE_THREAD_NAME( "Main" );
+
+    const char* scenarioName = nullptr;
+    const char* outputFilename = nullptr;
+    uint32 frameCount = 1000;
+    uint32 warmupFrames = 100;
+
+    for( int i=1; i<argc; i++ )
+    {
+        if( strcmp( argv[i], "--scenario" ) == 0 && i+1 < argc )
+            scenarioName = argv[++i];
+        else if( strcmp( argv[i], "--frames" ) == 0 && i+1 < argc )
+            frameCount = (uint32)atoi( argv[++i] );
+        else if( strcmp( argv[i], "--warmup" ) == 0 && i+1 < argc )
+            warmupFrames = (uint32)atoi( argv[++i] );
+        else if( strcmp( argv[i], "--out" ) == 0 && i+1 < argc )
+            outputFilename = argv[++i];
+        else
+        {
+            fprintf( stderr, "Usage: %s [--scenario name] [--frames count] [--warmup count] [--out results.json]\nScenarios:", argv[0] );
+            for( uint32 s=0; s<g_ScenarioCount; s++ )
+            {
+                fprintf( stderr, " %s", g_Scenarios[s].m_Name );
+            }
+            fprintf( stderr, "\n" );
+            return 1;
+        }
+    }
+
+    if( frameCount == 0 )
+        frameCount = 1;
+
+    BenchmarkResult* results = new BenchmarkResult[g_ScenarioCount];
+    uint32 resultCount = 0;
+
+    for( uint32 i=0; i<g_ScenarioCount; i++ )
+    {
+        if( scenarioName && strcmp( scenarioName, g_Scenarios[i].m_Name ) != 0 )
+            continue;
+
+        fprintf( stderr, "Running %s...\n", g_Scenarios[i].m_Name );
+        RunScenario( &g_Scenarios[i], warmupFrames, frameCount, &results[resultCount] );
+        resultCount++;
+    }
+
+    if( resultCount == 0 )
+    {
+        fprintf( stderr, "Unknown scenario: %s\n", scenarioName );
+        delete[] results;
+        return 1;
+    }
+
+    FILE* file = stdout;
+    if( outputFilename )
+    {
+        errno_t error = fopen_s( &file, outputFilename, "w" );
+        if( error != 0 || file == nullptr )
+        {
+            fprintf( stderr, "Couldn't open %s\n", outputFilename );
+            delete[] results;
+            return 1;
+        }
+    }
+
+    WriteResults( file, results, resultCount, warmupFrames );
+
+    if( file != stdout )
+        fclose( file );
+
+    delete[] results;
+
+#if CPU_PROFILER_ENABLED
+    CPUProfiler::ExportChromeTrace( "BenchmarkProfile.json" );
+#endif
+
+    return 0;
+}
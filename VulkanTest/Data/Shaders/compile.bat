@@ -1,4 +1,28 @@
-..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V test.vert -o spv.test.vs
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V mesh.vert -o spv.mesh.vs
+if errorlevel 1 pause
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V -DHAS_UV mesh.vert -o spv.mesh_uv.vs
+if errorlevel 1 pause
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V -DHAS_NORMAL mesh.vert -o spv.mesh_normal.vs
+if errorlevel 1 pause
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V -DHAS_NORMAL -DHAS_UV mesh.vert -o spv.mesh_normal_uv.vs
+if errorlevel 1 pause
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V -DHAS_OCT_NORMAL mesh.vert -o spv.mesh_octnormal.vs
+if errorlevel 1 pause
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V -DHAS_OCT_NORMAL -DHAS_UV mesh.vert -o spv.mesh_octnormal_uv.vs
+if errorlevel 1 pause
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V -DHAS_COLOR mesh.vert -o spv.mesh_color.vs
+if errorlevel 1 pause
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V -DHAS_COLOR -DHAS_UV mesh.vert -o spv.mesh_color_uv.vs
+if errorlevel 1 pause
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V -DHAS_COLOR -DHAS_NORMAL mesh.vert -o spv.mesh_color_normal.vs
+if errorlevel 1 pause
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V -DHAS_COLOR -DHAS_NORMAL -DHAS_UV mesh.vert -o spv.mesh_color_normal_uv.vs
+if errorlevel 1 pause
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V -DHAS_COLOR -DHAS_OCT_NORMAL mesh.vert -o spv.mesh_color_octnormal.vs
+if errorlevel 1 pause
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V -DHAS_COLOR -DHAS_OCT_NORMAL -DHAS_UV mesh.vert -o spv.mesh_color_octnormal_uv.vs
 if errorlevel 1 pause
 ..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V test.frag -o spv.test.fs
 if errorlevel 1 pause
+..\..\..\Libraries\Vulkan\Bin32\glslangValidator -V textured.frag -o spv.textured.fs
+if errorlevel 1 pause
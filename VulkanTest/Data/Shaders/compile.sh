@@ -0,0 +1,17 @@
+#!/bin/sh
+# Uses glslangValidator from the Vulkan SDK or the glslang-tools package.
+cd "$(dirname "$0")"
+glslangValidator -V mesh.vert -o spv.mesh.vs || exit 1
+glslangValidator -V -DHAS_UV mesh.vert -o spv.mesh_uv.vs || exit 1
+glslangValidator -V -DHAS_NORMAL mesh.vert -o spv.mesh_normal.vs || exit 1
+glslangValidator -V -DHAS_NORMAL -DHAS_UV mesh.vert -o spv.mesh_normal_uv.vs || exit 1
+glslangValidator -V -DHAS_OCT_NORMAL mesh.vert -o spv.mesh_octnormal.vs || exit 1
+glslangValidator -V -DHAS_OCT_NORMAL -DHAS_UV mesh.vert -o spv.mesh_octnormal_uv.vs || exit 1
+glslangValidator -V -DHAS_COLOR mesh.vert -o spv.mesh_color.vs || exit 1
+glslangValidator -V -DHAS_COLOR -DHAS_UV mesh.vert -o spv.mesh_color_uv.vs || exit 1
+glslangValidator -V -DHAS_COLOR -DHAS_NORMAL mesh.vert -o spv.mesh_color_normal.vs || exit 1
+glslangValidator -V -DHAS_COLOR -DHAS_NORMAL -DHAS_UV mesh.vert -o spv.mesh_color_normal_uv.vs || exit 1
+glslangValidator -V -DHAS_COLOR -DHAS_OCT_NORMAL mesh.vert -o spv.mesh_color_octnormal.vs || exit 1
+glslangValidator -V -DHAS_COLOR -DHAS_OCT_NORMAL -DHAS_UV mesh.vert -o spv.mesh_color_octnormal_uv.vs || exit 1
+glslangValidator -V test.frag -o spv.test.fs || exit 1
+glslangValidator -V textured.frag -o spv.textured.fs || exit 1
@@ -0,0 +1,77 @@
+#version 450
+
+// Compiled once per vertex layout, HAS_COLOR, HAS_NORMAL or HAS_OCT_NORMAL, and HAS_UV are defined for the attributes the layout has.
+// Every variant is listed in the compile scripts, VulkanInterface picks the one matching its layout.
+
+// Attributes
+layout(location = 0) in vec3 a_Position;
+#ifdef HAS_COLOR
+layout(location = 1) in vec4 a_Color;
+#endif
+#if defined( HAS_NORMAL )
+layout(location = 2) in vec3 a_Normal;
+#elif defined( HAS_OCT_NORMAL )
+layout(location = 2) in vec2 a_Normal;
+#endif
+#ifdef HAS_UV
+layout(location = 3) in vec2 a_UV;
+#endif
+
+// Uniforms
+layout(set = 0, binding = 0) uniform UniformBufferObject
+{
+    mat4 world;
+    mat4 view;
+    mat4 proj;
+} u_mat;
+
+// Matches PushConstants_Draw in Structs.h.  Undoes SNorm16 position quantization, the identity for other formats.
+layout(push_constant) uniform PushConstants
+{
+    vec4 quantizationScale;
+    vec4 quantizationOffset;
+} u_draw;
+
+// Varyings
+layout(location = 0) out vec4 v_Color;
+#ifdef HAS_UV
+layout(location = 1) out vec2 v_UV;
+#endif
+
+#if defined( HAS_NORMAL ) || defined( HAS_OCT_NORMAL )
+const vec3 c_LightDirection = vec3( 0.408248, 0.816497, -0.408248 );
+#endif
+
+void main()
+{
+    vec3 position = a_Position * u_draw.quantizationScale.xyz + u_draw.quantizationOffset.xyz;
+    gl_Position = u_mat.proj * u_mat.view * u_mat.world * vec4( position, 1.0 );
+
+#ifdef HAS_COLOR
+    vec4 color = a_Color;
+#else
+    vec4 color = vec4( 1.0 );
+#endif
+
+#if defined( HAS_NORMAL ) || defined( HAS_OCT_NORMAL )
+#ifdef HAS_OCT_NORMAL
+    // Unfold the lower hemisphere over the diagonals, the inverse of VertexLayout::EncodeOctahedral.
+    vec3 normal = vec3( a_Normal, 1.0 - abs( a_Normal.x ) - abs( a_Normal.y ) );
+    float fold = max( -normal.z, 0.0 );
+    normal.xy += mix( vec2( fold ), vec2( -fold ), greaterThanEqual( normal.xy, vec2( 0.0 ) ) );
+#else
+    vec3 normal = a_Normal;
+#endif
+
+    // Simple per vertex lighting, assumes the world matrix has uniform scale.
+    vec3 worldNormal = normalize( (u_mat.world * vec4( normal, 0.0 )).xyz );
+    float lighting = 0.35 + max( dot( worldNormal, c_LightDirection ), 0.0 ) * 0.65;
+    color.rgb *= lighting;
+#endif
+
+    v_Color = color;
+
+#ifdef HAS_UV
+    v_UV = a_UV;
+#endif
+}
@@ -0,0 +1,13 @@
+#version 450
+
+layout(set = 1, binding = 0) uniform sampler2D u_Texture;
+
+layout(location = 0) in vec4 v_Color;
+layout(location = 1) in vec2 v_UV;
+
+layout(location = 0) out vec4 fragColor;
+
+void main()
+{
+    fragColor = v_Color * texture( u_Texture, v_UV );
+}
@@ -0,0 +1,511 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+
+// Times the Math library's hot functions in ns/op over arrays of several sizes, so changes to it can be measured.
+// Usage: MathBenchmark [--filter substring] [--samples count] [--json results.json]
+// Each benchmark/size pair is run for a number of samples, each sample long enough to swamp the timer's resolution.
+// Variants suffixed _sse are reference kernels written here, the library itself is scalar.
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "CPUProfiler.h"
+#include "Math/MyMatrix.h"
+#include "Math/MyQuaternion.h"
+#include "Math/Vector.h"
+#include "Platform.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define MATH_BENCHMARK_SSE 1
+#include <emmintrin.h>
+#else
+#define MATH_BENCHMARK_SSE 0
+#endif
+
+static const uint32 MATH_BENCHMARK_MAX_ELEMENTS = 65536;
+static const uint32 MATH_BENCHMARK_MAX_SAMPLES = 200;
+static const int64 MATH_BENCHMARK_MIN_SAMPLE_NANOSECONDS = 2000000;
+
+// 16 fits in L1, 1024 in L2 and 65536 matrices spill out of most L2 caches.
+static const uint32 g_ArraySizes[] = { 16, 1024, 65536 };
+static const uint32 g_ArraySizeCount = sizeof( g_ArraySizes ) / sizeof( g_ArraySizes[0] );
+
+// Inputs and outputs for every benchmark, sized for the largest array.
+struct MathBenchmarkData
+{
+    MyMatrix* m_MatricesA;
+    MyMatrix* m_MatricesB;
+    MyMatrix* m_MatricesOut;
+
+    Vector3* m_Positions;
+    Vector3* m_Rotations;
+    Vector3* m_Scales;
+    Vector3* m_Vector3s;
+    Vector3* m_Vector3sOut;
+    Vector4* m_Vector4s;
+    Vector4* m_Vector4sOut;
+
+    MyQuat* m_QuatsA;
+    MyQuat* m_QuatsB;
+    MyQuat* m_QuatsOut;
+    float* m_Percents;
+};
+
+typedef void (*MathBenchmarkFunction)(MathBenchmarkData* pData, uint32 count);
+
+struct MathBenchmark
+{
+    const char* m_Name;
+    MathBenchmarkFunction m_pFunction;
+};
+
+struct MathBenchmarkResult
+{
+    const char* m_Name;
+    uint32 m_ArraySize;
+    uint32 m_Samples;
+    uint64 m_IterationsPerSample;
+
+    // Nanoseconds per element.
+    double m_MeanNS;
+    double m_StdDevNS;
+    double m_MinNS;
+    double m_MaxNS;
+    double m_MedianNS;
+    double m_P95NS;
+};
+
+// Keeps the optimizer from discarding results nothing else reads.
+static volatile float g_Sink;
+
+static uint32 g_RandomState = 12345;
+
+static float RandomFloat(float min, float max)
+{
+    g_RandomState = g_RandomState * 1664525 + 1013904223;
+    return min + (g_RandomState >> 8) / (float)(1 << 24) * (max - min);
+}
+
+static Vector3 RandomVector3(float min, float max)
+{
+    return Vector3( RandomFloat( min, max ), RandomFloat( min, max ), RandomFloat( min, max ) );
+}
+
+//==================================================================================
+// Scalar, through the library.
+//==================================================================================
+
+static void MatrixMultiply(MathBenchmarkData* pData, uint32 count)
+{
+    for( uint32 i=0; i<count; i++ )
+    {
+        pData->m_MatricesOut[i] = pData->m_MatricesA[i] * pData->m_MatricesB[i];
+    }
+}
+
+static void MatrixInverse(MathBenchmarkData* pData, uint32 count)
+{
+    for( uint32 i=0; i<count; i++ )
+    {
+        pData->m_MatricesOut[i] = pData->m_MatricesA[i].GetInverse();
+    }
+}
+
+static void MatrixCreateSRT(MathBenchmarkData* pData, uint32 count)
+{
+    for( uint32 i=0; i<count; i++ )
+    {
+        pData->m_MatricesOut[i].CreateSRT( pData->m_Scales[i], pData->m_Rotations[i], pData->m_Positions[i] );
+    }
+}
+
+static void MatrixCreateLookAtView(MathBenchmarkData* pData, uint32 count)
+{
+    for( uint32 i=0; i<count; i++ )
+    {
+        pData->m_MatricesOut[i].CreateLookAtView( pData->m_Positions[i], Vector3( 0, 1, 0 ), pData->m_Vector3s[i] );
+    }
+}
+
+static void QuatSlerp(MathBenchmarkData* pData, uint32 count)
+{
+    for( uint32 i=0; i<count; i++ )
+    {
+        pData->m_QuatsOut[i] = MyQuat::Slerp( pData->m_QuatsA[i], pData->m_QuatsB[i], pData->m_Percents[i] );
+    }
+}
+
+static void Vector3Normalize(MathBenchmarkData* pData, uint32 count)
+{
+    for( uint32 i=0; i<count; i++ )
+    {
+        pData->m_Vector3sOut[i] = pData->m_Vector3s[i].GetNormalized();
+    }
+}
+
+static void Vector4Normalize(MathBenchmarkData* pData, uint32 count)
+{
+    for( uint32 i=0; i<count; i++ )
+    {
+        pData->m_Vector4sOut[i] = pData->m_Vector4s[i].GetNormalized();
+    }
+}
+
+//==================================================================================
+// SSE2 reference kernels, same layout and results as the scalar versions.
+//==================================================================================
+
+#if MATH_BENCHMARK_SSE
+static void MatrixMultiplySSE(MathBenchmarkData* pData, uint32 count)
+{
+    for( uint32 i=0; i<count; i++ )
+    {
+        // Column major, each result column is a combination of a's columns weighted by b's column.
+        const float* a = &pData->m_MatricesA[i].m11;
+        const float* b = &pData->m_MatricesB[i].m11;
+        float* out = &pData->m_MatricesOut[i].m11;
+
+        __m128 a0 = _mm_loadu_ps( a + 0 );
+        __m128 a1 = _mm_loadu_ps( a + 4 );
+        __m128 a2 = _mm_loadu_ps( a + 8 );
+        __m128 a3 = _mm_loadu_ps( a + 12 );
+
+        for( uint32 column=0; column<4; column++ )
+        {
+            const float* bColumn = b + column*4;
+            __m128 result = _mm_mul_ps( a0, _mm_set1_ps( bColumn[0] ) );
+            result = _mm_add_ps( result, _mm_mul_ps( a1, _mm_set1_ps( bColumn[1] ) ) );
+            result = _mm_add_ps( result, _mm_mul_ps( a2, _mm_set1_ps( bColumn[2] ) ) );
+            result = _mm_add_ps( result, _mm_mul_ps( a3, _mm_set1_ps( bColumn[3] ) ) );
+            _mm_storeu_ps( out + column*4, result );
+        }
+    }
+}
+
+static void Vector4NormalizeSSE(MathBenchmarkData* pData, uint32 count)
+{
+    __m128 epsilon = _mm_set1_ps( FEQUALEPSILON );
+
+    for( uint32 i=0; i<count; i++ )
+    {
+        __m128 v = _mm_loadu_ps( &pData->m_Vector4s[i].x );
+
+        // Horizontal add of the squares, leaving the sum in every lane.
+        __m128 squares = _mm_mul_ps( v, v );
+        __m128 sum = _mm_add_ps( squares, _mm_shuffle_ps( squares, squares, _MM_SHUFFLE(2,3,0,1) ) );
+        sum = _mm_add_ps( sum, _mm_shuffle_ps( sum, sum, _MM_SHUFFLE(1,0,3,2) ) );
+        __m128 length = _mm_sqrt_ps( sum );
+
+        // Zero length vectors are returned unchanged, like Vector4::GetNormalized.
+        __m128 nonZero = _mm_cmpgt_ps( length, epsilon );
+        __m128 normalized = _mm_div_ps( v, length );
+        __m128 result = _mm_or_ps( _mm_and_ps( nonZero, normalized ), _mm_andnot_ps( nonZero, v ) );
+
+        _mm_storeu_ps( &pData->m_Vector4sOut[i].x, result );
+    }
+}
+#endif //MATH_BENCHMARK_SSE
+
+static const MathBenchmark g_Benchmarks[] =
+{
+    { "matrix_multiply",         MatrixMultiply },
+#if MATH_BENCHMARK_SSE
+    { "matrix_multiply_sse",     MatrixMultiplySSE },
+#endif
+    { "matrix_inverse",          MatrixInverse },
+    { "matrix_create_srt",       MatrixCreateSRT },
+    { "matrix_create_lookat",    MatrixCreateLookAtView },
+    { "quat_slerp",              QuatSlerp },
+    { "vector3_normalize",       Vector3Normalize },
+    { "vector4_normalize",       Vector4Normalize },
+#if MATH_BENCHMARK_SSE
+    { "vector4_normalize_sse",   Vector4NormalizeSSE },
+#endif
+};
+static const uint32 g_BenchmarkCount = sizeof( g_Benchmarks ) / sizeof( g_Benchmarks[0] );
+
+//==================================================================================
+// Setup and measurement.
+//==================================================================================
+
+static void CreateData(MathBenchmarkData* pData)
+{
+    const uint32 count = MATH_BENCHMARK_MAX_ELEMENTS;
+
+    pData->m_MatricesA = new MyMatrix[count];
+    pData->m_MatricesB = new MyMatrix[count];
+    pData->m_MatricesOut = new MyMatrix[count];
+    pData->m_Positions = new Vector3[count];
+    pData->m_Rotations = new Vector3[count];
+    pData->m_Scales = new Vector3[count];
+    pData->m_Vector3s = new Vector3[count];
+    pData->m_Vector3sOut = new Vector3[count];
+    pData->m_Vector4s = new Vector4[count];
+    pData->m_Vector4sOut = new Vector4[count];
+    pData->m_QuatsA = new MyQuat[count];
+    pData->m_QuatsB = new MyQuat[count];
+    pData->m_QuatsOut = new MyQuat[count];
+    pData->m_Percents = new float[count];
+
+    // Transforms like the renderer builds, so every matrix is invertible.
+    for( uint32 i=0; i<count; i++ )
+    {
+        pData->m_Positions[i] = RandomVector3( -100, 100 );
+        pData->m_Rotations[i] = RandomVector3( 0, 360 );
+        pData->m_Scales[i] = RandomVector3( 0.5f, 2.0f );
+        pData->m_Vector3s[i] = RandomVector3( -100, 100 );
+        pData->m_Vector4s[i] = Vector4( RandomFloat( -10, 10 ), RandomFloat( -10, 10 ), RandomFloat( -10, 10 ), RandomFloat( -10, 10 ) );
+
+        pData->m_MatricesA[i].CreateSRT( pData->m_Scales[i], pData->m_Rotations[i], pData->m_Positions[i] );
+        pData->m_MatricesB[i].CreateSRT( RandomVector3( 0.5f, 2.0f ), RandomVector3( 0, 360 ), RandomVector3( -100, 100 ) );
+
+        pData->m_QuatsA[i] = MyQuat( RandomFloat( -1, 1 ), RandomFloat( -1, 1 ), RandomFloat( -1, 1 ), RandomFloat( -1, 1 ) ).GetNormalized();
+        pData->m_QuatsB[i] = MyQuat( RandomFloat( -1, 1 ), RandomFloat( -1, 1 ), RandomFloat( -1, 1 ), RandomFloat( -1, 1 ) ).GetNormalized();
+        pData->m_Percents[i] = RandomFloat( 0, 1 );
+    }
+}
+
+static void DestroyData(MathBenchmarkData* pData)
+{
+    delete[] pData->m_MatricesA;
+    delete[] pData->m_MatricesB;
+    delete[] pData->m_MatricesOut;
+    delete[] pData->m_Positions;
+    delete[] pData->m_Rotations;
+    delete[] pData->m_Scales;
+    delete[] pData->m_Vector3s;
+    delete[] pData->m_Vector3sOut;
+    delete[] pData->m_Vector4s;
+    delete[] pData->m_Vector4sOut;
+    delete[] pData->m_QuatsA;
+    delete[] pData->m_QuatsB;
+    delete[] pData->m_QuatsOut;
+    delete[] pData->m_Percents;
+}
+
+// Reads something from every output so no benchmark's work can be optimized away.
+static void ConsumeResults(MathBenchmarkData* pData, uint32 count)
+{
+    float total = 0;
+    for( uint32 i=0; i<count; i++ )
+    {
+        total += pData->m_MatricesOut[i].m11 + pData->m_Vector3sOut[i].x + pData->m_Vector4sOut[i].x + pData->m_QuatsOut[i].x;
+    }
+    g_Sink = total;
+}
+
+#if MATH_BENCHMARK_SSE
+// The SSE kernels are only worth timing if they agree with the library.
+static bool VerifySSEKernels(MathBenchmarkData* pData)
+{
+    const uint32 count = 256;
+    bool ok = true;
+
+    MatrixMultiply( pData, count );
+    MyMatrix* expectedMatrices = new MyMatrix[count];
+    memcpy( expectedMatrices, pData->m_MatricesOut, sizeof( MyMatrix ) * count );
+
+    MatrixMultiplySSE( pData, count );
+    for( uint32 i=0; i<count && ok; i++ )
+    {
+        const float* expected = &expectedMatrices[i].m11;
+        const float* actual = &pData->m_MatricesOut[i].m11;
+        for( uint32 j=0; j<16; j++ )
+        {
+            if( fequal( expected[j], actual[j], fabsf( expected[j] ) * 0.0001f + 0.0001f ) == false )
+                ok = false;
+        }
+    }
+    delete[] expectedMatrices;
+
+    Vector4Normalize( pData, count );
+    Vector4* expectedVectors = new Vector4[count];
+    memcpy( expectedVectors, pData->m_Vector4sOut, sizeof( Vector4 ) * count );
+
+    Vector4NormalizeSSE( pData, count );
+    for( uint32 i=0; i<count && ok; i++ )
+    {
+        if( fequal( expectedVectors[i].x, pData->m_Vector4sOut[i].x, 0.0001f ) == false ||
+            fequal( expectedVectors[i].y, pData->m_Vector4sOut[i].y, 0.0001f ) == false ||
+            fequal( expectedVectors[i].z, pData->m_Vector4sOut[i].z, 0.0001f ) == false ||
+            fequal( expectedVectors[i].w, pData->m_Vector4sOut[i].w, 0.0001f ) == false )
+        {
+            ok = false;
+        }
+    }
+    delete[] expectedVectors;
+
+    return ok;
+}
+#endif //MATH_BENCHMARK_SSE
+
+static void RunBenchmark(const MathBenchmark& benchmark, MathBenchmarkData* pData, uint32 arraySize, uint32 sampleCount, MathBenchmarkResult* pResult)
+{
+    // Warm the caches and find how many passes over the array fill a sample.
+    uint64 iterations = 1;
+    while( true )
+    {
+        int64 startTime = CPUProfiler::GetTimeNanoseconds();
+        for( uint64 i=0; i<iterations; i++ )
+        {
+            benchmark.m_pFunction( pData, arraySize );
+        }
+        int64 elapsed = CPUProfiler::GetTimeNanoseconds() - startTime;
+
+        if( elapsed >= MATH_BENCHMARK_MIN_SAMPLE_NANOSECONDS )
+            break;
+
+        iterations *= 2;
+    }
+
+    double samplesNS[MATH_BENCHMARK_MAX_SAMPLES];
+    for( uint32 s=0; s<sampleCount; s++ )
+    {
+        int64 startTime = CPUProfiler::GetTimeNanoseconds();
+        for( uint64 i=0; i<iterations; i++ )
+        {
+            benchmark.m_pFunction( pData, arraySize );
+        }
+        int64 elapsed = CPUProfiler::GetTimeNanoseconds() - startTime;
+
+        samplesNS[s] = (double)elapsed / (iterations * arraySize);
+    }
+
+    ConsumeResults( pData, arraySize );
+
+    std::sort( samplesNS, samplesNS + sampleCount );
+
+    double total = 0;
+    for( uint32 s=0; s<sampleCount; s++ )
+    {
+        total += samplesNS[s];
+    }
+    double mean = total / sampleCount;
+
+    double variance = 0;
+    for( uint32 s=0; s<sampleCount; s++ )
+    {
+        variance += (samplesNS[s] - mean) * (samplesNS[s] - mean);
+    }
+    if( sampleCount > 1 )
+        variance /= sampleCount - 1;
+
+    pResult->m_Name = benchmark.m_Name;
+    pResult->m_ArraySize = arraySize;
+    pResult->m_Samples = sampleCount;
+    pResult->m_IterationsPerSample = iterations;
+    pResult->m_MeanNS = mean;
+    pResult->m_StdDevNS = sqrt( variance );
+    pResult->m_MinNS = samplesNS[0];
+    pResult->m_MaxNS = samplesNS[sampleCount-1];
+    pResult->m_MedianNS = samplesNS[sampleCount/2];
+    pResult->m_P95NS = samplesNS[(sampleCount-1) * 95 / 100];
+}
+
+static void WriteJSON(FILE* file, MathBenchmarkResult* results, uint32 resultCount)
+{
+    fprintf( file, "{\n" );
+    fprintf( file, "  \"sse\": %s,\n", MATH_BENCHMARK_SSE ? "true" : "false" );
+    fprintf( file, "  \"results\": [\n" );
+
+    for( uint32 i=0; i<resultCount; i++ )
+    {
+        MathBenchmarkResult& result = results[i];
+        fprintf( file, "    { \"name\": \"%s\", \"array_size\": %u, \"samples\": %u, \"iterations_per_sample\": %llu, "
+                       "\"mean_ns\": %0.4f, \"stddev_ns\": %0.4f, \"min_ns\": %0.4f, \"max_ns\": %0.4f, \"median_ns\": %0.4f, \"p95_ns\": %0.4f }%s\n",
+                 result.m_Name, result.m_ArraySize, result.m_Samples, (unsigned long long)result.m_IterationsPerSample,
+                 result.m_MeanNS, result.m_StdDevNS, result.m_MinNS, result.m_MaxNS, result.m_MedianNS, result.m_P95NS,
+                 i+1 < resultCount ? "," : "" );
+    }
+
+    fprintf( file, "  ]\n" );
+    fprintf( file, "}\n" );
+}
+
+int main(int argc, char** argv)
+{
+    const char* filter = nullptr;
+    const char* jsonFilename = nullptr;
+    uint32 sampleCount = 30;
+
+    for( int i=1; i<argc; i++ )
+    {
+        if( strcmp( argv[i], "--filter" ) == 0 && i+1 < argc )
+            filter = argv[++i];
+        else if( strcmp( argv[i], "--samples" ) == 0 && i+1 < argc )
+            sampleCount = (uint32)atoi( argv[++i] );
+        else if( strcmp( argv[i], "--json" ) == 0 && i+1 < argc )
+            jsonFilename = argv[++i];
+        else
+        {
+            fprintf( stderr, "Usage: %s [--filter substring] [--samples count] [--json results.json]\n", argv[0] );
+            return 1;
+        }
+    }
+
+    MyClamp( sampleCount, (uint32)1, MATH_BENCHMARK_MAX_SAMPLES );
+
+    MathBenchmarkData data;
+    CreateData( &data );
+
+#if MATH_BENCHMARK_SSE
+    if( VerifySSEKernels( &data ) == false )
+    {
+        fprintf( stderr, "SSE kernels don't match the library, not benchmarking.\n" );
+        DestroyData( &data );
+        return 1;
+    }
+#endif
+
+    MathBenchmarkResult* results = new MathBenchmarkResult[g_BenchmarkCount * g_ArraySizeCount];
+    uint32 resultCount = 0;
+
+    printf( "%-24s %8s %10s %10s %10s %10s %10s\n", "benchmark", "elements", "median ns", "mean ns", "stddev", "min ns", "p95 ns" );
+
+    for( uint32 b=0; b<g_BenchmarkCount; b++ )
+    {
+        if( filter && strstr( g_Benchmarks[b].m_Name, filter ) == nullptr )
+            continue;
+
+        for( uint32 s=0; s<g_ArraySizeCount; s++ )
+        {
+            MathBenchmarkResult& result = results[resultCount++];
+            RunBenchmark( g_Benchmarks[b], &data, g_ArraySizes[s], sampleCount, &result );
+
+            printf( "%-24s %8u %10.3f %10.3f %10.3f %10.3f %10.3f\n", result.m_Name, result.m_ArraySize,
+                    result.m_MedianNS, result.m_MeanNS, result.m_StdDevNS, result.m_MinNS, result.m_P95NS );
+            fflush( stdout );
+        }
+    }
+
+    if( jsonFilename )
+    {
+        FILE* file;
+        errno_t error = fopen_s( &file, jsonFilename, "w" );
+        if( error == 0 && file != nullptr )
+        {
+            WriteJSON( file, results, resultCount );
+            fclose( file );
+        }
+        else
+        {
+            fprintf( stderr, "Couldn't open %s\n", jsonFilename );
+        }
+    }
+
+    delete[] results;
+    DestroyData( &data );
+
+    return 0;
+}
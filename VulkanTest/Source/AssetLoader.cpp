@@ -0,0 +1,296 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "vulkan/vulkan.h"
+
+#include "AssetLoader.h"
+#include "CPUProfiler.h"
+#include "VulkanInterface.h"
+#include "VulkanMesh.h"
+
+// Limits how much is copied to the GPU per frame, a single larger asset is still finalized on its own.
+static const uint64 DEFAULT_FINALIZE_BYTES_PER_UPDATE = 16*1024*1024;
+
+MeshAsset::MeshAsset()
+{
+    m_pLoader = nullptr;
+    m_Filename[0] = 0;
+    m_State.store( AssetState_Reading );
+    m_ReleaseRequested = false;
+
+    m_IsMeshFile = false;
+    m_BakedMesh.NullEverything();
+    memset( &m_ImportStats, 0, sizeof( m_ImportStats ) );
+
+    m_pMesh = nullptr;
+}
+
+MeshAsset::~MeshAsset()
+{
+}
+
+AssetLoader::AssetLoader()
+{
+    m_pInterface = nullptr;
+
+    m_AssetCount = 0;
+
+    m_FailedAsset.m_pLoader = this;
+    m_FailedAsset.SetState( AssetState_Failed );
+
+    m_FinalizeBytesPerUpdate = DEFAULT_FINALIZE_BYTES_PER_UPDATE;
+}
+
+AssetLoader::~AssetLoader()
+{
+    assert( m_AssetCount == 0 );
+}
+
+void AssetLoader::Create(VulkanInterface* pInterface, uint32 ioThreadCount, uint32 cpuThreadCount)
+{
+    assert( m_pInterface == nullptr );
+
+    m_pInterface = pInterface;
+
+    m_IOThreads.Create( ioThreadCount );
+    m_CPUThreads.Create( cpuThreadCount );
+}
+
+void AssetLoader::Destroy()
+{
+    // I/O jobs can queue decode jobs, so drain them first.
+    m_IOThreads.Destroy();
+    m_CPUThreads.Destroy();
+
+    while( m_AssetCount > 0 )
+    {
+        DestroyAsset( m_AssetCount - 1 );
+    }
+
+    m_pInterface = nullptr;
+}
+
+MeshAsset* AssetLoader::LoadMesh(const char* filename)
+{
+    assert( m_pInterface != nullptr );
+
+    if( m_AssetCount == MAX_ASSETS || strlen( filename ) >= MAX_ASSET_PATH )
+        return &m_FailedAsset;
+
+    MeshAsset* pAsset = new MeshAsset();
+    pAsset->m_pLoader = this;
+    strncpy( pAsset->m_Filename, filename, MAX_ASSET_PATH - 1 );
+    pAsset->m_Filename[MAX_ASSET_PATH - 1] = 0;
+
+    const char* pExtension = strrchr( filename, '.' );
+    pAsset->m_IsMeshFile = pExtension && strcmp( pExtension, ".vtm" ) == 0;
+
+    m_Assets[m_AssetCount++] = pAsset;
+
+    m_IOThreads.Submit( ReadJob, pAsset );
+
+    return pAsset;
+}
+
+void AssetLoader::ReadJob(void* pData)
+{
+    PROFILE_FUNCTION();
+
+    MeshAsset* pAsset = (MeshAsset*)pData;
+
+    // Mesh files need no decoding, they're copied to the GPU as stored.
+    if( pAsset->m_IsMeshFile )
+    {
+        if( pAsset->m_MeshFile.Open( pAsset->m_Filename ) == false )
+        {
+            pAsset->SetState( AssetState_Failed );
+            return;
+        }
+
+        pAsset->m_MeshFile.TouchPages();
+        pAsset->SetState( AssetState_Finalizing );
+        return;
+    }
+
+    if( pAsset->m_SourceFile.Open( pAsset->m_Filename ) == false )
+    {
+        pAsset->SetState( AssetState_Failed );
+        return;
+    }
+
+    pAsset->m_SourceFile.TouchPages();
+    pAsset->SetState( AssetState_Decoding );
+    pAsset->m_pLoader->m_CPUThreads.Submit( DecodeJob, pAsset );
+}
+
+void AssetLoader::DecodeJob(void* pData)
+{
+    PROFILE_FUNCTION();
+
+    MeshAsset* pAsset = (MeshAsset*)pData;
+
+    // One thread per asset, the pool already keeps every core busy.
+    ImportedMesh importedMesh;
+    bool imported = MeshImporter::ImportFromMemory( pAsset->m_SourceFile.GetData(), pAsset->m_SourceFile.GetSize(), pAsset->m_Filename, &importedMesh, 1, &pAsset->m_ImportStats );
+    pAsset->m_SourceFile.Close();
+
+    if( imported == false )
+    {
+        pAsset->SetState( AssetState_Failed );
+        return;
+    }
+
+    MeshImporter::Bake( importedMesh, pAsset->m_pLoader->m_pInterface->GetVertexLayout(), &pAsset->m_BakedMesh );
+    importedMesh.Destroy();
+
+    pAsset->SetState( AssetState_Finalizing );
+}
+
+void AssetLoader::Finalize(MeshAsset* pAsset)
+{
+    PROFILE_FUNCTION();
+
+    assert( pAsset->GetState() == AssetState_Finalizing );
+
+    pAsset->m_pMesh = new VulkanMesh();
+
+    bool created;
+    if( pAsset->m_IsMeshFile )
+    {
+        created = pAsset->m_pMesh->Create( m_pInterface, &pAsset->m_MeshFile );
+        pAsset->m_MeshFile.Close();
+    }
+    else
+    {
+        created = MeshImporter::CreateMesh( m_pInterface, pAsset->m_BakedMesh, pAsset->m_pMesh );
+        pAsset->m_BakedMesh.Destroy();
+    }
+
+    if( created == false )
+    {
+        delete pAsset->m_pMesh;
+        pAsset->m_pMesh = nullptr;
+        pAsset->SetState( AssetState_Failed );
+        return;
+    }
+
+    pAsset->SetState( AssetState_Ready );
+}
+
+void AssetLoader::Update()
+{
+    PROFILE_FUNCTION();
+
+    uint64 bytesFinalized = 0;
+
+    for( uint32 i=0; i<m_AssetCount; i++ )
+    {
+        MeshAsset* pAsset = m_Assets[i];
+        AssetState state = pAsset->GetState();
+
+        // Released while in flight, clean up once the workers are done with it.
+        if( pAsset->m_ReleaseRequested )
+        {
+            if( state == AssetState_Finalizing || state == AssetState_Failed )
+            {
+                DestroyAsset( i );
+                i--;
+            }
+            continue;
+        }
+
+        if( state != AssetState_Finalizing )
+            continue;
+
+        uint64 size;
+        if( pAsset->m_IsMeshFile )
+        {
+            const MeshFileHeader* pHeader = pAsset->m_MeshFile.GetHeader();
+            size = (uint64)pHeader->m_VertexCount * pHeader->m_VertexStride + (uint64)pHeader->m_IndexCount * pHeader->m_IndexSize;
+        }
+        else
+        {
+            size = (uint64)pAsset->m_BakedMesh.m_VertexCount * m_pInterface->GetVertexLayout().GetStride() + (uint64)pAsset->m_BakedMesh.m_IndexCount * sizeof( uint32 );
+        }
+
+        if( bytesFinalized > 0 && bytesFinalized + size > m_FinalizeBytesPerUpdate )
+            break;
+
+        Finalize( pAsset );
+        bytesFinalized += size;
+    }
+}
+
+void AssetLoader::Wait(MeshAsset* pAsset)
+{
+    assert( pAsset->m_ReleaseRequested == false );
+
+    while( pAsset->GetState() == AssetState_Reading || pAsset->GetState() == AssetState_Decoding )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+
+    if( pAsset->GetState() == AssetState_Finalizing )
+        Finalize( pAsset );
+}
+
+void AssetLoader::Release(MeshAsset* pAsset)
+{
+    // Not owned by the table, there's nothing to free.
+    if( pAsset == &m_FailedAsset )
+        return;
+
+    AssetState state = pAsset->GetState();
+    if( state == AssetState_Reading || state == AssetState_Decoding )
+    {
+        pAsset->m_ReleaseRequested = true;
+        return;
+    }
+
+    DestroyAsset( FindAsset( pAsset ) );
+}
+
+uint32 AssetLoader::FindAsset(MeshAsset* pAsset)
+{
+    for( uint32 i=0; i<m_AssetCount; i++ )
+    {
+        if( m_Assets[i] == pAsset )
+            return i;
+    }
+
+    assert( false );
+    return UINT_MAX;
+}
+
+void AssetLoader::DestroyAsset(uint32 index)
+{
+    MeshAsset* pAsset = m_Assets[index];
+
+    // The mesh's pool ranges go through the deletion queue, so frames in flight can still draw it.
+    if( pAsset->m_pMesh )
+    {
+        pAsset->m_pMesh->Destroy();
+        delete pAsset->m_pMesh;
+    }
+
+    pAsset->m_BakedMesh.Destroy();
+    pAsset->m_MeshFile.Close();
+    pAsset->m_SourceFile.Close();
+    delete pAsset;
+
+    // Order doesn't matter, fill the gap with the last asset.
+    m_Assets[index] = m_Assets[m_AssetCount - 1];
+    m_AssetCount--;
+}
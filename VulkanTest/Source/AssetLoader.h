@@ -0,0 +1,126 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __AssetLoader_H__
+#define __AssetLoader_H__
+
+#include <atomic>
+
+#include "Math/MyTypes.h"
+#include "Mesh/MeshFile.h"
+#include "Mesh/MeshImporter.h"
+#include "MemoryMappedFile.h"
+#include "ThreadPool.h"
+
+class AssetLoader;
+class VulkanInterface;
+class VulkanMesh;
+
+static const uint32 MAX_ASSET_PATH = 260;
+static const uint32 MAX_ASSETS = 1024;
+
+enum AssetState
+{
+    AssetState_Reading,       // Queued or running on an I/O thread.
+    AssetState_Decoding,      // Queued or running on a CPU thread.
+    AssetState_Finalizing,    // Waiting for AssetLoader::Update to create GPU resources on the main thread.
+    AssetState_Ready,
+    AssetState_Failed,
+};
+
+// Handle to a mesh being loaded in the background.  Poll GetState, or block with AssetLoader::Wait.
+class MeshAsset
+{
+    friend class AssetLoader;
+
+protected:
+    AssetLoader* m_pLoader;
+    char m_Filename[MAX_ASSET_PATH];
+    std::atomic<int> m_State;
+    bool m_ReleaseRequested;
+
+    // Intermediate data, freed once the mesh is finalized.
+    bool m_IsMeshFile;
+    MeshFile m_MeshFile;
+    MemoryMappedFile m_SourceFile;
+    BakedMesh m_BakedMesh;
+    MeshImportStats m_ImportStats;
+
+    VulkanMesh* m_pMesh;
+
+protected:
+    MeshAsset();
+    virtual ~MeshAsset();
+
+    void SetState(AssetState state) { m_State.store( state, std::memory_order_release ); }
+
+public:
+    AssetState GetState() { return (AssetState)m_State.load( std::memory_order_acquire ); }
+    bool IsReady() { return GetState() == AssetState_Ready; }
+    bool HasFailed() { return GetState() == AssetState_Failed; }
+
+    const char* GetFilename() { return m_Filename; }
+    const MeshImportStats& GetImportStats() { return m_ImportStats; }
+
+    // Null until the asset is ready.
+    VulkanMesh* GetMesh() { return IsReady() ? m_pMesh : nullptr; }
+};
+
+// Loads meshes without blocking the render loop.
+// Files are read on I/O threads, parsed and baked on CPU threads, then copied to the GPU from Update on the main thread.
+// Binary mesh files skip the CPU stage.
+class AssetLoader
+{
+protected:
+    VulkanInterface* m_pInterface;
+
+    ThreadPool m_IOThreads;
+    ThreadPool m_CPUThreads;
+
+    MeshAsset* m_Assets[MAX_ASSETS];
+    uint32 m_AssetCount;
+
+    // Returned by LoadMesh when a load can't be started, always in the Failed state.
+    MeshAsset m_FailedAsset;
+
+    uint64 m_FinalizeBytesPerUpdate;
+
+protected:
+    static void ReadJob(void* pData);
+    static void DecodeJob(void* pData);
+
+    void Finalize(MeshAsset* pAsset);
+    void DestroyAsset(uint32 index);
+    uint32 FindAsset(MeshAsset* pAsset);
+
+public:
+    AssetLoader();
+    virtual ~AssetLoader();
+
+    // cpuThreadCount 0 uses one thread per hardware thread.
+    void Create(VulkanInterface* pInterface, uint32 ioThreadCount = 2, uint32 cpuThreadCount = 0);
+    // Waits for in-flight loads and frees every asset still owned by the loader.
+    void Destroy();
+
+    // .vtm mesh files are loaded as-is, anything else goes through MeshImporter.
+    // Never returns null, if the asset table is full or the name too long the returned asset has already failed.
+    MeshAsset* LoadMesh(const char* filename);
+
+    // Call once per frame from the main thread.  Finalizes loaded assets, up to about the byte budget.
+    void Update();
+    void SetFinalizeBytesPerUpdate(uint64 bytes) { m_FinalizeBytesPerUpdate = bytes; }
+
+    // Blocks until the asset is ready or has failed.
+    void Wait(MeshAsset* pAsset);
+
+    // Destroys the mesh, or cancels the load if it's still in flight.
+    void Release(MeshAsset* pAsset);
+};
+
+#endif //__AssetLoader_H__
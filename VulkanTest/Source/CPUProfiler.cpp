@@ -0,0 +1,171 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+
+#include "CPUProfiler.h"
+#include "Platform.h"
+
+struct CPUProfileEvent
+{
+    const char* m_Name;
+    int64 m_StartTime;
+    int64 m_EndTime;
+};
+
+// Written only by its own thread, read by the exporter.
+struct CPUProfileThread
+{
+    CPUProfileEvent m_Events[CPU_PROFILER_EVENTS_PER_THREAD];
+    std::atomic<uint64> m_WriteCount;
+    const char* m_Name;
+};
+
+// Threads register once, on their first zone, and their rings live until the process exits
+// since the exporter can run after a thread is gone.
+static std::atomic<CPUProfileThread*> g_pThreads[MAX_PROFILED_THREADS];
+static std::atomic<uint32> g_ThreadCount( 0 );
+static std::atomic<bool> g_Enabled( true );
+static thread_local CPUProfileThread* t_pThread = nullptr;
+static thread_local bool t_OutOfThreads = false;
+
+static CPUProfileThread* GetThreadRing()
+{
+    if( t_pThread == nullptr && t_OutOfThreads == false )
+    {
+        // Threads past the limit go unrecorded.
+        uint32 index = g_ThreadCount.fetch_add( 1 );
+        if( index >= MAX_PROFILED_THREADS )
+        {
+            t_OutOfThreads = true;
+            return nullptr;
+        }
+
+        CPUProfileThread* pThread = new CPUProfileThread;
+        pThread->m_WriteCount.store( 0 );
+        pThread->m_Name = nullptr;
+
+        // Publish the ring only once it's set up.
+        g_pThreads[index].store( pThread, std::memory_order_release );
+        t_pThread = pThread;
+    }
+
+    return t_pThread;
+}
+
+int64 CPUProfiler::GetTimeNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+void CPUProfiler::SetEnabled(bool enabled)
+{
+    g_Enabled.store( enabled, std::memory_order_relaxed );
+}
+
+bool CPUProfiler::IsEnabled()
+{
+    return g_Enabled.load( std::memory_order_relaxed );
+}
+
+void CPUProfiler::SetThreadName(const char* name)
+{
+    CPUProfileThread* pThread = GetThreadRing();
+    if( pThread )
+    {
+        pThread->m_Name = name;
+    }
+}
+
+void CPUProfiler::RecordZone(const char* name, int64 startTime, int64 endTime)
+{
+    if( g_Enabled.load( std::memory_order_relaxed ) == false )
+        return;
+
+    CPUProfileThread* pThread = GetThreadRing();
+    if( pThread == nullptr )
+        return;
+
+    uint64 writeCount = pThread->m_WriteCount.load( std::memory_order_relaxed );
+
+    CPUProfileEvent& event = pThread->m_Events[writeCount % CPU_PROFILER_EVENTS_PER_THREAD];
+    event.m_Name = name;
+    event.m_StartTime = startTime;
+    event.m_EndTime = endTime;
+
+    // The exporter only reads events below the count it sees.
+    pThread->m_WriteCount.store( writeCount + 1, std::memory_order_release );
+}
+
+bool CPUProfiler::ExportChromeTrace(const char* filename)
+{
+    FILE* filehandle;
+    errno_t error = fopen_s( &filehandle, filename, "wb" );
+    if( error != 0 || filehandle == nullptr )
+        return false;
+
+    uint32 threadCount = g_ThreadCount.load();
+    if( threadCount > MAX_PROFILED_THREADS )
+        threadCount = MAX_PROFILED_THREADS;
+
+    // Slots are claimed before they're filled, skip any that aren't published yet.
+    int64 baseTime = INT64_MAX;
+    for( uint32 t=0; t<threadCount; t++ )
+    {
+        CPUProfileThread* pThread = g_pThreads[t].load( std::memory_order_acquire );
+        if( pThread == nullptr )
+            continue;
+
+        uint64 writeCount = pThread->m_WriteCount.load( std::memory_order_acquire );
+        uint64 first = writeCount > CPU_PROFILER_EVENTS_PER_THREAD ? writeCount - CPU_PROFILER_EVENTS_PER_THREAD : 0;
+        for( uint64 i=first; i<writeCount; i++ )
+        {
+            int64 start = pThread->m_Events[i % CPU_PROFILER_EVENTS_PER_THREAD].m_StartTime;
+            if( start < baseTime )
+                baseTime = start;
+        }
+    }
+
+    // Complete events ("X") with microsecond timestamps relative to the first zone.
+    bool success = fprintf( filehandle, "{\"traceEvents\":[\n" ) > 0;
+    bool first = true;
+    for( uint32 t=0; t<threadCount; t++ )
+    {
+        CPUProfileThread* pThread = g_pThreads[t].load( std::memory_order_acquire );
+        if( pThread == nullptr )
+            continue;
+
+        if( pThread->m_Name )
+        {
+            success &= fprintf( filehandle, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                                first ? "" : ",\n", t, pThread->m_Name ) > 0;
+            first = false;
+        }
+
+        uint64 writeCount = pThread->m_WriteCount.load( std::memory_order_acquire );
+        uint64 firstEvent = writeCount > CPU_PROFILER_EVENTS_PER_THREAD ? writeCount - CPU_PROFILER_EVENTS_PER_THREAD : 0;
+        for( uint64 i=firstEvent; i<writeCount; i++ )
+        {
+            CPUProfileEvent& event = pThread->m_Events[i % CPU_PROFILER_EVENTS_PER_THREAD];
+
+            success &= fprintf( filehandle, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                                first ? "" : ",\n", event.m_Name, t,
+                                (event.m_StartTime - baseTime) / 1000.0, (event.m_EndTime - event.m_StartTime) / 1000.0 ) > 0;
+            first = false;
+        }
+    }
+    success &= fprintf( filehandle, "\n]}\n" ) > 0;
+
+    fclose( filehandle );
+
+    return success;
+}
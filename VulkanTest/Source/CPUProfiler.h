@@ -0,0 +1,70 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __CPUProfiler_H__
+#define __CPUProfiler_H__
+
+#include "Math/MyTypes.h"
+
+// Build with CPU_PROFILER_ENABLED=0 to compile every zone out.
+#ifndef CPU_PROFILER_ENABLED
+#define CPU_PROFILER_ENABLED 1
+#endif
+
+static const uint32 MAX_PROFILED_THREADS = 64;
+static const uint32 CPU_PROFILER_EVENTS_PER_THREAD = 16384;
+
+// Records timed zones from any thread into per-thread rings, newest events overwrite the oldest.
+// Recording a zone is a clock read at each end and one store into the thread's own ring, no locks or atomics
+// beyond a release of the write count, so zones are cheap enough to leave in shipping code paths.
+// Names must stay valid until exported, pass string literals.
+class CPUProfiler
+{
+public:
+    static int64 GetTimeNanoseconds();
+
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled();
+
+    // Labels the calling thread in exported traces.
+    static void SetThreadName(const char* name);
+
+    static void RecordZone(const char* name, int64 startTime, int64 endTime);
+
+    // Writes every recorded zone in Chrome's trace event format, open it with chrome://tracing or Perfetto.
+    // Zones recorded while exporting may come out torn, export while other threads are quiet.
+    static bool ExportChromeTrace(const char* filename);
+};
+
+// Times the enclosing block.
+class CPUProfileZone
+{
+protected:
+    const char* m_Name;
+    int64 m_StartTime;
+
+public:
+    CPUProfileZone(const char* name) { m_Name = name; m_StartTime = CPUProfiler::GetTimeNanoseconds(); }
+    ~CPUProfileZone() { CPUProfiler::RecordZone( m_Name, m_StartTime, CPUProfiler::GetTimeNanoseconds() ); }
+};
+
+#define CPU_PROFILER_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILER_CONCAT(a, b) CPU_PROFILER_CONCAT_INNER(a, b)
+
+#if CPU_PROFILER_ENABLED
+#define PROFILE_SCOPE(name) CPUProfileZone CPU_PROFILER_CONCAT( profileZone, __LINE__ )( name )
+#define PROFILE_FUNCTION() PROFILE_SCOPE( __FUNCTION__ )
+#define PROFILE_THREAD_NAME(name) CPUProfiler::SetThreadName( name )
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD_NAME(name)
+#endif
+
+#endif //__CPUProfiler_H__
@@ -0,0 +1,251 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <chrono>
+#include <thread>
+
+#include "CPUProfiler.h"
+#include "FramePacer.h"
+#include "VulkanTimelineSemaphore.h"
+
+// How much earlier than predicted a frame is submitted, covers noise in the estimates.
+static const int64 DEFAULT_SAFETY_MARGIN = 500000; // 0.5ms.
+
+// Below this a sleep is replaced with yields, OS sleeps can overshoot by a millisecond or more.
+static const int64 SPIN_THRESHOLD = 2000000; // 2ms.
+
+FramePacer::FramePacer()
+{
+    m_pTimeline = nullptr;
+
+    m_Mode = FramePacingMode_Off;
+    m_MaxQueuedFrames = 2;
+    m_SafetyMargin = DEFAULT_SAFETY_MARGIN;
+
+    for( uint32 i=0; i<MAX_PACED_FRAMES; i++ )
+    {
+        m_Frames[i].m_StartTime = 0;
+        m_Frames[i].m_SubmitTime = 0;
+        m_Frames[i].m_CompleteTime = 0;
+        m_Frames[i].m_SubmitValue = 0;
+    }
+    m_FrameCount = 0;
+    m_OldestPending = 0;
+    m_FrameOpen = false;
+
+    m_CPUFrameTime = 0;
+    m_GPUFrameTime = 0;
+    m_LastSleepTime = 0;
+
+    m_LatencyCount = 0;
+    m_LatencyNext = 0;
+}
+
+FramePacer::~FramePacer()
+{
+}
+
+void FramePacer::Init(VulkanTimelineSemaphore* pTimeline)
+{
+    assert( pTimeline != nullptr );
+
+    m_pTimeline = pTimeline;
+}
+
+void FramePacer::SetMode(FramePacingMode mode, uint32 maxQueuedFrames)
+{
+    assert( maxQueuedFrames >= 1 && maxQueuedFrames < MAX_PACED_FRAMES );
+
+    m_Mode = mode;
+    m_MaxQueuedFrames = maxQueuedFrames;
+}
+
+int64 FramePacer::GetTimeNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+void FramePacer::BeginFrame()
+{
+    PROFILE_FUNCTION();
+
+    assert( m_pTimeline != nullptr );
+
+    int64 now = GetTimeNanoseconds();
+    m_LastSleepTime = 0;
+
+    ObserveCompletions( now );
+
+    if( m_Mode != FramePacingMode_Off && m_FrameCount >= m_MaxQueuedFrames )
+    {
+        // Block until only m_MaxQueuedFrames - 1 frames are left on the GPU.
+        uint64 waitFrame = m_FrameCount - m_MaxQueuedFrames;
+        FrameRecord* pWaitFrame = GetFrame( waitFrame );
+
+        if( waitFrame >= m_OldestPending )
+        {
+            m_pTimeline->Wait( pWaitFrame->m_SubmitValue );
+            now = GetTimeNanoseconds();
+
+            // Older frames finished at some point before this one, only the waited frame's time is exact.
+            while( m_OldestPending < waitFrame )
+            {
+                OnFrameComplete( GetFrame( m_OldestPending ), now, false );
+                m_OldestPending++;
+            }
+            OnFrameComplete( pWaitFrame, now, true );
+            m_OldestPending++;
+        }
+
+        if( m_Mode == FramePacingMode_LowLatency && m_GPUFrameTime > 0 )
+        {
+            // Predict when the GPU runs out of queued work, each frame starts once it's submitted and the previous one is done.
+            int64 gpuIdleTime = pWaitFrame->m_CompleteTime;
+            for( uint64 frame=waitFrame+1; frame<m_FrameCount; frame++ )
+            {
+                FrameRecord* pFrame = GetFrame( frame );
+                if( pFrame->m_SubmitTime > gpuIdleTime )
+                    gpuIdleTime = pFrame->m_SubmitTime;
+                gpuIdleTime += m_GPUFrameTime;
+            }
+
+            // Submit right before then, but never sleep longer than the queued frames could take, in case the estimates are stale.
+            int64 startTime = gpuIdleTime - m_CPUFrameTime - m_SafetyMargin;
+            int64 maxStartTime = now + m_GPUFrameTime * m_MaxQueuedFrames;
+            if( startTime > maxStartTime )
+                startTime = maxStartTime;
+
+            if( startTime > now )
+            {
+                SleepUntil( startTime );
+                m_LastSleepTime = startTime - now;
+                now = GetTimeNanoseconds();
+            }
+        }
+    }
+
+    // If the ring wrapped, frames that old are dropped from the stats.
+    if( m_FrameCount - m_OldestPending >= MAX_PACED_FRAMES )
+    {
+        m_OldestPending = m_FrameCount - MAX_PACED_FRAMES + 1;
+    }
+
+    FrameRecord* pFrame = GetFrame( m_FrameCount );
+    pFrame->m_StartTime = now;
+    pFrame->m_SubmitTime = 0;
+    pFrame->m_CompleteTime = 0;
+    pFrame->m_SubmitValue = 0;
+
+    m_FrameOpen = true;
+}
+
+void FramePacer::EndFrame(uint64 submitValue)
+{
+    assert( m_FrameOpen );
+
+    FrameRecord* pFrame = GetFrame( m_FrameCount );
+    pFrame->m_SubmitTime = GetTimeNanoseconds();
+    pFrame->m_SubmitValue = submitValue;
+
+    // Exponential moving averages, 1/8th weight for the new sample.
+    int64 cpuTime = pFrame->m_SubmitTime - pFrame->m_StartTime;
+    m_CPUFrameTime = m_CPUFrameTime == 0 ? cpuTime : m_CPUFrameTime + (cpuTime - m_CPUFrameTime) / 8;
+
+    m_FrameCount++;
+    m_FrameOpen = false;
+}
+
+void FramePacer::ObserveCompletions(int64 now)
+{
+    // Frames that finished since the last look are stamped with the current time, an upper bound.
+    while( m_OldestPending < m_FrameCount )
+    {
+        FrameRecord* pFrame = GetFrame( m_OldestPending );
+        if( m_pTimeline->IsComplete( pFrame->m_SubmitValue ) == false )
+            break;
+
+        OnFrameComplete( pFrame, now, false );
+        m_OldestPending++;
+    }
+}
+
+void FramePacer::OnFrameComplete(FrameRecord* pFrame, int64 completeTime, bool accurate)
+{
+    pFrame->m_CompleteTime = completeTime;
+
+    // The GPU time is only measurable when the CPU was actually waiting on it.
+    if( accurate )
+    {
+        int64 gpuStartTime = pFrame->m_SubmitTime;
+        if( m_OldestPending > 0 )
+        {
+            FrameRecord* pPrevious = GetFrame( m_OldestPending - 1 );
+            if( pPrevious->m_CompleteTime > gpuStartTime )
+                gpuStartTime = pPrevious->m_CompleteTime;
+        }
+
+        int64 gpuTime = completeTime - gpuStartTime;
+        m_GPUFrameTime = m_GPUFrameTime == 0 ? gpuTime : m_GPUFrameTime + (gpuTime - m_GPUFrameTime) / 8;
+    }
+
+    m_LatencyHistory[m_LatencyNext] = (completeTime - pFrame->m_StartTime) / 1000000.0f;
+    m_LatencyNext = (m_LatencyNext + 1) % FRAME_LATENCY_HISTORY;
+    if( m_LatencyCount < FRAME_LATENCY_HISTORY )
+        m_LatencyCount++;
+}
+
+void FramePacer::SleepUntil(int64 time)
+{
+    while( true )
+    {
+        int64 remaining = time - GetTimeNanoseconds();
+        if( remaining <= 0 )
+            break;
+
+        if( remaining > SPIN_THRESHOLD )
+            std::this_thread::sleep_for( std::chrono::nanoseconds( remaining - SPIN_THRESHOLD ) );
+        else
+            std::this_thread::yield();
+    }
+}
+
+void FramePacer::GetLatencyStats(FrameLatencyStats* pStats)
+{
+    assert( pStats != nullptr );
+
+    pStats->m_LastMS = 0;
+    pStats->m_AverageMS = 0;
+    pStats->m_MinMS = 0;
+    pStats->m_MaxMS = 0;
+    pStats->m_CPUFrameMS = m_CPUFrameTime / 1000000.0f;
+    pStats->m_GPUFrameMS = m_GPUFrameTime / 1000000.0f;
+    pStats->m_SleepMS = m_LastSleepTime / 1000000.0f;
+    pStats->m_SampleCount = m_LatencyCount;
+
+    if( m_LatencyCount == 0 )
+        return;
+
+    pStats->m_LastMS = m_LatencyHistory[(m_LatencyNext + FRAME_LATENCY_HISTORY - 1) % FRAME_LATENCY_HISTORY];
+    pStats->m_MinMS = m_LatencyHistory[0];
+    pStats->m_MaxMS = m_LatencyHistory[0];
+
+    float total = 0;
+    for( uint32 i=0; i<m_LatencyCount; i++ )
+    {
+        float latency = m_LatencyHistory[i];
+
+        total += latency;
+        if( latency < pStats->m_MinMS )
+            pStats->m_MinMS = latency;
+        if( latency > pStats->m_MaxMS )
+            pStats->m_MaxMS = latency;
+    }
+    pStats->m_AverageMS = total / m_LatencyCount;
+}
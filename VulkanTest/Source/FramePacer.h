@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __FramePacer_H__
+#define __FramePacer_H__
+
+#include "Math/MyTypes.h"
+
+class VulkanTimelineSemaphore;
+
+static const int MAX_PACED_FRAMES = 8;
+static const int FRAME_LATENCY_HISTORY = 128;
+
+enum FramePacingMode
+{
+    FramePacingMode_Off,        // Only the per-image waits in VulkanInterface::Render limit the CPU.
+    FramePacingMode_MaxQueued,  // Block until at most m_MaxQueuedFrames - 1 frames are still on the GPU.
+    FramePacingMode_LowLatency, // As above, then sleep so the frame is submitted just as the GPU runs out of work.
+};
+
+// Latency in milliseconds from BeginFrame (where input should be read) until the GPU finished the frame.
+// Presentation adds up to one refresh interval on top, that isn't visible to the application.
+struct FrameLatencyStats
+{
+    float m_LastMS;
+    float m_AverageMS;
+    float m_MinMS;
+    float m_MaxMS;
+    float m_CPUFrameMS;     // Estimated time from BeginFrame to submit.
+    float m_GPUFrameMS;     // Estimated time the GPU spends on a frame.
+    float m_SleepMS;        // Time BeginFrame spent throttling last frame.
+    uint32 m_SampleCount;
+};
+
+// Decides when the CPU starts a frame.  The GPU only needs a new frame once it's done with the previous one,
+// so starting earlier just leaves the frame (and the input it was built from) sitting in a queue.
+// In low latency mode the pacer predicts when the GPU will go idle from measured CPU and GPU frame times and
+// delays the start so the submit lands just before that point.
+class FramePacer
+{
+protected:
+    struct FrameRecord
+    {
+        int64 m_StartTime;      // Nanoseconds.
+        int64 m_SubmitTime;
+        int64 m_CompleteTime;   // 0 until the completion was observed.
+        uint64 m_SubmitValue;   // Graphics timeline value of the frame's submission.
+    };
+
+    VulkanTimelineSemaphore* m_pTimeline;
+
+    FramePacingMode m_Mode;
+    uint32 m_MaxQueuedFrames;
+    int64 m_SafetyMargin;
+
+    FrameRecord m_Frames[MAX_PACED_FRAMES];
+    uint64 m_FrameCount;        // Frames submitted.
+    uint64 m_OldestPending;     // First submitted frame whose completion hasn't been observed.
+    bool m_FrameOpen;
+
+    // Running estimates, nanoseconds.
+    int64 m_CPUFrameTime;
+    int64 m_GPUFrameTime;
+    int64 m_LastSleepTime;
+
+    float m_LatencyHistory[FRAME_LATENCY_HISTORY];
+    uint32 m_LatencyCount;
+    uint32 m_LatencyNext;
+
+protected:
+    FrameRecord* GetFrame(uint64 frame) { return &m_Frames[frame % MAX_PACED_FRAMES]; }
+
+    void ObserveCompletions(int64 now);
+    void OnFrameComplete(FrameRecord* pFrame, int64 completeTime, bool accurate);
+    void SleepUntil(int64 time);
+
+public:
+    FramePacer();
+    virtual ~FramePacer();
+
+    void Init(VulkanTimelineSemaphore* pTimeline);
+
+    // maxQueuedFrames is how many frames can be on the GPU once the new one is submitted.
+    // 1 keeps latency lowest but leaves the GPU idle while the CPU builds the frame, 2 overlaps the two.
+    void SetMode(FramePacingMode mode, uint32 maxQueuedFrames = 2);
+    FramePacingMode GetMode() { return m_Mode; }
+    bool IsFrameOpen() { return m_FrameOpen; }
+
+    // Call before reading input.  Blocks according to the pacing mode.
+    void BeginFrame();
+
+    // Call after the frame's graphics submission, or CancelFrame if nothing was submitted.
+    void EndFrame(uint64 submitValue);
+    void CancelFrame() { m_FrameOpen = false; }
+
+    void GetLatencyStats(FrameLatencyStats* pStats);
+
+    static int64 GetTimeNanoseconds();
+};
+
+#endif //__FramePacer_H__
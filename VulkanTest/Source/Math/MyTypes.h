@@ -10,22 +10,7 @@
 #ifndef __MYTYPES_H__
 #define __MYTYPES_H__
 
-#if 1 //MYFW_WINDOWS
-
-typedef __int32 int32;
-typedef unsigned __int32 uint32;
-typedef __int64 int64;
-typedef unsigned __int64 uint64;
-
-#elif MYFW_NACL || MYFW_LINUX
-
-typedef __int32_t int32;
-typedef __uint32_t uint32;
-typedef __int64_t int64;
-typedef __uint64_t uint64;
-
-#elif MYFW_BLACKBERRY10 || MYFW_EMSCRIPTEN
-
+// Fixed width types come from stdint on every platform, MSVC and gcc/clang alike.
 #include <stdint.h>
 
 typedef int32_t int32;
@@ -33,15 +18,6 @@ typedef uint32_t uint32;
 typedef int64_t int64;
 typedef uint64_t uint64;
 
-#else
-
-typedef int32_t int32;
-typedef uint32_t uint32;
-typedef int64_t int64;
-typedef uint64_t uint64;
-
-#endif
-
 void TestMyTypeSizes();
 
 #endif //__MYTYPES_H__
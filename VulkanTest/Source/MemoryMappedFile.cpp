@@ -0,0 +1,150 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#if _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <assert.h>
+
+#include "MemoryMappedFile.h"
+
+MemoryMappedFile::MemoryMappedFile()
+{
+    NullEverything();
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    Close();
+}
+
+void MemoryMappedFile::NullEverything()
+{
+    m_FileHandle = nullptr;
+    m_MappingHandle = nullptr;
+    m_pData = nullptr;
+    m_Size = 0;
+}
+
+#if _WIN32
+bool MemoryMappedFile::Open(const char* filename)
+{
+    assert( m_pData == nullptr );
+
+    // Files are read front to back, let the cache manager read ahead aggressively.
+    HANDLE fileHandle = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+    if( fileHandle == INVALID_HANDLE_VALUE )
+        return false;
+
+    LARGE_INTEGER size;
+    if( GetFileSizeEx( fileHandle, &size ) == FALSE || size.QuadPart == 0 )
+    {
+        // Empty files can't be mapped.
+        CloseHandle( fileHandle );
+        return false;
+    }
+
+    HANDLE mappingHandle = CreateFileMappingA( fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if( mappingHandle == nullptr )
+    {
+        CloseHandle( fileHandle );
+        return false;
+    }
+
+    const void* pData = MapViewOfFile( mappingHandle, FILE_MAP_READ, 0, 0, 0 );
+    if( pData == nullptr )
+    {
+        CloseHandle( mappingHandle );
+        CloseHandle( fileHandle );
+        return false;
+    }
+
+    m_FileHandle = fileHandle;
+    m_MappingHandle = mappingHandle;
+    m_pData = pData;
+    m_Size = (uint64)size.QuadPart;
+
+    return true;
+}
+
+void MemoryMappedFile::Close()
+{
+    if( m_pData == nullptr )
+        return;
+
+    UnmapViewOfFile( m_pData );
+    CloseHandle( m_MappingHandle );
+    CloseHandle( m_FileHandle );
+
+    NullEverything();
+}
+
+#else
+bool MemoryMappedFile::Open(const char* filename)
+{
+    assert( m_pData == nullptr );
+
+    int fileDescriptor = open( filename, O_RDONLY );
+    if( fileDescriptor == -1 )
+        return false;
+
+    struct stat fileInfo;
+    if( fstat( fileDescriptor, &fileInfo ) != 0 || fileInfo.st_size == 0 )
+    {
+        // Empty files can't be mapped.
+        close( fileDescriptor );
+        return false;
+    }
+
+    void* pData = mmap( nullptr, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0 );
+
+    // The mapping keeps the file open.
+    close( fileDescriptor );
+
+    if( pData == MAP_FAILED )
+        return false;
+
+    // Files are read front to back, let the kernel read ahead aggressively.
+    madvise( pData, (size_t)fileInfo.st_size, MADV_SEQUENTIAL );
+
+    m_pData = pData;
+    m_Size = (uint64)fileInfo.st_size;
+
+    return true;
+}
+
+void MemoryMappedFile::Close()
+{
+    if( m_pData == nullptr )
+        return;
+
+    munmap( (void*)m_pData, (size_t)m_Size );
+
+    NullEverything();
+}
+
+#endif //_WIN32
+
+void MemoryMappedFile::TouchPages()
+{
+    static const uint64 pageSize = 4096;
+
+    const volatile unsigned char* pBytes = (const volatile unsigned char*)m_pData;
+    unsigned char sum = 0;
+    for( uint64 offset=0; offset<m_Size; offset+=pageSize )
+    {
+        sum += pBytes[offset];
+    }
+    (void)sum;
+}
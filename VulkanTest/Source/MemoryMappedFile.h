@@ -0,0 +1,42 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __MemoryMappedFile_H__
+#define __MemoryMappedFile_H__
+
+#include "Math/MyTypes.h"
+
+// Read-only view of a whole file.  Pages are faulted in by the OS as they're touched, nothing is copied on open.
+class MemoryMappedFile
+{
+protected:
+    void* m_FileHandle;    // Windows only, POSIX mappings don't need the file kept open.
+    void* m_MappingHandle; // Windows only.
+    const void* m_pData;
+    uint64 m_Size;
+
+protected:
+    void NullEverything();
+
+public:
+    MemoryMappedFile();
+    virtual ~MemoryMappedFile();
+
+    bool Open(const char* filename);
+    void Close();
+
+    // Reads one byte per page so the disk reads happen now, on the calling thread, instead of on first use.
+    void TouchPages();
+
+    bool IsOpen() { return m_pData != nullptr; }
+    const void* GetData() { return m_pData; }
+    uint64 GetSize() { return m_Size; }
+};
+
+#endif //__MemoryMappedFile_H__
@@ -0,0 +1,299 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Math/MyTypes.h"
+
+#include "JSONReader.h"
+
+// Guards against stack overflow on hostile input.
+static const int JSON_MAX_DEPTH = 64;
+
+JSONReader::JSONReader()
+{
+    m_Values = nullptr;
+    m_ValueCount = 0;
+    m_ValueCapacity = 0;
+
+    m_pCurrent = nullptr;
+    m_pEnd = nullptr;
+}
+
+JSONReader::~JSONReader()
+{
+    Destroy();
+}
+
+void JSONReader::Destroy()
+{
+    delete[] m_Values;
+
+    m_Values = nullptr;
+    m_ValueCount = 0;
+    m_ValueCapacity = 0;
+}
+
+bool JSONReader::Parse(const char* text, uint32 length)
+{
+    assert( m_Values == nullptr );
+
+    m_ValueCapacity = 256;
+    m_Values = new JSONValue[m_ValueCapacity];
+    m_ValueCount = 0;
+
+    m_pCurrent = text;
+    m_pEnd = text + length;
+
+    if( ParseValue( 0 ) == INVALID_VALUE )
+    {
+        Destroy();
+        return false;
+    }
+
+    // Only whitespace is allowed after the root.
+    SkipWhitespace();
+    if( m_pCurrent != m_pEnd && *m_pCurrent != 0 )
+    {
+        Destroy();
+        return false;
+    }
+
+    return true;
+}
+
+uint32 JSONReader::AddValue(JSONType type)
+{
+    if( m_ValueCount == m_ValueCapacity )
+    {
+        JSONValue* newValues = new JSONValue[m_ValueCapacity * 2];
+        memcpy( newValues, m_Values, sizeof( JSONValue ) * m_ValueCount );
+        delete[] m_Values;
+        m_Values = newValues;
+        m_ValueCapacity *= 2;
+    }
+
+    JSONValue& value = m_Values[m_ValueCount];
+    memset( &value, 0, sizeof( JSONValue ) );
+    value.m_Type = type;
+    value.m_FirstChild = INVALID_VALUE;
+    value.m_NextSibling = INVALID_VALUE;
+
+    return m_ValueCount++;
+}
+
+void JSONReader::SkipWhitespace()
+{
+    while( m_pCurrent < m_pEnd && (*m_pCurrent == ' ' || *m_pCurrent == '\t' || *m_pCurrent == '\n' || *m_pCurrent == '\r') )
+    {
+        m_pCurrent++;
+    }
+}
+
+bool JSONReader::ParseString(const char** ppString, uint32* pLength)
+{
+    if( m_pCurrent >= m_pEnd || *m_pCurrent != '"' )
+        return false;
+
+    m_pCurrent++;
+    const char* pStart = m_pCurrent;
+    while( m_pCurrent < m_pEnd && *m_pCurrent != '"' )
+    {
+        // Skip escaped characters, including escaped quotes.
+        if( *m_pCurrent == '\\' )
+            m_pCurrent++;
+        m_pCurrent++;
+    }
+
+    if( m_pCurrent >= m_pEnd )
+        return false;
+
+    *ppString = pStart;
+    *pLength = (uint32)(m_pCurrent - pStart);
+    m_pCurrent++;
+
+    return true;
+}
+
+uint32 JSONReader::ParseValue(int depth)
+{
+    if( depth > JSON_MAX_DEPTH )
+        return INVALID_VALUE;
+
+    SkipWhitespace();
+    if( m_pCurrent >= m_pEnd )
+        return INVALID_VALUE;
+
+    char c = *m_pCurrent;
+
+    if( c == '{' || c == '[' )
+    {
+        bool isObject = c == '{';
+        char closing = isObject ? '}' : ']';
+
+        uint32 index = AddValue( isObject ? JSONType_Object : JSONType_Array );
+        m_pCurrent++;
+
+        SkipWhitespace();
+        if( m_pCurrent < m_pEnd && *m_pCurrent == closing )
+        {
+            m_pCurrent++;
+            return index;
+        }
+
+        uint32 previousChild = INVALID_VALUE;
+        while( true )
+        {
+            const char* key = nullptr;
+            uint32 keyLength = 0;
+            if( isObject )
+            {
+                SkipWhitespace();
+                if( ParseString( &key, &keyLength ) == false )
+                    return INVALID_VALUE;
+
+                SkipWhitespace();
+                if( m_pCurrent >= m_pEnd || *m_pCurrent != ':' )
+                    return INVALID_VALUE;
+                m_pCurrent++;
+            }
+
+            uint32 child = ParseValue( depth + 1 );
+            if( child == INVALID_VALUE )
+                return INVALID_VALUE;
+
+            // m_Values can be reallocated by ParseValue, so only index it afterwards.
+            m_Values[child].m_Key = key;
+            m_Values[child].m_KeyLength = keyLength;
+
+            if( previousChild == INVALID_VALUE )
+                m_Values[index].m_FirstChild = child;
+            else
+                m_Values[previousChild].m_NextSibling = child;
+            m_Values[index].m_ChildCount++;
+            previousChild = child;
+
+            SkipWhitespace();
+            if( m_pCurrent >= m_pEnd )
+                return INVALID_VALUE;
+
+            if( *m_pCurrent == ',' )
+            {
+                m_pCurrent++;
+                continue;
+            }
+
+            if( *m_pCurrent == closing )
+            {
+                m_pCurrent++;
+                return index;
+            }
+
+            return INVALID_VALUE;
+        }
+    }
+
+    if( c == '"' )
+    {
+        uint32 index = AddValue( JSONType_String );
+        if( ParseString( &m_Values[index].m_String, &m_Values[index].m_StringLength ) == false )
+            return INVALID_VALUE;
+        return index;
+    }
+
+    if( c == '-' || (c >= '0' && c <= '9') )
+    {
+        // strtod needs a terminated string, numbers are short so copy them out.
+        char buffer[64];
+        uint32 length = 0;
+        while( m_pCurrent < m_pEnd && length < sizeof( buffer ) - 1 && strchr( "+-.eE0123456789", *m_pCurrent ) && *m_pCurrent != 0 )
+        {
+            buffer[length++] = *m_pCurrent++;
+        }
+        buffer[length] = 0;
+
+        uint32 index = AddValue( JSONType_Number );
+        m_Values[index].m_Number = strtod( buffer, nullptr );
+        return index;
+    }
+
+    // Literals.
+    static const char* literals[] = { "true", "false", "null" };
+    for( int i=0; i<3; i++ )
+    {
+        size_t length = strlen( literals[i] );
+        if( (size_t)(m_pEnd - m_pCurrent) >= length && strncmp( m_pCurrent, literals[i], length ) == 0 )
+        {
+            m_pCurrent += length;
+
+            uint32 index = AddValue( i == 2 ? JSONType_Null : JSONType_Bool );
+            m_Values[index].m_Number = i == 0 ? 1.0 : 0.0;
+            return index;
+        }
+    }
+
+    return INVALID_VALUE;
+}
+
+uint32 JSONReader::GetMember(uint32 objectIndex, const char* key)
+{
+    if( objectIndex == INVALID_VALUE || m_Values[objectIndex].m_Type != JSONType_Object )
+        return INVALID_VALUE;
+
+    size_t keyLength = strlen( key );
+    for( uint32 child = m_Values[objectIndex].m_FirstChild; child != INVALID_VALUE; child = m_Values[child].m_NextSibling )
+    {
+        if( m_Values[child].m_KeyLength == keyLength && strncmp( m_Values[child].m_Key, key, keyLength ) == 0 )
+            return child;
+    }
+
+    return INVALID_VALUE;
+}
+
+uint32 JSONReader::GetElement(uint32 arrayIndex, uint32 element)
+{
+    if( arrayIndex == INVALID_VALUE || m_Values[arrayIndex].m_Type != JSONType_Array )
+        return INVALID_VALUE;
+
+    uint32 child = m_Values[arrayIndex].m_FirstChild;
+    for( uint32 i=0; i<element && child != INVALID_VALUE; i++ )
+    {
+        child = m_Values[child].m_NextSibling;
+    }
+
+    return child;
+}
+
+uint32 JSONReader::GetArraySize(uint32 arrayIndex)
+{
+    if( arrayIndex == INVALID_VALUE || m_Values[arrayIndex].m_Type != JSONType_Array )
+        return 0;
+
+    return m_Values[arrayIndex].m_ChildCount;
+}
+
+double JSONReader::GetNumber(uint32 objectIndex, const char* key, double defaultValue)
+{
+    uint32 member = GetMember( objectIndex, key );
+    if( member == INVALID_VALUE || m_Values[member].m_Type != JSONType_Number )
+        return defaultValue;
+
+    return m_Values[member].m_Number;
+}
+
+bool JSONReader::StringEquals(uint32 index, const char* string)
+{
+    if( index == INVALID_VALUE || m_Values[index].m_Type != JSONType_String )
+        return false;
+
+    size_t length = strlen( string );
+    return m_Values[index].m_StringLength == length && strncmp( m_Values[index].m_String, string, length ) == 0;
+}
@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __JSONReader_H__
+#define __JSONReader_H__
+
+#include "Math/MyTypes.h"
+
+enum JSONType
+{
+    JSONType_Null,
+    JSONType_Bool,
+    JSONType_Number,
+    JSONType_String,
+    JSONType_Array,
+    JSONType_Object,
+};
+
+// Values are stored in one flat array, children are linked through m_NextSibling.
+// Strings and keys point into the source text and aren't unescaped, which is enough for glTF.
+struct JSONValue
+{
+    JSONType m_Type;
+    double m_Number; // Also 0 or 1 for bools.
+
+    const char* m_String;
+    uint32 m_StringLength;
+
+    const char* m_Key; // Set for object members.
+    uint32 m_KeyLength;
+
+    uint32 m_FirstChild;
+    uint32 m_ChildCount;
+    uint32 m_NextSibling;
+};
+
+// Minimal read-only JSON parser.  The source text must outlive the reader.
+class JSONReader
+{
+public:
+    static const uint32 INVALID_VALUE = 0xFFFFFFFF;
+
+protected:
+    JSONValue* m_Values;
+    uint32 m_ValueCount;
+    uint32 m_ValueCapacity;
+
+    const char* m_pCurrent;
+    const char* m_pEnd;
+
+protected:
+    uint32 AddValue(JSONType type);
+    void SkipWhitespace();
+    bool ParseString(const char** ppString, uint32* pLength);
+    uint32 ParseValue(int depth);
+
+public:
+    JSONReader();
+    virtual ~JSONReader();
+
+    // Returns false on malformed input.  The root value is index 0.
+    bool Parse(const char* text, uint32 length);
+    void Destroy();
+
+    const JSONValue& GetValue(uint32 index) { return m_Values[index]; }
+
+    // Lookups return INVALID_VALUE if the value is missing or has the wrong type.
+    uint32 GetMember(uint32 objectIndex, const char* key);
+    uint32 GetElement(uint32 arrayIndex, uint32 element);
+    uint32 GetArraySize(uint32 arrayIndex);
+
+    double GetNumber(uint32 objectIndex, const char* key, double defaultValue);
+    bool StringEquals(uint32 index, const char* string);
+};
+
+#endif //__JSONReader_H__
@@ -0,0 +1,226 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+
+#include "Mesh/MeshFile.h"
+#include "Platform.h"
+#include "VulkanGeometryPool.h"
+
+static uint64 AlignFileOffset(uint64 offset)
+{
+    return (offset + MESH_FILE_ALIGNMENT - 1) & ~(uint64)(MESH_FILE_ALIGNMENT - 1);
+}
+
+MeshFile::MeshFile()
+{
+    m_pHeader = nullptr;
+}
+
+MeshFile::~MeshFile()
+{
+    Close();
+}
+
+bool MeshFile::Open(const char* filename)
+{
+    assert( m_pHeader == nullptr );
+
+    if( m_File.Open( filename ) == false )
+        return false;
+
+    const MeshFileHeader* pHeader = (const MeshFileHeader*)m_File.GetData();
+    uint64 fileSize = m_File.GetSize();
+
+    // Check the header before trusting any offsets in it.
+    bool valid = fileSize >= sizeof( MeshFileHeader )
+              && pHeader->m_Magic == MESH_FILE_MAGIC
+              && pHeader->m_Version == MESH_FILE_VERSION
+              && pHeader->m_HeaderSize == sizeof( MeshFileHeader );
+
+    if( valid )
+    {
+        for( int i=0; i<VertexAttribute_Count; i++ )
+        {
+            if( pHeader->m_VertexFormats[i] >= VertexAttributeFormat_Count )
+                valid = false;
+        }
+
+        // Same restrictions as VertexLayout::Create.
+        if( pHeader->m_VertexFormats[VertexAttribute_Position] == VertexAttributeFormat_None )
+            valid = false;
+        if( pHeader->m_VertexFormats[VertexAttribute_Color] != VertexAttributeFormat_None && pHeader->m_VertexFormats[VertexAttribute_Color] != VertexAttributeFormat_UNorm8x4 )
+            valid = false;
+    }
+
+    if( valid )
+    {
+        VertexLayout layout;
+        layout.Create( (VertexAttributeFormat)pHeader->m_VertexFormats[VertexAttribute_Position], (VertexAttributeFormat)pHeader->m_VertexFormats[VertexAttribute_Color],
+                       (VertexAttributeFormat)pHeader->m_VertexFormats[VertexAttribute_Normal], (VertexAttributeFormat)pHeader->m_VertexFormats[VertexAttribute_UV] );
+
+        // Both factors are 32-bit, so the 64-bit products can't wrap.
+        // The geometry pool takes sizes in 32-bit bytes though, so anything larger is rejected.
+        uint64 vertexDataSize = (uint64)pHeader->m_VertexCount * pHeader->m_VertexStride;
+        uint64 indexDataSize = (uint64)pHeader->m_IndexCount * pHeader->m_IndexSize;
+
+        // Offsets come straight from the file, compare against the space left after them so offset + size can't wrap.
+        valid = layout.GetStride() == pHeader->m_VertexStride
+             && (pHeader->m_IndexSize == 2 || pHeader->m_IndexSize == 4)
+             && (pHeader->m_IndexSize == 4 || pHeader->m_VertexCount <= 65536)
+             && vertexDataSize <= UINT32_MAX
+             && indexDataSize <= UINT32_MAX
+             && pHeader->m_VertexDataOffset % MESH_FILE_ALIGNMENT == 0
+             && pHeader->m_IndexDataOffset % MESH_FILE_ALIGNMENT == 0
+             && pHeader->m_VertexDataOffset >= sizeof( MeshFileHeader )
+             && pHeader->m_VertexDataOffset <= fileSize && vertexDataSize <= fileSize - pHeader->m_VertexDataOffset
+             && pHeader->m_IndexDataOffset <= fileSize && indexDataSize <= fileSize - pHeader->m_IndexDataOffset
+             && pHeader->m_LODCount > 0 && pHeader->m_LODCount <= MAX_MESH_LODS;
+    }
+
+    if( valid )
+    {
+        for( uint32 i=0; i<pHeader->m_LODCount; i++ )
+        {
+            if( (uint64)pHeader->m_LODs[i].m_FirstIndex + pHeader->m_LODs[i].m_IndexCount > pHeader->m_IndexCount )
+                valid = false;
+        }
+    }
+
+    // Indices are used in place by the GPU, so one past the mesh's vertices would read another mesh's pool range.
+    if( valid )
+    {
+        const void* pIndices = (const char*)m_File.GetData() + pHeader->m_IndexDataOffset;
+        uint32 maxIndex = 0;
+
+        if( pHeader->m_IndexSize == 2 )
+        {
+            const unsigned short* indices = (const unsigned short*)pIndices;
+            for( uint32 i=0; i<pHeader->m_IndexCount; i++ )
+            {
+                if( indices[i] > maxIndex )
+                    maxIndex = indices[i];
+            }
+        }
+        else
+        {
+            const uint32* indices = (const uint32*)pIndices;
+            for( uint32 i=0; i<pHeader->m_IndexCount; i++ )
+            {
+                if( indices[i] > maxIndex )
+                    maxIndex = indices[i];
+            }
+        }
+
+        if( pHeader->m_IndexCount > 0 && maxIndex >= pHeader->m_VertexCount )
+            valid = false;
+    }
+
+    if( valid == false )
+    {
+        m_File.Close();
+        return false;
+    }
+
+    m_pHeader = pHeader;
+    return true;
+}
+
+void MeshFile::Close()
+{
+    m_File.Close();
+    m_pHeader = nullptr;
+}
+
+void MeshFile::GetVertexLayout(VertexLayout* pLayout)
+{
+    assert( m_pHeader != nullptr );
+
+    pLayout->Create( (VertexAttributeFormat)m_pHeader->m_VertexFormats[VertexAttribute_Position], (VertexAttributeFormat)m_pHeader->m_VertexFormats[VertexAttribute_Color],
+                     (VertexAttributeFormat)m_pHeader->m_VertexFormats[VertexAttribute_Normal], (VertexAttributeFormat)m_pHeader->m_VertexFormats[VertexAttribute_UV] );
+}
+
+bool MeshFile::Save(const char* filename, const MeshFileContents& contents)
+{
+    assert( contents.m_pLayout != nullptr );
+    assert( contents.m_LODCount <= MAX_MESH_LODS );
+
+    uint32 indexSize = VulkanGeometryPool::GetIndexSize( contents.m_IndexType );
+    uint64 vertexDataSize = (uint64)contents.m_VertexCount * contents.m_pLayout->GetStride();
+    uint64 indexDataSize = (uint64)contents.m_IndexCount * indexSize;
+
+    // Build the header.
+    MeshFileHeader header;
+    memset( &header, 0, sizeof( header ) );
+
+    header.m_Magic = MESH_FILE_MAGIC;
+    header.m_Version = MESH_FILE_VERSION;
+    header.m_HeaderSize = sizeof( MeshFileHeader );
+
+    for( int i=0; i<VertexAttribute_Count; i++ )
+    {
+        header.m_VertexFormats[i] = contents.m_pLayout->GetFormat( (VertexAttribute)i );
+    }
+    header.m_VertexStride = contents.m_pLayout->GetStride();
+    header.m_VertexCount = contents.m_VertexCount;
+    header.m_IndexCount = contents.m_IndexCount;
+    header.m_IndexSize = indexSize;
+
+    if( contents.m_pLODs && contents.m_LODCount > 0 )
+    {
+        header.m_LODCount = contents.m_LODCount;
+        memcpy( header.m_LODs, contents.m_pLODs, sizeof( MeshLOD ) * contents.m_LODCount );
+    }
+    else
+    {
+        header.m_LODCount = 1;
+        header.m_LODs[0].m_FirstIndex = 0;
+        header.m_LODs[0].m_IndexCount = contents.m_IndexCount;
+        header.m_LODs[0].m_Error = 0;
+    }
+
+    header.m_BoundingCenter[0] = contents.m_BoundingCenter.x;
+    header.m_BoundingCenter[1] = contents.m_BoundingCenter.y;
+    header.m_BoundingCenter[2] = contents.m_BoundingCenter.z;
+    header.m_BoundingRadius = contents.m_BoundingRadius;
+    header.m_QuantizationCenter[0] = contents.m_QuantizationCenter.x;
+    header.m_QuantizationCenter[1] = contents.m_QuantizationCenter.y;
+    header.m_QuantizationCenter[2] = contents.m_QuantizationCenter.z;
+    header.m_QuantizationExtents[0] = contents.m_QuantizationExtents.x;
+    header.m_QuantizationExtents[1] = contents.m_QuantizationExtents.y;
+    header.m_QuantizationExtents[2] = contents.m_QuantizationExtents.z;
+
+    header.m_VertexDataOffset = AlignFileOffset( sizeof( MeshFileHeader ) );
+    header.m_IndexDataOffset = AlignFileOffset( header.m_VertexDataOffset + vertexDataSize );
+
+    // Write the header and blobs, padding with zeros up to each blob's offset.
+    FILE* filehandle;
+    errno_t error = fopen_s( &filehandle, filename, "wb" );
+    if( error != 0 || filehandle == nullptr )
+        return false;
+
+    static const char padding[MESH_FILE_ALIGNMENT] = {};
+    bool success = true;
+
+    success &= fwrite( &header, sizeof( header ), 1, filehandle ) == 1;
+    success &= fwrite( padding, 1, (size_t)(header.m_VertexDataOffset - sizeof( header )), filehandle ) == header.m_VertexDataOffset - sizeof( header );
+    if( vertexDataSize > 0 )
+        success &= fwrite( contents.m_Vertices, (size_t)vertexDataSize, 1, filehandle ) == 1;
+    success &= fwrite( padding, 1, (size_t)(header.m_IndexDataOffset - header.m_VertexDataOffset - vertexDataSize), filehandle ) == header.m_IndexDataOffset - header.m_VertexDataOffset - vertexDataSize;
+    if( indexDataSize > 0 )
+        success &= fwrite( contents.m_Indices, (size_t)indexDataSize, 1, filehandle ) == 1;
+
+    success &= fclose( filehandle ) == 0;
+
+    return success;
+}
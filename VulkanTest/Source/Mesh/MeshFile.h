@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __MeshFile_H__
+#define __MeshFile_H__
+
+#include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+#include "Math/Vector.h"
+#include "MemoryMappedFile.h"
+#include "VertexLayout.h"
+#include "Mesh/MeshSimplifier.h"
+
+static const uint32 MESH_FILE_MAGIC = 0x534D5456; // "VTMS"
+static const uint32 MESH_FILE_VERSION = 1;
+static const uint32 MESH_FILE_ALIGNMENT = 16;
+
+// On disk layout: header, then the vertex blob and index blob, each starting on a MESH_FILE_ALIGNMENT boundary.
+// Vertices are stored already packed in the described layout so they can be copied to the GPU as-is.
+struct MeshFileHeader
+{
+    uint32 m_Magic;
+    uint32 m_Version;
+    uint32 m_HeaderSize;
+
+    uint32 m_VertexFormats[VertexAttribute_Count]; // VertexAttributeFormat for each attribute.
+    uint32 m_VertexStride;
+    uint32 m_VertexCount;
+    uint32 m_IndexCount;
+    uint32 m_IndexSize; // 2 or 4 bytes.
+
+    uint32 m_LODCount;
+    MeshLOD m_LODs[MAX_MESH_LODS];
+
+    float m_BoundingCenter[3];
+    float m_BoundingRadius;
+    float m_QuantizationCenter[3]; // Only meaningful for SNorm16 positions, see VertexLayout::PackVertices.
+    float m_QuantizationExtents[3];
+
+    uint64 m_VertexDataOffset;
+    uint64 m_IndexDataOffset;
+};
+
+// Everything needed to write a mesh file, vertices must already be packed with pLayout.
+struct MeshFileContents
+{
+    const VertexLayout* m_pLayout;
+    const void* m_Vertices;
+    uint32 m_VertexCount;
+    const void* m_Indices;
+    uint32 m_IndexCount;
+    VkIndexType m_IndexType;
+    const MeshLOD* m_pLODs; // Can be null, a single full detail LOD is written.
+    uint32 m_LODCount;
+    Vector3 m_BoundingCenter;
+    float m_BoundingRadius;
+    Vector3 m_QuantizationCenter;
+    Vector3 m_QuantizationExtents;
+};
+
+// Binary mesh container, memory mapped on load.  The vertex and index blobs are used in place, there's no parsing step.
+class MeshFile
+{
+protected:
+    MemoryMappedFile m_File;
+    const MeshFileHeader* m_pHeader;
+
+public:
+    MeshFile();
+    virtual ~MeshFile();
+
+    // Maps the file and validates the header and indices, returns false for missing, truncated, corrupt or incompatible files.
+    bool Open(const char* filename);
+    void Close();
+
+    const MeshFileHeader* GetHeader() { return m_pHeader; }
+    const void* GetVertexData() { return (const char*)m_File.GetData() + m_pHeader->m_VertexDataOffset; }
+    const void* GetIndexData() { return (const char*)m_File.GetData() + m_pHeader->m_IndexDataOffset; }
+    VkIndexType GetIndexType() { return m_pHeader->m_IndexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+    void GetVertexLayout(VertexLayout* pLayout);
+    void TouchPages() { m_File.TouchPages(); }
+
+    static bool Save(const char* filename, const MeshFileContents& contents);
+};
+
+#endif //__MeshFile_H__
@@ -0,0 +1,1416 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+#include "Math/Vector.h"
+
+#include "Mesh/MeshImporter.h"
+#include "Mesh/MeshFile.h"
+#include "Mesh/MeshOptimizer.h"
+#include "Mesh/MeshSimplifier.h"
+#include "Mesh/JSONReader.h"
+#include "MemoryMappedFile.h"
+#include "Platform.h"
+#include "VertexLayout.h"
+#include "VulkanInterface.h"
+#include "VulkanMesh.h"
+
+// Files smaller than this per thread aren't worth splitting further.
+static const uint64 IMPORT_MIN_BYTES_PER_THREAD = 1024*1024;
+
+static const uint32 MISSING_ATTRIBUTE = UINT_MAX;
+
+static double GetSeconds()
+{
+    return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+static uint32 ChooseThreadCount(uint32 threadCount, uint64 workSize)
+{
+    if( threadCount == 0 )
+        threadCount = std::thread::hardware_concurrency();
+    if( threadCount == 0 )
+        threadCount = 1;
+
+    uint64 maxUsefulThreads = workSize / IMPORT_MIN_BYTES_PER_THREAD + 1;
+    if( threadCount > maxUsefulThreads )
+        threadCount = (uint32)maxUsefulThreads;
+
+    return threadCount;
+}
+
+// Calls pFunction for each index in [0, count), one thread per index.  Index 0 runs on the calling thread.
+static void RunParallel(uint32 count, void (*pFunction)(void* pData, uint32 index), void* pData)
+{
+    if( count == 0 )
+        return;
+
+    std::thread* threads = new std::thread[count];
+    for( uint32 i=1; i<count; i++ )
+    {
+        threads[i] = std::thread( pFunction, pData, i );
+    }
+
+    pFunction( pData, 0 );
+
+    for( uint32 i=1; i<count; i++ )
+    {
+        threads[i].join();
+    }
+    delete[] threads;
+}
+
+void ImportedMesh::NullEverything()
+{
+    m_Positions = nullptr;
+    m_Normals = nullptr;
+    m_UVs = nullptr;
+    m_VertexCount = 0;
+
+    m_Indices = nullptr;
+    m_IndexCount = 0;
+}
+
+void ImportedMesh::Destroy()
+{
+    delete[] m_Positions;
+    delete[] m_Normals;
+    delete[] m_UVs;
+    delete[] m_Indices;
+
+    NullEverything();
+}
+
+void BakedMesh::NullEverything()
+{
+    m_Vertices = nullptr;
+    m_VertexCount = 0;
+
+    m_Indices = nullptr;
+    m_IndexCount = 0;
+
+    m_LODCount = 0;
+
+    m_BoundingCenter.Set( 0, 0, 0 );
+    m_BoundingRadius = 0;
+    m_QuantizationCenter.Set( 0, 0, 0 );
+    m_QuantizationExtents.Set( 0, 0, 0 );
+}
+
+void BakedMesh::Destroy()
+{
+    delete[] m_Vertices;
+    delete[] m_Indices;
+
+    NullEverything();
+}
+
+//====================================================================================================
+// Vertex deduplication.
+//====================================================================================================
+
+// One face corner, indices into the position, UV and normal arrays.
+struct VertexRef
+{
+    uint32 m_Position;
+    uint32 m_UV;
+    uint32 m_Normal;
+};
+
+struct VertexRefArray
+{
+    VertexRef* m_Refs;
+    uint32 m_Count;
+    uint32 m_Capacity;
+
+    void Init() { m_Refs = nullptr; m_Count = 0; m_Capacity = 0; }
+    void Destroy() { delete[] m_Refs; Init(); }
+
+    void Add(const VertexRef& ref)
+    {
+        if( m_Count == m_Capacity )
+        {
+            m_Capacity = m_Capacity ? m_Capacity * 2 : 1024;
+            VertexRef* newRefs = new VertexRef[m_Capacity];
+            if( m_Count > 0 )
+                memcpy( newRefs, m_Refs, sizeof( VertexRef ) * m_Count );
+            delete[] m_Refs;
+            m_Refs = newRefs;
+        }
+
+        m_Refs[m_Count++] = ref;
+    }
+};
+
+static uint32 HashVertexRef(const VertexRef& ref)
+{
+    uint32 hash = ref.m_Position * 73856093u ^ ref.m_UV * 19349663u ^ ref.m_Normal * 83492791u;
+
+    // Finalizer from MurmurHash3, spreads the bits so masking by the table size works.
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// Builds one vertex per unique position/UV/normal combination and an index list referencing them.
+// Returns false if any reference is out of range.
+static bool DeduplicateVertices(const VertexRef* refs, uint32 refCount, const float* positions, uint32 positionCount,
+                                const float* uvs, uint32 uvCount, const float* normals, uint32 normalCount, ImportedMesh* pMesh)
+{
+    bool hasUVs = false;
+    bool hasNormals = false;
+    for( uint32 i=0; i<refCount; i++ )
+    {
+        if( refs[i].m_Position >= positionCount )
+            return false;
+        if( refs[i].m_UV != MISSING_ATTRIBUTE && refs[i].m_UV >= uvCount )
+            return false;
+        if( refs[i].m_Normal != MISSING_ATTRIBUTE && refs[i].m_Normal >= normalCount )
+            return false;
+
+        hasUVs |= refs[i].m_UV != MISSING_ATTRIBUTE;
+        hasNormals |= refs[i].m_Normal != MISSING_ATTRIBUTE;
+    }
+
+    // Open addressing table of vertex indices, at most half full.
+    uint32 tableSize = 64;
+    while( tableSize < refCount * 2 )
+    {
+        tableSize *= 2;
+    }
+    uint32* table = new uint32[tableSize];
+    memset( table, 0xFF, sizeof( uint32 ) * tableSize );
+
+    VertexRef* uniqueRefs = new VertexRef[refCount];
+    uint32 uniqueCount = 0;
+
+    pMesh->m_Indices = new uint32[refCount];
+    pMesh->m_IndexCount = refCount;
+
+    for( uint32 i=0; i<refCount; i++ )
+    {
+        const VertexRef& ref = refs[i];
+
+        uint32 slot = HashVertexRef( ref ) & (tableSize - 1);
+        while( true )
+        {
+            uint32 vertex = table[slot];
+            if( vertex == UINT_MAX )
+            {
+                vertex = uniqueCount++;
+                uniqueRefs[vertex] = ref;
+                table[slot] = vertex;
+                pMesh->m_Indices[i] = vertex;
+                break;
+            }
+
+            const VertexRef& existing = uniqueRefs[vertex];
+            if( existing.m_Position == ref.m_Position && existing.m_UV == ref.m_UV && existing.m_Normal == ref.m_Normal )
+            {
+                pMesh->m_Indices[i] = vertex;
+                break;
+            }
+
+            slot = (slot + 1) & (tableSize - 1);
+        }
+    }
+
+    delete[] table;
+
+    // Gather the attributes, corners without a UV or normal get zeros.
+    pMesh->m_VertexCount = uniqueCount;
+    pMesh->m_Positions = new float[uniqueCount * 3];
+    pMesh->m_UVs = hasUVs ? new float[uniqueCount * 2] : nullptr;
+    pMesh->m_Normals = hasNormals ? new float[uniqueCount * 3] : nullptr;
+
+    for( uint32 v=0; v<uniqueCount; v++ )
+    {
+        const VertexRef& ref = uniqueRefs[v];
+
+        memcpy( &pMesh->m_Positions[v*3], &positions[ref.m_Position*3], sizeof( float ) * 3 );
+
+        if( hasUVs )
+        {
+            if( ref.m_UV != MISSING_ATTRIBUTE )
+                memcpy( &pMesh->m_UVs[v*2], &uvs[ref.m_UV*2], sizeof( float ) * 2 );
+            else
+                memset( &pMesh->m_UVs[v*2], 0, sizeof( float ) * 2 );
+        }
+
+        if( hasNormals )
+        {
+            if( ref.m_Normal != MISSING_ATTRIBUTE )
+                memcpy( &pMesh->m_Normals[v*3], &normals[ref.m_Normal*3], sizeof( float ) * 3 );
+            else
+                memset( &pMesh->m_Normals[v*3], 0, sizeof( float ) * 3 );
+        }
+    }
+
+    delete[] uniqueRefs;
+
+    return true;
+}
+
+//====================================================================================================
+// OBJ.
+//====================================================================================================
+
+// A line-aligned slice of the file.  Counted in a first pass so each chunk knows where its
+// vertices land in the shared arrays, which also resolves negative (relative) face indices.
+struct OBJChunk
+{
+    const char* m_pStart;
+    const char* m_pEnd;
+
+    uint32 m_PositionCount;
+    uint32 m_UVCount;
+    uint32 m_NormalCount;
+
+    uint32 m_PositionBase;
+    uint32 m_UVBase;
+    uint32 m_NormalBase;
+
+    VertexRefArray m_Corners; // Triangulated, three per triangle.
+    bool m_Failed;
+};
+
+struct OBJImportJob
+{
+    OBJChunk* m_Chunks;
+
+    float* m_Positions;
+    float* m_UVs;
+    float* m_Normals;
+};
+
+static const char* SkipSpaces(const char* p, const char* pEnd)
+{
+    while( p < pEnd && (*p == ' ' || *p == '\t') )
+    {
+        p++;
+    }
+    return p;
+}
+
+static const char* FindLineEnd(const char* p, const char* pEnd)
+{
+    const char* pLineEnd = (const char*)memchr( p, '\n', pEnd - p );
+    return pLineEnd ? pLineEnd : pEnd;
+}
+
+static bool ParseOBJFloat(const char** pp, const char* pEnd, float* pValue)
+{
+    static const double powersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+    const char* p = SkipSpaces( *pp, pEnd );
+
+    bool negative = false;
+    if( p < pEnd && (*p == '-' || *p == '+') )
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    // Mantissa digits past 18 don't fit, they only shift the exponent.
+    uint64 mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    const char* pDigitsStart = p;
+    while( p < pEnd && *p >= '0' && *p <= '9' )
+    {
+        if( digits < 18 ) { mantissa = mantissa * 10 + (*p - '0'); digits++; }
+        else exponent++;
+        p++;
+    }
+    if( p < pEnd && *p == '.' )
+    {
+        p++;
+        while( p < pEnd && *p >= '0' && *p <= '9' )
+        {
+            if( digits < 18 ) { mantissa = mantissa * 10 + (*p - '0'); digits++; exponent--; }
+            p++;
+        }
+    }
+    if( p == pDigitsStart )
+        return false;
+
+    if( p < pEnd && (*p == 'e' || *p == 'E') )
+    {
+        p++;
+        bool negativeExponent = false;
+        if( p < pEnd && (*p == '-' || *p == '+') )
+        {
+            negativeExponent = *p == '-';
+            p++;
+        }
+        int value = 0;
+        while( p < pEnd && *p >= '0' && *p <= '9' )
+        {
+            if( value < 1000 )
+                value = value * 10 + (*p - '0');
+            p++;
+        }
+        exponent += negativeExponent ? -value : value;
+    }
+
+    double result = (double)mantissa;
+    while( exponent > 0 ) { int step = exponent > 18 ? 18 : exponent; result *= powersOf10[step]; exponent -= step; }
+    while( exponent < 0 ) { int step = -exponent > 18 ? 18 : -exponent; result /= powersOf10[step]; exponent += step; }
+
+    *pValue = (float)(negative ? -result : result);
+    *pp = p;
+    return true;
+}
+
+static bool ParseOBJInt(const char** pp, const char* pEnd, int64* pValue)
+{
+    const char* p = *pp;
+
+    bool negative = false;
+    if( p < pEnd && *p == '-' )
+    {
+        negative = true;
+        p++;
+    }
+
+    const char* pDigitsStart = p;
+    int64 value = 0;
+    while( p < pEnd && *p >= '0' && *p <= '9' )
+    {
+        if( value < INT_MAX )
+            value = value * 10 + (*p - '0');
+        p++;
+    }
+    if( p == pDigitsStart )
+        return false;
+
+    *pValue = negative ? -value : value;
+    *pp = p;
+    return true;
+}
+
+// OBJ indices are 1-based, negative ones count back from the last element read so far.
+static uint32 ResolveOBJIndex(int64 index, uint32 countSoFar)
+{
+    if( index > 0 )
+        return (uint32)(index - 1);
+    if( index < 0 && -index <= countSoFar )
+        return (uint32)(countSoFar + index);
+
+    return MISSING_ATTRIBUTE - 1; // Out of range, rejected during deduplication.
+}
+
+static void CountOBJChunk(void* pData, uint32 chunkIndex)
+{
+    OBJChunk& chunk = ((OBJImportJob*)pData)->m_Chunks[chunkIndex];
+
+    for( const char* p = chunk.m_pStart; p < chunk.m_pEnd; )
+    {
+        const char* pLineEnd = FindLineEnd( p, chunk.m_pEnd );
+        p = SkipSpaces( p, pLineEnd );
+
+        if( pLineEnd - p >= 2 && p[0] == 'v' )
+        {
+            if( p[1] == ' ' || p[1] == '\t' )
+                chunk.m_PositionCount++;
+            else if( p[1] == 't' )
+                chunk.m_UVCount++;
+            else if( p[1] == 'n' )
+                chunk.m_NormalCount++;
+        }
+
+        p = pLineEnd + 1;
+    }
+}
+
+static void ParseOBJChunk(void* pData, uint32 chunkIndex)
+{
+    OBJImportJob* pJob = (OBJImportJob*)pData;
+    OBJChunk& chunk = pJob->m_Chunks[chunkIndex];
+
+    uint32 positionCount = chunk.m_PositionBase;
+    uint32 uvCount = chunk.m_UVBase;
+    uint32 normalCount = chunk.m_NormalBase;
+
+    for( const char* p = chunk.m_pStart; p < chunk.m_pEnd && chunk.m_Failed == false; )
+    {
+        const char* pLineEnd = FindLineEnd( p, chunk.m_pEnd );
+        p = SkipSpaces( p, pLineEnd );
+
+        if( pLineEnd - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t') )
+        {
+            // Optional w is ignored.
+            p += 1;
+            float* pPosition = &pJob->m_Positions[positionCount*3];
+            chunk.m_Failed = !ParseOBJFloat( &p, pLineEnd, &pPosition[0] ) || !ParseOBJFloat( &p, pLineEnd, &pPosition[1] ) || !ParseOBJFloat( &p, pLineEnd, &pPosition[2] );
+            positionCount++;
+        }
+        else if( pLineEnd - p >= 2 && p[0] == 'v' && p[1] == 't' )
+        {
+            // OBJ's V axis points up, Vulkan's image origin is the top left.
+            p += 2;
+            float* pUV = &pJob->m_UVs[uvCount*2];
+            chunk.m_Failed = !ParseOBJFloat( &p, pLineEnd, &pUV[0] );
+            if( ParseOBJFloat( &p, pLineEnd, &pUV[1] ) == false )
+                pUV[1] = 0;
+            pUV[1] = 1.0f - pUV[1];
+            uvCount++;
+        }
+        else if( pLineEnd - p >= 2 && p[0] == 'v' && p[1] == 'n' )
+        {
+            p += 2;
+            float* pNormal = &pJob->m_Normals[normalCount*3];
+            chunk.m_Failed = !ParseOBJFloat( &p, pLineEnd, &pNormal[0] ) || !ParseOBJFloat( &p, pLineEnd, &pNormal[1] ) || !ParseOBJFloat( &p, pLineEnd, &pNormal[2] );
+            normalCount++;
+        }
+        else if( pLineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t') )
+        {
+            // Fan triangulate polygons.
+            p += 1;
+            VertexRef first = {};
+            VertexRef previous = {};
+            uint32 cornerCount = 0;
+            while( true )
+            {
+                p = SkipSpaces( p, pLineEnd );
+                if( p >= pLineEnd || *p == '\r' )
+                    break;
+
+                int64 index;
+                VertexRef corner = { 0, MISSING_ATTRIBUTE, MISSING_ATTRIBUTE };
+                if( ParseOBJInt( &p, pLineEnd, &index ) == false )
+                {
+                    chunk.m_Failed = true;
+                    break;
+                }
+                corner.m_Position = ResolveOBJIndex( index, positionCount );
+
+                if( p < pLineEnd && *p == '/' )
+                {
+                    p++;
+                    if( p < pLineEnd && *p != '/' )
+                    {
+                        chunk.m_Failed |= !ParseOBJInt( &p, pLineEnd, &index );
+                        corner.m_UV = ResolveOBJIndex( index, uvCount );
+                    }
+                    if( p < pLineEnd && *p == '/' )
+                    {
+                        p++;
+                        chunk.m_Failed |= !ParseOBJInt( &p, pLineEnd, &index );
+                        corner.m_Normal = ResolveOBJIndex( index, normalCount );
+                    }
+                }
+
+                if( cornerCount == 0 )
+                    first = corner;
+                if( cornerCount >= 2 )
+                {
+                    chunk.m_Corners.Add( first );
+                    chunk.m_Corners.Add( previous );
+                    chunk.m_Corners.Add( corner );
+                }
+                previous = corner;
+                cornerCount++;
+            }
+        }
+
+        p = pLineEnd + 1;
+    }
+}
+
+bool MeshImporter::ImportOBJ(const char* filename, ImportedMesh* pMesh, uint32 threadCount, MeshImportStats* pStats)
+{
+    pMesh->NullEverything();
+
+    MemoryMappedFile file;
+    if( file.Open( filename ) == false )
+        return false;
+
+    return ImportOBJFromMemory( file.GetData(), file.GetSize(), pMesh, threadCount, pStats );
+}
+
+bool MeshImporter::ImportOBJFromMemory(const void* pData, uint64 size, ImportedMesh* pMesh, uint32 threadCount, MeshImportStats* pStats)
+{
+    double startTime = GetSeconds();
+
+    pMesh->NullEverything();
+
+    const char* pText = (const char*)pData;
+
+    // Split into chunks at line boundaries.
+    threadCount = ChooseThreadCount( threadCount, size );
+    OBJChunk* chunks = new OBJChunk[threadCount];
+    const char* pTextEnd = pText + size;
+    const char* pChunkStart = pText;
+    for( uint32 i=0; i<threadCount; i++ )
+    {
+        const char* pChunkEnd = pTextEnd;
+        if( i < threadCount-1 )
+        {
+            pChunkEnd = pText + size * (i+1) / threadCount;
+            if( pChunkEnd < pChunkStart )
+                pChunkEnd = pChunkStart;
+
+            const char* pLineEnd = FindLineEnd( pChunkEnd, pTextEnd );
+            pChunkEnd = pLineEnd < pTextEnd ? pLineEnd + 1 : pTextEnd;
+        }
+
+        memset( &chunks[i], 0, sizeof( OBJChunk ) );
+        chunks[i].m_pStart = pChunkStart;
+        chunks[i].m_pEnd = pChunkEnd;
+        chunks[i].m_Corners.Init();
+
+        pChunkStart = pChunkEnd;
+    }
+
+    OBJImportJob job;
+    job.m_Chunks = chunks;
+
+    // Count elements, then give each chunk its base in the shared arrays.
+    RunParallel( threadCount, CountOBJChunk, &job );
+
+    uint32 positionCount = 0;
+    uint32 uvCount = 0;
+    uint32 normalCount = 0;
+    for( uint32 i=0; i<threadCount; i++ )
+    {
+        chunks[i].m_PositionBase = positionCount;
+        chunks[i].m_UVBase = uvCount;
+        chunks[i].m_NormalBase = normalCount;
+
+        positionCount += chunks[i].m_PositionCount;
+        uvCount += chunks[i].m_UVCount;
+        normalCount += chunks[i].m_NormalCount;
+    }
+
+    job.m_Positions = new float[positionCount * 3 + 1];
+    job.m_UVs = new float[uvCount * 2 + 1];
+    job.m_Normals = new float[normalCount * 3 + 1];
+
+    RunParallel( threadCount, ParseOBJChunk, &job );
+
+    // Join the chunks' triangles.
+    bool failed = false;
+    uint32 cornerCount = 0;
+    for( uint32 i=0; i<threadCount; i++ )
+    {
+        failed |= chunks[i].m_Failed;
+        cornerCount += chunks[i].m_Corners.m_Count;
+    }
+
+    VertexRef* corners = new VertexRef[cornerCount + 1];
+    uint32 cornerOffset = 0;
+    for( uint32 i=0; i<threadCount; i++ )
+    {
+        if( chunks[i].m_Corners.m_Count > 0 )
+            memcpy( &corners[cornerOffset], chunks[i].m_Corners.m_Refs, sizeof( VertexRef ) * chunks[i].m_Corners.m_Count );
+        cornerOffset += chunks[i].m_Corners.m_Count;
+        chunks[i].m_Corners.Destroy();
+    }
+    delete[] chunks;
+
+    double parseEndTime = GetSeconds();
+
+    if( failed == false && cornerCount > 0 )
+        failed = !DeduplicateVertices( corners, cornerCount, job.m_Positions, positionCount, job.m_UVs, uvCount, job.m_Normals, normalCount, pMesh );
+    else
+        failed = true;
+
+    double endTime = GetSeconds();
+
+    delete[] corners;
+    delete[] job.m_Positions;
+    delete[] job.m_UVs;
+    delete[] job.m_Normals;
+
+    if( failed )
+    {
+        pMesh->Destroy();
+        return false;
+    }
+
+    if( pStats )
+    {
+        pStats->m_FileBytes = size;
+        pStats->m_ThreadCount = threadCount;
+        pStats->m_TriangleCount = cornerCount / 3;
+        pStats->m_SourceVertexCount = cornerCount;
+        pStats->m_UniqueVertexCount = pMesh->m_VertexCount;
+        pStats->m_ParseSeconds = parseEndTime - startTime;
+        pStats->m_DedupeSeconds = endTime - parseEndTime;
+        pStats->m_TotalSeconds = endTime - startTime;
+    }
+
+    return true;
+}
+
+//====================================================================================================
+// glTF 2.0.
+//====================================================================================================
+
+static const uint32 GLB_MAGIC = 0x46546C67; // "glTF"
+static const uint32 GLB_CHUNK_JSON = 0x4E4F534A;
+static const uint32 GLB_CHUNK_BIN = 0x004E4942;
+
+static const int GLTF_COMPONENT_UNSIGNED_BYTE = 5121;
+static const int GLTF_COMPONENT_UNSIGNED_SHORT = 5123;
+static const int GLTF_COMPONENT_UNSIGNED_INT = 5125;
+static const int GLTF_COMPONENT_FLOAT = 5126;
+static const int GLTF_MODE_TRIANGLES = 4;
+
+static const uint32 GLTF_MAX_BUFFERS = 64;
+
+struct GLTFBuffer
+{
+    const unsigned char* m_pData;
+    uint64 m_Size;
+    MemoryMappedFile* m_pExternalFile; // Set for buffers in separate .bin files.
+    unsigned char* m_pDecodedData;     // Set for base64 data URIs.
+};
+
+// A validated view of an accessor's data.
+struct GLTFAccessor
+{
+    const unsigned char* m_pData;
+    uint32 m_Count;
+    uint32 m_Stride;
+    int m_ComponentType;
+};
+
+struct GLTFPrimitive
+{
+    GLTFAccessor m_Positions;
+    GLTFAccessor m_Normals; // m_pData is null if missing.
+    GLTFAccessor m_UVs;
+    GLTFAccessor m_Indices; // m_pData is null for non-indexed primitives.
+
+    uint32 m_VertexBase;
+    uint32 m_IndexBase;
+    uint32 m_IndexCount;
+};
+
+struct GLTFImportJob
+{
+    GLTFPrimitive* m_Primitives;
+    uint32 m_PrimitiveCount;
+    uint32 m_ThreadCount;
+
+    float* m_Positions;
+    float* m_UVs;
+    float* m_Normals;
+    VertexRef* m_Corners;
+    bool* m_ThreadFailed;
+};
+
+// Reads a non-negative integer member.  Missing members return defaultValue, invalid ones return a value
+// large enough to fail any bounds check without overflowing the 64-bit offset math.
+static uint64 GetGLTFUnsigned(JSONReader& json, uint32 object, const char* key, uint64 defaultValue)
+{
+    static const uint64 invalidValue = 1ull << 48;
+
+    uint32 member = json.GetMember( object, key );
+    if( member == JSONReader::INVALID_VALUE )
+        return defaultValue;
+
+    const JSONValue& value = json.GetValue( member );
+    if( value.m_Type != JSONType_Number || value.m_Number < 0 || value.m_Number >= (double)invalidValue )
+        return invalidValue;
+
+    return (uint64)value.m_Number;
+}
+
+// Reads an index into one of the top level arrays, JSONReader::INVALID_VALUE if missing or invalid.
+static uint32 GetGLTFIndex(JSONReader& json, uint32 object, const char* key)
+{
+    uint64 index = GetGLTFUnsigned( json, object, key, JSONReader::INVALID_VALUE );
+    return index < JSONReader::INVALID_VALUE ? (uint32)index : JSONReader::INVALID_VALUE;
+}
+
+static int DecodeBase64Character(char c)
+{
+    if( c >= 'A' && c <= 'Z' ) return c - 'A';
+    if( c >= 'a' && c <= 'z' ) return c - 'a' + 26;
+    if( c >= '0' && c <= '9' ) return c - '0' + 52;
+    if( c == '+' ) return 62;
+    if( c == '/' ) return 63;
+    return -1;
+}
+
+// Returns the decoded size, pDestination needs room for length*3/4 bytes.
+static uint64 DecodeBase64(unsigned char* pDestination, const char* pSource, uint32 length)
+{
+    uint64 size = 0;
+    uint32 bits = 0;
+    int bitCount = 0;
+    for( uint32 i=0; i<length; i++ )
+    {
+        int value = DecodeBase64Character( pSource[i] );
+        if( value < 0 )
+            break; // Padding.
+
+        bits = (bits << 6) | value;
+        bitCount += 6;
+        if( bitCount >= 8 )
+        {
+            bitCount -= 8;
+            pDestination[size++] = (unsigned char)(bits >> bitCount);
+        }
+    }
+
+    return size;
+}
+
+static bool LoadGLTFBuffer(JSONReader& json, uint32 bufferIndex, const char* filename, const unsigned char* pGLBData, uint64 glbDataSize, GLTFBuffer* pBuffer)
+{
+    uint32 uri = json.GetMember( bufferIndex, "uri" );
+    uint64 byteLength = GetGLTFUnsigned( json, bufferIndex, "byteLength", 0 );
+
+    // No URI means the GLB binary chunk.
+    if( uri == JSONReader::INVALID_VALUE )
+    {
+        pBuffer->m_pData = pGLBData;
+        pBuffer->m_Size = glbDataSize;
+        return pGLBData != nullptr && byteLength <= glbDataSize;
+    }
+
+    const JSONValue& uriValue = json.GetValue( uri );
+    if( uriValue.m_Type != JSONType_String )
+        return false;
+
+    // Embedded data.
+    if( uriValue.m_StringLength > 5 && strncmp( uriValue.m_String, "data:", 5 ) == 0 )
+    {
+        const char* pBase64 = nullptr;
+        for( uint32 i=5; i+7<=uriValue.m_StringLength; i++ )
+        {
+            if( strncmp( &uriValue.m_String[i], ";base64,", 8 ) == 0 )
+            {
+                pBase64 = &uriValue.m_String[i+8];
+                break;
+            }
+        }
+        if( pBase64 == nullptr )
+            return false;
+
+        uint32 base64Length = (uint32)(uriValue.m_String + uriValue.m_StringLength - pBase64);
+        pBuffer->m_pDecodedData = new unsigned char[base64Length * 3 / 4 + 1];
+        pBuffer->m_pData = pBuffer->m_pDecodedData;
+        pBuffer->m_Size = DecodeBase64( pBuffer->m_pDecodedData, pBase64, base64Length );
+        return byteLength <= pBuffer->m_Size;
+    }
+
+    // External file, relative to the .gltf.
+    char path[1024];
+    const char* pLastSlash = strrchr( filename, '/' );
+    const char* pLastBackslash = strrchr( filename, '\\' );
+    if( pLastBackslash > pLastSlash )
+        pLastSlash = pLastBackslash;
+    size_t directoryLength = pLastSlash ? pLastSlash - filename + 1 : 0;
+    if( directoryLength + uriValue.m_StringLength >= sizeof( path ) )
+        return false;
+
+    memcpy( path, filename, directoryLength );
+    memcpy( &path[directoryLength], uriValue.m_String, uriValue.m_StringLength );
+    path[directoryLength + uriValue.m_StringLength] = 0;
+
+    pBuffer->m_pExternalFile = new MemoryMappedFile();
+    if( pBuffer->m_pExternalFile->Open( path ) == false )
+        return false;
+
+    pBuffer->m_pData = (const unsigned char*)pBuffer->m_pExternalFile->GetData();
+    pBuffer->m_Size = pBuffer->m_pExternalFile->GetSize();
+    return byteLength <= pBuffer->m_Size;
+}
+
+static uint32 GetGLTFComponentSize(int componentType)
+{
+    switch( componentType )
+    {
+    case GLTF_COMPONENT_UNSIGNED_BYTE:  return 1;
+    case GLTF_COMPONENT_UNSIGNED_SHORT: return 2;
+    case GLTF_COMPONENT_UNSIGNED_INT:   return 4;
+    case GLTF_COMPONENT_FLOAT:          return 4;
+    }
+    return 0;
+}
+
+// Looks up an accessor and checks its data lies inside its buffer.
+static bool ReadGLTFAccessor(JSONReader& json, uint32 accessorIndex, const char* type, const GLTFBuffer* buffers, uint32 bufferCount, GLTFAccessor* pAccessor)
+{
+    uint32 accessors = json.GetMember( 0, "accessors" );
+    uint32 accessor = json.GetElement( accessors, accessorIndex );
+    if( accessor == JSONReader::INVALID_VALUE )
+        return false;
+
+    // Sparse accessors and accessors without data aren't supported.
+    if( json.GetMember( accessor, "sparse" ) != JSONReader::INVALID_VALUE )
+        return false;
+    if( json.StringEquals( json.GetMember( accessor, "type" ), type ) == false )
+        return false;
+
+    uint32 componentCount = strcmp( type, "VEC3" ) == 0 ? 3 : strcmp( type, "VEC2" ) == 0 ? 2 : 1;
+    int componentType = (int)GetGLTFUnsigned( json, accessor, "componentType", 0 );
+    uint32 elementSize = GetGLTFComponentSize( componentType ) * componentCount;
+    if( elementSize == 0 )
+        return false;
+
+    uint32 bufferViews = json.GetMember( 0, "bufferViews" );
+    uint32 bufferView = json.GetElement( bufferViews, GetGLTFIndex( json, accessor, "bufferView" ) );
+    if( bufferView == JSONReader::INVALID_VALUE )
+        return false;
+
+    uint32 bufferIndex = GetGLTFIndex( json, bufferView, "buffer" );
+    if( bufferIndex >= bufferCount )
+        return false;
+
+    uint64 viewOffset = GetGLTFUnsigned( json, bufferView, "byteOffset", 0 );
+    uint64 viewLength = GetGLTFUnsigned( json, bufferView, "byteLength", 0 );
+    uint64 accessorOffset = GetGLTFUnsigned( json, accessor, "byteOffset", 0 );
+    uint64 stride = GetGLTFUnsigned( json, bufferView, "byteStride", 0 );
+    if( stride == 0 )
+        stride = elementSize;
+    uint64 count = GetGLTFUnsigned( json, accessor, "count", 0 );
+
+    if( count == 0 || count >= UINT_MAX || stride < elementSize || stride > 252 || viewOffset + viewLength > buffers[bufferIndex].m_Size )
+        return false;
+    if( accessorOffset + (count - 1) * stride + elementSize > viewLength )
+        return false;
+
+    pAccessor->m_pData = buffers[bufferIndex].m_pData + viewOffset + accessorOffset;
+    pAccessor->m_Count = (uint32)count;
+    pAccessor->m_Stride = (uint32)stride;
+    pAccessor->m_ComponentType = componentType;
+
+    return true;
+}
+
+static void ParseGLTFPrimitives(void* pData, uint32 threadIndex)
+{
+    GLTFImportJob* pJob = (GLTFImportJob*)pData;
+
+    // Primitives are split between threads round robin, each writes its own ranges of the shared arrays.
+    for( uint32 p=threadIndex; p<pJob->m_PrimitiveCount; p+=pJob->m_ThreadCount )
+    {
+        const GLTFPrimitive& primitive = pJob->m_Primitives[p];
+        uint32 vertexCount = primitive.m_Positions.m_Count;
+
+        for( uint32 v=0; v<vertexCount; v++ )
+        {
+            uint32 vertex = primitive.m_VertexBase + v;
+
+            memcpy( &pJob->m_Positions[vertex*3], primitive.m_Positions.m_pData + v * primitive.m_Positions.m_Stride, sizeof( float ) * 3 );
+
+            if( primitive.m_Normals.m_pData )
+                memcpy( &pJob->m_Normals[vertex*3], primitive.m_Normals.m_pData + v * primitive.m_Normals.m_Stride, sizeof( float ) * 3 );
+            else
+                memset( &pJob->m_Normals[vertex*3], 0, sizeof( float ) * 3 );
+
+            if( primitive.m_UVs.m_pData )
+                memcpy( &pJob->m_UVs[vertex*2], primitive.m_UVs.m_pData + v * primitive.m_UVs.m_Stride, sizeof( float ) * 2 );
+            else
+                memset( &pJob->m_UVs[vertex*2], 0, sizeof( float ) * 2 );
+        }
+
+        for( uint32 i=0; i<primitive.m_IndexCount; i++ )
+        {
+            uint32 index = i;
+            if( primitive.m_Indices.m_pData )
+            {
+                const unsigned char* pIndex = primitive.m_Indices.m_pData + i * primitive.m_Indices.m_Stride;
+                switch( primitive.m_Indices.m_ComponentType )
+                {
+                case GLTF_COMPONENT_UNSIGNED_BYTE:  index = *pIndex; break;
+                case GLTF_COMPONENT_UNSIGNED_SHORT: { unsigned short value; memcpy( &value, pIndex, 2 ); index = value; } break;
+                default:                            memcpy( &index, pIndex, 4 ); break;
+                }
+            }
+
+            if( index >= vertexCount )
+            {
+                pJob->m_ThreadFailed[threadIndex] = true;
+                index = 0;
+            }
+
+            uint32 vertex = primitive.m_VertexBase + index;
+            VertexRef& corner = pJob->m_Corners[primitive.m_IndexBase + i];
+            corner.m_Position = vertex;
+            corner.m_UV = primitive.m_UVs.m_pData ? vertex : MISSING_ATTRIBUTE;
+            corner.m_Normal = primitive.m_Normals.m_pData ? vertex : MISSING_ATTRIBUTE;
+        }
+    }
+}
+
+bool MeshImporter::ImportGLTF(const char* filename, ImportedMesh* pMesh, uint32 threadCount, MeshImportStats* pStats)
+{
+    pMesh->NullEverything();
+
+    MemoryMappedFile file;
+    if( file.Open( filename ) == false )
+        return false;
+
+    return ImportGLTFFromMemory( file.GetData(), file.GetSize(), filename, pMesh, threadCount, pStats );
+}
+
+bool MeshImporter::ImportGLTFFromMemory(const void* pData, uint64 size, const char* filename, ImportedMesh* pMesh, uint32 threadCount, MeshImportStats* pStats)
+{
+    double startTime = GetSeconds();
+
+    pMesh->NullEverything();
+
+    const unsigned char* pFileData = (const unsigned char*)pData;
+    uint64 fileSize = size;
+
+    // Find the JSON, either the whole file or the first chunk of a .glb.
+    const char* pJSONText = (const char*)pFileData;
+    uint64 jsonLength = fileSize;
+    const unsigned char* pGLBData = nullptr;
+    uint64 glbDataSize = 0;
+
+    uint32 magic = 0;
+    if( fileSize >= 4 )
+        memcpy( &magic, pFileData, 4 );
+
+    if( magic == GLB_MAGIC )
+    {
+        // 12 byte header, then chunks of (length, type, data).
+        uint32 chunkHeader[2];
+        if( fileSize < 20 )
+            return false;
+
+        memcpy( chunkHeader, pFileData + 12, 8 );
+        if( chunkHeader[1] != GLB_CHUNK_JSON || 20 + (uint64)chunkHeader[0] > fileSize )
+            return false;
+
+        pJSONText = (const char*)pFileData + 20;
+        jsonLength = chunkHeader[0];
+
+        uint64 binOffset = 20 + (uint64)chunkHeader[0];
+        if( binOffset + 8 <= fileSize )
+        {
+            memcpy( chunkHeader, pFileData + binOffset, 8 );
+            if( chunkHeader[1] == GLB_CHUNK_BIN && binOffset + 8 + chunkHeader[0] <= fileSize )
+            {
+                pGLBData = pFileData + binOffset + 8;
+                glbDataSize = chunkHeader[0];
+            }
+        }
+    }
+
+    JSONReader json;
+    if( jsonLength > UINT_MAX || json.Parse( pJSONText, (uint32)jsonLength ) == false )
+        return false;
+
+    // Load buffers.
+    uint32 buffersArray = json.GetMember( 0, "buffers" );
+    uint32 bufferCount = json.GetArraySize( buffersArray );
+    if( bufferCount > GLTF_MAX_BUFFERS )
+        return false;
+
+    GLTFBuffer buffers[GLTF_MAX_BUFFERS];
+    memset( buffers, 0, sizeof( buffers ) );
+
+    bool failed = false;
+    uint32 bufferIndex = 0;
+    for( uint32 buffer = bufferCount ? json.GetValue( buffersArray ).m_FirstChild : JSONReader::INVALID_VALUE; buffer != JSONReader::INVALID_VALUE && failed == false; buffer = json.GetValue( buffer ).m_NextSibling )
+    {
+        failed = !LoadGLTFBuffer( json, buffer, filename, pGLBData, glbDataSize, &buffers[bufferIndex++] );
+    }
+
+    // Gather triangle primitives from every mesh.
+    // Node transforms aren't applied, all primitives are merged in their mesh's space.
+    uint32 meshes = json.GetMember( 0, "meshes" );
+    uint32 primitiveCapacity = 0;
+    for( uint32 mesh = json.GetArraySize( meshes ) ? json.GetValue( meshes ).m_FirstChild : JSONReader::INVALID_VALUE; mesh != JSONReader::INVALID_VALUE; mesh = json.GetValue( mesh ).m_NextSibling )
+    {
+        primitiveCapacity += json.GetArraySize( json.GetMember( mesh, "primitives" ) );
+    }
+
+    GLTFPrimitive* primitives = new GLTFPrimitive[primitiveCapacity + 1];
+    uint32 primitiveCount = 0;
+    uint32 vertexCount = 0;
+    uint32 cornerCount = 0;
+
+    for( uint32 mesh = json.GetArraySize( meshes ) ? json.GetValue( meshes ).m_FirstChild : JSONReader::INVALID_VALUE; mesh != JSONReader::INVALID_VALUE && failed == false; mesh = json.GetValue( mesh ).m_NextSibling )
+    {
+        uint32 primitivesArray = json.GetMember( mesh, "primitives" );
+        for( uint32 primitive = json.GetArraySize( primitivesArray ) ? json.GetValue( primitivesArray ).m_FirstChild : JSONReader::INVALID_VALUE; primitive != JSONReader::INVALID_VALUE && failed == false; primitive = json.GetValue( primitive ).m_NextSibling )
+        {
+            if( GetGLTFUnsigned( json, primitive, "mode", GLTF_MODE_TRIANGLES ) != GLTF_MODE_TRIANGLES )
+                continue;
+
+            GLTFPrimitive& info = primitives[primitiveCount];
+            memset( &info, 0, sizeof( GLTFPrimitive ) );
+
+            uint32 attributes = json.GetMember( primitive, "attributes" );
+            if( ReadGLTFAccessor( json, GetGLTFIndex( json, attributes, "POSITION" ), "VEC3", buffers, bufferCount, &info.m_Positions ) == false ||
+                info.m_Positions.m_ComponentType != GLTF_COMPONENT_FLOAT )
+            {
+                failed = true;
+                break;
+            }
+
+            // Optional attributes in formats other than float are skipped.
+            uint32 normal = GetGLTFIndex( json, attributes, "NORMAL" );
+            if( normal != JSONReader::INVALID_VALUE &&
+                (ReadGLTFAccessor( json, normal, "VEC3", buffers, bufferCount, &info.m_Normals ) == false ||
+                 info.m_Normals.m_ComponentType != GLTF_COMPONENT_FLOAT || info.m_Normals.m_Count != info.m_Positions.m_Count) )
+            {
+                memset( &info.m_Normals, 0, sizeof( GLTFAccessor ) );
+            }
+
+            uint32 uv = GetGLTFIndex( json, attributes, "TEXCOORD_0" );
+            if( uv != JSONReader::INVALID_VALUE &&
+                (ReadGLTFAccessor( json, uv, "VEC2", buffers, bufferCount, &info.m_UVs ) == false ||
+                 info.m_UVs.m_ComponentType != GLTF_COMPONENT_FLOAT || info.m_UVs.m_Count != info.m_Positions.m_Count) )
+            {
+                memset( &info.m_UVs, 0, sizeof( GLTFAccessor ) );
+            }
+
+            info.m_IndexCount = info.m_Positions.m_Count;
+            uint32 indices = GetGLTFIndex( json, primitive, "indices" );
+            if( indices != JSONReader::INVALID_VALUE )
+            {
+                if( ReadGLTFAccessor( json, indices, "SCALAR", buffers, bufferCount, &info.m_Indices ) == false ||
+                    info.m_Indices.m_ComponentType == GLTF_COMPONENT_FLOAT )
+                {
+                    failed = true;
+                    break;
+                }
+                info.m_IndexCount = info.m_Indices.m_Count;
+            }
+            info.m_IndexCount -= info.m_IndexCount % 3;
+
+            if( (uint64)vertexCount + info.m_Positions.m_Count >= UINT_MAX || (uint64)cornerCount + info.m_IndexCount >= UINT_MAX )
+            {
+                failed = true;
+                break;
+            }
+
+            info.m_VertexBase = vertexCount;
+            info.m_IndexBase = cornerCount;
+            vertexCount += info.m_Positions.m_Count;
+            cornerCount += info.m_IndexCount;
+            primitiveCount++;
+        }
+    }
+
+    // Copy attributes and indices out in parallel, primitives are independent.
+    threadCount = ChooseThreadCount( threadCount, (uint64)vertexCount * 32 );
+    if( threadCount > primitiveCount )
+        threadCount = primitiveCount > 0 ? primitiveCount : 1;
+
+    GLTFImportJob job;
+    job.m_Primitives = primitives;
+    job.m_PrimitiveCount = primitiveCount;
+    job.m_ThreadCount = threadCount;
+    job.m_Positions = new float[vertexCount * 3 + 1];
+    job.m_Normals = new float[vertexCount * 3 + 1];
+    job.m_UVs = new float[vertexCount * 2 + 1];
+    job.m_Corners = new VertexRef[cornerCount + 1];
+    job.m_ThreadFailed = new bool[threadCount];
+    memset( job.m_ThreadFailed, 0, sizeof( bool ) * threadCount );
+
+    if( failed == false )
+    {
+        RunParallel( threadCount, ParseGLTFPrimitives, &job );
+
+        for( uint32 i=0; i<threadCount; i++ )
+        {
+            failed |= job.m_ThreadFailed[i];
+        }
+    }
+
+    double parseEndTime = GetSeconds();
+
+    if( failed == false && cornerCount > 0 )
+        failed = !DeduplicateVertices( job.m_Corners, cornerCount, job.m_Positions, vertexCount, job.m_UVs, vertexCount, job.m_Normals, vertexCount, pMesh );
+    else
+        failed = true;
+
+    double endTime = GetSeconds();
+
+    // External buffers count towards the bytes read.
+    uint64 bytesRead = fileSize;
+    for( uint32 i=0; i<bufferCount; i++ )
+    {
+        if( buffers[i].m_pExternalFile )
+            bytesRead += buffers[i].m_Size;
+    }
+
+    delete[] primitives;
+    delete[] job.m_Positions;
+    delete[] job.m_Normals;
+    delete[] job.m_UVs;
+    delete[] job.m_Corners;
+    delete[] job.m_ThreadFailed;
+
+    for( uint32 i=0; i<bufferCount; i++ )
+    {
+        delete buffers[i].m_pExternalFile;
+        delete[] buffers[i].m_pDecodedData;
+    }
+
+    if( failed )
+    {
+        pMesh->Destroy();
+        return false;
+    }
+
+    if( pStats )
+    {
+        pStats->m_FileBytes = bytesRead;
+        pStats->m_ThreadCount = threadCount;
+        pStats->m_TriangleCount = cornerCount / 3;
+        pStats->m_SourceVertexCount = vertexCount;
+        pStats->m_UniqueVertexCount = pMesh->m_VertexCount;
+        pStats->m_ParseSeconds = parseEndTime - startTime;
+        pStats->m_DedupeSeconds = endTime - parseEndTime;
+        pStats->m_TotalSeconds = endTime - startTime;
+    }
+
+    return true;
+}
+
+bool MeshImporter::IsOBJFilename(const char* filename)
+{
+    const char* pExtension = strrchr( filename, '.' );
+    return pExtension && (strcmp( pExtension, ".obj" ) == 0 || strcmp( pExtension, ".OBJ" ) == 0);
+}
+
+bool MeshImporter::Import(const char* filename, ImportedMesh* pMesh, uint32 threadCount, MeshImportStats* pStats)
+{
+    if( IsOBJFilename( filename ) )
+        return ImportOBJ( filename, pMesh, threadCount, pStats );
+
+    return ImportGLTF( filename, pMesh, threadCount, pStats );
+}
+
+bool MeshImporter::ImportFromMemory(const void* pData, uint64 size, const char* filename, ImportedMesh* pMesh, uint32 threadCount, MeshImportStats* pStats)
+{
+    if( IsOBJFilename( filename ) )
+        return ImportOBJFromMemory( pData, size, pMesh, threadCount, pStats );
+
+    return ImportGLTFFromMemory( pData, size, filename, pMesh, threadCount, pStats );
+}
+
+//====================================================================================================
+// Baking and output.
+//====================================================================================================
+
+// Area weighted vertex normals, for meshes imported without any.
+static float* CalculateNormals(const ImportedMesh& mesh)
+{
+    float* normals = new float[mesh.m_VertexCount * 3];
+    memset( normals, 0, sizeof( float ) * mesh.m_VertexCount * 3 );
+
+    for( uint32 i=0; i+2<mesh.m_IndexCount; i+=3 )
+    {
+        const float* p0 = &mesh.m_Positions[mesh.m_Indices[i+0]*3];
+        const float* p1 = &mesh.m_Positions[mesh.m_Indices[i+1]*3];
+        const float* p2 = &mesh.m_Positions[mesh.m_Indices[i+2]*3];
+
+        // Unnormalized, so larger triangles contribute more.
+        Vector3 edge1( p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] );
+        Vector3 edge2( p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] );
+        Vector3 faceNormal = edge1.Cross( edge2 );
+
+        for( int corner=0; corner<3; corner++ )
+        {
+            float* pNormal = &normals[mesh.m_Indices[i+corner]*3];
+            pNormal[0] += faceNormal.x;
+            pNormal[1] += faceNormal.y;
+            pNormal[2] += faceNormal.z;
+        }
+    }
+
+    for( uint32 v=0; v<mesh.m_VertexCount; v++ )
+    {
+        Vector3 normal( normals[v*3+0], normals[v*3+1], normals[v*3+2] );
+        normal.Normalize();
+        normals[v*3+0] = normal.x;
+        normals[v*3+1] = normal.y;
+        normals[v*3+2] = normal.z;
+    }
+
+    return normals;
+}
+
+void MeshImporter::Bake(const ImportedMesh& mesh, const VertexLayout& layout, BakedMesh* pBaked)
+{
+    assert( mesh.m_IndexCount % 3 == 0 );
+
+    pBaked->NullEverything();
+
+    // Reorder triangles on the float positions, before quantization.
+    uint32* cacheOptimized = new uint32[mesh.m_IndexCount];
+    uint32* optimized = new uint32[mesh.m_IndexCount];
+    MeshOptimizer::OptimizeVertexCache( cacheOptimized, mesh.m_Indices, mesh.m_IndexCount, mesh.m_VertexCount, MeshOptimizer::DEFAULT_CACHE_SIZE );
+    MeshOptimizer::OptimizeOverdraw( optimized, cacheOptimized, mesh.m_IndexCount, mesh.m_Positions, mesh.m_VertexCount, sizeof( float ) * 3, 0,
+                                     MeshOptimizer::DEFAULT_CACHE_SIZE, MeshOptimizer::DEFAULT_OVERDRAW_THRESHOLD_PERCENT );
+    delete[] cacheOptimized;
+
+    uint32 lodIndexCapacity = mesh.m_IndexCount * 2;
+    uint32* lodIndices = new uint32[lodIndexCapacity];
+    pBaked->m_LODCount = MeshSimplifier::GenerateLODs( lodIndices, lodIndexCapacity, pBaked->m_LODs, MAX_MESH_LODS, optimized, mesh.m_IndexCount, mesh.m_Positions, mesh.m_VertexCount, sizeof( float ) * 3, 0 );
+    delete[] optimized;
+
+    const MeshLOD& lastLOD = pBaked->m_LODs[pBaked->m_LODCount - 1];
+    pBaked->m_IndexCount = lastLOD.m_FirstIndex + lastLOD.m_IndexCount;
+
+    VulkanMesh::CalculateBoundingSphere( mesh.m_Positions, mesh.m_VertexCount, sizeof( float ) * 3, 0, &pBaked->m_BoundingCenter, &pBaked->m_BoundingRadius );
+
+    // Fill in attributes the layout wants but the file didn't have.
+    unsigned char* colors = nullptr;
+    float* normals = mesh.m_Normals;
+    float* uvs = mesh.m_UVs;
+
+    if( layout.GetFormat( VertexAttribute_Color ) != VertexAttributeFormat_None )
+    {
+        colors = new unsigned char[mesh.m_VertexCount * 4];
+        memset( colors, 0xFF, mesh.m_VertexCount * 4 );
+    }
+    if( layout.GetFormat( VertexAttribute_Normal ) != VertexAttributeFormat_None && normals == nullptr )
+    {
+        normals = CalculateNormals( mesh );
+    }
+    if( layout.GetFormat( VertexAttribute_UV ) != VertexAttributeFormat_None && uvs == nullptr )
+    {
+        uvs = new float[mesh.m_VertexCount * 2];
+        memset( uvs, 0, sizeof( float ) * mesh.m_VertexCount * 2 );
+    }
+
+    VertexStreams streams;
+    streams.m_Positions = mesh.m_Positions;
+    streams.m_Colors = colors;
+    streams.m_Normals = normals;
+    streams.m_UVs = uvs;
+
+    uint32 stride = layout.GetStride();
+    unsigned char* packed = new unsigned char[mesh.m_VertexCount * stride];
+    layout.PackVertices( packed, mesh.m_VertexCount, streams, &pBaked->m_QuantizationCenter, &pBaked->m_QuantizationExtents );
+
+    delete[] colors;
+    if( normals != mesh.m_Normals )
+        delete[] normals;
+    if( uvs != mesh.m_UVs )
+        delete[] uvs;
+
+    // Reorder vertices for fetch locality across all LODs, LOD 0 comes first so it sets the order.
+    pBaked->m_Vertices = new unsigned char[mesh.m_VertexCount * stride];
+    pBaked->m_VertexCount = MeshOptimizer::OptimizeVertexFetch( pBaked->m_Vertices, lodIndices, pBaked->m_IndexCount, packed, mesh.m_VertexCount, stride );
+    delete[] packed;
+
+    pBaked->m_Indices = lodIndices;
+}
+
+bool MeshImporter::CreateMesh(VulkanInterface* pInterface, const BakedMesh& baked, VulkanMesh* pMesh)
+{
+    assert( baked.m_LODCount > 0 );
+
+    if( pMesh->Create( pInterface->GetGeometryPool(), baked.m_Vertices, baked.m_VertexCount, baked.m_Indices, baked.m_IndexCount ) == false )
+        return false;
+
+    pMesh->SetLODs( baked.m_LODs, baked.m_LODCount );
+    pMesh->SetBounds( baked.m_BoundingCenter, baked.m_BoundingRadius );
+    pMesh->SetQuantization( baked.m_QuantizationCenter, baked.m_QuantizationExtents );
+    return true;
+}
+
+bool MeshImporter::SaveMeshFile(const char* filename, const VertexLayout& layout, const BakedMesh& baked)
+{
+    assert( baked.m_LODCount > 0 );
+
+    MeshFileContents contents;
+    contents.m_pLayout = &layout;
+    contents.m_Vertices = baked.m_Vertices;
+    contents.m_VertexCount = baked.m_VertexCount;
+    contents.m_IndexCount = baked.m_IndexCount;
+    contents.m_IndexType = VulkanMesh::ChooseIndexType( baked.m_VertexCount );
+    contents.m_pLODs = baked.m_LODs;
+    contents.m_LODCount = baked.m_LODCount;
+    contents.m_BoundingCenter = baked.m_BoundingCenter;
+    contents.m_BoundingRadius = baked.m_BoundingRadius;
+    contents.m_QuantizationCenter = baked.m_QuantizationCenter;
+    contents.m_QuantizationExtents = baked.m_QuantizationExtents;
+
+    // Store the narrowest index width so loading is a straight copy.
+    unsigned short* narrowIndices = nullptr;
+    if( contents.m_IndexType == VK_INDEX_TYPE_UINT16 )
+    {
+        narrowIndices = new unsigned short[baked.m_IndexCount];
+        for( uint32 i=0; i<baked.m_IndexCount; i++ )
+        {
+            narrowIndices[i] = (unsigned short)baked.m_Indices[i];
+        }
+        contents.m_Indices = narrowIndices;
+    }
+    else
+    {
+        contents.m_Indices = baked.m_Indices;
+    }
+
+    bool success = MeshFile::Save( filename, contents );
+
+    delete[] narrowIndices;
+
+    return success;
+}
+
+bool MeshImporter::WriteTestOBJ(const char* filename, uint32 segments)
+{
+    FILE* filehandle;
+    errno_t error = fopen_s( &filehandle, filename, "wb" );
+    if( error != 0 || filehandle == nullptr )
+        return false;
+
+    // A rippled grid in the XZ plane, normals from the height function's derivatives.
+    uint32 rowLength = segments + 1;
+    for( uint32 z=0; z<rowLength; z++ )
+    {
+        for( uint32 x=0; x<rowLength; x++ )
+        {
+            float u = (float)x / segments;
+            float v = (float)z / segments;
+            float height = 0.05f * sinf( u * 31.4f ) * cosf( v * 31.4f );
+            float dhdu = 0.05f * 31.4f * cosf( u * 31.4f ) * cosf( v * 31.4f );
+            float dhdv = -0.05f * 31.4f * sinf( u * 31.4f ) * sinf( v * 31.4f );
+            Vector3 normal = Vector3( -dhdu, 1.0f, -dhdv ).GetNormalized();
+
+            fprintf( filehandle, "v %f %f %f\n", u - 0.5f, height, v - 0.5f );
+            fprintf( filehandle, "vt %f %f\n", u, 1.0f - v );
+            fprintf( filehandle, "vn %f %f %f\n", normal.x, normal.y, normal.z );
+        }
+    }
+
+    for( uint32 z=0; z<segments; z++ )
+    {
+        for( uint32 x=0; x<segments; x++ )
+        {
+            uint32 i0 = z * rowLength + x + 1;
+            uint32 i1 = i0 + 1;
+            uint32 i2 = i0 + rowLength;
+            uint32 i3 = i2 + 1;
+            fprintf( filehandle, "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", i0, i0, i0, i2, i2, i2, i3, i3, i3, i1, i1, i1 );
+        }
+    }
+
+    return fclose( filehandle ) == 0;
+}
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __MeshImporter_H__
+#define __MeshImporter_H__
+
+#include "Math/MyTypes.h"
+#include "Math/Vector.h"
+#include "Mesh/MeshSimplifier.h"
+
+class VertexLayout;
+class VulkanInterface;
+class VulkanMesh;
+
+// Deduplicated, indexed geometry straight out of an importer, one float array per attribute.
+// Normals and UVs are null if the source file didn't have them.
+struct ImportedMesh
+{
+    float* m_Positions;
+    float* m_Normals;
+    float* m_UVs;
+    uint32 m_VertexCount;
+
+    uint32* m_Indices;
+    uint32 m_IndexCount;
+
+    void NullEverything();
+    void Destroy();
+};
+
+// Imported geometry converted to a vertex layout, cache optimized, with LODs.
+// m_Indices holds all LODs back-to-back, LOD 0 first.
+struct BakedMesh
+{
+    unsigned char* m_Vertices;
+    uint32 m_VertexCount;
+
+    uint32* m_Indices;
+    uint32 m_IndexCount;
+
+    MeshLOD m_LODs[MAX_MESH_LODS];
+    uint32 m_LODCount;
+
+    Vector3 m_BoundingCenter;
+    float m_BoundingRadius;
+    Vector3 m_QuantizationCenter;
+    Vector3 m_QuantizationExtents;
+
+    void NullEverything();
+    void Destroy();
+};
+
+struct MeshImportStats
+{
+    uint64 m_FileBytes;
+    uint32 m_ThreadCount;
+    uint32 m_TriangleCount;
+    uint32 m_SourceVertexCount; // Face corners for OBJ, accessor vertices for glTF.
+    uint32 m_UniqueVertexCount;
+
+    double m_ParseSeconds;
+    double m_DedupeSeconds;
+    double m_TotalSeconds;
+
+    double GetMegabytesPerSecond() const { return m_TotalSeconds > 0 ? m_FileBytes / (1024.0 * 1024.0) / m_TotalSeconds : 0; }
+    double GetTrianglesPerSecond() const { return m_TotalSeconds > 0 ? m_TriangleCount / m_TotalSeconds : 0; }
+};
+
+// Loads OBJ and glTF 2.0 (.gltf with external or embedded buffers, and .glb) files.
+// Files are memory mapped and parsed on multiple threads, then vertices are deduplicated with a hash map.
+class MeshImporter
+{
+public:
+    // threadCount 0 uses one thread per hardware thread.  pStats can be null.
+    static bool Import(const char* filename, ImportedMesh* pMesh, uint32 threadCount = 0, MeshImportStats* pStats = nullptr);
+    static bool ImportOBJ(const char* filename, ImportedMesh* pMesh, uint32 threadCount = 0, MeshImportStats* pStats = nullptr);
+    static bool ImportGLTF(const char* filename, ImportedMesh* pMesh, uint32 threadCount = 0, MeshImportStats* pStats = nullptr);
+
+    // Same as above for files already in memory.  filename picks the format and locates external glTF buffers.
+    static bool ImportFromMemory(const void* pData, uint64 size, const char* filename, ImportedMesh* pMesh, uint32 threadCount = 0, MeshImportStats* pStats = nullptr);
+    static bool ImportOBJFromMemory(const void* pData, uint64 size, ImportedMesh* pMesh, uint32 threadCount = 0, MeshImportStats* pStats = nullptr);
+    static bool ImportGLTFFromMemory(const void* pData, uint64 size, const char* filename, ImportedMesh* pMesh, uint32 threadCount = 0, MeshImportStats* pStats = nullptr);
+    static bool IsOBJFilename(const char* filename);
+
+    // Packs vertices into the layout, optimizes for the vertex cache and overdraw, and builds LODs.
+    static void Bake(const ImportedMesh& mesh, const VertexLayout& layout, BakedMesh* pBaked);
+
+    // Fails if the interface's geometry pool has no room left.
+    static bool CreateMesh(VulkanInterface* pInterface, const BakedMesh& baked, VulkanMesh* pMesh);
+    static bool SaveMeshFile(const char* filename, const VertexLayout& layout, const BakedMesh& baked);
+
+    // Writes a displaced grid with positions, normals and UVs, segments*segments*2 triangles.  For throughput testing.
+    static bool WriteTestOBJ(const char* filename, uint32 segments);
+};
+
+#endif //__MeshImporter_H__
@@ -0,0 +1,427 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+
+#include "Math/MyTypes.h"
+#include "Math/Vector.h"
+
+#include "MeshOptimizer.h"
+
+void VertexTriangleAdjacency::Create(const uint32* indices, uint32 indexCount, uint32 vertexCount)
+{
+    m_Counts = new uint32[vertexCount];
+    m_Offsets = new uint32[vertexCount];
+    m_Triangles = new uint32[indexCount];
+
+    memset( m_Counts, 0, sizeof( uint32 ) * vertexCount );
+    for( uint32 i=0; i<indexCount; i++ )
+    {
+        assert( indices[i] < vertexCount );
+        m_Counts[indices[i]]++;
+    }
+
+    uint32 offset = 0;
+    for( uint32 v=0; v<vertexCount; v++ )
+    {
+        m_Offsets[v] = offset;
+        offset += m_Counts[v];
+    }
+
+    // Fill the lists, using m_Offsets as a cursor then rewinding it.
+    for( uint32 i=0; i<indexCount; i++ )
+    {
+        m_Triangles[m_Offsets[indices[i]]++] = i / 3;
+    }
+    for( uint32 v=0; v<vertexCount; v++ )
+    {
+        m_Offsets[v] -= m_Counts[v];
+    }
+}
+
+void VertexTriangleAdjacency::Destroy()
+{
+    delete[] m_Counts;
+    delete[] m_Offsets;
+    delete[] m_Triangles;
+}
+
+void MeshOptimizer::AnalyzeVertexCache(const uint32* indices, uint32 indexCount, uint32 vertexCount, uint32 cacheSize, MeshOptimizerStats* pStats)
+{
+    assert( indexCount % 3 == 0 );
+    assert( pStats != nullptr );
+
+    // A vertex is in the cache if fewer than cacheSize misses have happened since it was inserted.
+    uint32* timestamps = new uint32[vertexCount];
+    memset( timestamps, 0, sizeof( uint32 ) * vertexCount );
+    uint32 time = cacheSize + 1;
+
+    uint32 misses = 0;
+    uint32 uniqueVertices = 0;
+    for( uint32 i=0; i<indexCount; i++ )
+    {
+        uint32 v = indices[i];
+        if( time - timestamps[v] > cacheSize )
+        {
+            if( timestamps[v] == 0 )
+                uniqueVertices++;
+
+            timestamps[v] = time++;
+            misses++;
+        }
+    }
+
+    delete[] timestamps;
+
+    uint32 triangleCount = indexCount / 3;
+    pStats->m_VertexShaderInvocations = misses;
+    pStats->m_ACMR = triangleCount ? (float)misses / triangleCount : 0.0f;
+    pStats->m_ATVR = uniqueVertices ? (float)misses / uniqueVertices : 0.0f;
+}
+
+// Picks the next fanning vertex for Tipsify: the candidate that will still be in the cache after
+// emitting its remaining triangles and has been there longest, falling back to the dead-end stack.
+static int TipsifyNextVertex(uint32* pCursor, uint32 vertexCount, const uint32* liveTriangles, const uint32* timestamps, uint32 time, uint32 cacheSize,
+                             const uint32* candidates, uint32 candidateCount, uint32* deadEndStack, uint32* pDeadEndCount)
+{
+    int bestVertex = -1;
+    int bestPriority = -1;
+
+    for( uint32 i=0; i<candidateCount; i++ )
+    {
+        uint32 v = candidates[i];
+        if( liveTriangles[v] == 0 )
+            continue;
+
+        int priority = 0;
+        if( time - timestamps[v] + 2 * liveTriangles[v] <= cacheSize )
+            priority = time - timestamps[v];
+
+        if( priority > bestPriority )
+        {
+            bestPriority = priority;
+            bestVertex = v;
+        }
+    }
+
+    if( bestVertex != -1 )
+        return bestVertex;
+
+    // Dead end, try recently used vertices.
+    while( *pDeadEndCount > 0 )
+    {
+        uint32 v = deadEndStack[--(*pDeadEndCount)];
+        if( liveTriangles[v] > 0 )
+            return v;
+    }
+
+    // Fall back to the next vertex in input order with triangles left.
+    while( *pCursor < vertexCount )
+    {
+        uint32 v = (*pCursor)++;
+        if( liveTriangles[v] > 0 )
+            return v;
+    }
+
+    return -1;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32* destination, const uint32* indices, uint32 indexCount, uint32 vertexCount, uint32 cacheSize)
+{
+    assert( indexCount % 3 == 0 );
+    assert( destination != indices );
+
+    uint32 triangleCount = indexCount / 3;
+    if( triangleCount == 0 )
+        return;
+
+    VertexTriangleAdjacency adjacency;
+    adjacency.Create( indices, indexCount, vertexCount );
+
+    uint32* liveTriangles = new uint32[vertexCount];
+    memcpy( liveTriangles, adjacency.m_Counts, sizeof( uint32 ) * vertexCount );
+
+    uint32* timestamps = new uint32[vertexCount];
+    memset( timestamps, 0, sizeof( uint32 ) * vertexCount );
+
+    bool* emitted = new bool[triangleCount];
+    memset( emitted, 0, sizeof( bool ) * triangleCount );
+
+    // Every emitted index is pushed once, so the stack can't outgrow the index count.
+    uint32* deadEndStack = new uint32[indexCount];
+    uint32 deadEndCount = 0;
+
+    uint32* candidates = new uint32[indexCount];
+
+    uint32 time = cacheSize + 1;
+    uint32 cursor = 0;
+    uint32 outputCount = 0;
+
+    int fanningVertex = indices[0];
+    while( fanningVertex >= 0 )
+    {
+        uint32 candidateCount = 0;
+
+        // Emit every remaining triangle around the fanning vertex.
+        uint32 adjacencyStart = adjacency.m_Offsets[fanningVertex];
+        uint32 adjacencyCount = adjacency.m_Counts[fanningVertex];
+        for( uint32 a=0; a<adjacencyCount; a++ )
+        {
+            uint32 triangle = adjacency.m_Triangles[adjacencyStart + a];
+            if( emitted[triangle] )
+                continue;
+
+            for( uint32 k=0; k<3; k++ )
+            {
+                uint32 v = indices[triangle*3 + k];
+
+                destination[outputCount++] = v;
+                deadEndStack[deadEndCount++] = v;
+                candidates[candidateCount++] = v;
+                liveTriangles[v]--;
+
+                if( time - timestamps[v] > cacheSize )
+                    timestamps[v] = time++;
+            }
+
+            emitted[triangle] = true;
+        }
+
+        fanningVertex = TipsifyNextVertex( &cursor, vertexCount, liveTriangles, timestamps, time, cacheSize,
+                                           candidates, candidateCount, deadEndStack, &deadEndCount );
+    }
+
+    assert( outputCount == indexCount );
+
+    delete[] candidates;
+    delete[] deadEndStack;
+    delete[] emitted;
+    delete[] timestamps;
+    delete[] liveTriangles;
+    adjacency.Destroy();
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32* destination, const uint32* indices, uint32 indexCount, const void* vertices, uint32 vertexCount, uint32 vertexStride, uint32 positionOffset, uint32 cacheSize, uint32 thresholdPercent)
+{
+    assert( indexCount % 3 == 0 );
+    assert( destination != indices );
+
+    uint32 triangleCount = indexCount / 3;
+    if( triangleCount == 0 )
+        return;
+
+    uint32* clusterStarts = new uint32[triangleCount + 1];
+    uint32 clusterCount = 0;
+
+    uint32* timestamps = new uint32[vertexCount];
+
+    // Hard boundaries: triangles where all 3 vertices miss the cache, the cache optimizer jumped there.
+    // Soft boundaries: split each hard cluster further whenever the running ACMR drops under the cluster's ACMR scaled by the threshold.
+    {
+        uint32* hardStarts = new uint32[triangleCount + 1];
+        uint32 hardCount = 0;
+
+        memset( timestamps, 0, sizeof( uint32 ) * vertexCount );
+        uint32 time = cacheSize + 1;
+
+        unsigned char* triangleMisses = new unsigned char[triangleCount];
+        for( uint32 t=0; t<triangleCount; t++ )
+        {
+            unsigned char misses = 0;
+            for( uint32 k=0; k<3; k++ )
+            {
+                uint32 v = indices[t*3 + k];
+                if( time - timestamps[v] > cacheSize )
+                {
+                    timestamps[v] = time++;
+                    misses++;
+                }
+            }
+            triangleMisses[t] = misses;
+
+            if( t == 0 || misses == 3 )
+                hardStarts[hardCount++] = t;
+        }
+        hardStarts[hardCount] = triangleCount;
+
+        for( uint32 h=0; h<hardCount; h++ )
+        {
+            uint32 start = hardStarts[h];
+            uint32 end = hardStarts[h+1];
+
+            uint32 clusterMisses = 0;
+            for( uint32 t=start; t<end; t++ )
+                clusterMisses += triangleMisses[t];
+            float clusterThreshold = (float)clusterMisses / (end - start) * thresholdPercent / 100.0f;
+
+            clusterStarts[clusterCount++] = start;
+
+            // Re-simulate the cache from empty for each soft cluster, since clusters will be reordered.
+            memset( timestamps, 0, sizeof( uint32 ) * vertexCount );
+            time = cacheSize + 1;
+
+            uint32 softStart = start;
+            uint32 softMisses = 0;
+            for( uint32 t=start; t<end; t++ )
+            {
+                for( uint32 k=0; k<3; k++ )
+                {
+                    uint32 v = indices[t*3 + k];
+                    if( time - timestamps[v] > cacheSize )
+                    {
+                        timestamps[v] = time++;
+                        softMisses++;
+                    }
+                }
+
+                if( t+1 < end && (float)softMisses / (t + 1 - softStart) <= clusterThreshold )
+                {
+                    clusterStarts[clusterCount++] = t+1;
+                    softStart = t+1;
+                    softMisses = 0;
+
+                    memset( timestamps, 0, sizeof( uint32 ) * vertexCount );
+                    time = cacheSize + 1;
+                }
+            }
+        }
+        clusterStarts[clusterCount] = triangleCount;
+
+        delete[] triangleMisses;
+        delete[] hardStarts;
+    }
+
+    // Find the mesh centroid.
+    const char* pVertexBytes = (const char*)vertices;
+    Vector3 meshCentroid( 0, 0, 0 );
+    for( uint32 i=0; i<indexCount; i++ )
+    {
+        const float* pos = (const float*)(pVertexBytes + indices[i] * vertexStride + positionOffset);
+        meshCentroid += Vector3( pos[0], pos[1], pos[2] );
+    }
+    meshCentroid /= (float)indexCount;
+
+    // Score each cluster by how much it faces away from the mesh centroid, outward facing clusters draw first.
+    float* sortKeys = new float[clusterCount];
+    uint32* clusterOrder = new uint32[clusterCount];
+    for( uint32 c=0; c<clusterCount; c++ )
+    {
+        Vector3 clusterCentroid( 0, 0, 0 );
+        Vector3 clusterNormal( 0, 0, 0 );
+        float clusterArea = 0;
+
+        for( uint32 t=clusterStarts[c]; t<clusterStarts[c+1]; t++ )
+        {
+            const float* p0 = (const float*)(pVertexBytes + indices[t*3 + 0] * vertexStride + positionOffset);
+            const float* p1 = (const float*)(pVertexBytes + indices[t*3 + 1] * vertexStride + positionOffset);
+            const float* p2 = (const float*)(pVertexBytes + indices[t*3 + 2] * vertexStride + positionOffset);
+
+            Vector3 v0( p0[0], p0[1], p0[2] );
+            Vector3 v1( p1[0], p1[1], p1[2] );
+            Vector3 v2( p2[0], p2[1], p2[2] );
+
+            // Area weighted normal, length is twice the triangle area.
+            Vector3 normal = (v1 - v0).Cross( v2 - v0 );
+            float area = normal.Length();
+
+            clusterCentroid += (v0 + v1 + v2) * (area / 3.0f);
+            clusterNormal += normal;
+            clusterArea += area;
+        }
+
+        if( clusterArea > 0 )
+            clusterCentroid /= clusterArea;
+
+        clusterNormal.Normalize();
+        sortKeys[c] = (clusterCentroid - meshCentroid).Dot( clusterNormal );
+        clusterOrder[c] = c;
+    }
+
+    // Sort by descending key, stable so tied clusters keep their cache optimized order and bakes are deterministic.
+    std::stable_sort( clusterOrder, clusterOrder + clusterCount, [sortKeys](uint32 a, uint32 b) { return sortKeys[a] > sortKeys[b]; } );
+
+    uint32 outputCount = 0;
+    for( uint32 i=0; i<clusterCount; i++ )
+    {
+        uint32 c = clusterOrder[i];
+        uint32 clusterIndexCount = (clusterStarts[c+1] - clusterStarts[c]) * 3;
+        memcpy( &destination[outputCount], &indices[clusterStarts[c] * 3], sizeof( uint32 ) * clusterIndexCount );
+        outputCount += clusterIndexCount;
+    }
+    assert( outputCount == indexCount );
+
+    delete[] clusterOrder;
+    delete[] sortKeys;
+    delete[] timestamps;
+    delete[] clusterStarts;
+}
+
+uint32 MeshOptimizer::OptimizeVertexFetch(void* destinationVertices, uint32* indices, uint32 indexCount, const void* vertices, uint32 vertexCount, uint32 vertexStride)
+{
+    assert( destinationVertices != vertices );
+
+    uint32* remap = new uint32[vertexCount];
+    memset( remap, 0xFF, sizeof( uint32 ) * vertexCount );
+
+    uint32 newVertexCount = 0;
+    for( uint32 i=0; i<indexCount; i++ )
+    {
+        uint32 v = indices[i];
+        assert( v < vertexCount );
+
+        if( remap[v] == UINT_MAX )
+        {
+            memcpy( (char*)destinationVertices + newVertexCount * vertexStride, (const char*)vertices + v * vertexStride, vertexStride );
+            remap[v] = newVertexCount++;
+        }
+
+        indices[i] = remap[v];
+    }
+
+    delete[] remap;
+
+    return newVertexCount;
+}
+
+void MeshOptimizer::OptimizeMesh(void* vertices, uint32* pVertexCount, uint32 vertexStride, uint32 positionOffset, uint32* indices, uint32 indexCount, bool optimizeOverdraw, MeshOptimizerStats* pStatsBefore, MeshOptimizerStats* pStatsAfter)
+{
+    uint32 vertexCount = *pVertexCount;
+
+    if( pStatsBefore )
+        AnalyzeVertexCache( indices, indexCount, vertexCount, DEFAULT_CACHE_SIZE, pStatsBefore );
+
+    uint32* tempIndices = new uint32[indexCount];
+
+    OptimizeVertexCache( tempIndices, indices, indexCount, vertexCount, DEFAULT_CACHE_SIZE );
+
+    if( optimizeOverdraw )
+    {
+        OptimizeOverdraw( indices, tempIndices, indexCount, vertices, vertexCount, vertexStride, positionOffset, DEFAULT_CACHE_SIZE, DEFAULT_OVERDRAW_THRESHOLD_PERCENT );
+    }
+    else
+    {
+        memcpy( indices, tempIndices, sizeof( uint32 ) * indexCount );
+    }
+
+    delete[] tempIndices;
+
+    // Vertex fetch order follows the final index order.
+    char* tempVertices = new char[vertexCount * vertexStride];
+    vertexCount = OptimizeVertexFetch( tempVertices, indices, indexCount, vertices, vertexCount, vertexStride );
+    memcpy( vertices, tempVertices, vertexCount * vertexStride );
+    delete[] tempVertices;
+
+    *pVertexCount = vertexCount;
+
+    if( pStatsAfter )
+        AnalyzeVertexCache( indices, indexCount, vertexCount, DEFAULT_CACHE_SIZE, pStatsAfter );
+}
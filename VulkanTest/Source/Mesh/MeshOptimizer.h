@@ -0,0 +1,63 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __MeshOptimizer_H__
+#define __MeshOptimizer_H__
+
+#include "Math/MyTypes.h"
+
+// Triangle adjacency for each vertex, stored as one flat list with per-vertex offsets.
+struct VertexTriangleAdjacency
+{
+    uint32* m_Counts;
+    uint32* m_Offsets;
+    uint32* m_Triangles;
+
+    void Create(const uint32* indices, uint32 indexCount, uint32 vertexCount);
+    void Destroy();
+};
+
+struct MeshOptimizerStats
+{
+    float m_ACMR; // Average cache miss ratio, vertex shader invocations per triangle. 0.5 is ideal, 3.0 is worst.
+    float m_ATVR; // Average transformed vertex ratio, vertex shader invocations per unique vertex. 1.0 is ideal.
+    uint32 m_VertexShaderInvocations;
+};
+
+// Load-time index and vertex reordering for triangle lists.
+// Indices are 32-bit here, VulkanMesh narrows them to 16-bit afterwards if the vertex count allows it.
+class MeshOptimizer
+{
+public:
+    static const uint32 DEFAULT_CACHE_SIZE = 16;
+    static const uint32 DEFAULT_OVERDRAW_THRESHOLD_PERCENT = 105; // Allow clusters to be 5% worse than cache optimal.
+
+public:
+    // Simulates a FIFO post-transform cache.
+    static void AnalyzeVertexCache(const uint32* indices, uint32 indexCount, uint32 vertexCount, uint32 cacheSize, MeshOptimizerStats* pStats);
+
+    // Reorders triangles for post-transform cache locality (Tipsify, Sander et al. 2007).
+    // destination and indices must not overlap.
+    static void OptimizeVertexCache(uint32* destination, const uint32* indices, uint32 indexCount, uint32 vertexCount, uint32 cacheSize);
+
+    // Splits a cache optimized index list into clusters and sorts them front-to-back from the outside in,
+    // keeping the cache efficiency within thresholdPercent of the input.
+    // destination and indices must not overlap.
+    static void OptimizeOverdraw(uint32* destination, const uint32* indices, uint32 indexCount, const void* vertices, uint32 vertexCount, uint32 vertexStride, uint32 positionOffset, uint32 cacheSize, uint32 thresholdPercent);
+
+    // Reorders vertices in the order they're first referenced and remaps indices to match, unused vertices are dropped.
+    // destinationVertices and vertices must not overlap. Returns the new vertex count.
+    static uint32 OptimizeVertexFetch(void* destinationVertices, uint32* indices, uint32 indexCount, const void* vertices, uint32 vertexCount, uint32 vertexStride);
+
+    // Runs all of the above in place, positions must be 3 floats at positionOffset in each vertex.
+    // Either stats pointer can be null.
+    static void OptimizeMesh(void* vertices, uint32* pVertexCount, uint32 vertexStride, uint32 positionOffset, uint32* indices, uint32 indexCount, bool optimizeOverdraw, MeshOptimizerStats* pStatsBefore, MeshOptimizerStats* pStatsAfter);
+};
+
+#endif //__MeshOptimizer_H__
@@ -0,0 +1,393 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Math/MyTypes.h"
+#include "Math/Vector.h"
+
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+// Symmetric 4x4 matrix of the sum of squared distances to a set of planes, weighted by triangle area.
+struct Quadric
+{
+    double a2, ab, ac, ad;
+    double b2, bc, bd;
+    double c2, cd;
+    double d2;
+    double weight;
+
+    void Clear()
+    {
+        a2 = ab = ac = ad = b2 = bc = bd = c2 = cd = d2 = weight = 0;
+    }
+
+    void AddPlane(double a, double b, double c, double d, double w)
+    {
+        a2 += a*a*w; ab += a*b*w; ac += a*c*w; ad += a*d*w;
+        b2 += b*b*w; bc += b*c*w; bd += b*d*w;
+        c2 += c*c*w; cd += c*d*w;
+        d2 += d*d*w;
+        weight += w;
+    }
+
+    void Add(const Quadric& o)
+    {
+        a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+        b2 += o.b2; bc += o.bc; bd += o.bd;
+        c2 += o.c2; cd += o.cd;
+        d2 += o.d2;
+        weight += o.weight;
+    }
+
+    // Average squared distance from p to the planes.
+    double Evaluate(const Vector3& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double error = a2*x*x + 2*ab*x*y + 2*ac*x*z + 2*ad*x
+                     + b2*y*y + 2*bc*y*z + 2*bd*y
+                     + c2*z*z + 2*cd*z
+                     + d2;
+
+        if( weight > 0 )
+            error /= weight;
+
+        return error < 0 ? 0 : error;
+    }
+};
+
+struct EdgeCollapse
+{
+    uint32 m_From;
+    uint32 m_To;
+    float m_Cost;
+};
+
+static int CompareEdgeCollapseCost(const void* a, const void* b)
+{
+    float costA = ((const EdgeCollapse*)a)->m_Cost;
+    float costB = ((const EdgeCollapse*)b)->m_Cost;
+
+    if( costA < costB ) return -1;
+    if( costA > costB ) return 1;
+    return 0;
+}
+
+static Vector3 GetPosition(const void* vertices, uint32 vertexStride, uint32 positionOffset, uint32 index)
+{
+    const float* pPosition = (const float*)((const char*)vertices + index * vertexStride + positionOffset);
+    return Vector3( pPosition[0], pPosition[1], pPosition[2] );
+}
+
+// Marks vertices with at least one edge used by only a single triangle.
+static void FindBorderVertices(bool* isBorder, const uint32* indices, uint32 indexCount, uint32 vertexCount)
+{
+    VertexTriangleAdjacency adjacency;
+    adjacency.Create( indices, indexCount, vertexCount );
+
+    // Scratch space for the neighbours of one vertex, grown as needed.
+    uint32 maxNeighbours = 64;
+    uint32* neighbours = new uint32[maxNeighbours];
+
+    for( uint32 v=0; v<vertexCount; v++ )
+    {
+        isBorder[v] = false;
+
+        uint32 triangleCount = adjacency.m_Counts[v];
+        if( triangleCount * 2 > maxNeighbours )
+        {
+            delete[] neighbours;
+            maxNeighbours = triangleCount * 2;
+            neighbours = new uint32[maxNeighbours];
+        }
+
+        uint32 neighbourCount = 0;
+        for( uint32 a=0; a<triangleCount; a++ )
+        {
+            uint32 triangle = adjacency.m_Triangles[adjacency.m_Offsets[v] + a];
+            for( uint32 k=0; k<3; k++ )
+            {
+                uint32 w = indices[triangle*3 + k];
+                if( w != v )
+                    neighbours[neighbourCount++] = w;
+            }
+        }
+
+        // On a closed manifold every neighbour is shared by exactly two of this vertex's triangles.
+        for( uint32 i=0; i<neighbourCount && isBorder[v] == false; i++ )
+        {
+            uint32 occurrences = 0;
+            for( uint32 j=0; j<neighbourCount; j++ )
+            {
+                if( neighbours[j] == neighbours[i] )
+                    occurrences++;
+            }
+
+            if( occurrences == 1 )
+                isBorder[v] = true;
+        }
+    }
+
+    delete[] neighbours;
+    adjacency.Destroy();
+}
+
+// Returns true if moving vertex 'from' onto 'to' would flip any of the surrounding triangles.
+static bool CollapseFlipsTriangles(uint32 from, uint32 to, const uint32* indices, const VertexTriangleAdjacency& adjacency, const void* vertices, uint32 vertexStride, uint32 positionOffset)
+{
+    Vector3 newPosition = GetPosition( vertices, vertexStride, positionOffset, to );
+
+    for( uint32 a=0; a<adjacency.m_Counts[from]; a++ )
+    {
+        uint32 triangle = adjacency.m_Triangles[adjacency.m_Offsets[from] + a];
+        uint32 i0 = indices[triangle*3 + 0];
+        uint32 i1 = indices[triangle*3 + 1];
+        uint32 i2 = indices[triangle*3 + 2];
+
+        // Triangles using the collapsed edge become degenerate and are removed.
+        if( i0 == to || i1 == to || i2 == to )
+            continue;
+
+        Vector3 p0 = GetPosition( vertices, vertexStride, positionOffset, i0 );
+        Vector3 p1 = GetPosition( vertices, vertexStride, positionOffset, i1 );
+        Vector3 p2 = GetPosition( vertices, vertexStride, positionOffset, i2 );
+
+        Vector3 oldNormal = (p1 - p0).Cross( p2 - p0 );
+
+        if( i0 == from ) p0 = newPosition;
+        if( i1 == from ) p1 = newPosition;
+        if( i2 == from ) p2 = newPosition;
+
+        Vector3 newNormal = (p1 - p0).Cross( p2 - p0 );
+
+        if( oldNormal.Dot( newNormal ) <= 0 )
+            return true;
+    }
+
+    return false;
+}
+
+uint32 MeshSimplifier::Simplify(uint32* destination, const uint32* indices, uint32 indexCount, const void* vertices, uint32 vertexCount, uint32 vertexStride, uint32 positionOffset,
+                                uint32 targetIndexCount, float maxError, float* pResultError)
+{
+    assert( indexCount % 3 == 0 );
+
+    if( destination != indices )
+        memcpy( destination, indices, sizeof( uint32 ) * indexCount );
+
+    float resultError = 0;
+
+    bool* isLocked = new bool[vertexCount];
+    FindBorderVertices( isLocked, destination, indexCount, vertexCount );
+
+    // Build the initial quadric for each vertex from the planes of its triangles.
+    Quadric* quadrics = new Quadric[vertexCount];
+    for( uint32 v=0; v<vertexCount; v++ )
+    {
+        quadrics[v].Clear();
+    }
+
+    for( uint32 t=0; t<indexCount/3; t++ )
+    {
+        Vector3 p0 = GetPosition( vertices, vertexStride, positionOffset, destination[t*3 + 0] );
+        Vector3 p1 = GetPosition( vertices, vertexStride, positionOffset, destination[t*3 + 1] );
+        Vector3 p2 = GetPosition( vertices, vertexStride, positionOffset, destination[t*3 + 2] );
+
+        Vector3 normal = (p1 - p0).Cross( p2 - p0 );
+        float doubleArea = normal.Length();
+        if( doubleArea == 0 )
+            continue;
+
+        normal /= doubleArea;
+        float d = -normal.Dot( p0 );
+
+        for( uint32 k=0; k<3; k++ )
+        {
+            quadrics[destination[t*3 + k]].AddPlane( normal.x, normal.y, normal.z, d, doubleArea * 0.5f );
+        }
+    }
+
+    float maxErrorSquared = maxError * maxError;
+
+    uint32* remap = new uint32[vertexCount];
+    bool* isTouched = new bool[vertexCount];
+    EdgeCollapse* collapses = new EdgeCollapse[indexCount];
+
+    // Each pass collapses the cheapest independent edges, then rebuilds the index list.
+    while( indexCount > targetIndexCount )
+    {
+        VertexTriangleAdjacency adjacency;
+        adjacency.Create( destination, indexCount, vertexCount );
+
+        // Cost each edge in its cheapest direction, an edge shared by two triangles is simply considered twice.
+        uint32 collapseCount = 0;
+        for( uint32 t=0; t<indexCount/3; t++ )
+        {
+            for( uint32 k=0; k<3; k++ )
+            {
+                uint32 v0 = destination[t*3 + k];
+                uint32 v1 = destination[t*3 + (k+1)%3];
+
+                float cost01 = FLT_MAX;
+                float cost10 = FLT_MAX;
+
+                if( isLocked[v0] == false )
+                {
+                    Quadric q = quadrics[v0];
+                    q.Add( quadrics[v1] );
+                    cost01 = (float)q.Evaluate( GetPosition( vertices, vertexStride, positionOffset, v1 ) );
+                }
+
+                if( isLocked[v1] == false )
+                {
+                    Quadric q = quadrics[v1];
+                    q.Add( quadrics[v0] );
+                    cost10 = (float)q.Evaluate( GetPosition( vertices, vertexStride, positionOffset, v0 ) );
+                }
+
+                if( cost01 == FLT_MAX && cost10 == FLT_MAX )
+                    continue;
+
+                EdgeCollapse& collapse = collapses[collapseCount++];
+                collapse.m_From = cost01 <= cost10 ? v0 : v1;
+                collapse.m_To = cost01 <= cost10 ? v1 : v0;
+                collapse.m_Cost = cost01 <= cost10 ? cost01 : cost10;
+            }
+        }
+
+        qsort( collapses, collapseCount, sizeof( EdgeCollapse ), CompareEdgeCollapseCost );
+
+        for( uint32 v=0; v<vertexCount; v++ )
+        {
+            remap[v] = v;
+            isTouched[v] = false;
+        }
+
+        // Most collapses remove two triangles.
+        uint32 collapsesWanted = (indexCount - targetIndexCount) / 6 + 1;
+        uint32 collapsesDone = 0;
+
+        for( uint32 i=0; i<collapseCount && collapsesDone < collapsesWanted; i++ )
+        {
+            const EdgeCollapse& collapse = collapses[i];
+
+            if( collapse.m_Cost > maxErrorSquared )
+                break;
+
+            if( isTouched[collapse.m_From] || isTouched[collapse.m_To] )
+                continue;
+
+            if( CollapseFlipsTriangles( collapse.m_From, collapse.m_To, destination, adjacency, vertices, vertexStride, positionOffset ) )
+                continue;
+
+            remap[collapse.m_From] = collapse.m_To;
+            quadrics[collapse.m_To].Add( quadrics[collapse.m_From] );
+
+            // Lock the whole neighbourhood for the rest of the pass so flip checks stay valid.
+            for( uint32 a=0; a<adjacency.m_Counts[collapse.m_From]; a++ )
+            {
+                uint32 triangle = adjacency.m_Triangles[adjacency.m_Offsets[collapse.m_From] + a];
+                isTouched[destination[triangle*3 + 0]] = true;
+                isTouched[destination[triangle*3 + 1]] = true;
+                isTouched[destination[triangle*3 + 2]] = true;
+            }
+
+            IncreaseIfBigger( resultError, collapse.m_Cost );
+            collapsesDone++;
+        }
+
+        adjacency.Destroy();
+
+        if( collapsesDone == 0 )
+            break;
+
+        // Apply the collapses and drop triangles that became degenerate.
+        uint32 newIndexCount = 0;
+        for( uint32 t=0; t<indexCount/3; t++ )
+        {
+            uint32 i0 = remap[destination[t*3 + 0]];
+            uint32 i1 = remap[destination[t*3 + 1]];
+            uint32 i2 = remap[destination[t*3 + 2]];
+
+            if( i0 == i1 || i1 == i2 || i2 == i0 )
+                continue;
+
+            destination[newIndexCount++] = i0;
+            destination[newIndexCount++] = i1;
+            destination[newIndexCount++] = i2;
+        }
+        indexCount = newIndexCount;
+    }
+
+    delete[] collapses;
+    delete[] isTouched;
+    delete[] remap;
+    delete[] quadrics;
+    delete[] isLocked;
+
+    if( pResultError )
+        *pResultError = sqrtf( resultError );
+
+    return indexCount;
+}
+
+uint32 MeshSimplifier::GenerateLODs(uint32* pDestinationIndices, uint32 destinationCapacity, MeshLOD* pLODs, uint32 maxLODs, const uint32* indices, uint32 indexCount,
+                                    const void* vertices, uint32 vertexCount, uint32 vertexStride, uint32 positionOffset)
+{
+    assert( maxLODs > 0 && maxLODs <= MAX_MESH_LODS );
+    assert( destinationCapacity >= indexCount );
+
+    // LOD 0 is the full mesh.
+    memcpy( pDestinationIndices, indices, sizeof( uint32 ) * indexCount );
+    pLODs[0].m_FirstIndex = 0;
+    pLODs[0].m_IndexCount = indexCount;
+    pLODs[0].m_Error = 0;
+
+    uint32* tempIndices = new uint32[indexCount];
+
+    uint32 lodCount = 1;
+    while( lodCount < maxLODs )
+    {
+        const MeshLOD& previous = pLODs[lodCount-1];
+        const uint32* previousIndices = &pDestinationIndices[previous.m_FirstIndex];
+
+        // Simplify from the previous level, it's cheaper and keeps the levels nested.
+        uint32 targetIndexCount = (previous.m_IndexCount / 6) * 3;
+        float error;
+        uint32 newIndexCount = Simplify( tempIndices, previousIndices, previous.m_IndexCount, vertices, vertexCount, vertexStride, positionOffset,
+                                         targetIndexCount, FLT_MAX, &error );
+
+        // Stop if this level didn't remove at least 10% of the triangles, it isn't worth the index memory.
+        if( newIndexCount == 0 || newIndexCount > previous.m_IndexCount * 9 / 10 )
+            break;
+
+        // Levels that only shrink a little can add up to more than 2*indexCount, stop rather than overflow.
+        uint32 firstIndex = previous.m_FirstIndex + previous.m_IndexCount;
+        if( newIndexCount > destinationCapacity - firstIndex )
+            break;
+
+        // The error was measured against the previous level, add it so each LOD's error is relative to LOD 0.
+        MeshLOD& lod = pLODs[lodCount];
+        lod.m_FirstIndex = firstIndex;
+        lod.m_IndexCount = newIndexCount;
+        lod.m_Error = previous.m_Error + error;
+
+        MeshOptimizer::OptimizeVertexCache( &pDestinationIndices[lod.m_FirstIndex], tempIndices, newIndexCount, vertexCount, MeshOptimizer::DEFAULT_CACHE_SIZE );
+
+        lodCount++;
+    }
+
+    delete[] tempIndices;
+
+    return lodCount;
+}
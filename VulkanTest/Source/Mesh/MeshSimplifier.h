@@ -0,0 +1,44 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __MeshSimplifier_H__
+#define __MeshSimplifier_H__
+
+#include "Math/MyTypes.h"
+
+static const int MAX_MESH_LODS = 4;
+
+// A range of a mesh's index list, all LODs of a mesh share its vertices.
+struct MeshLOD
+{
+    uint32 m_FirstIndex;
+    uint32 m_IndexCount;
+    float m_Error; // Bound on how far simplification moved the surface from LOD 0, in object space units. 0 for the full detail mesh.
+};
+
+// Quadric error metric edge collapse (Garland and Heckbert 1997).
+// Vertices are only collapsed onto existing vertices, so simplified index lists reuse the original vertex buffer.
+// Vertices on open borders (including attribute seams, which are borders in the index topology) are never moved.
+class MeshSimplifier
+{
+public:
+    // Returns the new index count, which may be larger than targetIndexCount if maxError was reached first.
+    // destination and indices can be the same.
+    static uint32 Simplify(uint32* destination, const uint32* indices, uint32 indexCount, const void* vertices, uint32 vertexCount, uint32 vertexStride, uint32 positionOffset,
+                           uint32 targetIndexCount, float maxError, float* pResultError);
+
+    // Builds up to maxLODs levels, each about half the triangles of the previous, and cache optimizes each one.
+    // pDestinationIndices holds destinationCapacity indices, at least indexCount since LOD 0 is a copy of the input. 2*indexCount fits most chains.
+    // Returns the number of LODs written, generation stops early once a level can't be reduced further or wouldn't fit.
+    // Errors accumulate, each LOD's error is bounded against the full detail mesh, not the previous level.
+    static uint32 GenerateLODs(uint32* pDestinationIndices, uint32 destinationCapacity, MeshLOD* pLODs, uint32 maxLODs, const uint32* indices, uint32 indexCount,
+                               const void* vertices, uint32 vertexCount, uint32 vertexStride, uint32 positionOffset);
+};
+
+#endif //__MeshSimplifier_H__
@@ -0,0 +1,34 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+
+#ifndef __Platform_H__
+#define __Platform_H__
+
+#include <stdio.h>
+
+// The code is written against the MSVC CRT, fill in the few secure functions it uses elsewhere.
+#if !_WIN32
+
+#include <errno.h>
+
+typedef int errno_t;
+
+inline errno_t fopen_s(FILE** ppFile, const char* filename, const char* mode)
+{
+    *ppFile = fopen( filename, mode );
+    if( *ppFile == nullptr )
+        return errno;
+
+    return 0;
+}
+
+#endif //!_WIN32
+
+#endif //__Platform_H__
@@ -14,6 +14,7 @@
 
 #include "VulkanBuffer.h"
 #include "Math/MyMatrix.h"
+#include "Mesh/MeshSimplifier.h"
 
 class VulkanInterface;
 
@@ -24,42 +25,47 @@ struct UniformBufferObject_Matrices
     MyMatrix m_Proj;
 };
 
-struct VertexFormat
+// Pushed per draw, undoes position quantization in the vertex shader.  Vec4s to match the shader's layout, w is unused.
+struct PushConstants_Draw
 {
-    float pos[3];
-    unsigned char color[4];
+    Vector4 m_QuantizationScale;
+    Vector4 m_QuantizationOffset;
+};
 
-    static VkVertexInputBindingDescription bindingDescription;
-    static VkVertexInputAttributeDescription attributeDescriptions[2];
+static const uint32 MAX_RENDER_VIEWS = 4;
 
-    static void SetupDescriptions()
-    {
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof( VertexFormat );
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+// A camera drawn into part of the swapchain image, all views share one pipeline.
+struct RenderView
+{
+    // Normalized to the surface size, so views follow the window when it's resized.
+    float m_X;
+    float m_Y;
+    float m_Width;
+    float m_Height;
 
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof( VertexFormat, pos );
+    Vector3 m_CameraPosition;
+    Vector3 m_CameraUp;
+    Vector3 m_LookAtTarget;
+    float m_VerticalFOV;
 
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
-        attributeDescriptions[1].offset = offsetof( VertexFormat, color );
-    }
+    // Only applied if the device supports VK_EXT_extended_dynamic_state, otherwise the pipeline culls back faces.
+    VkCullModeFlags m_CullMode;
+};
 
-    static int GetBindingDescriptionCount() { return 1; }
-    static VkVertexInputBindingDescription* getBindingDescription()
-    {
-        return &bindingDescription;
-    }
+// CPU side vertex for the default VertexLayout, see VertexLayout::CreateDefault().
+struct VertexFormat
+{
+    float pos[3];
+    unsigned char color[4];
+};
 
-    static int GetAttributeDescriptionCount() { return 2; }
-    static VkVertexInputAttributeDescription* getAttributeDescriptions()
-    {
-        return attributeDescriptions;
-    }
+// Counts for the last frame rendered.
+struct RenderStats
+{
+    uint32 m_DrawCount;
+    uint32 m_TrianglesDrawn;
+    uint32 m_DrawsPerLOD[MAX_MESH_LODS];
+    uint32 m_TrianglesPerLOD[MAX_MESH_LODS];
 };
 
 #endif //__Structs_H__
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+
+#include "CPUProfiler.h"
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool()
+{
+    m_ThreadCount = 0;
+    m_FirstJob = 0;
+    m_JobCount = 0;
+    m_ShuttingDown = false;
+}
+
+ThreadPool::~ThreadPool()
+{
+    assert( m_ThreadCount == 0 );
+}
+
+void ThreadPool::Create(uint32 threadCount)
+{
+    assert( m_ThreadCount == 0 );
+
+    if( threadCount == 0 )
+        threadCount = std::thread::hardware_concurrency();
+    if( threadCount == 0 )
+        threadCount = 1;
+    if( threadCount > MAX_THREAD_POOL_THREADS )
+        threadCount = MAX_THREAD_POOL_THREADS;
+
+    m_ShuttingDown = false;
+    m_ThreadCount = threadCount;
+    for( uint32 i=0; i<m_ThreadCount; i++ )
+    {
+        m_Threads[i] = std::thread( WorkerThread, this );
+    }
+}
+
+void ThreadPool::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_Mutex );
+        m_ShuttingDown = true;
+    }
+    m_JobAvailable.notify_all();
+
+    for( uint32 i=0; i<m_ThreadCount; i++ )
+    {
+        m_Threads[i].join();
+    }
+    m_ThreadCount = 0;
+}
+
+void ThreadPool::Submit(ThreadPoolJobFunction pFunction, void* pData)
+{
+    assert( m_ThreadCount > 0 );
+
+    {
+        std::unique_lock<std::mutex> lock( m_Mutex );
+        m_SpaceAvailable.wait( lock, [this] { return m_JobCount < MAX_THREAD_POOL_JOBS; } );
+
+        Job& job = m_Jobs[(m_FirstJob + m_JobCount) % MAX_THREAD_POOL_JOBS];
+        job.m_pFunction = pFunction;
+        job.m_pData = pData;
+        m_JobCount++;
+    }
+    m_JobAvailable.notify_one();
+}
+
+void ThreadPool::WorkerThread(ThreadPool* pPool)
+{
+    PROFILE_THREAD_NAME( "Thread Pool Worker" );
+
+    while( true )
+    {
+        Job job;
+
+        {
+            std::unique_lock<std::mutex> lock( pPool->m_Mutex );
+            pPool->m_JobAvailable.wait( lock, [pPool] { return pPool->m_JobCount > 0 || pPool->m_ShuttingDown; } );
+
+            // Queued jobs still run during shutdown, only exit once the queue is drained.
+            if( pPool->m_JobCount == 0 )
+                return;
+
+            job = pPool->m_Jobs[pPool->m_FirstJob];
+            pPool->m_FirstJob = (pPool->m_FirstJob + 1) % MAX_THREAD_POOL_JOBS;
+            pPool->m_JobCount--;
+        }
+        pPool->m_SpaceAvailable.notify_one();
+
+        job.m_pFunction( job.m_pData );
+    }
+}
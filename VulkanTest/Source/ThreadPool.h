@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __ThreadPool_H__
+#define __ThreadPool_H__
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Math/MyTypes.h"
+
+static const uint32 MAX_THREAD_POOL_THREADS = 64;
+static const uint32 MAX_THREAD_POOL_JOBS = 1024;
+
+typedef void (*ThreadPoolJobFunction)(void* pData);
+
+// Fixed set of worker threads pulling jobs from a FIFO queue.
+class ThreadPool
+{
+protected:
+    struct Job
+    {
+        ThreadPoolJobFunction m_pFunction;
+        void* m_pData;
+    };
+
+    std::thread m_Threads[MAX_THREAD_POOL_THREADS];
+    uint32 m_ThreadCount;
+
+    // Ring buffer of queued jobs.
+    Job m_Jobs[MAX_THREAD_POOL_JOBS];
+    uint32 m_FirstJob;
+    uint32 m_JobCount;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_JobAvailable;
+    std::condition_variable m_SpaceAvailable;
+    bool m_ShuttingDown;
+
+protected:
+    static void WorkerThread(ThreadPool* pPool);
+
+public:
+    ThreadPool();
+    virtual ~ThreadPool();
+
+    // threadCount 0 uses one thread per hardware thread.
+    void Create(uint32 threadCount);
+    // Runs all queued jobs before returning.
+    void Destroy();
+
+    // Blocks if the queue is full.
+    void Submit(ThreadPoolJobFunction pFunction, void* pData);
+
+    uint32 GetThreadCount() { return m_ThreadCount; }
+};
+
+#endif //__ThreadPool_H__
@@ -0,0 +1,342 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+
+#include "Structs.h"
+#include "VertexLayout.h"
+
+VertexLayout::VertexLayout()
+{
+    for( int i=0; i<VertexAttribute_Count; i++ )
+    {
+        m_Formats[i] = VertexAttributeFormat_None;
+        m_Offsets[i] = 0;
+    }
+    m_Stride = 0;
+
+    m_BindingDescription = {};
+    m_AttributeDescriptionCount = 0;
+}
+
+void VertexLayout::Create(VertexAttributeFormat positionFormat, VertexAttributeFormat colorFormat, VertexAttributeFormat normalFormat, VertexAttributeFormat uvFormat)
+{
+    assert( positionFormat != VertexAttributeFormat_None );
+    assert( colorFormat == VertexAttributeFormat_None || colorFormat == VertexAttributeFormat_UNorm8x4 );
+
+    m_Formats[VertexAttribute_Position] = positionFormat;
+    m_Formats[VertexAttribute_Color] = colorFormat;
+    m_Formats[VertexAttribute_Normal] = normalFormat;
+    m_Formats[VertexAttribute_UV] = uvFormat;
+
+    // Pack attributes tightly in attribute order, every format is a multiple of 4 bytes so offsets stay aligned.
+    m_Stride = 0;
+    m_AttributeDescriptionCount = 0;
+    for( int i=0; i<VertexAttribute_Count; i++ )
+    {
+        m_Offsets[i] = m_Stride;
+
+        if( m_Formats[i] == VertexAttributeFormat_None )
+            continue;
+
+        VkVertexInputAttributeDescription& description = m_AttributeDescriptions[m_AttributeDescriptionCount++];
+        description.binding = 0;
+        description.location = i;
+        description.format = GetVkFormat( m_Formats[i] );
+        description.offset = m_Stride;
+
+        m_Stride += GetFormatSize( m_Formats[i] );
+    }
+
+    m_BindingDescription.binding = 0;
+    m_BindingDescription.stride = m_Stride;
+    m_BindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+}
+
+void VertexLayout::CreateDefault()
+{
+    Create( VertexAttributeFormat_Float3, VertexAttributeFormat_UNorm8x4, VertexAttributeFormat_None, VertexAttributeFormat_None );
+
+    assert( m_Stride == sizeof( VertexFormat ) );
+    assert( m_Offsets[VertexAttribute_Position] == offsetof( VertexFormat, pos ) );
+    assert( m_Offsets[VertexAttribute_Color] == offsetof( VertexFormat, color ) );
+}
+
+bool VertexLayout::Matches(const VertexLayout& other) const
+{
+    for( int i=0; i<VertexAttribute_Count; i++ )
+    {
+        if( m_Formats[i] != other.m_Formats[i] )
+            return false;
+    }
+
+    return true;
+}
+
+uint32 VertexLayout::GetFormatSize(VertexAttributeFormat format)
+{
+    switch( format )
+    {
+    case VertexAttributeFormat_None:            return 0;
+    case VertexAttributeFormat_Float2:          return 8;
+    case VertexAttributeFormat_Float3:          return 12;
+    case VertexAttributeFormat_Half2:           return 4;
+    case VertexAttributeFormat_Half4:           return 8;
+    case VertexAttributeFormat_SNorm16x4:       return 8;
+    case VertexAttributeFormat_UNorm16x2:       return 4;
+    case VertexAttributeFormat_OctSNorm16x2:    return 4;
+    case VertexAttributeFormat_UNorm8x4:        return 4;
+    case VertexAttributeFormat_Count:           break;
+    }
+
+    assert( false );
+    return 0;
+}
+
+VkFormat VertexLayout::GetVkFormat(VertexAttributeFormat format)
+{
+    switch( format )
+    {
+    case VertexAttributeFormat_None:            return VK_FORMAT_UNDEFINED;
+    case VertexAttributeFormat_Float2:          return VK_FORMAT_R32G32_SFLOAT;
+    case VertexAttributeFormat_Float3:          return VK_FORMAT_R32G32B32_SFLOAT;
+    case VertexAttributeFormat_Half2:           return VK_FORMAT_R16G16_SFLOAT;
+    case VertexAttributeFormat_Half4:           return VK_FORMAT_R16G16B16A16_SFLOAT;
+    case VertexAttributeFormat_SNorm16x4:       return VK_FORMAT_R16G16B16A16_SNORM;
+    case VertexAttributeFormat_UNorm16x2:       return VK_FORMAT_R16G16_UNORM;
+    case VertexAttributeFormat_OctSNorm16x2:    return VK_FORMAT_R16G16_SNORM;
+    case VertexAttributeFormat_UNorm8x4:        return VK_FORMAT_R8G8B8A8_UNORM;
+    case VertexAttributeFormat_Count:           break;
+    }
+
+    assert( false );
+    return VK_FORMAT_UNDEFINED;
+}
+
+unsigned short VertexLayout::FloatToHalf(float value)
+{
+    uint32 bits;
+    memcpy( &bits, &value, sizeof( float ) );
+
+    uint32 sign = (bits >> 16) & 0x8000;
+    int32 exponent = (int32)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32 mantissa = bits & 0x007FFFFF;
+
+    // Infinity or NaN.
+    if( ((bits >> 23) & 0xFF) == 0xFF )
+        return (unsigned short)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+    // Too large, clamp to infinity.
+    if( exponent >= 31 )
+        return (unsigned short)(sign | 0x7C00);
+
+    // Too small for a normal half, produce a denormal or zero.
+    if( exponent <= 0 )
+    {
+        if( exponent < -10 )
+            return (unsigned short)sign;
+
+        mantissa |= 0x00800000;
+        uint32 shift = 14 - exponent;
+        uint32 half = mantissa >> shift;
+        if( (mantissa >> (shift - 1)) & 1 )
+            half++;
+
+        return (unsigned short)(sign | half);
+    }
+
+    // Round to nearest, a carry out of the mantissa correctly bumps the exponent.
+    uint32 half = sign | (exponent << 10) | (mantissa >> 13);
+    if( mantissa & 0x1000 )
+        half++;
+
+    return (unsigned short)half;
+}
+
+void VertexLayout::EncodeOctahedral(const float* normal, short* pEncoded)
+{
+    float x = normal[0];
+    float y = normal[1];
+    float z = normal[2];
+
+    // Project onto the octahedron |x|+|y|+|z| = 1.
+    float length = fabsf( x ) + fabsf( y ) + fabsf( z );
+    if( length == 0 )
+    {
+        pEncoded[0] = 0;
+        pEncoded[1] = 0;
+        return;
+    }
+    x /= length;
+    y /= length;
+
+    // Fold the lower hemisphere over the diagonals.
+    if( z < 0 )
+    {
+        float foldedX = (1.0f - fabsf( y )) * (x >= 0 ? 1.0f : -1.0f);
+        float foldedY = (1.0f - fabsf( x )) * (y >= 0 ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    pEncoded[0] = (short)roundf( MyClamp_Return( x, -1.0f, 1.0f ) * 32767.0f );
+    pEncoded[1] = (short)roundf( MyClamp_Return( y, -1.0f, 1.0f ) * 32767.0f );
+}
+
+static void PackAttribute(VertexAttributeFormat format, const float* pSource, unsigned char* pDestination)
+{
+    switch( format )
+    {
+    case VertexAttributeFormat_Float2:
+        memcpy( pDestination, pSource, sizeof( float ) * 2 );
+        break;
+
+    case VertexAttributeFormat_Float3:
+        memcpy( pDestination, pSource, sizeof( float ) * 3 );
+        break;
+
+    case VertexAttributeFormat_Half2:
+        {
+            unsigned short* pHalf = (unsigned short*)pDestination;
+            pHalf[0] = VertexLayout::FloatToHalf( pSource[0] );
+            pHalf[1] = VertexLayout::FloatToHalf( pSource[1] );
+        }
+        break;
+
+    case VertexAttributeFormat_Half4:
+        {
+            unsigned short* pHalf = (unsigned short*)pDestination;
+            pHalf[0] = VertexLayout::FloatToHalf( pSource[0] );
+            pHalf[1] = VertexLayout::FloatToHalf( pSource[1] );
+            pHalf[2] = VertexLayout::FloatToHalf( pSource[2] );
+            pHalf[3] = VertexLayout::FloatToHalf( 1.0f );
+        }
+        break;
+
+    case VertexAttributeFormat_SNorm16x4:
+        {
+            // Source is already normalized to the quantization bounds.
+            short* pShort = (short*)pDestination;
+            pShort[0] = (short)roundf( MyClamp_Return( pSource[0], -1.0f, 1.0f ) * 32767.0f );
+            pShort[1] = (short)roundf( MyClamp_Return( pSource[1], -1.0f, 1.0f ) * 32767.0f );
+            pShort[2] = (short)roundf( MyClamp_Return( pSource[2], -1.0f, 1.0f ) * 32767.0f );
+            pShort[3] = 32767;
+        }
+        break;
+
+    case VertexAttributeFormat_UNorm16x2:
+        {
+            unsigned short* pShort = (unsigned short*)pDestination;
+            pShort[0] = (unsigned short)roundf( MyClamp_Return( pSource[0], 0.0f, 1.0f ) * 65535.0f );
+            pShort[1] = (unsigned short)roundf( MyClamp_Return( pSource[1], 0.0f, 1.0f ) * 65535.0f );
+        }
+        break;
+
+    case VertexAttributeFormat_OctSNorm16x2:
+        VertexLayout::EncodeOctahedral( pSource, (short*)pDestination );
+        break;
+
+    case VertexAttributeFormat_None:
+    case VertexAttributeFormat_UNorm8x4:
+    case VertexAttributeFormat_Count:
+        assert( false );
+        break;
+    }
+}
+
+void VertexLayout::PackVertices(void* pDestination, uint32 vertexCount, const VertexStreams& streams, Vector3* pQuantizationCenter, Vector3* pQuantizationExtents) const
+{
+    assert( pDestination != nullptr );
+    assert( streams.m_Positions != nullptr );
+
+    // Find the bounds used to quantize positions.
+    Vector3 center( 0, 0, 0 );
+    Vector3 extents( 1, 1, 1 );
+    if( m_Formats[VertexAttribute_Position] == VertexAttributeFormat_SNorm16x4 && vertexCount > 0 )
+    {
+        Vector3 minimum( streams.m_Positions[0], streams.m_Positions[1], streams.m_Positions[2] );
+        Vector3 maximum = minimum;
+        for( uint32 v=1; v<vertexCount; v++ )
+        {
+            for( int axis=0; axis<3; axis++ )
+            {
+                DecreaseIfLower( minimum[axis], streams.m_Positions[v*3 + axis] );
+                IncreaseIfBigger( maximum[axis], streams.m_Positions[v*3 + axis] );
+            }
+        }
+
+        center = (minimum + maximum) * 0.5f;
+        extents = (maximum - minimum) * 0.5f;
+
+        // Avoid dividing by zero on flat meshes.
+        for( int axis=0; axis<3; axis++ )
+        {
+            if( extents[axis] <= 0 )
+                extents[axis] = 1.0f;
+        }
+    }
+
+    if( pQuantizationCenter )
+        *pQuantizationCenter = center;
+    if( pQuantizationExtents )
+        *pQuantizationExtents = extents;
+
+    unsigned char* pVertex = (unsigned char*)pDestination;
+    for( uint32 v=0; v<vertexCount; v++ )
+    {
+        // Position.
+        {
+            const float* pPosition = &streams.m_Positions[v*3];
+            if( m_Formats[VertexAttribute_Position] == VertexAttributeFormat_SNorm16x4 )
+            {
+                float normalized[3];
+                normalized[0] = (pPosition[0] - center.x) / extents.x;
+                normalized[1] = (pPosition[1] - center.y) / extents.y;
+                normalized[2] = (pPosition[2] - center.z) / extents.z;
+                PackAttribute( m_Formats[VertexAttribute_Position], normalized, pVertex + m_Offsets[VertexAttribute_Position] );
+            }
+            else
+            {
+                PackAttribute( m_Formats[VertexAttribute_Position], pPosition, pVertex + m_Offsets[VertexAttribute_Position] );
+            }
+        }
+
+        // Color, white if the source has none.
+        if( m_Formats[VertexAttribute_Color] != VertexAttributeFormat_None )
+        {
+            unsigned char* pColor = pVertex + m_Offsets[VertexAttribute_Color];
+            if( streams.m_Colors )
+                memcpy( pColor, &streams.m_Colors[v*4], 4 );
+            else
+                memset( pColor, 255, 4 );
+        }
+
+        // Normal, pointing up if the source has none.
+        if( m_Formats[VertexAttribute_Normal] != VertexAttributeFormat_None )
+        {
+            const float defaultNormal[3] = { 0, 1, 0 };
+            const float* pNormal = streams.m_Normals ? &streams.m_Normals[v*3] : defaultNormal;
+            PackAttribute( m_Formats[VertexAttribute_Normal], pNormal, pVertex + m_Offsets[VertexAttribute_Normal] );
+        }
+
+        // UV, zero if the source has none.
+        if( m_Formats[VertexAttribute_UV] != VertexAttributeFormat_None )
+        {
+            const float defaultUV[2] = { 0, 0 };
+            const float* pUV = streams.m_UVs ? &streams.m_UVs[v*2] : defaultUV;
+            PackAttribute( m_Formats[VertexAttribute_UV], pUV, pVertex + m_Offsets[VertexAttribute_UV] );
+        }
+
+        pVertex += m_Stride;
+    }
+}
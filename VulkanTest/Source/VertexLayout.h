@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __VertexLayout_H__
+#define __VertexLayout_H__
+
+#include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+#include "Math/Vector.h"
+
+// Shader input locations match the attribute order.
+enum VertexAttribute
+{
+    VertexAttribute_Position,
+    VertexAttribute_Color,
+    VertexAttribute_Normal,
+    VertexAttribute_UV,
+    VertexAttribute_Count,
+};
+
+enum VertexAttributeFormat
+{
+    VertexAttributeFormat_None,
+    VertexAttributeFormat_Float2,
+    VertexAttributeFormat_Float3,
+    VertexAttributeFormat_Half2,
+    VertexAttributeFormat_Half4,          // Positions, w is padding.
+    VertexAttributeFormat_SNorm16x4,      // Positions quantized to the mesh bounds, w is padding. See VulkanMesh::SetQuantization.
+    VertexAttributeFormat_UNorm16x2,      // UVs in the 0-1 range.
+    VertexAttributeFormat_OctSNorm16x2,   // Unit vectors, octahedral encoded. Decoded in mesh.vert.
+    VertexAttributeFormat_UNorm8x4,       // Colors.
+    VertexAttributeFormat_Count,
+};
+
+// Source data for PackVertices, one array per attribute. Arrays for attributes not in the layout are ignored.
+struct VertexStreams
+{
+    const float* m_Positions;       // 3 floats per vertex.
+    const unsigned char* m_Colors;  // 4 bytes per vertex.
+    const float* m_Normals;         // 3 floats per vertex.
+    const float* m_UVs;             // 2 floats per vertex.
+};
+
+class VertexLayout
+{
+protected:
+    VertexAttributeFormat m_Formats[VertexAttribute_Count];
+    uint32 m_Offsets[VertexAttribute_Count];
+    uint32 m_Stride;
+
+    VkVertexInputBindingDescription m_BindingDescription;
+    VkVertexInputAttributeDescription m_AttributeDescriptions[VertexAttribute_Count];
+    uint32 m_AttributeDescriptionCount;
+
+public:
+    VertexLayout();
+
+    void Create(VertexAttributeFormat positionFormat, VertexAttributeFormat colorFormat, VertexAttributeFormat normalFormat, VertexAttributeFormat uvFormat);
+    void CreateDefault(); // Matches VertexFormat in Structs.h.
+
+    // Converts the source streams into this layout.
+    // For SNorm16 positions the mesh bounds are returned, pass them to VulkanMesh::SetQuantization.
+    void PackVertices(void* pDestination, uint32 vertexCount, const VertexStreams& streams, Vector3* pQuantizationCenter = nullptr, Vector3* pQuantizationExtents = nullptr) const;
+
+    VertexAttributeFormat GetFormat(VertexAttribute attribute) const { return m_Formats[attribute]; }
+    uint32 GetOffset(VertexAttribute attribute) const { return m_Offsets[attribute]; }
+    uint32 GetStride() const { return m_Stride; }
+    bool Matches(const VertexLayout& other) const;
+
+    uint32 GetBindingDescriptionCount() const { return 1; }
+    const VkVertexInputBindingDescription* GetBindingDescriptions() const { return &m_BindingDescription; }
+    uint32 GetAttributeDescriptionCount() const { return m_AttributeDescriptionCount; }
+    const VkVertexInputAttributeDescription* GetAttributeDescriptions() const { return m_AttributeDescriptions; }
+
+    static uint32 GetFormatSize(VertexAttributeFormat format);
+    static VkFormat GetVkFormat(VertexAttributeFormat format);
+
+    static unsigned short FloatToHalf(float value);
+    static void EncodeOctahedral(const float* normal, short* pEncoded);
+};
+
+#endif //__VertexLayout_H__
@@ -9,37 +9,39 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
-#define VK_USE_PLATFORM_WIN32_KHR
 #include "vulkan/vulkan.h"
 
 #include "Structs.h"
 #include "VulkanBuffer.h"
+#include "VulkanDeletionQueue.h"
 #include "VulkanInterface.h"
 
-VkVertexInputBindingDescription VertexFormat::bindingDescription = {};
-VkVertexInputAttributeDescription VertexFormat::attributeDescriptions[2] = {};
-
 VulkanBuffer::VulkanBuffer()
 {
     m_Buffer = VK_NULL_HANDLE;
     m_BufferMemory = VK_NULL_HANDLE;
+    m_MemoryProperties = 0;
+    m_Size = 0;
+    m_AllocationSize = 0;
 
     m_pInterface = nullptr;
-
-    VertexFormat::SetupDescriptions();
 }
 
 VulkanBuffer::~VulkanBuffer()
 {
 }
 
-void VulkanBuffer::Create(VulkanInterface* pInterface, VkBufferUsageFlags usageFlags, const void* pData, unsigned int sizeInBytes)
+void VulkanBuffer::Create(VulkanInterface* pInterface, VkBufferUsageFlags usageFlags, const void* pData, unsigned int sizeInBytes, VkMemoryPropertyFlags memoryProperties)
 {
     assert( m_Buffer == VK_NULL_HANDLE );
     assert( pInterface != nullptr );
+    assert( pData == nullptr || (memoryProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) );
 
     m_pInterface = pInterface;
+    m_MemoryProperties = memoryProperties;
+    m_Size = sizeInBytes;
 
     VkDevice device = m_pInterface->GetDevice();
 
@@ -68,11 +70,14 @@ void VulkanBuffer::Create(VulkanInterface* pInterface, VkBufferUsageFlags usageF
         allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
         allocInfo.pNext = nullptr;
         allocInfo.allocationSize = memoryRequirements.size;
-        allocInfo.memoryTypeIndex = m_pInterface->FindMemoryType( memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT );
+        allocInfo.memoryTypeIndex = m_pInterface->FindMemoryType( memoryRequirements.memoryTypeBits, memoryProperties );
 
         VkResult result = vkAllocateMemory( device, &allocInfo, nullptr, &m_BufferMemory );
         assert( result == VK_SUCCESS );
 
+        m_AllocationSize = memoryRequirements.size;
+        m_pInterface->TrackAllocation( m_AllocationSize );
+
         vkBindBufferMemory( device, m_Buffer, m_BufferMemory, 0 );
     }
 
@@ -85,22 +90,44 @@ void VulkanBuffer::Create(VulkanInterface* pInterface, VkBufferUsageFlags usageF
 
 void VulkanBuffer::Destroy()
 {
-    vkFreeMemory( m_pInterface->GetDevice(), m_BufferMemory, nullptr );
-    vkDestroyBuffer( m_pInterface->GetDevice(), m_Buffer, nullptr );
-    
+    // Frames in flight or pending uploads may still use the buffer, it's deleted once they're done.
+    VulkanDeletionQueue* pDeletionQueue = m_pInterface->GetDeletionQueue();
+    pDeletionQueue->DeferBuffer( m_Buffer );
+    pDeletionQueue->DeferMemory( m_BufferMemory );
+    m_pInterface->TrackFree( m_AllocationSize );
+
     m_Buffer = VK_NULL_HANDLE;
+    m_BufferMemory = VK_NULL_HANDLE;
     m_pInterface = nullptr;
 }
 
-void VulkanBuffer::BufferData(const void* pData, unsigned int sizeInBytes)
+void VulkanBuffer::BufferData(const void* pData, unsigned int sizeInBytes, unsigned int offsetInBytes)
 {
     assert( pData != nullptr );
     assert( m_pInterface != nullptr );
+    assert( IsHostVisible() );
 
     VkDevice device = m_pInterface->GetDevice();
 
     void* data;
-    vkMapMemory( device, m_BufferMemory, 0, sizeInBytes, 0, &data );
+    vkMapMemory( device, m_BufferMemory, offsetInBytes, sizeInBytes, 0, &data );
     memcpy( data, pData, sizeInBytes );
     vkUnmapMemory( device, m_BufferMemory );
 }
+
+void* VulkanBuffer::Map()
+{
+    assert( m_pInterface != nullptr );
+    assert( IsHostVisible() );
+
+    void* data;
+    VkResult result = vkMapMemory( m_pInterface->GetDevice(), m_BufferMemory, 0, VK_WHOLE_SIZE, 0, &data );
+    assert( result == VK_SUCCESS );
+
+    return data;
+}
+
+void VulkanBuffer::Unmap()
+{
+    vkUnmapMemory( m_pInterface->GetDevice(), m_BufferMemory );
+}
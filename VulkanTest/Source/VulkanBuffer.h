@@ -22,6 +22,9 @@ class VulkanBuffer
 protected:
     VkBuffer m_Buffer;
     VkDeviceMemory m_BufferMemory;
+    VkMemoryPropertyFlags m_MemoryProperties;
+    VkDeviceSize m_Size;
+    VkDeviceSize m_AllocationSize;
 
     VulkanInterface* m_pInterface;
 
@@ -31,12 +34,20 @@ public:
     VulkanBuffer();
     virtual ~VulkanBuffer();
 
-    void Create(VulkanInterface* pInterface, VkBufferUsageFlags usageFlags, const void* pData, unsigned int sizeInBytes);
+    // Buffers default to host visible memory, device local buffers have to be filled through VulkanTransferQueue.
+    void Create(VulkanInterface* pInterface, VkBufferUsageFlags usageFlags, const void* pData, unsigned int sizeInBytes,
+                VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
     void Destroy();
 
-    void BufferData(const void* pData, unsigned int sizeInBytes);
+    void BufferData(const void* pData, unsigned int sizeInBytes, unsigned int offsetInBytes = 0);
+
+    // Persistent mapping, for buffers written every frame or used as staging.
+    void* Map();
+    void Unmap();
 
     VkBuffer GetBuffer() { return m_Buffer; }
+    VkDeviceSize GetSize() { return m_Size; }
+    bool IsHostVisible() { return (m_MemoryProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0; }
 };
 
 #endif //__VulkanBuffer_H__
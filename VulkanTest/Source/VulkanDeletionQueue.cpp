@@ -0,0 +1,180 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+
+#include "VulkanDeletionQueue.h"
+#include "VulkanInterface.h"
+#include "VulkanTransferQueue.h"
+
+VulkanDeletionQueue::VulkanDeletionQueue()
+{
+    NullEverything();
+}
+
+VulkanDeletionQueue::~VulkanDeletionQueue()
+{
+}
+
+void VulkanDeletionQueue::NullEverything()
+{
+    m_pInterface = nullptr;
+
+    m_First = 0;
+    m_Count = 0;
+
+    m_TotalDeleted = 0;
+}
+
+void VulkanDeletionQueue::Create(VulkanInterface* pInterface)
+{
+    assert( pInterface != nullptr );
+
+    m_pInterface = pInterface;
+}
+
+void VulkanDeletionQueue::Destroy()
+{
+    while( m_Count > 0 )
+    {
+        DeleteFirst();
+    }
+
+    NullEverything();
+}
+
+VulkanDeletionQueue::Entry* VulkanDeletionQueue::Push()
+{
+    // If the ring is full, wait for the oldest entries instead of growing.
+    if( m_Count == MAX_DEFERRED_DELETIONS )
+    {
+        Update();
+
+        if( m_Count == MAX_DEFERRED_DELETIONS )
+        {
+            Flush();
+        }
+    }
+
+    Entry* pEntry = &m_Entries[(m_First + m_Count) % MAX_DEFERRED_DELETIONS];
+    m_Count++;
+
+    VulkanTransferQueue* pTransferQueue = m_pInterface->GetTransferQueue();
+
+    pEntry->m_GraphicsValue = m_pInterface->GetLastSubmitValue();
+    pEntry->m_TransferSerial = pTransferQueue ? pTransferQueue->GetLastSerial() : 0;
+    pEntry->m_Type = VK_OBJECT_TYPE_UNKNOWN;
+    pEntry->m_Handle = 0;
+    pEntry->m_pCallback = nullptr;
+    pEntry->m_pContext = nullptr;
+
+    return pEntry;
+}
+
+void VulkanDeletionQueue::Defer(VkObjectType type, uint64 handle)
+{
+    assert( m_pInterface != nullptr );
+    assert( type != VK_OBJECT_TYPE_UNKNOWN );
+
+    if( handle == 0 )
+        return;
+
+    Entry* pEntry = Push();
+    pEntry->m_Type = type;
+    pEntry->m_Handle = handle;
+}
+
+void VulkanDeletionQueue::DeferCallback(DeferredDeletionCallback pCallback, void* pContext, const uint32* pData, uint32 dataCount)
+{
+    assert( m_pInterface != nullptr );
+    assert( pCallback != nullptr );
+    assert( dataCount <= 4 );
+
+    Entry* pEntry = Push();
+    pEntry->m_pCallback = pCallback;
+    pEntry->m_pContext = pContext;
+    memcpy( pEntry->m_Data, pData, dataCount * sizeof(uint32) );
+}
+
+bool VulkanDeletionQueue::IsRetired(const Entry& entry)
+{
+    VulkanTransferQueue* pTransferQueue = m_pInterface->GetTransferQueue();
+
+    if( pTransferQueue && pTransferQueue->IsRetired( entry.m_TransferSerial ) == false )
+        return false;
+
+    return m_pInterface->IsGPUComplete( entry.m_GraphicsValue );
+}
+
+void VulkanDeletionQueue::DeleteFirst()
+{
+    assert( m_Count > 0 );
+
+    Entry* pEntry = &m_Entries[m_First];
+    VkDevice device = m_pInterface->GetDevice();
+
+    switch( pEntry->m_Type )
+    {
+    case VK_OBJECT_TYPE_UNKNOWN:        pEntry->m_pCallback( pEntry->m_pContext, pEntry->m_Data );                break;
+    case VK_OBJECT_TYPE_BUFFER:         vkDestroyBuffer( device, (VkBuffer)pEntry->m_Handle, nullptr );           break;
+    case VK_OBJECT_TYPE_DEVICE_MEMORY:  vkFreeMemory( device, (VkDeviceMemory)pEntry->m_Handle, nullptr );        break;
+    case VK_OBJECT_TYPE_IMAGE:          vkDestroyImage( device, (VkImage)pEntry->m_Handle, nullptr );             break;
+    case VK_OBJECT_TYPE_IMAGE_VIEW:     vkDestroyImageView( device, (VkImageView)pEntry->m_Handle, nullptr );     break;
+    case VK_OBJECT_TYPE_FRAMEBUFFER:    vkDestroyFramebuffer( device, (VkFramebuffer)pEntry->m_Handle, nullptr ); break;
+    case VK_OBJECT_TYPE_SAMPLER:        vkDestroySampler( device, (VkSampler)pEntry->m_Handle, nullptr );         break;
+    case VK_OBJECT_TYPE_PIPELINE:       vkDestroyPipeline( device, (VkPipeline)pEntry->m_Handle, nullptr );       break;
+    case VK_OBJECT_TYPE_QUERY_POOL:     vkDestroyQueryPool( device, (VkQueryPool)pEntry->m_Handle, nullptr );     break;
+    case VK_OBJECT_TYPE_DESCRIPTOR_SET:
+        {
+            VkDescriptorSet descriptorSet = (VkDescriptorSet)pEntry->m_Handle;
+            vkFreeDescriptorSets( device, m_pInterface->GetTextureDescriptorPool(), 1, &descriptorSet );
+        }
+        break;
+    default:
+        assert( false ); // Add the type above.
+        break;
+    }
+
+    m_First = (m_First + 1) % MAX_DEFERRED_DELETIONS;
+    m_Count--;
+    m_TotalDeleted++;
+}
+
+void VulkanDeletionQueue::Update()
+{
+    while( m_Count > 0 && IsRetired( m_Entries[m_First] ) )
+    {
+        DeleteFirst();
+    }
+}
+
+void VulkanDeletionQueue::Flush()
+{
+    if( m_Count == 0 )
+        return;
+
+    // The newest entry has the highest values, waiting for it covers everything.
+    Entry* pNewest = &m_Entries[(m_First + m_Count - 1) % MAX_DEFERRED_DELETIONS];
+
+    VulkanTransferQueue* pTransferQueue = m_pInterface->GetTransferQueue();
+    if( pTransferQueue && pTransferQueue->IsRetired( pNewest->m_TransferSerial ) == false )
+    {
+        pTransferQueue->WaitIdle();
+    }
+
+    m_pInterface->WaitForGPU( pNewest->m_GraphicsValue );
+
+    while( m_Count > 0 )
+    {
+        DeleteFirst();
+    }
+}
@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __VulkanDeletionQueue_H__
+#define __VulkanDeletionQueue_H__
+
+#include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+
+class VulkanInterface;
+
+static const int MAX_DEFERRED_DELETIONS = 4096;
+
+// Called once the GPU is done with a range of something that isn't a Vulkan handle, like a geometry pool allocation.
+typedef void (*DeferredDeletionCallback)(void* pContext, const uint32* pData);
+
+// Parks Vulkan handles until the GPU can no longer be using them, then destroys them.
+// Each entry is tagged with the last submitted graphics timeline value and the last transfer serial at the time
+// it's queued, anything recorded before that point is finished once both are reached.
+// Entries are queued in order of those values, so Update() only has to look at the front of the ring.
+class VulkanDeletionQueue
+{
+protected:
+    struct Entry
+    {
+        uint64 m_GraphicsValue;
+        uint64 m_TransferSerial;
+
+        VkObjectType m_Type; // VK_OBJECT_TYPE_UNKNOWN for callbacks.
+        uint64 m_Handle;
+
+        DeferredDeletionCallback m_pCallback;
+        void* m_pContext;
+        uint32 m_Data[4];
+    };
+
+    VulkanInterface* m_pInterface;
+
+    Entry m_Entries[MAX_DEFERRED_DELETIONS];
+    uint32 m_First;
+    uint32 m_Count;
+
+    uint32 m_TotalDeleted;
+
+protected:
+    void NullEverything();
+
+    Entry* Push();
+    bool IsRetired(const Entry& entry);
+    void DeleteFirst();
+
+public:
+    VulkanDeletionQueue();
+    virtual ~VulkanDeletionQueue();
+
+    void Create(VulkanInterface* pInterface);
+    void Destroy(); // Deletes everything still queued, the device must be idle.
+
+    // Handles are passed as uint64 so one entry type covers every non-dispatchable handle.
+    void Defer(VkObjectType type, uint64 handle);
+    void DeferBuffer(VkBuffer buffer) { Defer( VK_OBJECT_TYPE_BUFFER, (uint64)buffer ); }
+    void DeferMemory(VkDeviceMemory memory) { Defer( VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64)memory ); }
+    void DeferImage(VkImage image) { Defer( VK_OBJECT_TYPE_IMAGE, (uint64)image ); }
+    void DeferImageView(VkImageView imageView) { Defer( VK_OBJECT_TYPE_IMAGE_VIEW, (uint64)imageView ); }
+    void DeferFramebuffer(VkFramebuffer framebuffer) { Defer( VK_OBJECT_TYPE_FRAMEBUFFER, (uint64)framebuffer ); }
+    // Only texture descriptor sets are freed one at a time, they go back to the interface's texture descriptor pool.
+    void DeferDescriptorSet(VkDescriptorSet descriptorSet) { Defer( VK_OBJECT_TYPE_DESCRIPTOR_SET, (uint64)descriptorSet ); }
+
+    // pData is copied, up to 4 values.
+    void DeferCallback(DeferredDeletionCallback pCallback, void* pContext, const uint32* pData, uint32 dataCount);
+
+    // Deletes everything the GPU has finished with, call once a frame.
+    void Update();
+
+    // Blocks until everything queued can be deleted.
+    void Flush();
+
+    uint32 GetPendingCount() { return m_Count; }
+    uint32 GetTotalDeleted() { return m_TotalDeleted; }
+};
+
+#endif //__VulkanDeletionQueue_H__
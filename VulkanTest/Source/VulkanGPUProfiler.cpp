@@ -0,0 +1,384 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+
+#include "VulkanGPUProfiler.h"
+#include "VulkanInterface.h"
+
+static const VkQueryPipelineStatisticFlags PIPELINE_STATISTICS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+VulkanGPUProfiler::VulkanGPUProfiler()
+{
+    m_pInterface = nullptr;
+    m_QueryPool = VK_NULL_HANDLE;
+    m_StatisticsQueryPool = VK_NULL_HANDLE;
+    m_Enabled = false;
+    m_StatisticsEnabled = false;
+    m_NanosecondsPerTick = 1.0f;
+    m_TimestampMask = UINT64_MAX;
+
+    for( uint32 i=0; i<MAX_GPU_PROFILER_FRAMES; i++ )
+    {
+        m_Frames[i].m_ScopeCount = 0;
+        m_Frames[i].m_StatisticsCount = 0;
+        m_Frames[i].m_SubmitValue = 0;
+        m_Frames[i].m_Pending = false;
+    }
+    m_FrameCount = 0;
+    m_CurrentFrame = 0;
+    m_CommandBuffer = VK_NULL_HANDLE;
+    m_OpenScopeCount = 0;
+    m_StatisticsActive = false;
+    m_StatisticsReset = false;
+
+    for( uint32 i=0; i<MAX_GPU_SCOPE_NAMES; i++ )
+    {
+        m_Names[i] = nullptr;
+        m_HistoryCount[i] = 0;
+        m_HistoryNext[i] = 0;
+        m_HasStatistics[i] = false;
+    }
+    m_NameCount = 0;
+}
+
+VulkanGPUProfiler::~VulkanGPUProfiler()
+{
+    assert( m_QueryPool == VK_NULL_HANDLE );
+    assert( m_StatisticsQueryPool == VK_NULL_HANDLE );
+}
+
+void VulkanGPUProfiler::Create(VulkanInterface* pInterface, uint32 frameCount)
+{
+    assert( pInterface != nullptr );
+    assert( frameCount >= 1 && frameCount <= MAX_GPU_PROFILER_FRAMES );
+
+    m_pInterface = pInterface;
+    m_FrameCount = frameCount;
+    m_CurrentFrame = 0;
+
+    // Ticks are converted with the device's period.
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties( pInterface->m_PhysicalDevice, &deviceProperties );
+    m_NanosecondsPerTick = deviceProperties.limits.timestampPeriod;
+
+    // Queues that can't write timestamps report 0 valid bits, leave the profiler off.
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties( pInterface->m_PhysicalDevice, &queueFamilyCount, nullptr );
+    if( queueFamilyCount > 128 )
+        queueFamilyCount = 128;
+    VkQueueFamilyProperties queueFamilyProperties[128];
+    vkGetPhysicalDeviceQueueFamilyProperties( pInterface->m_PhysicalDevice, &queueFamilyCount, queueFamilyProperties );
+
+    uint32 validBits = queueFamilyProperties[pInterface->m_GraphicsQueueFamilyIndex].timestampValidBits;
+    if( validBits == 0 )
+        return;
+
+    m_TimestampMask = validBits >= 64 ? UINT64_MAX : ((uint64)1 << validBits) - 1;
+
+    // Two timestamps per scope.
+    VkQueryPoolCreateInfo queryPoolInfo = {};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.pNext = nullptr;
+    queryPoolInfo.flags = 0;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = m_FrameCount * MAX_GPU_SCOPES_PER_FRAME * 2;
+    queryPoolInfo.pipelineStatistics = 0;
+
+    VkResult result = vkCreateQueryPool( pInterface->m_Device, &queryPoolInfo, nullptr, &m_QueryPool );
+    assert( result == VK_SUCCESS );
+
+    m_Enabled = true;
+
+    // One pipeline statistics query per statistics scope, if the device enabled the feature.
+    if( pInterface->m_PipelineStatisticsQuerySupported )
+    {
+        queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        queryPoolInfo.queryCount = m_FrameCount * MAX_GPU_STATISTICS_SCOPES_PER_FRAME;
+        queryPoolInfo.pipelineStatistics = PIPELINE_STATISTICS;
+
+        result = vkCreateQueryPool( pInterface->m_Device, &queryPoolInfo, nullptr, &m_StatisticsQueryPool );
+        assert( result == VK_SUCCESS );
+    }
+}
+
+void VulkanGPUProfiler::Destroy()
+{
+    // The device is idle by now, nothing is left to resolve.
+    vkDestroyQueryPool( m_pInterface->m_Device, m_QueryPool, nullptr );
+    vkDestroyQueryPool( m_pInterface->m_Device, m_StatisticsQueryPool, nullptr );
+    m_QueryPool = VK_NULL_HANDLE;
+    m_StatisticsQueryPool = VK_NULL_HANDLE;
+    m_Enabled = false;
+    m_StatisticsEnabled = false;
+}
+
+uint32 VulkanGPUProfiler::FindOrAddName(const char* name)
+{
+    for( uint32 i=0; i<m_NameCount; i++ )
+    {
+        if( m_Names[i] == name )
+            return i;
+    }
+
+    for( uint32 i=0; i<m_NameCount; i++ )
+    {
+        if( strcmp( m_Names[i], name ) == 0 )
+            return i;
+    }
+
+    if( m_NameCount == MAX_GPU_SCOPE_NAMES )
+        return UINT_MAX;
+
+    m_Names[m_NameCount] = name;
+    return m_NameCount++;
+}
+
+void VulkanGPUProfiler::BeginFrame(VkCommandBuffer commandBuffer)
+{
+    assert( m_CommandBuffer == VK_NULL_HANDLE );
+
+    // Pick up every frame the GPU has finished with.
+    for( uint32 i=0; i<m_FrameCount; i++ )
+    {
+        if( m_Frames[i].m_Pending && m_pInterface->IsGPUComplete( m_Frames[i].m_SubmitValue ) )
+        {
+            ResolveFrame( &m_Frames[i], i );
+        }
+    }
+
+    // The range is about to be reset, anything still unresolved in it is lost.
+    FrameRecord* pFrame = &m_Frames[m_CurrentFrame];
+    pFrame->m_Pending = false;
+    pFrame->m_ScopeCount = 0;
+    pFrame->m_StatisticsCount = 0;
+    pFrame->m_SubmitValue = 0;
+
+    m_CommandBuffer = commandBuffer;
+    m_OpenScopeCount = 0;
+    m_StatisticsActive = false;
+    m_StatisticsReset = false;
+
+    if( m_Enabled )
+    {
+        vkCmdResetQueryPool( commandBuffer, m_QueryPool, m_CurrentFrame * MAX_GPU_SCOPES_PER_FRAME * 2, MAX_GPU_SCOPES_PER_FRAME * 2 );
+
+        if( m_StatisticsEnabled )
+        {
+            vkCmdResetQueryPool( commandBuffer, m_StatisticsQueryPool, m_CurrentFrame * MAX_GPU_STATISTICS_SCOPES_PER_FRAME, MAX_GPU_STATISTICS_SCOPES_PER_FRAME );
+            m_StatisticsReset = true;
+        }
+    }
+}
+
+void VulkanGPUProfiler::EndFrame(uint64 submitValue)
+{
+    assert( m_OpenScopeCount == 0 );
+
+    FrameRecord* pFrame = &m_Frames[m_CurrentFrame];
+    if( pFrame->m_ScopeCount > 0 )
+    {
+        pFrame->m_SubmitValue = submitValue;
+        pFrame->m_Pending = true;
+    }
+
+    m_CommandBuffer = VK_NULL_HANDLE;
+    m_CurrentFrame = (m_CurrentFrame + 1) % m_FrameCount;
+}
+
+void VulkanGPUProfiler::BeginScope(const char* name, bool collectPipelineStatistics)
+{
+    assert( m_OpenScopeCount < MAX_GPU_SCOPES_PER_FRAME );
+
+    FrameRecord* pFrame = &m_Frames[m_CurrentFrame];
+
+    // UINT_MAX marks a scope that wrote nothing, so EndScope stays balanced.
+    uint32 nameIndex = UINT_MAX;
+    if( m_Enabled && m_CommandBuffer != VK_NULL_HANDLE && pFrame->m_ScopeCount < MAX_GPU_SCOPES_PER_FRAME )
+    {
+        nameIndex = FindOrAddName( name );
+    }
+
+    if( nameIndex == UINT_MAX )
+    {
+        m_OpenScopes[m_OpenScopeCount++] = UINT_MAX;
+        return;
+    }
+
+    uint32 scopeIndex = pFrame->m_ScopeCount++;
+    pFrame->m_Scopes[scopeIndex].m_NameIndex = nameIndex;
+    pFrame->m_Scopes[scopeIndex].m_StatisticsIndex = UINT_MAX;
+    m_OpenScopes[m_OpenScopeCount++] = scopeIndex;
+
+    uint32 query = (m_CurrentFrame * MAX_GPU_SCOPES_PER_FRAME + scopeIndex) * 2;
+    vkCmdWriteTimestamp( m_CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, query );
+
+    // Only one pipeline statistics query can be active at a time, nested requests just get timed.
+    if( collectPipelineStatistics && m_StatisticsReset && m_StatisticsActive == false && pFrame->m_StatisticsCount < MAX_GPU_STATISTICS_SCOPES_PER_FRAME )
+    {
+        uint32 statisticsIndex = pFrame->m_StatisticsCount++;
+        pFrame->m_Scopes[scopeIndex].m_StatisticsIndex = statisticsIndex;
+        m_StatisticsActive = true;
+
+        vkCmdBeginQuery( m_CommandBuffer, m_StatisticsQueryPool, m_CurrentFrame * MAX_GPU_STATISTICS_SCOPES_PER_FRAME + statisticsIndex, 0 );
+    }
+}
+
+void VulkanGPUProfiler::EndScope()
+{
+    assert( m_OpenScopeCount > 0 );
+
+    uint32 scopeIndex = m_OpenScopes[--m_OpenScopeCount];
+    if( scopeIndex == UINT_MAX )
+        return;
+
+    uint32 statisticsIndex = m_Frames[m_CurrentFrame].m_Scopes[scopeIndex].m_StatisticsIndex;
+    if( statisticsIndex != UINT_MAX )
+    {
+        vkCmdEndQuery( m_CommandBuffer, m_StatisticsQueryPool, m_CurrentFrame * MAX_GPU_STATISTICS_SCOPES_PER_FRAME + statisticsIndex );
+        m_StatisticsActive = false;
+    }
+
+    // Written once all earlier work in the command buffer has finished.
+    uint32 query = (m_CurrentFrame * MAX_GPU_SCOPES_PER_FRAME + scopeIndex) * 2 + 1;
+    vkCmdWriteTimestamp( m_CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, query );
+}
+
+void VulkanGPUProfiler::ResolveFrame(FrameRecord* pFrame, uint32 frameIndex)
+{
+    uint64 timestamps[MAX_GPU_SCOPES_PER_FRAME * 2];
+    uint32 queryCount = pFrame->m_ScopeCount * 2;
+
+    // The frame's timeline value has been reached, so the results are available and this doesn't wait.
+    VkResult result = vkGetQueryPoolResults( m_pInterface->m_Device, m_QueryPool, frameIndex * MAX_GPU_SCOPES_PER_FRAME * 2, queryCount,
+                                             sizeof( uint64 ) * queryCount, timestamps, sizeof( uint64 ), VK_QUERY_RESULT_64_BIT );
+    if( result == VK_NOT_READY )
+        return;
+    assert( result == VK_SUCCESS );
+
+    uint64 statistics[MAX_GPU_STATISTICS_SCOPES_PER_FRAME][GPUPipelineStatistic_Count];
+    if( pFrame->m_StatisticsCount > 0 )
+    {
+        result = vkGetQueryPoolResults( m_pInterface->m_Device, m_StatisticsQueryPool, frameIndex * MAX_GPU_STATISTICS_SCOPES_PER_FRAME, pFrame->m_StatisticsCount,
+                                        sizeof( statistics ), statistics, sizeof( statistics[0] ), VK_QUERY_RESULT_64_BIT );
+        if( result == VK_NOT_READY )
+            return;
+        assert( result == VK_SUCCESS );
+    }
+
+    pFrame->m_Pending = false;
+
+    // Sum scopes with the same name, then add one sample per name.
+    float totals[MAX_GPU_SCOPE_NAMES];
+    bool used[MAX_GPU_SCOPE_NAMES] = {};
+    bool usedStatistics[MAX_GPU_SCOPE_NAMES] = {};
+    for( uint32 i=0; i<pFrame->m_ScopeCount; i++ )
+    {
+        uint32 nameIndex = pFrame->m_Scopes[i].m_NameIndex;
+        uint64 ticks = (timestamps[i*2 + 1] - timestamps[i*2]) & m_TimestampMask;
+        float ms = ticks * m_NanosecondsPerTick / 1000000.0f;
+
+        if( used[nameIndex] == false )
+        {
+            used[nameIndex] = true;
+            totals[nameIndex] = 0;
+        }
+        totals[nameIndex] += ms;
+
+        uint32 statisticsIndex = pFrame->m_Scopes[i].m_StatisticsIndex;
+        if( statisticsIndex != UINT_MAX )
+        {
+            if( usedStatistics[nameIndex] == false )
+            {
+                usedStatistics[nameIndex] = true;
+                memset( m_LastStatistics[nameIndex], 0, sizeof( m_LastStatistics[nameIndex] ) );
+            }
+
+            for( uint32 s=0; s<GPUPipelineStatistic_Count; s++ )
+            {
+                m_LastStatistics[nameIndex][s] += statistics[statisticsIndex][s];
+            }
+            m_HasStatistics[nameIndex] = true;
+        }
+    }
+
+    for( uint32 i=0; i<m_NameCount; i++ )
+    {
+        if( used[i] == false )
+            continue;
+
+        m_History[i][m_HistoryNext[i]] = totals[i];
+        m_HistoryNext[i] = (m_HistoryNext[i] + 1) % GPU_PROFILER_HISTORY;
+        if( m_HistoryCount[i] < GPU_PROFILER_HISTORY )
+            m_HistoryCount[i]++;
+    }
+}
+
+void VulkanGPUProfiler::GetScopeStats(uint32 scopeIndex, GPUScopeStats* pStats)
+{
+    assert( scopeIndex < m_NameCount );
+    assert( pStats != nullptr );
+
+    memset( pStats, 0, sizeof( GPUScopeStats ) );
+    pStats->m_Name = m_Names[scopeIndex];
+    pStats->m_SampleCount = m_HistoryCount[scopeIndex];
+
+    pStats->m_HasPipelineStatistics = m_HasStatistics[scopeIndex];
+    if( m_HasStatistics[scopeIndex] )
+    {
+        memcpy( pStats->m_PipelineStatistics, m_LastStatistics[scopeIndex], sizeof( pStats->m_PipelineStatistics ) );
+    }
+
+    uint32 count = m_HistoryCount[scopeIndex];
+    if( count == 0 )
+        return;
+
+    pStats->m_LastMS = m_History[scopeIndex][(m_HistoryNext[scopeIndex] + GPU_PROFILER_HISTORY - 1) % GPU_PROFILER_HISTORY];
+
+    // Percentiles come from a sorted copy of the history.
+    float sorted[GPU_PROFILER_HISTORY];
+    memcpy( sorted, m_History[scopeIndex], sizeof( float ) * count );
+    std::sort( sorted, sorted + count );
+
+    float total = 0;
+    for( uint32 i=0; i<count; i++ )
+    {
+        total += sorted[i];
+    }
+
+    pStats->m_AverageMS = total / count;
+    pStats->m_MinMS = sorted[0];
+    pStats->m_MaxMS = sorted[count-1];
+    pStats->m_MedianMS = sorted[(count-1) * 50 / 100];
+    pStats->m_P95MS = sorted[(count-1) * 95 / 100];
+    pStats->m_P99MS = sorted[(count-1) * 99 / 100];
+}
+
+bool VulkanGPUProfiler::GetScopeStats(const char* name, GPUScopeStats* pStats)
+{
+    for( uint32 i=0; i<m_NameCount; i++ )
+    {
+        if( strcmp( m_Names[i], name ) == 0 )
+        {
+            GetScopeStats( i, pStats );
+            return true;
+        }
+    }
+
+    return false;
+}
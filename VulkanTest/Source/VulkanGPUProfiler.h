@@ -0,0 +1,147 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __VulkanGPUProfiler_H__
+#define __VulkanGPUProfiler_H__
+
+#include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+
+class VulkanInterface;
+
+static const uint32 MAX_GPU_PROFILER_FRAMES = 8;
+static const uint32 MAX_GPU_SCOPES_PER_FRAME = 64;
+static const uint32 MAX_GPU_STATISTICS_SCOPES_PER_FRAME = 16;
+static const uint32 MAX_GPU_SCOPE_NAMES = 32;
+static const uint32 GPU_PROFILER_HISTORY = 128;
+
+// Pipeline statistics counters, in the order Vulkan returns them.
+enum GPUPipelineStatistic
+{
+    GPUPipelineStatistic_InputAssemblyVertices,
+    GPUPipelineStatistic_InputAssemblyPrimitives,
+    GPUPipelineStatistic_VertexShaderInvocations,
+    GPUPipelineStatistic_ClippingInvocations,
+    GPUPipelineStatistic_ClippingPrimitives,    // Primitives that survived clipping.
+    GPUPipelineStatistic_FragmentShaderInvocations,
+    GPUPipelineStatistic_Count,
+};
+
+// Rolling stats for one named scope, in milliseconds.  Scopes that run more than once a frame are summed per frame.
+struct GPUScopeStats
+{
+    const char* m_Name;
+    float m_LastMS;
+    float m_AverageMS;
+    float m_MinMS;
+    float m_MaxMS;
+    float m_MedianMS;
+    float m_P95MS;
+    float m_P99MS;
+    uint32 m_SampleCount;
+
+    // From the last resolved frame that collected them, summed like the times.
+    bool m_HasPipelineStatistics;
+    uint64 m_PipelineStatistics[GPUPipelineStatistic_Count];
+};
+
+// Times named scopes on the graphics queue with timestamp queries.
+// Each frame in flight gets its own range of the query pool.  Results are read once the graphics timeline shows
+// the frame finished, which is a few frames later, so reading them never stalls the CPU or the GPU.
+// Scopes can also count vertex, primitive and fragment work with pipeline statistics queries, if the device
+// supports them and they're turned on.  Those queries can't nest, so only the outermost such scope collects them.
+class VulkanGPUProfiler
+{
+protected:
+    struct ScopeRecord
+    {
+        uint32 m_NameIndex;
+        uint32 m_StatisticsIndex; // UINT_MAX if the scope didn't collect pipeline statistics.
+    };
+
+    struct FrameRecord
+    {
+        ScopeRecord m_Scopes[MAX_GPU_SCOPES_PER_FRAME]; // Scope i uses queries 2*i and 2*i+1 of the frame's range.
+        uint32 m_ScopeCount;
+        uint32 m_StatisticsCount;
+        uint64 m_SubmitValue;   // Graphics timeline value, 0 until EndFrame.
+        bool m_Pending;         // Submitted and not resolved yet.
+    };
+
+    VulkanInterface* m_pInterface;
+    VkQueryPool m_QueryPool;
+    VkQueryPool m_StatisticsQueryPool; // VK_NULL_HANDLE if the device has no pipelineStatisticsQuery.
+    bool m_Enabled;
+    bool m_StatisticsEnabled;
+    float m_NanosecondsPerTick;
+    uint64 m_TimestampMask;     // Only timestampValidBits of each value are meaningful.
+
+    FrameRecord m_Frames[MAX_GPU_PROFILER_FRAMES];
+    uint32 m_FrameCount;
+    uint32 m_CurrentFrame;
+    VkCommandBuffer m_CommandBuffer; // Set between BeginFrame and EndFrame.
+    uint32 m_OpenScopes[MAX_GPU_SCOPES_PER_FRAME];
+    uint32 m_OpenScopeCount;
+    bool m_StatisticsActive;
+    bool m_StatisticsReset;     // This frame's statistics queries were reset, so they can be used.
+
+    // Names are compared by pointer first, pass string literals.
+    const char* m_Names[MAX_GPU_SCOPE_NAMES];
+    float m_History[MAX_GPU_SCOPE_NAMES][GPU_PROFILER_HISTORY];
+    uint32 m_HistoryCount[MAX_GPU_SCOPE_NAMES];
+    uint32 m_HistoryNext[MAX_GPU_SCOPE_NAMES];
+    uint64 m_LastStatistics[MAX_GPU_SCOPE_NAMES][GPUPipelineStatistic_Count];
+    bool m_HasStatistics[MAX_GPU_SCOPE_NAMES];
+    uint32 m_NameCount;
+
+protected:
+    uint32 FindOrAddName(const char* name);
+    void ResolveFrame(FrameRecord* pFrame, uint32 frameIndex);
+
+public:
+    VulkanGPUProfiler();
+    virtual ~VulkanGPUProfiler();
+
+    // frameCount is how many frames can be recorded before the oldest has to be resolved, use the frames in flight.
+    void Create(VulkanInterface* pInterface, uint32 frameCount);
+    void Destroy();
+
+    // Resolves finished frames and resets this frame's queries.  Call outside a render pass.
+    void BeginFrame(VkCommandBuffer commandBuffer);
+    void EndFrame(uint64 submitValue);
+
+    // Scopes nest.  Nothing is written if the profiler is off or the frame has run out of queries.
+    // Statistics scopes that begin inside a render pass must end in the same subpass.
+    void BeginScope(const char* name, bool collectPipelineStatistics = false);
+    void EndScope();
+
+    void SetEnabled(bool enabled) { m_Enabled = enabled && m_QueryPool != VK_NULL_HANDLE; }
+    bool IsEnabled() { return m_Enabled; }
+
+    // Off by default, the counters cost a little GPU time on some hardware.
+    void SetPipelineStatisticsEnabled(bool enabled) { m_StatisticsEnabled = enabled && m_StatisticsQueryPool != VK_NULL_HANDLE; }
+    bool ArePipelineStatisticsEnabled() { return m_StatisticsEnabled; }
+
+    uint32 GetScopeCount() { return m_NameCount; }
+    void GetScopeStats(uint32 scopeIndex, GPUScopeStats* pStats);
+    bool GetScopeStats(const char* name, GPUScopeStats* pStats);
+};
+
+// Times the enclosing block.
+class VulkanGPUScope
+{
+protected:
+    VulkanGPUProfiler* m_pProfiler;
+
+public:
+    VulkanGPUScope(VulkanGPUProfiler* pProfiler, const char* name, bool collectPipelineStatistics = false) { m_pProfiler = pProfiler; m_pProfiler->BeginScope( name, collectPipelineStatistics ); }
+    ~VulkanGPUScope() { m_pProfiler->EndScope(); }
+};
+
+#endif //__VulkanGPUProfiler_H__
@@ -0,0 +1,257 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+
+#include "VulkanBuffer.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanGeometryPool.h"
+#include "VulkanInterface.h"
+#include "VulkanTransferQueue.h"
+
+//============================================================================================================
+// GeometryPoolRangeAllocator
+//============================================================================================================
+
+GeometryPoolRangeAllocator::GeometryPoolRangeAllocator()
+{
+    m_FreeRanges = nullptr;
+    m_FreeRangeCount = 0;
+    m_FreeRangeCapacity = 0;
+    m_Capacity = 0;
+}
+
+GeometryPoolRangeAllocator::~GeometryPoolRangeAllocator()
+{
+    delete[] m_FreeRanges;
+}
+
+void GeometryPoolRangeAllocator::Init(uint32 capacity)
+{
+    m_Capacity = capacity;
+
+    if( m_FreeRanges == nullptr )
+    {
+        m_FreeRangeCapacity = INITIAL_GEOMETRY_POOL_FREE_RANGES;
+        m_FreeRanges = new Range[m_FreeRangeCapacity];
+    }
+
+    // Start with a single free range covering everything.
+    m_FreeRanges[0].m_Start = 0;
+    m_FreeRanges[0].m_Count = capacity;
+    m_FreeRangeCount = 1;
+}
+
+bool GeometryPoolRangeAllocator::Allocate(uint32 count, uint32* pStart)
+{
+    assert( pStart != nullptr );
+
+    for( uint32 i=0; i<m_FreeRangeCount; i++ )
+    {
+        if( m_FreeRanges[i].m_Count >= count )
+        {
+            *pStart = m_FreeRanges[i].m_Start;
+
+            m_FreeRanges[i].m_Start += count;
+            m_FreeRanges[i].m_Count -= count;
+
+            // Remove the range if it's now empty.
+            if( m_FreeRanges[i].m_Count == 0 )
+            {
+                for( uint32 j=i; j<m_FreeRangeCount-1; j++ )
+                {
+                    m_FreeRanges[j] = m_FreeRanges[j+1];
+                }
+                m_FreeRangeCount--;
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void GeometryPoolRangeAllocator::Free(uint32 start, uint32 count)
+{
+    assert( start + count <= m_Capacity );
+
+    if( count == 0 )
+        return;
+
+    // Find the insertion point, ranges are kept sorted by start.
+    uint32 index = 0;
+    while( index < m_FreeRangeCount && m_FreeRanges[index].m_Start < start )
+    {
+        index++;
+    }
+
+    bool mergesWithPrevious = index > 0 && m_FreeRanges[index-1].m_Start + m_FreeRanges[index-1].m_Count == start;
+    bool mergesWithNext = index < m_FreeRangeCount && start + count == m_FreeRanges[index].m_Start;
+
+    if( mergesWithPrevious && mergesWithNext )
+    {
+        // Join previous, freed and next ranges into one, then remove next.
+        m_FreeRanges[index-1].m_Count += count + m_FreeRanges[index].m_Count;
+        for( uint32 j=index; j<m_FreeRangeCount-1; j++ )
+        {
+            m_FreeRanges[j] = m_FreeRanges[j+1];
+        }
+        m_FreeRangeCount--;
+    }
+    else if( mergesWithPrevious )
+    {
+        m_FreeRanges[index-1].m_Count += count;
+    }
+    else if( mergesWithNext )
+    {
+        m_FreeRanges[index].m_Start = start;
+        m_FreeRanges[index].m_Count += count;
+    }
+    else
+    {
+        // Another hole, grow the table if it's full.
+        if( m_FreeRangeCount == m_FreeRangeCapacity )
+        {
+            Range* newRanges = new Range[m_FreeRangeCapacity * 2];
+            memcpy( newRanges, m_FreeRanges, sizeof( Range ) * m_FreeRangeCount );
+            delete[] m_FreeRanges;
+            m_FreeRanges = newRanges;
+            m_FreeRangeCapacity *= 2;
+        }
+
+        for( uint32 j=m_FreeRangeCount; j>index; j-- )
+        {
+            m_FreeRanges[j] = m_FreeRanges[j-1];
+        }
+        m_FreeRanges[index].m_Start = start;
+        m_FreeRanges[index].m_Count = count;
+        m_FreeRangeCount++;
+    }
+}
+
+//============================================================================================================
+// VulkanGeometryPool
+//============================================================================================================
+
+VulkanGeometryPool::VulkanGeometryPool()
+{
+    m_pInterface = nullptr;
+
+    m_VertexBuffer = nullptr;
+    m_IndexBuffer = nullptr;
+
+    m_VertexStride = 0;
+}
+
+VulkanGeometryPool::~VulkanGeometryPool()
+{
+    assert( m_VertexBuffer == nullptr );
+    assert( m_IndexBuffer == nullptr );
+}
+
+void VulkanGeometryPool::Create(VulkanInterface* pInterface, uint32 vertexStride, uint32 maxVertices, uint32 maxIndexBytes)
+{
+    assert( m_VertexBuffer == nullptr );
+    assert( pInterface != nullptr );
+    assert( vertexStride > 0 );
+
+    m_pInterface = pInterface;
+    m_VertexStride = vertexStride;
+
+    // Create one vertex and one index buffer large enough for every mesh in the pool.
+    m_VertexBuffer = new VulkanBuffer();
+    m_VertexBuffer->Create( pInterface, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, nullptr, vertexStride * maxVertices, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+
+    m_IndexBuffer = new VulkanBuffer();
+    m_IndexBuffer->Create( pInterface, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, nullptr, maxIndexBytes, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+
+    m_VertexRanges.Init( maxVertices );
+    m_IndexRanges.Init( maxIndexBytes );
+}
+
+void VulkanGeometryPool::Destroy()
+{
+    // Run any frees still waiting on the GPU while the pool is alive.
+    m_pInterface->GetDeletionQueue()->Flush();
+
+    m_VertexBuffer->Destroy();
+    m_IndexBuffer->Destroy();
+
+    delete m_VertexBuffer;
+    delete m_IndexBuffer;
+
+    m_VertexBuffer = nullptr;
+    m_IndexBuffer = nullptr;
+
+    m_pInterface = nullptr;
+}
+
+// Index ranges are allocated in bytes, rounded up to 4 so every range starts aligned for either index type.
+static uint32 GetIndexRangeSize(uint32 indexCount, VkIndexType indexType)
+{
+    uint32 sizeInBytes = indexCount * VulkanGeometryPool::GetIndexSize( indexType );
+    return (sizeInBytes + 3) & ~3;
+}
+
+bool VulkanGeometryPool::Allocate(const void* vertices, uint32 vertexCount, const void* indices, uint32 indexCount, VkIndexType indexType, int32* pVertexOffset, uint32* pFirstIndex, uint64* pUploadSerial)
+{
+    assert( m_VertexBuffer != nullptr );
+    assert( pVertexOffset != nullptr && pFirstIndex != nullptr && pUploadSerial != nullptr );
+    assert( indexType == VK_INDEX_TYPE_UINT16 || indexType == VK_INDEX_TYPE_UINT32 );
+
+    uint32 indexSize = GetIndexSize( indexType );
+    uint32 indexRangeSize = GetIndexRangeSize( indexCount, indexType );
+
+    uint32 firstVertex;
+    if( m_VertexRanges.Allocate( vertexCount, &firstVertex ) == false )
+        return false;
+
+    uint32 indexByteOffset;
+    if( m_IndexRanges.Allocate( indexRangeSize, &indexByteOffset ) == false )
+    {
+        m_VertexRanges.Free( firstVertex, vertexCount );
+        return false;
+    }
+
+    // Indices stay relative to the mesh, vertexOffset is added by vkCmdDrawIndexed.
+    // Serials only increase, so the index upload finishes no earlier than the vertex one.
+    VulkanTransferQueue* pTransferQueue = m_pInterface->GetTransferQueue();
+    pTransferQueue->Upload( m_VertexBuffer, m_VertexStride * firstVertex, vertices, m_VertexStride * vertexCount, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT );
+    *pUploadSerial = pTransferQueue->Upload( m_IndexBuffer, indexByteOffset, indices, indexSize * indexCount, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT );
+
+    *pVertexOffset = (int32)firstVertex;
+    *pFirstIndex = indexByteOffset / indexSize;
+
+    return true;
+}
+
+void VulkanGeometryPool::Free(int32 vertexOffset, uint32 vertexCount, uint32 firstIndex, uint32 indexCount, VkIndexType indexType)
+{
+    // Frames in flight may still draw from these ranges, so they only return to the allocators once those are done.
+    uint32 data[4];
+    data[0] = (uint32)vertexOffset;
+    data[1] = vertexCount;
+    data[2] = firstIndex * GetIndexSize( indexType );
+    data[3] = GetIndexRangeSize( indexCount, indexType );
+
+    m_pInterface->GetDeletionQueue()->DeferCallback( FreeRangesCallback, this, data, 4 );
+}
+
+void VulkanGeometryPool::FreeRangesCallback(void* pContext, const uint32* pData)
+{
+    VulkanGeometryPool* pPool = (VulkanGeometryPool*)pContext;
+
+    pPool->m_VertexRanges.Free( pData[0], pData[1] );
+    pPool->m_IndexRanges.Free( pData[2], pData[3] );
+}
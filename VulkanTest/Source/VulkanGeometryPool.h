@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __VulkanGeometryPool_H__
+#define __VulkanGeometryPool_H__
+
+#include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+
+class VulkanInterface;
+class VulkanBuffer;
+
+// The free range table doubles whenever a Free needs another hole.
+static const uint32 INITIAL_GEOMETRY_POOL_FREE_RANGES = 256;
+
+// First-fit allocator handing out ranges of elements (vertices or index bytes) from a fixed capacity.
+class GeometryPoolRangeAllocator
+{
+protected:
+    struct Range
+    {
+        uint32 m_Start;
+        uint32 m_Count;
+    };
+
+    Range* m_FreeRanges; // Sorted by start, adjacent ranges are merged.
+    uint32 m_FreeRangeCount;
+    uint32 m_FreeRangeCapacity;
+    uint32 m_Capacity;
+
+public:
+    GeometryPoolRangeAllocator();
+    ~GeometryPoolRangeAllocator();
+
+    void Init(uint32 capacity);
+
+    bool Allocate(uint32 count, uint32* pStart);
+    void Free(uint32 start, uint32 count);
+
+    uint32 GetCapacity() { return m_Capacity; }
+};
+
+// One large vertex buffer and one large index buffer shared by many meshes.
+// Meshes only store their vertexOffset/firstIndex into these, so consecutive draws don't rebind buffers.
+class VulkanGeometryPool
+{
+protected:
+    VulkanInterface* m_pInterface;
+
+    VulkanBuffer* m_VertexBuffer;
+    VulkanBuffer* m_IndexBuffer;
+
+    uint32 m_VertexStride;
+
+    GeometryPoolRangeAllocator m_VertexRanges;
+    GeometryPoolRangeAllocator m_IndexRanges;
+
+protected:
+    static void FreeRangesCallback(void* pContext, const uint32* pData);
+
+public:
+    VulkanGeometryPool();
+    virtual ~VulkanGeometryPool();
+
+    void Create(VulkanInterface* pInterface, uint32 vertexStride, uint32 maxVertices, uint32 maxIndexBytes);
+    void Destroy();
+
+    // Copies the vertices and indices into the pool, returns false if the pool is full.
+    // 16 and 32-bit indices share the index buffer, firstIndex is in units of the given index type.
+    // The buffers are device local, the copy goes through the transfer queue and pUploadSerial says when it's done.
+    bool Allocate(const void* vertices, uint32 vertexCount, const void* indices, uint32 indexCount, VkIndexType indexType, int32* pVertexOffset, uint32* pFirstIndex, uint64* pUploadSerial);
+    // The ranges are reused once the GPU is done with them, see VulkanDeletionQueue.
+    void Free(int32 vertexOffset, uint32 vertexCount, uint32 firstIndex, uint32 indexCount, VkIndexType indexType);
+
+    static uint32 GetIndexSize(VkIndexType indexType) { return indexType == VK_INDEX_TYPE_UINT32 ? 4 : 2; }
+
+    VulkanInterface* GetInterface() { return m_pInterface; }
+    VulkanBuffer* GetVertexBuffer() { return m_VertexBuffer; }
+    VulkanBuffer* GetIndexBuffer() { return m_IndexBuffer; }
+    uint32 GetVertexStride() { return m_VertexStride; }
+};
+
+#endif //__VulkanGeometryPool_H__
@@ -8,21 +8,139 @@
 // 3. This notice may not be removed or altered from any source distribution.
 
 #include <assert.h>
+#include <ctype.h>
 #include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#if _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#else
+#define VK_USE_PLATFORM_XCB_KHR
+#endif
 #include "vulkan/vulkan.h"
 
+#include "CPUProfiler.h"
 #include "VulkanBuffer.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanGeometryPool.h"
 #include "VulkanInterface.h"
 #include "VulkanMesh.h"
+#include "VulkanSamplerCache.h"
 #include "VulkanShader.h"
 #include "VulkanSwapchainObject.h"
+#include "VulkanTexture.h"
+#include "VulkanTexturePool.h"
+#include "VulkanTransferQueue.h"
 #include "Structs.h"
 
+// Size of the shared vertex/index buffers all meshes are suballocated from.
+static const uint32 GEOMETRY_POOL_MAX_VERTICES = 1024*1024;
+static const uint32 GEOMETRY_POOL_MAX_INDEX_BYTES = 16*1024*1024;
+
+// Size of the ring all uploads to device local memory are staged through.
+static const uint32 TRANSFER_STAGING_SIZE = 32*1024*1024;
+
+// Size of the shared allocation all textures are placed in, and how many textures can exist at once.
+static const uint32 TEXTURE_POOL_SIZE = 64*1024*1024;
+static const uint32 MAX_TEXTURES = 1024;
+
+static const char* VALIDATION_LAYER_NAME = "VK_LAYER_KHRONOS_validation";
+
+static VKAPI_ATTR VkBool32 VKAPI_CALL DebugUtilsCallback(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT types,
+                                                         const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData)
+{
+    char message[2048];
+    snprintf( message, sizeof( message ), "Vulkan %s: %s\n", (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) ? "error" : "warning", pCallbackData->pMessage );
+
+#if _WIN32
+    OutputDebugStringA( message );
+#else
+    fputs( message, stderr );
+#endif
+
+    // Don't abort the call that triggered the message.
+    return VK_FALSE;
+}
+
+// Integrated GPUs report part of system memory here.
+static uint64 SumDeviceLocalMemory(VkPhysicalDevice device)
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties( device, &memoryProperties );
+
+    uint64 size = 0;
+    for( uint32_t i=0; i<memoryProperties.memoryHeapCount; i++ )
+    {
+        if( memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT )
+            size += memoryProperties.memoryHeaps[i].size;
+    }
+
+    return size;
+}
+
+static bool IsInstanceLayerAvailable(const char* layerName)
+{
+    uint32_t layerCount = 0;
+    vkEnumerateInstanceLayerProperties( &layerCount, nullptr );
+
+    VkLayerProperties* layers = new VkLayerProperties[layerCount];
+    vkEnumerateInstanceLayerProperties( &layerCount, layers );
+
+    bool found = false;
+    for( uint32_t i=0; i<layerCount; i++ )
+    {
+        if( strcmp( layers[i].layerName, layerName ) == 0 )
+            found = true;
+    }
+
+    delete[] layers;
+    return found;
+}
+
+// Searches the extensions the loader and drivers provide, or a layer's if layerName isn't nullptr.
+static bool IsInstanceExtensionAvailable(const char* layerName, const char* extensionName)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateInstanceExtensionProperties( layerName, &extensionCount, nullptr );
+
+    VkExtensionProperties* extensions = new VkExtensionProperties[extensionCount];
+    vkEnumerateInstanceExtensionProperties( layerName, &extensionCount, extensions );
+
+    bool found = false;
+    for( uint32_t i=0; i<extensionCount; i++ )
+    {
+        if( strcmp( extensions[i].extensionName, extensionName ) == 0 )
+            found = true;
+    }
+
+    delete[] extensions;
+    return found;
+}
+
 VulkanInterface::VulkanInterface()
 {
-    m_SwapchainImageCount = 3;
+    m_FramesInFlight = 2;
+    m_RequestedPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    m_RequestedImageCount = 0;
+    m_VertexLayout.CreateDefault();
+    m_InstanceCount = 1;
+    m_LODPixelError = 1.0f;
+    m_PreferredDevice[0] = '\0';
+
+    // One full screen view.
+    RenderView view;
+    view.m_X = 0.0f;
+    view.m_Y = 0.0f;
+    view.m_Width = 1.0f;
+    view.m_Height = 1.0f;
+    view.m_CameraPosition = Vector3(0,0,-5);
+    view.m_CameraUp = Vector3(0,1,0);
+    view.m_LookAtTarget = Vector3(0,0,0);
+    view.m_VerticalFOV = 45.0f;
+    view.m_CullMode = VK_CULL_MODE_BACK_BIT;
+    SetViews( &view, 1 );
 
     NullEverything();
 }
@@ -35,9 +153,19 @@ void VulkanInterface::NullEverything()
 {
     m_Window = nullptr;
     m_TempShader = nullptr;
+    m_GeometryPool = nullptr;
+    m_TransferQueue = nullptr;
+    m_DeletionQueue = nullptr;
     m_UBODescriptorSetLayout = VK_NULL_HANDLE;
 
+    m_TexturePool = nullptr;
+    m_SamplerCache = nullptr;
+    m_DefaultTexture = nullptr;
+    m_TextureDescriptorSetLayout = VK_NULL_HANDLE;
+    m_TextureDescriptorPool = VK_NULL_HANDLE;
+
     m_VulkanInstance = VK_NULL_HANDLE;
+    m_InstanceAPIVersion = VK_API_VERSION_1_0;
     m_PhysicalDevice = VK_NULL_HANDLE;
     m_Device = VK_NULL_HANDLE;
     m_Surface = VK_NULL_HANDLE;
@@ -46,6 +174,10 @@ void VulkanInterface::NullEverything()
     m_Queue = VK_NULL_HANDLE;
     m_GraphicsQueueFamilyIndex = UINT_MAX;
     //m_PresentQueueFamilyIndex = UINT_MAX;
+    m_TransferDeviceQueue = VK_NULL_HANDLE;
+    m_TransferQueueFamilyIndex = UINT_MAX;
+    m_ComputeDeviceQueue = VK_NULL_HANDLE;
+    m_ComputeQueueFamilyIndex = UINT_MAX;
 
     m_CommandBufferPool = VK_NULL_HANDLE;
     m_DescriptorPool = VK_NULL_HANDLE;
@@ -53,19 +185,51 @@ void VulkanInterface::NullEverything()
     m_SurfaceWidth = 0;
     m_SurfaceHeight = 0;
 
+    m_Headless = false;
+    m_OffscreenMemory = VK_NULL_HANDLE;
+
     m_Swapchain = VK_NULL_HANDLE;
-    for( uint32 i=0; i<MAX_SWAP_IMAGES; i++ )
-    {
-        m_SwapchainStuff[i].NullEverything();
-    }
+    m_SwapchainImageCount = 0;
+    m_PresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    m_SwapchainStuff = nullptr;
     m_CurrentSwapchainImageIndex = UINT_MAX;
-
-    m_ImageAcquiredSemaphore = VK_NULL_HANDLE;
-    m_DrawCompleteSemaphore = VK_NULL_HANDLE;
+    m_SwapchainOutOfDate = false;
+
+    m_FrameStuff = nullptr;
+    m_CurrentFrameIndex = 0;
+
+    m_pfnWaitSemaphores = nullptr;
+    m_pfnGetSemaphoreCounterValue = nullptr;
+    m_pfnCmdSetCullMode = nullptr;
+    memset( &m_DeviceProperties, 0, sizeof( m_DeviceProperties ) );
+    memset( &m_DeviceFeatures, 0, sizeof( m_DeviceFeatures ) );
+    m_DeviceLocalMemorySize = 0;
+    m_PipelineStatisticsQuerySupported = false;
+    m_MultiDrawIndirect = false;
+    m_MaxDrawIndirectCount = 1;
+    m_ValidationEnabled = false;
+    m_DebugMessenger = VK_NULL_HANDLE;
+    m_pfnSetDebugUtilsObjectName = nullptr;
+    m_UBOViewStride = 0;
 
     m_RenderPass = VK_NULL_HANDLE;
     m_Pipeline = VK_NULL_HANDLE;
     m_PipelineLayout = VK_NULL_HANDLE;
+
+    m_MeshCount = 0;
+    memset( &m_RenderStats, 0, sizeof( m_RenderStats ) );
+
+    m_DeviceMemoryInUse = 0;
+    m_PeakDeviceMemory = 0;
+    m_DeviceAllocationCount = 0;
+}
+
+void VulkanInterface::SetVertexLayout(const VertexLayout& layout)
+{
+    // The pipeline and geometry pool are built for a single layout.
+    assert( m_Device == VK_NULL_HANDLE );
+
+    m_VertexLayout = layout;
 }
 
 void VulkanInterface::Create(const char* windowName, int width, int height)
@@ -74,90 +238,440 @@ void VulkanInterface::Create(const char* windowName, int width, int height)
     assert( m_Window == nullptr );
 
     CreateInterface();
-    CreateSurface( windowName, width, height );
-    CreateSwapchain();
+    if( m_Headless )
+    {
+        CreateOffscreenTarget( width, height );
+    }
+    else
+    {
+        CreateSurface( windowName, width, height );
+        CreateSwapchain();
+    }
     CreateCommandBufferPool();
     CreateDescriptorPool();
-    CreateSemaphores();
 
+    m_GraphicsTimeline.Create( this );
+    SetObjectName( VK_OBJECT_TYPE_SEMAPHORE, (uint64)m_GraphicsTimeline.GetSemaphore(), "Graphics Timeline" );
+    m_FramePacer.Init( &m_GraphicsTimeline );
+    m_GPUProfiler.Create( this, m_FramesInFlight );
+
+    // Anything destroyed from here on is held until the GPU is done with it.
+    m_DeletionQueue = new VulkanDeletionQueue();
+    m_DeletionQueue->Create( this );
 
     m_UBODescriptorSetLayout = CreateUBODescriptorSetLayout();
+    m_TextureDescriptorSetLayout = CreateTextureDescriptorSetLayout();
 
-    // Create UBOs for matrices.  One per swapchain image.
-    for( uint32 i=0; i<m_SwapchainImageCount; i++ )
-    {
-        m_SwapchainStuff[i].m_UBO_Matrices = new VulkanBuffer();
-        m_SwapchainStuff[i].m_UBO_Matrices->Create( this, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, nullptr, sizeof( UniformBufferObject_Matrices ) );
-    }
+    CreateFrameResources();
+
+    CreateRenderPassAndPipeline( m_UBODescriptorSetLayout, m_TextureDescriptorSetLayout );
+    CreateFramebuffers();
+
+    // Create the uploader for device local buffers.
+    m_TransferQueue = new VulkanTransferQueue();
+    m_TransferQueue->Create( this, m_TransferDeviceQueue, m_TransferQueueFamilyIndex, m_Queue, m_GraphicsQueueFamilyIndex, &m_GraphicsTimeline, TRANSFER_STAGING_SIZE );
 
-    CreateDescriptorSets();
+    // Create the geometry pool all meshes will share.
+    m_GeometryPool = new VulkanGeometryPool();
+    m_GeometryPool->Create( this, m_VertexLayout.GetStride(), GEOMETRY_POOL_MAX_VERTICES, GEOMETRY_POOL_MAX_INDEX_BYTES );
 
-    CreateRenderPassAndPipeline( m_UBODescriptorSetLayout );
+    // Create the texture pool and sampler cache all textures will share.
+    m_TexturePool = new VulkanTexturePool();
+    m_TexturePool->Create( this, TEXTURE_POOL_SIZE );
+
+    m_SamplerCache = new VulkanSamplerCache();
+    m_SamplerCache->Create( this );
+
+    // Wait for the default texture once here, so there's always something resident to bind.
+    m_DefaultTexture = new VulkanTexture();
+    m_DefaultTexture->CreateSolidColor( this, 255, 255, 255, 255 );
+    m_TransferQueue->WaitIdle();
+}
+
+void VulkanInterface::CreateHeadless(int width, int height)
+{
+    assert( m_VulkanInstance == VK_NULL_HANDLE );
+
+    m_Headless = true;
+    Create( nullptr, width, height );
 }
 
 void VulkanInterface::Destroy()
 {
+    // Nothing below is tracked by the deletion queue, so the GPU has to be finished with all of it.
+    VkResult result = vkDeviceWaitIdle( m_Device );
+    assert( result == VK_SUCCESS );
+
     // Destroy Vulkan objects.
     vkDestroyDescriptorSetLayout( m_Device, m_UBODescriptorSetLayout, nullptr );
+    vkDestroyDescriptorSetLayout( m_Device, m_TextureDescriptorSetLayout, nullptr );
 
     vkDestroyPipelineLayout( m_Device, m_PipelineLayout, nullptr );
     vkDestroyPipeline( m_Device, m_Pipeline, nullptr );
     vkDestroyRenderPass( m_Device, m_RenderPass, nullptr );
 
-    vkDestroySemaphore( m_Device, m_ImageAcquiredSemaphore, nullptr );
-    vkDestroySemaphore( m_Device, m_DrawCompleteSemaphore, nullptr );
+    DestroySwapchainImageResources();
+    if( m_Swapchain != VK_NULL_HANDLE )
+    {
+        vkDestroySwapchainKHR( m_Device, m_Swapchain, nullptr );
+    }
 
-    vkDestroySwapchainKHR( m_Device, m_Swapchain, nullptr );
+    DestroyFrameResources();
 
     vkDestroyCommandPool( m_Device, m_CommandBufferPool, nullptr );
     vkDestroyDescriptorPool( m_Device, m_DescriptorPool, nullptr );
 
-    for( uint32 i=0; i<MAX_SWAP_IMAGES; i++ )
-    {
-        vkDestroyImageView( m_Device, m_SwapchainStuff[i].m_ImageViews, nullptr );
-        vkDestroyFramebuffer( m_Device, m_SwapchainStuff[i].m_Framebuffers, nullptr );
-    }
+    // Textures still alive belong to the application, it has to destroy them before this.
+    m_DefaultTexture->Destroy();
+    delete m_DefaultTexture;
+
+    m_SamplerCache->Destroy();
+    delete m_SamplerCache;
+
+    m_TexturePool->Destroy();
+    delete m_TexturePool;
+
+    // Waits for any uploads still in flight.
+    m_TransferQueue->Destroy();
+    delete m_TransferQueue;
+    m_TransferQueue = nullptr;
 
+    m_GeometryPool->Destroy();
+    delete m_GeometryPool;
+
+    // Kept until now for CreatePipeline.
+    m_TempShader->Destroy();
     delete m_TempShader;
-    for( uint32 i=0; i<MAX_SWAP_IMAGES; i++ )
-    {
-        delete m_SwapchainStuff[i].m_UBO_Matrices;
-    }
+
+    // The device is idle, so everything still queued can go.
+    m_DeletionQueue->Destroy();
+    delete m_DeletionQueue;
+
+    // Freed texture descriptor sets were returned to it by the deletion queue.
+    vkDestroyDescriptorPool( m_Device, m_TextureDescriptorPool, nullptr );
+
+    m_GPUProfiler.Destroy();
+
+    // Destroyed last, flushing the deletion queue waits on it.
+    m_GraphicsTimeline.Destroy();
 
     vkDestroyDevice( m_Device, nullptr );
 
-    m_Window->Destroy();
-    delete m_Window;
+    if( m_Window )
+    {
+        m_Window->Destroy();
+        delete m_Window;
+    }
+
+    if( m_DebugMessenger != VK_NULL_HANDLE )
+    {
+        PFN_vkDestroyDebugUtilsMessengerEXT pfnDestroyDebugUtilsMessenger = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr( m_VulkanInstance, "vkDestroyDebugUtilsMessengerEXT" );
+        pfnDestroyDebugUtilsMessenger( m_VulkanInstance, m_DebugMessenger, nullptr );
+    }
 
     vkDestroyInstance( m_VulkanInstance, nullptr );
 
     NullEverything();
 }
 
+void VulkanInterface::SetPreferredDevice(const char* nameOrUUID)
+{
+    assert( m_PhysicalDevice == VK_NULL_HANDLE );
+
+    strncpy( m_PreferredDevice, nameOrUUID ? nameOrUUID : "", sizeof( m_PreferredDevice ) - 1 );
+    m_PreferredDevice[sizeof( m_PreferredDevice ) - 1] = '\0';
+}
+
 int VulkanInterface::ChooseDevice(int deviceCount, VkPhysicalDevice* devices)
 {
-    // Default to the first physical device for now.
-    return 0;
+    // An explicit choice wins, as long as the device can run the renderer.
+    const char* preferred = m_PreferredDevice[0] ? m_PreferredDevice : getenv( "VULKAN_DEVICE" );
+    if( preferred && preferred[0] )
+    {
+        for( int i=0; i<deviceCount; i++ )
+        {
+            if( ScoreDevice( devices[i] ) >= 0 && MatchesPreferredDevice( devices[i], preferred ) )
+                return i;
+        }
+
+        fprintf( stderr, "No usable Vulkan device matches \"%s\", picking the best one.\n", preferred );
+    }
+
+    int bestIndex = -1;
+    int64 bestScore = -1;
+    for( int i=0; i<deviceCount; i++ )
+    {
+        int64 score = ScoreDevice( devices[i] );
+        if( score > bestScore )
+        {
+            bestIndex = i;
+            bestScore = score;
+        }
+    }
+
+    // No device meets the requirements.
+    assert( bestIndex != -1 );
+    return bestIndex != -1 ? bestIndex : 0;
+}
+
+int64 VulkanInterface::ScoreDevice(VkPhysicalDevice device)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties( device, &properties );
+
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures( device, &features );
+
+    // Needs a graphics queue, separate transfer and compute families are a bonus.
+    bool hasGraphicsFamily = false;
+    bool hasTransferFamily = false;
+    bool hasComputeFamily = false;
+    {
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties( device, &queueFamilyCount, nullptr );
+
+        if( queueFamilyCount > 128 )
+            queueFamilyCount = 128;
+        VkQueueFamilyProperties queueFamilyProperties[128];
+
+        vkGetPhysicalDeviceQueueFamilyProperties( device, &queueFamilyCount, queueFamilyProperties );
+
+        for( uint32_t i=0; i<queueFamilyCount; i++ )
+        {
+            VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+            if( queueFamilyProperties[i].queueCount == 0 )
+                continue;
+
+            if( flags & VK_QUEUE_GRAPHICS_BIT )
+                hasGraphicsFamily = true;
+            else if( flags & VK_QUEUE_COMPUTE_BIT )
+                hasComputeFamily = true;
+            else if( flags & VK_QUEUE_TRANSFER_BIT )
+                hasTransferFamily = true;
+        }
+    }
+
+    if( hasGraphicsFamily == false )
+        return -1;
+
+    // Needs timeline semaphores and, with a window, swapchains.
+    bool timelineSemaphoreExtension = false;
+    bool swapchainExtension = false;
+    {
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties( device, nullptr, &extensionCount, nullptr );
+
+        VkExtensionProperties* pExtensions = new VkExtensionProperties[extensionCount];
+        vkEnumerateDeviceExtensionProperties( device, nullptr, &extensionCount, pExtensions );
+
+        for( uint32_t i=0; i<extensionCount; i++ )
+        {
+            if( strcmp( pExtensions[i].extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME ) == 0 )
+                timelineSemaphoreExtension = true;
+            if( strcmp( pExtensions[i].extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME ) == 0 )
+                swapchainExtension = true;
+        }
+        delete[] pExtensions;
+    }
+
+    bool coreTimelineSemaphores = m_InstanceAPIVersion >= VK_API_VERSION_1_2 && properties.apiVersion >= VK_API_VERSION_1_2;
+    if( coreTimelineSemaphores == false && timelineSemaphoreExtension == false )
+        return -1;
+
+    if( m_Headless == false && swapchainExtension == false )
+        return -1;
+
+    // Needs room for one view's matrices behind a dynamic offset.
+    if( properties.limits.maxUniformBufferRange < sizeof( UniformBufferObject_Matrices ) ||
+        properties.limits.maxDescriptorSetUniformBuffersDynamic < 1 )
+    {
+        return -1;
+    }
+
+    // Device type outweighs memory size, which outweighs the optional features.
+    int64 typeScore = 0;
+    switch( properties.deviceType )
+    {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   typeScore = 3; break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: typeScore = 2; break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    typeScore = 1; break;
+    default:                                     typeScore = 0; break;
+    }
+
+    int64 score = typeScore * 1000000000000LL;
+    score += (int64)(SumDeviceLocalMemory( device ) / (1024*1024)) * 1000;
+
+    if( features.multiDrawIndirect )
+        score += 100;
+    if( hasTransferFamily )
+        score += 50;
+    if( hasComputeFamily )
+        score += 50;
+    if( features.pipelineStatisticsQuery )
+        score += 10;
+
+    return score;
+}
+
+bool VulkanInterface::MatchesPreferredDevice(VkPhysicalDevice device, const char* nameOrUUID)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties( device, &properties );
+
+    if( strstr( properties.deviceName, nameOrUUID ) != nullptr )
+        return true;
+
+    // Normalize to 32 lower case hex digits, anything else isn't a UUID.
+    char uuid[VK_UUID_SIZE*2 + 1];
+    uint32 digitCount = 0;
+    for( const char* p = nameOrUUID; *p; p++ )
+    {
+        if( *p == '-' )
+            continue;
+
+        if( isxdigit( (unsigned char)*p ) == false || digitCount == VK_UUID_SIZE*2 )
+            return false;
+
+        uuid[digitCount++] = (char)tolower( (unsigned char)*p );
+    }
+    uuid[digitCount] = '\0';
+
+    if( digitCount != VK_UUID_SIZE*2 )
+        return false;
+
+    // Device UUIDs come from VkPhysicalDeviceIDProperties, which needs 1.1 or VK_KHR_get_physical_device_properties2.
+    if( properties.apiVersion < VK_API_VERSION_1_1 )
+        return false;
+
+    const char* name = m_InstanceAPIVersion >= VK_API_VERSION_1_1 ? "vkGetPhysicalDeviceProperties2" : "vkGetPhysicalDeviceProperties2KHR";
+    PFN_vkGetPhysicalDeviceProperties2 pfnGetPhysicalDeviceProperties2 = (PFN_vkGetPhysicalDeviceProperties2)vkGetInstanceProcAddr( m_VulkanInstance, name );
+    if( pfnGetPhysicalDeviceProperties2 == nullptr )
+        return false;
+
+    VkPhysicalDeviceIDProperties idProperties = {};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    idProperties.pNext = nullptr;
+
+    VkPhysicalDeviceProperties2 properties2 = {};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &idProperties;
+
+    pfnGetPhysicalDeviceProperties2( device, &properties2 );
+
+    char deviceUUID[VK_UUID_SIZE*2 + 1];
+    for( uint32 i=0; i<VK_UUID_SIZE; i++ )
+    {
+        snprintf( &deviceUUID[i*2], 3, "%02x", idProperties.deviceUUID[i] );
+    }
+
+    return strcmp( uuid, deviceUUID ) == 0;
 }
 
 int VulkanInterface::ChooseGraphicsQueueFamily(int queueFamilyCount, VkQueueFamilyProperties* queueFamilyProperties)
 {
-    // Default to the first queue family for now.
+    // The first family with graphics, ScoreDevice made sure there is one.
+    for( int i=0; i<queueFamilyCount; i++ )
+    {
+        if( (queueFamilyProperties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && queueFamilyProperties[i].queueCount > 0 )
+            return i;
+    }
+
     return 0;
 }
 
+int VulkanInterface::ChooseTransferQueueFamily(int queueFamilyCount, VkQueueFamilyProperties* queueFamilyProperties, int graphicsQueueFamily)
+{
+    // Prefer a transfer only family, those map to the DMA engines.
+    for( int i=0; i<queueFamilyCount; i++ )
+    {
+        VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+        if( (flags & VK_QUEUE_TRANSFER_BIT) && (flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0 && queueFamilyProperties[i].queueCount > 0 )
+            return i;
+    }
+
+    // Then any other family that isn't graphics, compute queues support transfers too.
+    for( int i=0; i<queueFamilyCount; i++ )
+    {
+        VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+        if( (flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) && (flags & VK_QUEUE_GRAPHICS_BIT) == 0 && queueFamilyProperties[i].queueCount > 0 )
+            return i;
+    }
+
+    // Otherwise upload on the graphics queue.
+    return graphicsQueueFamily;
+}
+
+int VulkanInterface::ChooseComputeQueueFamily(int queueFamilyCount, VkQueueFamilyProperties* queueFamilyProperties, int graphicsQueueFamily)
+{
+    // Async compute needs a compute family without graphics.
+    for( int i=0; i<queueFamilyCount; i++ )
+    {
+        VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+        if( (flags & VK_QUEUE_COMPUTE_BIT) && (flags & VK_QUEUE_GRAPHICS_BIT) == 0 && queueFamilyProperties[i].queueCount > 0 )
+            return i;
+    }
+
+    return graphicsQueueFamily;
+}
+
 int VulkanInterface::ChooseSurfaceFormat(int formatCount, VkSurfaceFormatKHR* surfaceFormats)
 {
     // Default to the first surface format for now.
     return 0;
 }
 
+VkPresentModeKHR VulkanInterface::ChoosePresentMode(int presentModeCount, VkPresentModeKHR* presentModes)
+{
+    // Use the requested mode if the surface supports it, FIFO is always available.
+    for( int i=0; i<presentModeCount; i++ )
+    {
+        if( presentModes[i] == m_RequestedPresentMode )
+            return m_RequestedPresentMode;
+    }
+
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+void VulkanInterface::SetViews(const RenderView* pViews, uint32 viewCount)
+{
+    assert( viewCount >= 1 && viewCount <= MAX_RENDER_VIEWS );
+
+    for( uint32 i=0; i<viewCount; i++ )
+    {
+        m_Views[i] = pViews[i];
+    }
+    m_ViewCount = viewCount;
+}
+
+void VulkanInterface::SetPresentMode(VkPresentModeKHR presentMode, uint32 imageCount)
+{
+    m_RequestedPresentMode = presentMode;
+    m_RequestedImageCount = imageCount;
+
+    // Picked up by the next Render() if the swapchain already exists.
+    if( m_Swapchain != VK_NULL_HANDLE )
+    {
+        m_SwapchainOutOfDate = true;
+    }
+}
+
 void VulkanInterface::CreateInterface()
 {
+    PROFILE_FUNCTION();
+
     VkResult result;
 
     // Create instance.
     {
+        // Ask for 1.2 if the loader supports it, vkEnumerateInstanceVersion doesn't exist in 1.0 loaders.
+        PFN_vkEnumerateInstanceVersion pfnEnumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr( nullptr, "vkEnumerateInstanceVersion" );
+        if( pfnEnumerateInstanceVersion )
+        {
+            uint32_t loaderVersion = VK_API_VERSION_1_0;
+            pfnEnumerateInstanceVersion( &loaderVersion );
+            m_InstanceAPIVersion = loaderVersion < VK_API_VERSION_1_2 ? loaderVersion : VK_API_VERSION_1_2;
+        }
+
         // Setup application info struct.
         VkApplicationInfo applicationInfo = {};       
         applicationInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -166,28 +680,73 @@ void VulkanInterface::CreateInterface()
         applicationInfo.applicationVersion = 1;
         applicationInfo.pEngineName = nullptr;
         applicationInfo.engineVersion = 1;
-        applicationInfo.apiVersion = VK_API_VERSION_1_0;
+        applicationInfo.apiVersion = m_InstanceAPIVersion;
+
+        // Validation is off unless asked for, it's only turned on if the layer is installed.
+        bool validationRequested = VULKAN_VALIDATION_DEFAULT != 0;
+        const char* validationSetting = getenv( "VULKAN_VALIDATION" );
+        if( validationSetting && validationSetting[0] )
+            validationRequested = atoi( validationSetting ) != 0;
 
-        // Setup extensions.
-        const int extensionCount = 3;
-        const char* extensionList[extensionCount] =
+        if( validationRequested )
         {
-            VK_EXT_DEBUG_REPORT_EXTENSION_NAME,
-            VK_KHR_SURFACE_EXTENSION_NAME,
-            VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
-        };
+            m_ValidationEnabled = IsInstanceLayerAvailable( VALIDATION_LAYER_NAME );
+            if( m_ValidationEnabled == false )
+                fprintf( stderr, "%s isn't installed, running without validation.\n", VALIDATION_LAYER_NAME );
+        }
+
+        // Debug utils carries the validation messages and object names, skip it when neither is wanted.
+        bool debugUtilsEnabled = false;
+        if( m_ValidationEnabled || VULKAN_OBJECT_NAMES )
+        {
+            debugUtilsEnabled = IsInstanceExtensionAvailable( nullptr, VK_EXT_DEBUG_UTILS_EXTENSION_NAME ) ||
+                                (m_ValidationEnabled && IsInstanceExtensionAvailable( VALIDATION_LAYER_NAME, VK_EXT_DEBUG_UTILS_EXTENSION_NAME ));
+        }
+
+        // Setup extensions, headless instances don't need the surface ones.
+        int extensionCount = 0;
+        const char* extensionList[4];
+
+        if( debugUtilsEnabled )
+            extensionList[extensionCount++] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+
+        if( m_Headless == false )
+        {
+            extensionList[extensionCount++] = VK_KHR_SURFACE_EXTENSION_NAME;
+#if _WIN32
+            extensionList[extensionCount++] = VK_KHR_WIN32_SURFACE_EXTENSION_NAME;
+#else
+            extensionList[extensionCount++] = VK_KHR_XCB_SURFACE_EXTENSION_NAME;
+#endif
+        }
+
+        // VK_KHR_timeline_semaphore depends on this on 1.0 instances.
+        if( m_InstanceAPIVersion < VK_API_VERSION_1_1 )
+            extensionList[extensionCount++] = VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME;
 
         // Setup validation layer.
-        const int layerCount = 1;
-        const char* layerList[layerCount] =
+        uint32_t layerCount = m_ValidationEnabled ? 1 : 0;
+        const char* layerList[1] =
         {
-            "VK_LAYER_KHRONOS_validation"
+            VALIDATION_LAYER_NAME
         };
 
+        // Warnings and errors only, chained to the instance info as well so instance creation and destruction are covered.
+        VkDebugUtilsMessengerCreateInfoEXT messengerCreateInfo = {};
+        messengerCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+        messengerCreateInfo.pNext = nullptr;
+        messengerCreateInfo.flags = 0;
+        messengerCreateInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+        messengerCreateInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+        messengerCreateInfo.pfnUserCallback = DebugUtilsCallback;
+        messengerCreateInfo.pUserData = nullptr;
+
+        bool messengerEnabled = m_ValidationEnabled && debugUtilsEnabled;
+
         // Setup instance creation info struct, using structs/lists setup above.
         VkInstanceCreateInfo instanceCreateInfo = {};
         instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-        instanceCreateInfo.pNext = nullptr;
+        instanceCreateInfo.pNext = messengerEnabled ? &messengerCreateInfo : nullptr;
         instanceCreateInfo.flags = 0;
         instanceCreateInfo.pApplicationInfo = &applicationInfo;
         instanceCreateInfo.enabledLayerCount = layerCount;
@@ -197,6 +756,18 @@ void VulkanInterface::CreateInterface()
 
         result = vkCreateInstance( &instanceCreateInfo, nullptr, &m_VulkanInstance );
         assert( result == VK_SUCCESS );
+
+        if( messengerEnabled )
+        {
+            PFN_vkCreateDebugUtilsMessengerEXT pfnCreateDebugUtilsMessenger = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr( m_VulkanInstance, "vkCreateDebugUtilsMessengerEXT" );
+            result = pfnCreateDebugUtilsMessenger( m_VulkanInstance, &messengerCreateInfo, nullptr, &m_DebugMessenger );
+            assert( result == VK_SUCCESS );
+        }
+
+#if VULKAN_OBJECT_NAMES
+        if( debugUtilsEnabled )
+            m_pfnSetDebugUtilsObjectName = (PFN_vkSetDebugUtilsObjectNameEXT)vkGetInstanceProcAddr( m_VulkanInstance, "vkSetDebugUtilsObjectNameEXT" );
+#endif
     }
 
     // Enumerate physical devices.
@@ -219,13 +790,68 @@ void VulkanInterface::CreateInterface()
         m_PhysicalDevice = devices[deviceIndex];
     }
 
-    // Get physical device properties and features, not used for anything yet.
+    // Get physical device properties and features.
+    bool coreTimelineSemaphores;
     {
-        VkPhysicalDeviceProperties deviceProperties;
-        vkGetPhysicalDeviceProperties( m_PhysicalDevice, &deviceProperties );
+        vkGetPhysicalDeviceProperties( m_PhysicalDevice, &m_DeviceProperties );
+        vkGetPhysicalDeviceFeatures( m_PhysicalDevice, &m_DeviceFeatures );
+        m_DeviceLocalMemorySize = SumDeviceLocalMemory( m_PhysicalDevice );
+
+        // Timeline semaphores are core if both the instance and the device are 1.2.
+        coreTimelineSemaphores = m_InstanceAPIVersion >= VK_API_VERSION_1_2 && m_DeviceProperties.apiVersion >= VK_API_VERSION_1_2;
 
-        VkPhysicalDeviceFeatures deviceFeatures;
-        vkGetPhysicalDeviceFeatures( m_PhysicalDevice, &deviceFeatures );
+        m_PipelineStatisticsQuerySupported = m_DeviceFeatures.pipelineStatisticsQuery == VK_TRUE;
+
+        m_MultiDrawIndirect = m_DeviceFeatures.multiDrawIndirect == VK_TRUE && m_DeviceProperties.limits.maxDrawIndirectCount > 1;
+        m_MaxDrawIndirectCount = m_MultiDrawIndirect ? m_DeviceProperties.limits.maxDrawIndirectCount : 1;
+
+        // Dynamic UBO offsets have to be aligned, the limit is a power of two.
+        uint32 alignment = (uint32)m_DeviceProperties.limits.minUniformBufferOffsetAlignment;
+        if( alignment == 0 )
+            alignment = 1;
+        m_UBOViewStride = (sizeof( UniformBufferObject_Matrices ) + alignment - 1) & ~(alignment - 1);
+    }
+
+    // Check which optional device extensions are available.
+    bool timelineSemaphoreExtension = false;
+    bool extendedDynamicState = false;
+    {
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties( m_PhysicalDevice, nullptr, &extensionCount, nullptr );
+
+        VkExtensionProperties* pExtensions = new VkExtensionProperties[extensionCount];
+        vkEnumerateDeviceExtensionProperties( m_PhysicalDevice, nullptr, &extensionCount, pExtensions );
+
+        for( uint32_t i=0; i<extensionCount; i++ )
+        {
+            if( strcmp( pExtensions[i].extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME ) == 0 )
+                timelineSemaphoreExtension = true;
+            if( strcmp( pExtensions[i].extensionName, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME ) == 0 )
+                extendedDynamicState = true;
+        }
+        delete[] pExtensions;
+
+        // The extension being listed doesn't mean the feature is, ask for it.
+        if( extendedDynamicState )
+        {
+            const char* name = m_InstanceAPIVersion >= VK_API_VERSION_1_1 ? "vkGetPhysicalDeviceFeatures2" : "vkGetPhysicalDeviceFeatures2KHR";
+            PFN_vkGetPhysicalDeviceFeatures2 pfnGetPhysicalDeviceFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2)vkGetInstanceProcAddr( m_VulkanInstance, name );
+
+            VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures = {};
+            extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+            extendedDynamicStateFeatures.pNext = nullptr;
+
+            VkPhysicalDeviceFeatures2 features2 = {};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features2.pNext = &extendedDynamicStateFeatures;
+
+            extendedDynamicState = false;
+            if( pfnGetPhysicalDeviceFeatures2 )
+            {
+                pfnGetPhysicalDeviceFeatures2( m_PhysicalDevice, &features2 );
+                extendedDynamicState = extendedDynamicStateFeatures.extendedDynamicState == VK_TRUE;
+            }
+        }
     }
 
     // Enumerate queue families.
@@ -242,48 +868,125 @@ void VulkanInterface::CreateInterface()
         // Get list.
         vkGetPhysicalDeviceQueueFamilyProperties( m_PhysicalDevice, &queueFamilyCount, queueFamilyProperties );
 
-        // Choose a queue family.
+        // Choose queue families.
         m_GraphicsQueueFamilyIndex = ChooseGraphicsQueueFamily( queueFamilyCount, queueFamilyProperties );
         //m_PresentQueueFamilyIndex = m_GraphicsQueueFamilyIndex;
+        m_TransferQueueFamilyIndex = ChooseTransferQueueFamily( queueFamilyCount, queueFamilyProperties, m_GraphicsQueueFamilyIndex );
+        m_ComputeQueueFamilyIndex = ChooseComputeQueueFamily( queueFamilyCount, queueFamilyProperties, m_GraphicsQueueFamilyIndex );
     }
 
     // Create logical device.
     {
-        float queuePriorities = 0.0f;
-        VkDeviceQueueCreateInfo queueInfo = {};
-        queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueInfo.pNext = nullptr;
-        queueInfo.flags = 0;
-        queueInfo.queueFamilyIndex = m_GraphicsQueueFamilyIndex;
-        queueInfo.queueCount = 1;
-        queueInfo.pQueuePriorities = &queuePriorities;
+        // One queue from each family in use, rendering gets the highest priority.
+        float graphicsQueuePriority = 1.0f;
+        float otherQueuePriority = 0.5f;
+
+        uint32_t families[3] = { m_GraphicsQueueFamilyIndex, m_TransferQueueFamilyIndex, m_ComputeQueueFamilyIndex };
+        VkDeviceQueueCreateInfo queueInfos[3] = {};
+        uint32_t queueInfoCount = 0;
+
+        for( uint32 i=0; i<3; i++ )
+        {
+            bool alreadyAdded = false;
+            for( uint32 j=0; j<queueInfoCount; j++ )
+            {
+                if( queueInfos[j].queueFamilyIndex == families[i] )
+                    alreadyAdded = true;
+            }
+
+            if( alreadyAdded )
+                continue;
+
+            VkDeviceQueueCreateInfo& queueInfo = queueInfos[queueInfoCount++];
+            queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queueInfo.pNext = nullptr;
+            queueInfo.flags = 0;
+            queueInfo.queueFamilyIndex = families[i];
+            queueInfo.queueCount = 1;
+            queueInfo.pQueuePriorities = i == 0 ? &graphicsQueuePriority : &otherQueuePriority;
+        }
     
-        const int deviceExtensionCount = 1;
-        const char* pDeviceExtensions[deviceExtensionCount] =
+        int deviceExtensionCount = 0;
+        const char* pDeviceExtensions[4];
+
+        if( m_Headless == false )
         {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-        };
+            pDeviceExtensions[deviceExtensionCount++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+        }
+
+        // Timeline semaphores are required, every driver with 1.2 or the extension supports the feature.
+        if( coreTimelineSemaphores == false )
+        {
+            assert( timelineSemaphoreExtension );
+            pDeviceExtensions[deviceExtensionCount++] = VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME;
+        }
+
+        // Lets views change the cull mode without another pipeline.
+        VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures = {};
+        extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+        extendedDynamicStateFeatures.pNext = nullptr;
+        extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+
+        if( extendedDynamicState )
+        {
+            pDeviceExtensions[deviceExtensionCount++] = VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME;
+        }
+
+        // Only optional features are turned on.
+        VkPhysicalDeviceFeatures enabledFeatures = {};
+        enabledFeatures.pipelineStatisticsQuery = m_PipelineStatisticsQuerySupported ? VK_TRUE : VK_FALSE;
+        enabledFeatures.multiDrawIndirect = m_MultiDrawIndirect ? VK_TRUE : VK_FALSE;
+        enabledFeatures.samplerAnisotropy = m_DeviceFeatures.samplerAnisotropy;
+
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        timelineFeatures.pNext = extendedDynamicState ? &extendedDynamicStateFeatures : nullptr;
+        timelineFeatures.timelineSemaphore = VK_TRUE;
     
         VkDeviceCreateInfo deviceCreateInfo = {};
         deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        deviceCreateInfo.pNext = nullptr;
+        deviceCreateInfo.pNext = &timelineFeatures;
         deviceCreateInfo.flags = 0;
-        deviceCreateInfo.queueCreateInfoCount = 1;
-        deviceCreateInfo.pQueueCreateInfos = &queueInfo;
+        deviceCreateInfo.queueCreateInfoCount = queueInfoCount;
+        deviceCreateInfo.pQueueCreateInfos = queueInfos;
         deviceCreateInfo.enabledLayerCount = 0;
         deviceCreateInfo.ppEnabledLayerNames = nullptr;
         deviceCreateInfo.enabledExtensionCount = deviceExtensionCount;
         deviceCreateInfo.ppEnabledExtensionNames = pDeviceExtensions;
-        deviceCreateInfo.pEnabledFeatures = nullptr;
+        deviceCreateInfo.pEnabledFeatures = &enabledFeatures;
        
         VkResult result = vkCreateDevice( m_PhysicalDevice, &deviceCreateInfo, nullptr, &m_Device );
         assert( result == VK_SUCCESS );
     }
 
-    // Get the Device Queue for selected family.
+    // Get the Device Queues for selected families.
     {
         uint32_t deviceQueueIndex = 0;
         vkGetDeviceQueue( m_Device, m_GraphicsQueueFamilyIndex, deviceQueueIndex, &m_Queue );
+        vkGetDeviceQueue( m_Device, m_TransferQueueFamilyIndex, deviceQueueIndex, &m_TransferDeviceQueue );
+        vkGetDeviceQueue( m_Device, m_ComputeQueueFamilyIndex, deviceQueueIndex, &m_ComputeDeviceQueue );
+    }
+
+    // Load timeline semaphore functions.
+    {
+        if( coreTimelineSemaphores )
+        {
+            m_pfnWaitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr( m_Device, "vkWaitSemaphores" );
+            m_pfnGetSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr( m_Device, "vkGetSemaphoreCounterValue" );
+        }
+        else
+        {
+            m_pfnWaitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr( m_Device, "vkWaitSemaphoresKHR" );
+            m_pfnGetSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr( m_Device, "vkGetSemaphoreCounterValueKHR" );
+        }
+
+        assert( m_pfnWaitSemaphores != nullptr && m_pfnGetSemaphoreCounterValue != nullptr );
+    }
+
+    // Load extended dynamic state functions.
+    if( extendedDynamicState )
+    {
+        m_pfnCmdSetCullMode = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr( m_Device, "vkCmdSetCullModeEXT" );
     }
 }
 
@@ -308,6 +1011,8 @@ void VulkanInterface::CreateSurface(const char* windowName, int width, int heigh
 
 void VulkanInterface::CreateSwapchain()
 {
+    PROFILE_FUNCTION();
+
     assert( m_Window != nullptr );
 
     VkResult result;
@@ -325,11 +1030,42 @@ void VulkanInterface::CreateSwapchain()
     vkGetPhysicalDeviceSurfaceFormatsKHR( m_PhysicalDevice, m_Surface, &formatCount, surfaceFormats );
 
     // Choose a surface format.
+    // The render pass is built for the first format, a recreated swapchain has to keep it.
     int surfaceFormatIndex = ChooseSurfaceFormat( formatCount, surfaceFormats );
+    assert( m_Swapchain == VK_NULL_HANDLE || m_SurfaceFormat == surfaceFormats[surfaceFormatIndex].format );
     m_SurfaceFormat = surfaceFormats[surfaceFormatIndex].format;
 
-    m_SurfaceWidth = surfaceCapabilities.currentExtent.width;
-    m_SurfaceHeight = surfaceCapabilities.currentExtent.height;
+    // Some platforms let the swapchain pick the size, keep the last one within the allowed range.
+    if( surfaceCapabilities.currentExtent.width != UINT32_MAX )
+    {
+        m_SurfaceWidth = surfaceCapabilities.currentExtent.width;
+        m_SurfaceHeight = surfaceCapabilities.currentExtent.height;
+    }
+    else
+    {
+        MyClamp( m_SurfaceWidth, surfaceCapabilities.minImageExtent.width, surfaceCapabilities.maxImageExtent.width );
+        MyClamp( m_SurfaceHeight, surfaceCapabilities.minImageExtent.height, surfaceCapabilities.maxImageExtent.height );
+    }
+
+    VkExtent2D extent = { m_SurfaceWidth, m_SurfaceHeight };
+    assert( extent.width > 0 && extent.height > 0 );
+
+    // Get list of present modes and choose one.
+    uint32_t presentModeCount = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR( m_PhysicalDevice, m_Surface, &presentModeCount, nullptr );
+    if( presentModeCount > 16 )
+        presentModeCount = 16;
+    VkPresentModeKHR presentModes[16];
+    vkGetPhysicalDeviceSurfacePresentModesKHR( m_PhysicalDevice, m_Surface, &presentModeCount, presentModes );
+
+    m_PresentMode = ChoosePresentMode( presentModeCount, presentModes );
+
+    // One more image than the minimum so the CPU isn't waiting on the presentation engine, unless a count was asked for.
+    uint32_t imageCount = m_RequestedImageCount != 0 ? m_RequestedImageCount : surfaceCapabilities.minImageCount + 1;
+    if( imageCount < surfaceCapabilities.minImageCount )
+        imageCount = surfaceCapabilities.minImageCount;
+    if( surfaceCapabilities.maxImageCount != 0 && imageCount > surfaceCapabilities.maxImageCount )
+        imageCount = surfaceCapabilities.maxImageCount;
 
     // Create the swapchain.
     VkSwapchainCreateInfoKHR swapchainCreateInfo = {};
@@ -337,10 +1073,10 @@ void VulkanInterface::CreateSwapchain()
     swapchainCreateInfo.pNext = nullptr;
     swapchainCreateInfo.flags = 0;
     swapchainCreateInfo.surface = m_Surface;
-    swapchainCreateInfo.minImageCount = m_SwapchainImageCount; // Triple buffer.
+    swapchainCreateInfo.minImageCount = imageCount;
     swapchainCreateInfo.imageFormat = surfaceFormats[surfaceFormatIndex].format; //VK_FORMAT_R8G8B8A8_UNORM;
     swapchainCreateInfo.imageColorSpace = surfaceFormats[surfaceFormatIndex].colorSpace; //VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
-    swapchainCreateInfo.imageExtent = surfaceCapabilities.currentExtent;
+    swapchainCreateInfo.imageExtent = extent;
     swapchainCreateInfo.imageArrayLayers = 1;
     swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
     swapchainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -348,23 +1084,51 @@ void VulkanInterface::CreateSwapchain()
     swapchainCreateInfo.pQueueFamilyIndices = nullptr;
     swapchainCreateInfo.preTransform = surfaceCapabilities.currentTransform; //VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR
     swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    swapchainCreateInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    swapchainCreateInfo.presentMode = m_PresentMode;
     swapchainCreateInfo.clipped = true;
-    swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+    swapchainCreateInfo.oldSwapchain = m_Swapchain; // Lets the driver reuse resources when recreating.
+
+    VkSwapchainKHR oldSwapchain = m_Swapchain;
 
     result = vkCreateSwapchainKHR( m_Device, &swapchainCreateInfo, nullptr, &m_Swapchain );
     assert( result == VK_SUCCESS );
 
-    // Get swapchain images.
-    VkImage images[MAX_SWAP_IMAGES];
+    // The old swapchain is retired by the create, none of its images are acquired so it can go now.
+    if( oldSwapchain != VK_NULL_HANDLE )
+    {
+        vkDestroySwapchainKHR( m_Device, oldSwapchain, nullptr );
+    }
+
+    // Get swapchain images, the driver can return more than minImageCount.
+    assert( m_SwapchainStuff == nullptr );
+
+    result = vkGetSwapchainImagesKHR( m_Device, m_Swapchain, &m_SwapchainImageCount, nullptr );
+    assert( result == VK_SUCCESS );
+
+    VkImage* images = new VkImage[m_SwapchainImageCount];
     result = vkGetSwapchainImagesKHR( m_Device, m_Swapchain, &m_SwapchainImageCount, images );
     assert( result == VK_SUCCESS );
 
+    m_SwapchainStuff = new SwapchainStuff[m_SwapchainImageCount];
     for( uint32 i=0; i<m_SwapchainImageCount; i++ )
     {
         m_SwapchainStuff[i].m_Images = images[i];
     }
 
+    delete[] images;
+
+    // Create the semaphores presents wait on.
+    for( uint32 i=0; i<m_SwapchainImageCount; i++ )
+    {
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = nullptr;
+        semaphoreInfo.flags = 0;
+
+        result = vkCreateSemaphore( m_Device, &semaphoreInfo, nullptr, &m_SwapchainStuff[i].m_DrawCompleteSemaphore );
+        assert( result == VK_SUCCESS );
+    }
+
     // Create image views.
     for( uint32 i=0; i<m_SwapchainImageCount; i++ )
     {
@@ -385,9 +1149,88 @@ void VulkanInterface::CreateSwapchain()
         imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
         imageViewCreateInfo.subresourceRange.layerCount = 1;
 
-        result = vkCreateImageView( m_Device, &imageViewCreateInfo, nullptr, &m_SwapchainStuff[i].m_ImageViews );
-        assert( result == VK_SUCCESS );
-    }
+        result = vkCreateImageView( m_Device, &imageViewCreateInfo, nullptr, &m_SwapchainStuff[i].m_ImageViews );
+        assert( result == VK_SUCCESS );
+    }
+}
+
+void VulkanInterface::CreateOffscreenTarget(uint32 width, uint32 height)
+{
+    assert( m_SwapchainStuff == nullptr );
+
+    VkResult result;
+
+    m_SurfaceWidth = width;
+    m_SurfaceHeight = height;
+    m_SurfaceFormat = VK_FORMAT_B8G8R8A8_UNORM;
+
+    m_SwapchainImageCount = 1;
+    m_SwapchainStuff = new SwapchainStuff[1];
+
+    // Create the image, it can be copied out for inspection.
+    VkImageCreateInfo imageCreateInfo = {};
+    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCreateInfo.pNext = nullptr;
+    imageCreateInfo.flags = 0;
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.format = m_SurfaceFormat;
+    imageCreateInfo.extent.width = width;
+    imageCreateInfo.extent.height = height;
+    imageCreateInfo.extent.depth = 1;
+    imageCreateInfo.mipLevels = 1;
+    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageCreateInfo.queueFamilyIndexCount = 0;
+    imageCreateInfo.pQueueFamilyIndices = nullptr;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    result = vkCreateImage( m_Device, &imageCreateInfo, nullptr, &m_SwapchainStuff[0].m_Images );
+    assert( result == VK_SUCCESS );
+    SetObjectName( VK_OBJECT_TYPE_IMAGE, (uint64)m_SwapchainStuff[0].m_Images, "Offscreen Target" );
+
+    // Allocate memory for the image.
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements( m_Device, m_SwapchainStuff[0].m_Images, &memoryRequirements );
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = nullptr;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = FindMemoryType( memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+
+    result = vkAllocateMemory( m_Device, &allocInfo, nullptr, &m_OffscreenMemory );
+    assert( result == VK_SUCCESS );
+    TrackAllocation( memoryRequirements.size );
+
+    result = vkBindImageMemory( m_Device, m_SwapchainStuff[0].m_Images, m_OffscreenMemory, 0 );
+    assert( result == VK_SUCCESS );
+
+    // Create the image view.
+    VkImageViewCreateInfo imageViewCreateInfo = {};
+    imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewCreateInfo.pNext = nullptr;
+    imageViewCreateInfo.flags = 0;
+    imageViewCreateInfo.image = m_SwapchainStuff[0].m_Images;
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = m_SurfaceFormat;
+    imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_R;
+    imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_G;
+    imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_B;
+    imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_A;
+    imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+    imageViewCreateInfo.subresourceRange.levelCount = 1;
+    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+    result = vkCreateImageView( m_Device, &imageViewCreateInfo, nullptr, &m_SwapchainStuff[0].m_ImageViews );
+    assert( result == VK_SUCCESS );
+
+    // Nothing is presented, so there's no draw complete semaphore to wait on.
+    m_SwapchainStuff[0].m_DrawCompleteSemaphore = VK_NULL_HANDLE;
 }
 
 void VulkanInterface::CreateCommandBufferPool()
@@ -395,40 +1238,67 @@ void VulkanInterface::CreateCommandBufferPool()
     VkCommandPoolCreateInfo commandPoolCreateInfo = {};
     commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     commandPoolCreateInfo.pNext = nullptr;
-    commandPoolCreateInfo.flags = 0;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // Frame command buffers are re-recorded every frame.
     commandPoolCreateInfo.queueFamilyIndex = m_GraphicsQueueFamilyIndex;
     
     VkResult result = vkCreateCommandPool( m_Device, &commandPoolCreateInfo, nullptr, &m_CommandBufferPool );    
     assert( result == VK_SUCCESS );
-
-    for( uint32 i=0; i<m_SwapchainImageCount; i++ )
-    {
-        m_SwapchainStuff[i].m_CommandBuffers = CreateCommandBuffer();
-    }
 }
 
 void VulkanInterface::CreateDescriptorPool()
 {
     VkDescriptorPoolSize poolSize = {};
-    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = m_SwapchainImageCount;
+    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSize.descriptorCount = m_FramesInFlight;
 
     VkDescriptorPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.pNext = nullptr;
     poolInfo.flags = 0;
-    poolInfo.maxSets = m_SwapchainImageCount;
+    poolInfo.maxSets = m_FramesInFlight;
     poolInfo.poolSizeCount = 1;
     poolInfo.pPoolSizes = &poolSize;
 
     VkResult result = vkCreateDescriptorPool( m_Device, &poolInfo, nullptr, &m_DescriptorPool );
     assert( result == VK_SUCCESS );
+
+    // Texture sets come and go with their textures, so this pool frees them individually.
+    VkDescriptorPoolSize texturePoolSize = {};
+    texturePoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    texturePoolSize.descriptorCount = MAX_TEXTURES;
+
+    VkDescriptorPoolCreateInfo texturePoolInfo = {};
+    texturePoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    texturePoolInfo.pNext = nullptr;
+    texturePoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    texturePoolInfo.maxSets = MAX_TEXTURES;
+    texturePoolInfo.poolSizeCount = 1;
+    texturePoolInfo.pPoolSizes = &texturePoolSize;
+
+    result = vkCreateDescriptorPool( m_Device, &texturePoolInfo, nullptr, &m_TextureDescriptorPool );
+    assert( result == VK_SUCCESS );
 }
 
-void VulkanInterface::CreateDescriptorSets()
+void VulkanInterface::SetFramesInFlight(uint32 count)
 {
-    VkDescriptorSetLayout layouts[3];
-    for( uint32 i=0; i<m_SwapchainImageCount; i++ )
+    // Frame resources are created once with the device.
+    assert( m_Device == VK_NULL_HANDLE );
+    assert( count >= 1 );
+
+    m_FramesInFlight = count;
+}
+
+void VulkanInterface::CreateFrameResources()
+{
+    VkResult result;
+
+    m_FrameStuff = new FrameStuff[m_FramesInFlight];
+    m_CurrentFrameIndex = 0;
+
+    // Allocate the descriptor sets, all frames use the same layout.
+    VkDescriptorSetLayout* layouts = new VkDescriptorSetLayout[m_FramesInFlight];
+    VkDescriptorSet* descriptorSets = new VkDescriptorSet[m_FramesInFlight];
+    for( uint32 i=0; i<m_FramesInFlight; i++ )
     {
         layouts[i] = m_UBODescriptorSetLayout;
     }
@@ -437,62 +1307,96 @@ void VulkanInterface::CreateDescriptorSets()
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.pNext = nullptr;
     allocInfo.descriptorPool = m_DescriptorPool;
-    allocInfo.descriptorSetCount = m_SwapchainImageCount;
+    allocInfo.descriptorSetCount = m_FramesInFlight;
     allocInfo.pSetLayouts = layouts;
 
-    VkDescriptorSet descriptorSets[MAX_SWAP_IMAGES];
-    VkResult result = vkAllocateDescriptorSets( m_Device, &allocInfo, descriptorSets );
+    result = vkAllocateDescriptorSets( m_Device, &allocInfo, descriptorSets );
     assert( result == VK_SUCCESS );
 
-    for( uint32 i=0; i<m_SwapchainImageCount; i++ )
-    {
-        m_SwapchainStuff[i].m_DescriptorSets = descriptorSets[i];
-    }
-
-    for( uint32 i=0; i<m_SwapchainImageCount; i++ )
+    for( uint32 i=0; i<m_FramesInFlight; i++ )
     {
+        FrameStuff* pFrame = &m_FrameStuff[i];
+
+        pFrame->m_CommandBuffer = CreateCommandBuffer();
+        pFrame->m_DescriptorSet = descriptorSets[i];
+
+        // Create the UBO for matrices, one block per view.
+        pFrame->m_UBO_Matrices = new VulkanBuffer();
+        pFrame->m_UBO_Matrices->Create( this, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, nullptr, m_UBOViewStride * MAX_RENDER_VIEWS );
+
+        // Create the indirect draw buffer, views write their draws one after the other.
+        pFrame->m_IndirectCommands = new VulkanBuffer();
+        pFrame->m_IndirectCommands->Create( this, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, nullptr, sizeof( VkDrawIndexedIndirectCommand ) * MAX_DRAWS_PER_FRAME * MAX_RENDER_VIEWS );
+
+#if VULKAN_OBJECT_NAMES
+        char name[64];
+        snprintf( name, sizeof( name ), "Frame %u Commands", i );
+        SetObjectName( VK_OBJECT_TYPE_COMMAND_BUFFER, (uint64)pFrame->m_CommandBuffer, name );
+        snprintf( name, sizeof( name ), "Frame %u UBO", i );
+        SetObjectName( VK_OBJECT_TYPE_BUFFER, (uint64)pFrame->m_UBO_Matrices->GetBuffer(), name );
+        snprintf( name, sizeof( name ), "Frame %u Indirect Draws", i );
+        SetObjectName( VK_OBJECT_TYPE_BUFFER, (uint64)pFrame->m_IndirectCommands->GetBuffer(), name );
+#endif
+
+        // Point the descriptor set at the first view's block, the dynamic offset picks the view.
         VkDescriptorBufferInfo bufferInfo = {};
-        bufferInfo.buffer = m_SwapchainStuff[i].m_UBO_Matrices->GetBuffer();
+        bufferInfo.buffer = pFrame->m_UBO_Matrices->GetBuffer();
         bufferInfo.offset = 0;
         bufferInfo.range = sizeof( UniformBufferObject_Matrices );
 
         VkWriteDescriptorSet descriptorWrite = {};
         descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrite.pNext = nullptr;
-        descriptorWrite.dstSet = m_SwapchainStuff[i].m_DescriptorSets;
+        descriptorWrite.dstSet = pFrame->m_DescriptorSet;
         descriptorWrite.dstBinding = 0;
         descriptorWrite.dstArrayElement = 0;
         descriptorWrite.descriptorCount = 1;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         descriptorWrite.pImageInfo = nullptr;
         descriptorWrite.pBufferInfo = &bufferInfo;
         descriptorWrite.pTexelBufferView = nullptr;
 
         vkUpdateDescriptorSets( m_Device, 1, &descriptorWrite, 0, nullptr );
+
+        // Create the semaphore the acquire signals.
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = nullptr;
+        semaphoreInfo.flags = 0;
+
+        result = vkCreateSemaphore( m_Device, &semaphoreInfo, nullptr, &pFrame->m_ImageAcquiredSemaphore );
+        assert( result == VK_SUCCESS );
     }
+
+    delete[] layouts;
+    delete[] descriptorSets;
 }
 
-void VulkanInterface::CreateSemaphores()
+void VulkanInterface::DestroyFrameResources()
 {
-    VkResult result;
+    // Command buffers and descriptor sets go with their pools.
+    for( uint32 i=0; i<m_FramesInFlight; i++ )
+    {
+        FrameStuff* pFrame = &m_FrameStuff[i];
 
-    VkSemaphoreCreateInfo semaphoreInfo = {};
-    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    semaphoreInfo.pNext = nullptr;
-    semaphoreInfo.flags = 0;
+        pFrame->m_UBO_Matrices->Destroy();
+        delete pFrame->m_UBO_Matrices;
 
-    result = vkCreateSemaphore( m_Device, &semaphoreInfo, nullptr, &m_ImageAcquiredSemaphore );
-    assert( result == VK_SUCCESS );
+        pFrame->m_IndirectCommands->Destroy();
+        delete pFrame->m_IndirectCommands;
 
-    result = vkCreateSemaphore( m_Device, &semaphoreInfo, nullptr, &m_DrawCompleteSemaphore );
-    assert( result == VK_SUCCESS );
+        vkDestroySemaphore( m_Device, pFrame->m_ImageAcquiredSemaphore, nullptr );
+    }
+
+    delete[] m_FrameStuff;
+    m_FrameStuff = nullptr;
 }
 
 VkDescriptorSetLayout VulkanInterface::CreateUBODescriptorSetLayout()
 {
     VkDescriptorSetLayoutBinding layoutBinding = {};
     layoutBinding.binding = 0;
-    layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     layoutBinding.descriptorCount = 1;
     layoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
     layoutBinding.pImmutableSamplers = nullptr;
@@ -511,6 +1415,29 @@ VkDescriptorSetLayout VulkanInterface::CreateUBODescriptorSetLayout()
     return layout;
 }
 
+VkDescriptorSetLayout VulkanInterface::CreateTextureDescriptorSetLayout()
+{
+    VkDescriptorSetLayoutBinding layoutBinding = {};
+    layoutBinding.binding = 0;
+    layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    layoutBinding.descriptorCount = 1;
+    layoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    layoutBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+    layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutCreateInfo.pNext = nullptr;
+    layoutCreateInfo.flags = 0;
+    layoutCreateInfo.bindingCount = 1;
+    layoutCreateInfo.pBindings = &layoutBinding;
+
+    VkDescriptorSetLayout layout;
+    VkResult result = vkCreateDescriptorSetLayout( m_Device, &layoutCreateInfo, nullptr, &layout );
+    assert( result == VK_SUCCESS );
+
+    return layout;
+}
+
 VkCommandBuffer VulkanInterface::CreateCommandBuffer()
 {
     VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
@@ -529,8 +1456,89 @@ VkCommandBuffer VulkanInterface::CreateCommandBuffer()
     return commandBuffer;
 }
 
-void VulkanInterface::CreateRenderPassAndPipeline(VkDescriptorSetLayout uboLayout)
+void VulkanInterface::CreateFramebuffers()
+{
+    for( uint32 i=0; i<m_SwapchainImageCount; i++ )
+    {
+        VkFramebufferCreateInfo framebufferCreateInfo = {};
+        framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferCreateInfo.pNext = nullptr;
+        framebufferCreateInfo.flags = 0;
+        framebufferCreateInfo.renderPass = m_RenderPass;
+        framebufferCreateInfo.attachmentCount = 1;
+        framebufferCreateInfo.pAttachments = &m_SwapchainStuff[i].m_ImageViews;
+        framebufferCreateInfo.width = m_SurfaceWidth;
+        framebufferCreateInfo.height = m_SurfaceHeight;
+        framebufferCreateInfo.layers = 1;
+
+        VkResult result = vkCreateFramebuffer( m_Device, &framebufferCreateInfo, nullptr, &m_SwapchainStuff[i].m_Framebuffers );
+        assert( result == VK_SUCCESS );
+    }
+}
+
+void VulkanInterface::DestroySwapchainImageResources()
+{
+    for( uint32 i=0; i<m_SwapchainImageCount; i++ )
+    {
+        vkDestroyFramebuffer( m_Device, m_SwapchainStuff[i].m_Framebuffers, nullptr );
+        vkDestroyImageView( m_Device, m_SwapchainStuff[i].m_ImageViews, nullptr );
+        vkDestroySemaphore( m_Device, m_SwapchainStuff[i].m_DrawCompleteSemaphore, nullptr );
+    }
+
+    // The offscreen image is ours, swapchain images belong to the swapchain.
+    if( m_Headless )
+    {
+        VkMemoryRequirements memoryRequirements;
+        vkGetImageMemoryRequirements( m_Device, m_SwapchainStuff[0].m_Images, &memoryRequirements );
+        TrackFree( memoryRequirements.size );
+
+        vkDestroyImage( m_Device, m_SwapchainStuff[0].m_Images, nullptr );
+        vkFreeMemory( m_Device, m_OffscreenMemory, nullptr );
+        m_OffscreenMemory = VK_NULL_HANDLE;
+    }
+
+    delete[] m_SwapchainStuff;
+    m_SwapchainStuff = nullptr;
+    m_SwapchainImageCount = 0;
+}
+
+bool VulkanInterface::RecreateSwapchain()
+{
+    PROFILE_FUNCTION();
+
+    m_Window->m_Resized = false;
+
+    // Nothing to create images for while minimized, try again once the window is restored.
+    VkSurfaceCapabilitiesKHR surfaceCapabilities;
+    VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR( m_PhysicalDevice, m_Surface, &surfaceCapabilities );
+    assert( result == VK_SUCCESS );
+
+    if( surfaceCapabilities.currentExtent.width == 0 || surfaceCapabilities.currentExtent.height == 0 )
+    {
+        m_SwapchainOutOfDate = true;
+        return false;
+    }
+
+    // Frames and presents still using the old framebuffers and semaphores are all on the graphics queue,
+    // uploads on the transfer queue keep going.
+    VkResult waitResult = vkQueueWaitIdle( m_Queue );
+    assert( waitResult == VK_SUCCESS );
+
+    // The render pass and pipeline don't depend on the size or image count, only the per image resources are rebuilt.
+    // Command buffers are recorded every frame, so there's nothing to re-record.
+    DestroySwapchainImageResources();
+    CreateSwapchain();
+    CreateFramebuffers();
+
+    m_SwapchainOutOfDate = false;
+
+    return true;
+}
+
+void VulkanInterface::CreateRenderPassAndPipeline(VkDescriptorSetLayout uboLayout, VkDescriptorSetLayout textureLayout)
 {
+    PROFILE_FUNCTION();
+
     VkResult result;
 
     VkAttachmentReference colorAttachmentReference = {};
@@ -549,7 +1557,7 @@ void VulkanInterface::CreateRenderPassAndPipeline(VkDescriptorSetLayout uboLayou
         colorAttachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachmentDescription.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachmentDescription.finalLayout = m_Headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
     }
 
     //VkAttachmentReference depthAttachmentReference = {};
@@ -609,211 +1617,247 @@ void VulkanInterface::CreateRenderPassAndPipeline(VkDescriptorSetLayout uboLayou
         assert( result == VK_SUCCESS );
     }
 
-    // Create framebuffers.
-    for( uint32 i=0; i<m_SwapchainImageCount; i++ )
+    // Create the shader, kept until Destroy so CreatePipeline can build more pipelines.
+    // The vertex shader variant reads exactly the layout's attributes, see Data/Shaders/mesh.vert.
+    // Layouts with UVs sample the mesh's texture, the others only use vertex colors.
     {
-        VkFramebufferCreateInfo framebufferCreateInfo = {};
-        framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferCreateInfo.pNext = nullptr;
-        framebufferCreateInfo.flags = 0;
-        framebufferCreateInfo.renderPass = m_RenderPass;
-        framebufferCreateInfo.attachmentCount = 1;
-        framebufferCreateInfo.pAttachments = &m_SwapchainStuff[i].m_ImageViews;
-        framebufferCreateInfo.width = m_SurfaceWidth;
-        framebufferCreateInfo.height = m_SurfaceHeight;
-        framebufferCreateInfo.layers = 1;
+        VertexAttributeFormat normalFormat = m_VertexLayout.GetFormat( VertexAttribute_Normal );
+        bool hasColor = m_VertexLayout.GetFormat( VertexAttribute_Color ) != VertexAttributeFormat_None;
+        bool hasUV = m_VertexLayout.GetFormat( VertexAttribute_UV ) != VertexAttributeFormat_None;
 
-        result = vkCreateFramebuffer( m_Device, &framebufferCreateInfo, nullptr, &m_SwapchainStuff[i].m_Framebuffers );
-        assert( result == VK_SUCCESS );
-    }
+        const char* normalSuffix = "";
+        if( normalFormat == VertexAttributeFormat_OctSNorm16x2 )
+            normalSuffix = "_octnormal";
+        else if( normalFormat != VertexAttributeFormat_None )
+            normalSuffix = "_normal";
+
+        char vertexShaderFilename[64];
+        snprintf( vertexShaderFilename, sizeof( vertexShaderFilename ), "Data/Shaders/spv.mesh%s%s%s.vs", hasColor ? "_color" : "", normalSuffix, hasUV ? "_uv" : "" );
 
-    // Create a temporary shader.
-    {
         m_TempShader = new VulkanShader();
-        m_TempShader->Create( m_Device, "Data/Shaders/spv.test.vs", "Data/Shaders/spv.test.fs" );
-    }
-
-    // Create a pipeline.
-    {
-        VkPipelineShaderStageCreateInfo shaderStageCreateInfoArray[2] = {};
-
-        shaderStageCreateInfoArray[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        shaderStageCreateInfoArray[0].pNext = nullptr;
-        shaderStageCreateInfoArray[0].flags = 0;
-        shaderStageCreateInfoArray[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-        shaderStageCreateInfoArray[0].module = m_TempShader->GetVertexShader();
-        shaderStageCreateInfoArray[0].pName = "main";
-        shaderStageCreateInfoArray[0].pSpecializationInfo = nullptr;
-
-        shaderStageCreateInfoArray[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        shaderStageCreateInfoArray[1].pNext = nullptr;
-        shaderStageCreateInfoArray[1].flags = 0;
-        shaderStageCreateInfoArray[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        shaderStageCreateInfoArray[1].module = m_TempShader->GetFragmentShader();
-        shaderStageCreateInfoArray[1].pName = "main";
-        shaderStageCreateInfoArray[1].pSpecializationInfo = nullptr;
-
-        VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {};
-        vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputStateCreateInfo.pNext = nullptr;
-        vertexInputStateCreateInfo.flags = 0;;
-        //vertexInputStateCreateInfo.vertexBindingDescriptionCount = 0;
-        //vertexInputStateCreateInfo.pVertexBindingDescriptions = nullptr;
-        //vertexInputStateCreateInfo.vertexAttributeDescriptionCount = 0;
-        //vertexInputStateCreateInfo.pVertexAttributeDescriptions = nullptr;
-        vertexInputStateCreateInfo.vertexBindingDescriptionCount = VertexFormat::GetBindingDescriptionCount();
-        vertexInputStateCreateInfo.pVertexBindingDescriptions = VertexFormat::getBindingDescription();
-        vertexInputStateCreateInfo.vertexAttributeDescriptionCount = VertexFormat::GetAttributeDescriptionCount();
-        vertexInputStateCreateInfo.pVertexAttributeDescriptions = VertexFormat::getAttributeDescriptions();
-
-        VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo = {};
-        inputAssemblyStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssemblyStateCreateInfo.pNext = nullptr;
-        inputAssemblyStateCreateInfo.flags = 0;
-        inputAssemblyStateCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        inputAssemblyStateCreateInfo.primitiveRestartEnable = false;
+        m_TempShader->Create( m_Device, vertexShaderFilename, hasUV ? "Data/Shaders/spv.textured.fs" : "Data/Shaders/spv.test.fs" );
+    }
 
-        VkViewport viewport = {};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width  = (float)m_SurfaceWidth;
-        viewport.height = (float)m_SurfaceHeight;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
+    // Create the pipeline layout, shared by every pipeline CreatePipeline makes.
+    // Set 0 is the frame's matrices, set 1 the mesh's texture, the push constants undo the mesh's position quantization.
+    {
+        VkDescriptorSetLayout setLayouts[] = { uboLayout, textureLayout };
 
-        VkRect2D scissorRect = {};
-        scissorRect.offset.x = 0;
-        scissorRect.offset.y = 0;
-        scissorRect.extent.width = m_SurfaceWidth;
-        scissorRect.extent.height = m_SurfaceHeight;
-
-        VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
-        viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewportStateCreateInfo.pNext = nullptr;
-        viewportStateCreateInfo.flags = 0;
-        viewportStateCreateInfo.viewportCount = 1;
-        viewportStateCreateInfo.pViewports = &viewport;
-        viewportStateCreateInfo.scissorCount = 1;
-        viewportStateCreateInfo.pScissors = &scissorRect;
-
-        VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo = {};
-        rasterizationStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizationStateCreateInfo.pNext = nullptr;
-        rasterizationStateCreateInfo.flags = 0;
-        rasterizationStateCreateInfo.depthClampEnable = false;
-        rasterizationStateCreateInfo.rasterizerDiscardEnable = false;
-        rasterizationStateCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-        rasterizationStateCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizationStateCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
-        rasterizationStateCreateInfo.depthBiasEnable = false;
-        rasterizationStateCreateInfo.depthBiasConstantFactor = 0.0f;
-        rasterizationStateCreateInfo.depthBiasClamp = 0.0f;
-        rasterizationStateCreateInfo.depthBiasSlopeFactor = 0.0f;
-        rasterizationStateCreateInfo.lineWidth = 1.0f;
-
-        VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo = {};
-        multisampleStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisampleStateCreateInfo.pNext = nullptr;
-        multisampleStateCreateInfo.flags = 0;
-        multisampleStateCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-        multisampleStateCreateInfo.sampleShadingEnable = false;
-        multisampleStateCreateInfo.minSampleShading = 1.0f;
-        multisampleStateCreateInfo.pSampleMask = nullptr;
-        multisampleStateCreateInfo.alphaToCoverageEnable = false;
-        multisampleStateCreateInfo.alphaToOneEnable = false;
-
-        VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo = {};
-        depthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-        depthStencilStateCreateInfo.pNext = nullptr;
-        depthStencilStateCreateInfo.flags = 0;
-        depthStencilStateCreateInfo.depthTestEnable = false;
-        depthStencilStateCreateInfo.depthWriteEnable = false;
-        depthStencilStateCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
-        depthStencilStateCreateInfo.depthBoundsTestEnable = false;
-        depthStencilStateCreateInfo.stencilTestEnable = false;
-        depthStencilStateCreateInfo.front.failOp = VK_STENCIL_OP_KEEP;
-        depthStencilStateCreateInfo.front.passOp = VK_STENCIL_OP_KEEP;
-        depthStencilStateCreateInfo.front.compareOp = VK_COMPARE_OP_ALWAYS;
-        depthStencilStateCreateInfo.back.failOp = VK_STENCIL_OP_KEEP;
-        depthStencilStateCreateInfo.back.passOp = VK_STENCIL_OP_KEEP;
-        depthStencilStateCreateInfo.back.compareOp = VK_COMPARE_OP_ALWAYS;
-        depthStencilStateCreateInfo.minDepthBounds = 0.0f;
-        depthStencilStateCreateInfo.maxDepthBounds = 1.0f;
-
-        VkPipelineColorBlendAttachmentState colorBlendAttachmentState = {};
-        colorBlendAttachmentState.blendEnable = false;
-        colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-        colorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-        colorBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
-        colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-        colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-        colorBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
-        colorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-
-        VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo = {};
-        colorBlendStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        colorBlendStateCreateInfo.pNext = nullptr;
-        colorBlendStateCreateInfo.flags = 0;
-        colorBlendStateCreateInfo.logicOpEnable = false;
-        colorBlendStateCreateInfo.logicOp = VK_LOGIC_OP_COPY;
-        colorBlendStateCreateInfo.attachmentCount = 1;
-        colorBlendStateCreateInfo.pAttachments = &colorBlendAttachmentState;
-        colorBlendStateCreateInfo.blendConstants[0] = 0.0f;
-        colorBlendStateCreateInfo.blendConstants[1] = 0.0f;
-        colorBlendStateCreateInfo.blendConstants[2] = 0.0f;
-        colorBlendStateCreateInfo.blendConstants[3] = 0.0f;
+        VkPushConstantRange pushConstantRange = {};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof( PushConstants_Draw );
 
         VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
         pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutCreateInfo.pNext = nullptr;
         pipelineLayoutCreateInfo.flags = 0;
-        pipelineLayoutCreateInfo.setLayoutCount = 1;
-        pipelineLayoutCreateInfo.pSetLayouts = &uboLayout;
-        pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-        pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+        pipelineLayoutCreateInfo.setLayoutCount = 2;
+        pipelineLayoutCreateInfo.pSetLayouts = setLayouts;
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 
         result = vkCreatePipelineLayout( m_Device, &pipelineLayoutCreateInfo, nullptr, &m_PipelineLayout );
         assert( result == VK_SUCCESS );
-
-        VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
-        graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        graphicsPipelineCreateInfo.pNext = nullptr;
-        graphicsPipelineCreateInfo.flags = 0;
-        graphicsPipelineCreateInfo.stageCount = 2;
-        graphicsPipelineCreateInfo.pStages = shaderStageCreateInfoArray;
-        graphicsPipelineCreateInfo.pVertexInputState = &vertexInputStateCreateInfo;
-        graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssemblyStateCreateInfo;
-        graphicsPipelineCreateInfo.pTessellationState = nullptr;
-        graphicsPipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
-        graphicsPipelineCreateInfo.pRasterizationState = &rasterizationStateCreateInfo;
-        graphicsPipelineCreateInfo.pMultisampleState = &multisampleStateCreateInfo;
-        graphicsPipelineCreateInfo.pDepthStencilState = &depthStencilStateCreateInfo;
-        graphicsPipelineCreateInfo.pColorBlendState = &colorBlendStateCreateInfo;
-        graphicsPipelineCreateInfo.pDynamicState = nullptr;
-        graphicsPipelineCreateInfo.layout = m_PipelineLayout;
-        graphicsPipelineCreateInfo.renderPass = m_RenderPass;
-        graphicsPipelineCreateInfo.subpass = 0;
-        graphicsPipelineCreateInfo.basePipelineHandle;
-        graphicsPipelineCreateInfo.basePipelineIndex = -1;
-
-        result = vkCreateGraphicsPipelines( m_Device, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, NULL, &m_Pipeline );
-        assert( result == VK_SUCCESS );
     }
 
-    // Delete the shader.
+    m_Pipeline = CreatePipeline();
+
+    SetObjectName( VK_OBJECT_TYPE_RENDER_PASS, (uint64)m_RenderPass, "Main Render Pass" );
+    SetObjectName( VK_OBJECT_TYPE_PIPELINE_LAYOUT, (uint64)m_PipelineLayout, "Main Pipeline Layout" );
+    SetObjectName( VK_OBJECT_TYPE_PIPELINE, (uint64)m_Pipeline, "Main Pipeline" );
+}
+
+VkPipeline VulkanInterface::CreatePipeline()
+{
+    assert( m_TempShader != nullptr );
+
+    VkPipelineShaderStageCreateInfo shaderStageCreateInfoArray[2] = {};
+
+    shaderStageCreateInfoArray[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStageCreateInfoArray[0].pNext = nullptr;
+    shaderStageCreateInfoArray[0].flags = 0;
+    shaderStageCreateInfoArray[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStageCreateInfoArray[0].module = m_TempShader->GetVertexShader();
+    shaderStageCreateInfoArray[0].pName = "main";
+    shaderStageCreateInfoArray[0].pSpecializationInfo = nullptr;
+
+    shaderStageCreateInfoArray[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStageCreateInfoArray[1].pNext = nullptr;
+    shaderStageCreateInfoArray[1].flags = 0;
+    shaderStageCreateInfoArray[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStageCreateInfoArray[1].module = m_TempShader->GetFragmentShader();
+    shaderStageCreateInfoArray[1].pName = "main";
+    shaderStageCreateInfoArray[1].pSpecializationInfo = nullptr;
+
+    VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {};
+    vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputStateCreateInfo.pNext = nullptr;
+    vertexInputStateCreateInfo.flags = 0;;
+    //vertexInputStateCreateInfo.vertexBindingDescriptionCount = 0;
+    //vertexInputStateCreateInfo.pVertexBindingDescriptions = nullptr;
+    //vertexInputStateCreateInfo.vertexAttributeDescriptionCount = 0;
+    //vertexInputStateCreateInfo.pVertexAttributeDescriptions = nullptr;
+    vertexInputStateCreateInfo.vertexBindingDescriptionCount = m_VertexLayout.GetBindingDescriptionCount();
+    vertexInputStateCreateInfo.pVertexBindingDescriptions = m_VertexLayout.GetBindingDescriptions();
+    vertexInputStateCreateInfo.vertexAttributeDescriptionCount = m_VertexLayout.GetAttributeDescriptionCount();
+    vertexInputStateCreateInfo.pVertexAttributeDescriptions = m_VertexLayout.GetAttributeDescriptions();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo = {};
+    inputAssemblyStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssemblyStateCreateInfo.pNext = nullptr;
+    inputAssemblyStateCreateInfo.flags = 0;
+    inputAssemblyStateCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssemblyStateCreateInfo.primitiveRestartEnable = false;
+
+    // Viewport and scissor are dynamic, so the pipeline survives swapchain resizes and serves every view.
+    VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
+    viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportStateCreateInfo.pNext = nullptr;
+    viewportStateCreateInfo.flags = 0;
+    viewportStateCreateInfo.viewportCount = 1;
+    viewportStateCreateInfo.pViewports = nullptr;
+    viewportStateCreateInfo.scissorCount = 1;
+    viewportStateCreateInfo.pScissors = nullptr;
+
+    // Cull mode too if the device can, the rasterization state's cull mode is ignored then.
+    VkDynamicState dynamicStates[3] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    uint32 dynamicStateCount = 2;
+    if( m_pfnCmdSetCullMode )
+        dynamicStates[dynamicStateCount++] = VK_DYNAMIC_STATE_CULL_MODE_EXT;
+
+    VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+    dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateCreateInfo.pNext = nullptr;
+    dynamicStateCreateInfo.flags = 0;
+    dynamicStateCreateInfo.dynamicStateCount = dynamicStateCount;
+    dynamicStateCreateInfo.pDynamicStates = dynamicStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo = {};
+    rasterizationStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizationStateCreateInfo.pNext = nullptr;
+    rasterizationStateCreateInfo.flags = 0;
+    rasterizationStateCreateInfo.depthClampEnable = false;
+    rasterizationStateCreateInfo.rasterizerDiscardEnable = false;
+    rasterizationStateCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizationStateCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizationStateCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterizationStateCreateInfo.depthBiasEnable = false;
+    rasterizationStateCreateInfo.depthBiasConstantFactor = 0.0f;
+    rasterizationStateCreateInfo.depthBiasClamp = 0.0f;
+    rasterizationStateCreateInfo.depthBiasSlopeFactor = 0.0f;
+    rasterizationStateCreateInfo.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo = {};
+    multisampleStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampleStateCreateInfo.pNext = nullptr;
+    multisampleStateCreateInfo.flags = 0;
+    multisampleStateCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampleStateCreateInfo.sampleShadingEnable = false;
+    multisampleStateCreateInfo.minSampleShading = 1.0f;
+    multisampleStateCreateInfo.pSampleMask = nullptr;
+    multisampleStateCreateInfo.alphaToCoverageEnable = false;
+    multisampleStateCreateInfo.alphaToOneEnable = false;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo = {};
+    depthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencilStateCreateInfo.pNext = nullptr;
+    depthStencilStateCreateInfo.flags = 0;
+    depthStencilStateCreateInfo.depthTestEnable = false;
+    depthStencilStateCreateInfo.depthWriteEnable = false;
+    depthStencilStateCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    depthStencilStateCreateInfo.depthBoundsTestEnable = false;
+    depthStencilStateCreateInfo.stencilTestEnable = false;
+    depthStencilStateCreateInfo.front.failOp = VK_STENCIL_OP_KEEP;
+    depthStencilStateCreateInfo.front.passOp = VK_STENCIL_OP_KEEP;
+    depthStencilStateCreateInfo.front.compareOp = VK_COMPARE_OP_ALWAYS;
+    depthStencilStateCreateInfo.back.failOp = VK_STENCIL_OP_KEEP;
+    depthStencilStateCreateInfo.back.passOp = VK_STENCIL_OP_KEEP;
+    depthStencilStateCreateInfo.back.compareOp = VK_COMPARE_OP_ALWAYS;
+    depthStencilStateCreateInfo.minDepthBounds = 0.0f;
+    depthStencilStateCreateInfo.maxDepthBounds = 1.0f;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachmentState = {};
+    colorBlendAttachmentState.blendEnable = false;
+    colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo = {};
+    colorBlendStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlendStateCreateInfo.pNext = nullptr;
+    colorBlendStateCreateInfo.flags = 0;
+    colorBlendStateCreateInfo.logicOpEnable = false;
+    colorBlendStateCreateInfo.logicOp = VK_LOGIC_OP_COPY;
+    colorBlendStateCreateInfo.attachmentCount = 1;
+    colorBlendStateCreateInfo.pAttachments = &colorBlendAttachmentState;
+    colorBlendStateCreateInfo.blendConstants[0] = 0.0f;
+    colorBlendStateCreateInfo.blendConstants[1] = 0.0f;
+    colorBlendStateCreateInfo.blendConstants[2] = 0.0f;
+    colorBlendStateCreateInfo.blendConstants[3] = 0.0f;
+
+    VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
+    graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    graphicsPipelineCreateInfo.pNext = nullptr;
+    graphicsPipelineCreateInfo.flags = 0;
+    graphicsPipelineCreateInfo.stageCount = 2;
+    graphicsPipelineCreateInfo.pStages = shaderStageCreateInfoArray;
+    graphicsPipelineCreateInfo.pVertexInputState = &vertexInputStateCreateInfo;
+    graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssemblyStateCreateInfo;
+    graphicsPipelineCreateInfo.pTessellationState = nullptr;
+    graphicsPipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
+    graphicsPipelineCreateInfo.pRasterizationState = &rasterizationStateCreateInfo;
+    graphicsPipelineCreateInfo.pMultisampleState = &multisampleStateCreateInfo;
+    graphicsPipelineCreateInfo.pDepthStencilState = &depthStencilStateCreateInfo;
+    graphicsPipelineCreateInfo.pColorBlendState = &colorBlendStateCreateInfo;
+    graphicsPipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+    graphicsPipelineCreateInfo.layout = m_PipelineLayout;
+    graphicsPipelineCreateInfo.renderPass = m_RenderPass;
+    graphicsPipelineCreateInfo.subpass = 0;
+    graphicsPipelineCreateInfo.basePipelineHandle;
+    graphicsPipelineCreateInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    VkResult result = vkCreateGraphicsPipelines( m_Device, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, NULL, &pipeline );
+    assert( result == VK_SUCCESS );
+
+    return pipeline;
+}
+
+void VulkanInterface::SetupCommandBuffers(VulkanMesh* pMesh)
+{
+    SetupCommandBuffers( &pMesh, 1 );
+}
+
+void VulkanInterface::SetupCommandBuffers(VulkanMesh** ppMeshes, uint32 meshCount)
+{
+    assert( meshCount <= MAX_DRAWS_PER_FRAME );
+
+    // Keep the list, Render() picks each mesh's LOD, writes its draw into the indirect buffer and records the frame.
+    // Frames already submitted keep their own command buffers, so there's no need to wait for them.
+    for( uint32 meshIndex=0; meshIndex<meshCount; meshIndex++ )
     {
-        m_TempShader->Destroy();
-        delete m_TempShader;
-        m_TempShader = nullptr;
+        m_Meshes[meshIndex] = ppMeshes[meshIndex];
     }
+    m_MeshCount = meshCount;
 }
 
-void VulkanInterface::SetupCommandBuffers(VulkanMesh* pMesh)
+void VulkanInterface::RecordCommandBuffer(FrameStuff* pFrame, uint32 imageIndex)
 {
+    PROFILE_FUNCTION();
+
+    VkResult result;
+
+    VkCommandBuffer commandBuffer = pFrame->m_CommandBuffer;
+
     VkCommandBufferBeginInfo bufferBeginInfo = {};
     bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     bufferBeginInfo.pNext = nullptr;
-    bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     bufferBeginInfo.pInheritanceInfo = nullptr;
 
     VkClearColorValue clearColor = { 0.0f, 0.0f, 0.3f, 1.0f };
@@ -833,7 +1877,7 @@ void VulkanInterface::SetupCommandBuffers(VulkanMesh* pMesh)
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.pNext = nullptr;
     renderPassInfo.renderPass = m_RenderPass;
-    //renderPassInfo.framebuffer = m_SwapchainStuff[i].m_Framebuffers; // Set in loop below.
+    renderPassInfo.framebuffer = m_SwapchainStuff[imageIndex].m_Framebuffers;
     renderPassInfo.renderArea.offset.x = 0;
     renderPassInfo.renderArea.offset.y = 0;
     renderPassInfo.renderArea.extent.width = m_SurfaceWidth;
@@ -841,32 +1885,156 @@ void VulkanInterface::SetupCommandBuffers(VulkanMesh* pMesh)
     renderPassInfo.clearValueCount = 1;
     renderPassInfo.pClearValues = &clearValue;
 
-    for( uint32 i=0; i<m_SwapchainImageCount; i++ )
+    result = vkBeginCommandBuffer( commandBuffer, &bufferBeginInfo );
+    assert( result == VK_SUCCESS );
+
+    // Query resets can't go in a render pass.
+    m_GPUProfiler.BeginFrame( commandBuffer );
+
+    // Time the pass as a whole and each view's draws, and count the pass's work if pipeline statistics are on.
+    static const char* viewScopeNames[MAX_RENDER_VIEWS] = { "View 0", "View 1", "View 2", "View 3" };
+    m_GPUProfiler.BeginScope( "Main Pass", true );
+
+    vkCmdBeginRenderPass( commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+
+    vkCmdBindPipeline( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline );
+
+    // Meshes sharing a geometry pool are drawn back-to-back, buffers are only bound when the pool changes.
+    // The index buffer is also rebound when the index width changes, since 16 and 32-bit meshes share it.
+    // Bindings carry over between views.
+    VulkanGeometryPool* pBoundPool = nullptr;
+    VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+    VkDescriptorSet boundTextureSet = VK_NULL_HANDLE;
+    PushConstants_Draw boundConstants;
+    bool constantsPushed = false;
+    for( uint32 viewIndex=0; viewIndex<m_ViewCount; viewIndex++ )
     {
-        renderPassInfo.framebuffer = m_SwapchainStuff[i].m_Framebuffers;
+        VulkanGPUScope viewScope( &m_GPUProfiler, viewScopeNames[viewIndex] );
 
-        VkResult result = vkBeginCommandBuffer( m_SwapchainStuff[i].m_CommandBuffers, &bufferBeginInfo );
-        assert( result == VK_SUCCESS );
+        // Only dynamic state changes between views, the pipeline stays bound.
+        VkRect2D scissorRect = GetViewRect( m_Views[viewIndex] );
+
+        VkViewport viewport = {};
+        viewport.x = (float)scissorRect.offset.x;
+        viewport.y = (float)scissorRect.offset.y;
+        viewport.width  = (float)scissorRect.extent.width;
+        viewport.height = (float)scissorRect.extent.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
 
-        vkCmdBeginRenderPass( m_SwapchainStuff[i].m_CommandBuffers, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE );
+        vkCmdSetViewport( commandBuffer, 0, 1, &viewport );
+        vkCmdSetScissor( commandBuffer, 0, 1, &scissorRect );
 
-        vkCmdBindPipeline( m_SwapchainStuff[i].m_CommandBuffers, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline );
+        if( m_pfnCmdSetCullMode )
+        {
+            m_pfnCmdSetCullMode( commandBuffer, m_Views[viewIndex].m_CullMode );
+        }
 
-        VkBuffer vertexBuffers[] = { pMesh->GetVertexBuffer()->m_Buffer };
-        VkDeviceSize offsets[] = { 0 };
-        vkCmdBindVertexBuffers( m_SwapchainStuff[i].m_CommandBuffers, 0, 1, vertexBuffers, offsets );
-        vkCmdBindIndexBuffer( m_SwapchainStuff[i].m_CommandBuffers, pMesh->GetIndexBuffer()->m_Buffer, 0, VK_INDEX_TYPE_UINT16 );
+        uint32 uboOffset = viewIndex * m_UBOViewStride;
+        vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &pFrame->m_DescriptorSet, 1, &uboOffset );
 
-        vkCmdBindDescriptorSets( m_SwapchainStuff[i].m_CommandBuffers, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_SwapchainStuff[i].m_DescriptorSets, 0, nullptr );
+        uint32 meshIndex = 0;
+        while( meshIndex < m_MeshCount )
+        {
+            VulkanMesh* pMesh = m_Meshes[meshIndex];
+            VkDescriptorSet textureSet = GetTextureSet( pMesh );
+
+            if( textureSet != boundTextureSet )
+            {
+                boundTextureSet = textureSet;
+                vkCmdBindDescriptorSets( commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 1, 1, &boundTextureSet, 0, nullptr );
+            }
+
+            if( pMesh->GetGeometryPool() != pBoundPool )
+            {
+                pBoundPool = pMesh->GetGeometryPool();
+                boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+
+                VkBuffer vertexBuffers[] = { pBoundPool->GetVertexBuffer()->m_Buffer };
+                VkDeviceSize offsets[] = { 0 };
+                vkCmdBindVertexBuffers( commandBuffer, 0, 1, vertexBuffers, offsets );
+            }
+
+            if( pMesh->GetIndexType() != boundIndexType )
+            {
+                boundIndexType = pMesh->GetIndexType();
+                vkCmdBindIndexBuffer( commandBuffer, pBoundPool->GetIndexBuffer()->m_Buffer, 0, boundIndexType );
+            }
+
+            // Unquantized meshes all share the same constants, quantized meshes each need their own.
+            PushConstants_Draw drawConstants;
+            pMesh->GetDrawConstants( &drawConstants );
+            if( constantsPushed == false || memcmp( &drawConstants, &boundConstants, sizeof( PushConstants_Draw ) ) != 0 )
+            {
+                boundConstants = drawConstants;
+                constantsPushed = true;
+                vkCmdPushConstants( commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( PushConstants_Draw ), &boundConstants );
+            }
+
+            // The draw commands are contiguous, so with multiDrawIndirect every following mesh using the same buffers, texture and constants joins this call.
+            uint32 drawCount = 1;
+            if( m_MultiDrawIndirect )
+            {
+                while( meshIndex + drawCount < m_MeshCount && drawCount < m_MaxDrawIndirectCount )
+                {
+                    VulkanMesh* pNextMesh = m_Meshes[meshIndex + drawCount];
+                    if( pNextMesh->GetGeometryPool() != pBoundPool || pNextMesh->GetIndexType() != boundIndexType || GetTextureSet( pNextMesh ) != boundTextureSet )
+                        break;
+
+                    pNextMesh->GetDrawConstants( &drawConstants );
+                    if( memcmp( &drawConstants, &boundConstants, sizeof( PushConstants_Draw ) ) != 0 )
+                        break;
+
+                    drawCount++;
+                }
+            }
+
+            //vkCmdDraw( commandBuffer, drawCount, 1, 0, 0 );
+            VkDeviceSize commandOffset = (viewIndex * MAX_DRAWS_PER_FRAME + meshIndex) * sizeof( VkDrawIndexedIndirectCommand );
+            vkCmdDrawIndexedIndirect( commandBuffer, pFrame->m_IndirectCommands->m_Buffer, commandOffset, drawCount, sizeof( VkDrawIndexedIndirectCommand ) );
+
+            meshIndex += drawCount;
+        }
+    }
 
-        //vkCmdDraw( m_SwapchainStuff[i].m_CommandBuffers, drawCount, 1, 0, 0 );
-        vkCmdDrawIndexed( m_SwapchainStuff[i].m_CommandBuffers, pMesh->GetIndexCount(), 1, 0, 0, 0 );
+    vkCmdEndRenderPass( commandBuffer );
 
-        vkCmdEndRenderPass( m_SwapchainStuff[i].m_CommandBuffers );
+    m_GPUProfiler.EndScope();
 	
-        result = vkEndCommandBuffer( m_SwapchainStuff[i].m_CommandBuffers );
-        assert( result == VK_SUCCESS );
-    }
+    result = vkEndCommandBuffer( commandBuffer );
+    assert( result == VK_SUCCESS );
+}
+
+VkDescriptorSet VulkanInterface::GetTextureSet(VulkanMesh* pMesh)
+{
+    // Textures still uploading aren't in a shader readable layout yet.
+    VulkanTexture* pTexture = pMesh->GetTexture();
+    if( pTexture == nullptr || pTexture->IsResident() == false )
+        pTexture = m_DefaultTexture;
+
+    return pTexture->GetDescriptorSet();
+}
+
+VkRect2D VulkanInterface::GetViewRect(const RenderView& view)
+{
+    // Round the edges rather than the size, so neighbouring views meet without gaps.
+    int32 left   = (int32)( view.m_X * m_SurfaceWidth + 0.5f );
+    int32 top    = (int32)( view.m_Y * m_SurfaceHeight + 0.5f );
+    int32 right  = (int32)( (view.m_X + view.m_Width) * m_SurfaceWidth + 0.5f );
+    int32 bottom = (int32)( (view.m_Y + view.m_Height) * m_SurfaceHeight + 0.5f );
+
+    MyClamp( left, 0, (int32)m_SurfaceWidth );
+    MyClamp( top, 0, (int32)m_SurfaceHeight );
+    MyClamp( right, left, (int32)m_SurfaceWidth );
+    MyClamp( bottom, top, (int32)m_SurfaceHeight );
+
+    VkRect2D rect;
+    rect.offset.x = left;
+    rect.offset.y = top;
+    rect.extent.width = right - left;
+    rect.extent.height = bottom - top;
+
+    return rect;
 }
 
 uint32_t VulkanInterface::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
@@ -886,47 +2054,235 @@ uint32_t VulkanInterface::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFl
     return UINT_MAX;
 }
 
-void VulkanInterface::Render()
+#if VULKAN_OBJECT_NAMES
+void VulkanInterface::SetObjectName(VkObjectType type, uint64 handle, const char* name)
 {
-    VkResult result = vkAcquireNextImageKHR( m_Device, m_Swapchain, UINT64_MAX, m_ImageAcquiredSemaphore, VK_NULL_HANDLE, &m_CurrentSwapchainImageIndex );
+    if( m_pfnSetDebugUtilsObjectName == nullptr || handle == 0 )
+        return;
+
+    VkDebugUtilsObjectNameInfoEXT nameInfo = {};
+    nameInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+    nameInfo.pNext = nullptr;
+    nameInfo.objectType = type;
+    nameInfo.objectHandle = handle;
+    nameInfo.pObjectName = name;
+
+    VkResult result = m_pfnSetDebugUtilsObjectName( m_Device, &nameInfo );
     assert( result == VK_SUCCESS );
+}
+#endif //VULKAN_OBJECT_NAMES
+
+void VulkanInterface::TrackAllocation(VkDeviceSize size)
+{
+    m_DeviceMemoryInUse += size;
+    m_DeviceAllocationCount++;
+
+    if( m_DeviceMemoryInUse > m_PeakDeviceMemory )
+        m_PeakDeviceMemory = m_DeviceMemoryInUse;
+}
+
+void VulkanInterface::TrackFree(VkDeviceSize size)
+{
+    assert( m_DeviceMemoryInUse >= size && m_DeviceAllocationCount > 0 );
+
+    m_DeviceMemoryInUse -= size;
+    m_DeviceAllocationCount--;
+}
+
+void VulkanInterface::Render()
+{
+    PROFILE_FUNCTION();
+
+    VkResult result;
+
+    // Submit pending uploads and hand finished ones to this queue before the frame is submitted.
+    // Done even when the frame is skipped so streaming continues while minimized.
+    m_TransferQueue->Flush();
+    m_TransferQueue->Update();
+
+    // Free resources that the last frame using them has finished with.
+    m_DeletionQueue->Update();
+
+    // Throttle here if the application didn't call BeginFrame() itself.
+    if( m_FramePacer.IsFrameOpen() == false )
+    {
+        m_FramePacer.BeginFrame();
+    }
+
+    m_CurrentSwapchainImageIndex = UINT_MAX;
+
+    // Skip the frame while minimized, otherwise rebuild the swapchain if the window changed size.
+    if( IsMinimized() )
+    {
+        m_FramePacer.CancelFrame();
+        return;
+    }
+
+    if( m_Headless == false && (m_SwapchainOutOfDate || m_Window->m_Resized) )
+    {
+        if( RecreateSwapchain() == false )
+        {
+            m_FramePacer.CancelFrame();
+            return;
+        }
+    }
+
+    // The frame's UBO, indirect buffer, command buffer and acquire semaphore are reused below, wait for the last frame that used them.
+    FrameStuff* pFrame = &m_FrameStuff[m_CurrentFrameIndex];
+    {
+        PROFILE_SCOPE( "Wait For Frame Resources" );
+        m_GraphicsTimeline.Wait( pFrame->m_LastSubmitValue );
+    }
+
+    // Headless frames all draw to the one offscreen image.
+    uint32_t imageIndex = 0;
+    if( m_Headless )
+    {
+        result = VK_SUCCESS;
+    }
+    else
+    {
+        PROFILE_SCOPE( "Acquire" );
+        result = vkAcquireNextImageKHR( m_Device, m_Swapchain, UINT64_MAX, pFrame->m_ImageAcquiredSemaphore, VK_NULL_HANDLE, &imageIndex );
+    }
+    if( result == VK_ERROR_OUT_OF_DATE_KHR )
+    {
+        // No image was acquired and the semaphore won't be signaled, try again next frame.
+        m_SwapchainOutOfDate = true;
+        m_FramePacer.CancelFrame();
+        return;
+    }
+    else if( result == VK_SUBOPTIMAL_KHR )
+    {
+        // The image is still usable, draw and present it, then recreate.
+        m_SwapchainOutOfDate = true;
+    }
+    else
+    {
+        assert( result == VK_SUCCESS );
+    }
+
+    m_CurrentSwapchainImageIndex = imageIndex;
 
     // Update our UBO.
     {
+        PROFILE_SCOPE( "Update Views" );
+
         static float frameCount = 0.0f;
-        UniformBufferObject_Matrices matrices;
-        matrices.m_World.CreateSRT( Vector3(1,1,1), Vector3(0,frameCount,frameCount/1.5f), Vector3(0,0,0) );
-        matrices.m_View.CreateLookAtView( Vector3(0,0,-5), Vector3(0,1,0), Vector3(0,0,0) );
-        matrices.m_Proj.CreatePerspectiveVFoV( 45.0f, (float)m_SurfaceWidth/m_SurfaceHeight, 0.01f, 100.0f );
-        matrices.m_Proj.m22 *= -1; // Hack for vulkan clip-space being upside down. (-1,-1) at top left.
+        MyMatrix world;
+        world.CreateSRT( Vector3(1,1,1), Vector3(0,frameCount,frameCount/1.5f), Vector3(0,0,0) );
         frameCount += 1.0f;
 
-        m_SwapchainStuff[m_CurrentSwapchainImageIndex].m_UBO_Matrices->BufferData( &matrices, sizeof( UniformBufferObject_Matrices ) );
+        memset( &m_RenderStats, 0, sizeof( m_RenderStats ) );
+
+        for( uint32 viewIndex=0; viewIndex<m_ViewCount; viewIndex++ )
+        {
+            RenderView& view = m_Views[viewIndex];
+            VkRect2D rect = GetViewRect( view );
+            float viewWidth = rect.extent.width > 0 ? (float)rect.extent.width : 1.0f;
+            float viewHeight = rect.extent.height > 0 ? (float)rect.extent.height : 1.0f;
+
+            UniformBufferObject_Matrices matrices;
+            matrices.m_World = world;
+            matrices.m_View.CreateLookAtView( view.m_CameraPosition, view.m_CameraUp, view.m_LookAtTarget );
+            matrices.m_Proj.CreatePerspectiveVFoV( view.m_VerticalFOV, viewWidth/viewHeight, 0.01f, 100.0f );
+            matrices.m_Proj.m22 *= -1; // Hack for vulkan clip-space being upside down. (-1,-1) at top left.
+
+            pFrame->m_UBO_Matrices->BufferData( &matrices, sizeof( UniformBufferObject_Matrices ), viewIndex * m_UBOViewStride );
+
+            // Select a LOD for each mesh in this view and write its draw.
+            if( m_MeshCount > 0 )
+            {
+                VkDrawIndexedIndirectCommand commands[MAX_DRAWS_PER_FRAME];
+                for( uint32 meshIndex=0; meshIndex<m_MeshCount; meshIndex++ )
+                {
+                    VulkanMesh* pMesh = m_Meshes[meshIndex];
+
+                    // Skip meshes whose geometry is still uploading.
+                    if( pMesh->IsResident() == false )
+                    {
+                        memset( &commands[meshIndex], 0, sizeof( VkDrawIndexedIndirectCommand ) );
+                        continue;
+                    }
+
+                    uint32 lod = pMesh->SelectLOD( matrices.m_World, matrices.m_View, matrices.m_Proj, viewHeight, m_LODPixelError );
+                    pMesh->GetDrawCommand( &commands[meshIndex], m_InstanceCount, lod );
+
+                    m_RenderStats.m_DrawCount++;
+                    m_RenderStats.m_TrianglesDrawn += pMesh->GetLODTriangleCount( lod ) * m_InstanceCount;
+                    m_RenderStats.m_DrawsPerLOD[lod]++;
+                    m_RenderStats.m_TrianglesPerLOD[lod] += pMesh->GetLODTriangleCount( lod ) * m_InstanceCount;
+                }
+
+                uint32 commandOffset = viewIndex * MAX_DRAWS_PER_FRAME * sizeof( VkDrawIndexedIndirectCommand );
+                pFrame->m_IndirectCommands->BufferData( commands, sizeof( VkDrawIndexedIndirectCommand ) * m_MeshCount, commandOffset );
+            }
+        }
     }
 
-    VkSemaphore waitSemaphores[] = { m_ImageAcquiredSemaphore };
-    VkSemaphore signalSemaphores[] = { m_DrawCompleteSemaphore };
+    RecordCommandBuffer( pFrame, imageIndex );
+
+    // Signal the image's binary semaphore for present and the next graphics timeline value.
+    uint64 signalValue = m_GraphicsTimeline.Next();
+
+    VkSemaphore waitSemaphores[] = { pFrame->m_ImageAcquiredSemaphore };
+    VkSemaphore signalSemaphores[] = { m_SwapchainStuff[imageIndex].m_DrawCompleteSemaphore, m_GraphicsTimeline.GetSemaphore() };
+    uint64_t waitValues[] = { 0 }; // Ignored for binary semaphores.
+    uint64_t signalValues[] = { 0, signalValue };
 
     VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.pNext = nullptr;
+    // Headless frames have nothing to wait for and nothing to present, only the timeline is signaled.
+    uint32 waitCount = m_Headless ? 0 : 1;
+    uint32 signalOffset = m_Headless ? 1 : 0;
+
+    timelineInfo.waitSemaphoreValueCount = waitCount;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    timelineInfo.signalSemaphoreValueCount = 2 - signalOffset;
+    timelineInfo.pSignalSemaphoreValues = signalValues + signalOffset;
+
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.pNext = nullptr;
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = waitCount;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_SwapchainStuff[m_CurrentSwapchainImageIndex].m_CommandBuffers;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    submitInfo.pCommandBuffers = &pFrame->m_CommandBuffer;
+    submitInfo.signalSemaphoreCount = 2 - signalOffset;
+    submitInfo.pSignalSemaphores = signalSemaphores + signalOffset;
     
-    result = vkQueueSubmit( m_Queue, 1, &submitInfo, VK_NULL_HANDLE );    
-    assert( result == VK_SUCCESS );
+    {
+        PROFILE_SCOPE( "Submit" );
+        result = vkQueueSubmit( m_Queue, 1, &submitInfo, VK_NULL_HANDLE );
+        assert( result == VK_SUCCESS );
+    }
+
+    pFrame->m_LastSubmitValue = signalValue;
+    m_GPUProfiler.EndFrame( signalValue );
+    m_CurrentFrameIndex = (m_CurrentFrameIndex + 1) % m_FramesInFlight;
+
+    m_FramePacer.EndFrame( signalValue );
 }
 
 void VulkanInterface::Present()
 {
-    VkSemaphore waitSemaphores[1] = { m_DrawCompleteSemaphore };
+    PROFILE_FUNCTION();
+
+    // Render() skipped the frame.
+    if( m_CurrentSwapchainImageIndex == UINT_MAX )
+        return;
+
+    if( m_Headless )
+    {
+        m_CurrentSwapchainImageIndex = UINT_MAX;
+        return;
+    }
+
+    VkSemaphore waitSemaphores[1] = { m_SwapchainStuff[m_CurrentSwapchainImageIndex].m_DrawCompleteSemaphore };
 
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -939,5 +2295,14 @@ void VulkanInterface::Present()
     presentInfo.pResults = nullptr;
     
     VkResult result = vkQueuePresentKHR( m_Queue, &presentInfo );    
-    assert( result == VK_SUCCESS );
+    if( result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR )
+    {
+        m_SwapchainOutOfDate = true;
+    }
+    else
+    {
+        assert( result == VK_SUCCESS );
+    }
+
+    m_CurrentSwapchainImageIndex = UINT_MAX;
 }
@@ -13,23 +13,74 @@
 #include "vulkan/vulkan.h"
 #include "VulkanWindow.h"
 #include "VulkanSwapchainObject.h"
+#include "VertexLayout.h"
+#include "VulkanTimelineSemaphore.h"
+#include "FramePacer.h"
+#include "VulkanGPUProfiler.h"
+#include "Structs.h"
 
 #include "Math/MyTypes.h"
 
 class VulkanShader;
 class VulkanBuffer;
 class VulkanMesh;
+class VulkanGeometryPool;
+class VulkanTransferQueue;
+class VulkanDeletionQueue;
+class VulkanTexture;
+class VulkanTexturePool;
+class VulkanSamplerCache;
+
+static const uint32 MAX_DRAWS_PER_FRAME = 1024;
+
+// Validation costs CPU time on every Vulkan call, so only Debug builds enable it by default.
+// The VULKAN_VALIDATION environment variable, 0 or 1, overrides this at runtime.
+#ifndef VULKAN_VALIDATION_DEFAULT
+#if DEBUG
+#define VULKAN_VALIDATION_DEFAULT 1
+#else
+#define VULKAN_VALIDATION_DEFAULT 0
+#endif
+#endif
+
+// Names show up in validation messages and capture tools, release builds don't pay for them.
+#ifndef VULKAN_OBJECT_NAMES
+#if DEBUG
+#define VULKAN_OBJECT_NAMES 1
+#else
+#define VULKAN_OBJECT_NAMES 0
+#endif
+#endif
 
 class VulkanInterface
 {
     friend class VulkanBuffer;
+    friend class VulkanTransferQueue;
+    friend class VulkanTimelineSemaphore;
+    friend class VulkanDeletionQueue;
+    friend class VulkanGPUProfiler;
+    friend class VulkanTexture;
+    friend class VulkanTexturePool;
+    friend class VulkanSamplerCache;
 
 protected:
     VulkanWindow* m_Window;
     VulkanShader* m_TempShader;
+    VulkanGeometryPool* m_GeometryPool;
+    VulkanTransferQueue* m_TransferQueue;
+    VulkanDeletionQueue* m_DeletionQueue;
+    VertexLayout m_VertexLayout;
     VkDescriptorSetLayout m_UBODescriptorSetLayout;
 
+    // Textures live in one shared allocation, each owns a descriptor set from the texture descriptor pool.
+    VulkanTexturePool* m_TexturePool;
+    VulkanSamplerCache* m_SamplerCache;
+    VulkanTexture* m_DefaultTexture; // White, bound for meshes without a texture.
+    VkDescriptorSetLayout m_TextureDescriptorSetLayout;
+    VkDescriptorPool m_TextureDescriptorPool;
+
     VkInstance m_VulkanInstance;
+    uint32_t m_InstanceAPIVersion;
     VkPhysicalDevice m_PhysicalDevice;
     VkDevice m_Device;
     VkSurfaceKHR m_Surface;
@@ -39,61 +90,227 @@ protected:
     uint32_t m_GraphicsQueueFamilyIndex;
     //uint32_t m_PresentQueueFamilyIndex;
 
+    // Same as m_Queue if the device has no separate family for these.
+    VkQueue m_TransferDeviceQueue;
+    uint32_t m_TransferQueueFamilyIndex;
+    VkQueue m_ComputeDeviceQueue;
+    uint32_t m_ComputeQueueFamilyIndex;
+
     VkCommandPool m_CommandBufferPool;
     VkDescriptorPool m_DescriptorPool;
 
     uint32_t m_SurfaceWidth;
     uint32_t m_SurfaceHeight;
 
+    // Headless interfaces render into an offscreen image in m_SwapchainStuff[0] instead of a window's swapchain.
+    bool m_Headless;
+    VkDeviceMemory m_OffscreenMemory;
+
     VkSwapchainKHR m_Swapchain;
-    uint32 m_SwapchainImageCount; // Currently hardcoded to 3.
-    SwapchainStuff m_SwapchainStuff[3];
-    uint32_t m_CurrentSwapchainImageIndex;
+    uint32 m_SwapchainImageCount;
+    VkPresentModeKHR m_PresentMode;
+    VkPresentModeKHR m_RequestedPresentMode;
+    uint32 m_RequestedImageCount; // 0 picks one more than the surface minimum.
+    SwapchainStuff* m_SwapchainStuff; // m_SwapchainImageCount entries.
+    uint32_t m_CurrentSwapchainImageIndex; // UINT_MAX if Render() skipped the frame.
+    bool m_SwapchainOutOfDate;
+
+    // Frames the CPU can build while the GPU works on earlier ones, unrelated to the swapchain image count.
+    FrameStuff* m_FrameStuff; // m_FramesInFlight entries.
+    uint32 m_FramesInFlight;
+    uint32 m_CurrentFrameIndex;
+
+    // Signaled by every graphics queue submission, used to tell when the GPU is done with a resource.
+    VulkanTimelineSemaphore m_GraphicsTimeline;
+    FramePacer m_FramePacer;
+    VulkanGPUProfiler m_GPUProfiler;
+
+    // Core in 1.2, loaded from VK_KHR_timeline_semaphore otherwise.
+    PFN_vkWaitSemaphoresKHR m_pfnWaitSemaphores;
+    PFN_vkGetSemaphoreCounterValueKHR m_pfnGetSemaphoreCounterValue;
 
-    VkSemaphore m_ImageAcquiredSemaphore;
-    VkSemaphore m_DrawCompleteSemaphore;
+    // The chosen device, filled in by CreateInterface.
+    VkPhysicalDeviceProperties m_DeviceProperties;
+    VkPhysicalDeviceFeatures m_DeviceFeatures;
+    uint64 m_DeviceLocalMemorySize;
+
+    // Substring of a device name or a device UUID, see SetPreferredDevice.
+    char m_PreferredDevice[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+
+    // Enabled on the device if supported, the GPU profiler uses it.
+    bool m_PipelineStatisticsQuerySupported;
+
+    // Enabled if supported, consecutive meshes sharing buffers are drawn with one indirect call.
+    bool m_MultiDrawIndirect;
+    uint32 m_MaxDrawIndirectCount;
+
+    // Only if requested and VK_LAYER_KHRONOS_validation is installed.
+    bool m_ValidationEnabled;
+    VkDebugUtilsMessengerEXT m_DebugMessenger;
+
+    // Loaded if VK_EXT_debug_utils is enabled in a VULKAN_OBJECT_NAMES build, nullptr otherwise.
+    PFN_vkSetDebugUtilsObjectNameEXT m_pfnSetDebugUtilsObjectName;
+
+    // Loaded if the device supports VK_EXT_extended_dynamic_state, nullptr otherwise.
+    PFN_vkCmdSetCullModeEXT m_pfnCmdSetCullMode;
+
+    // Each view's matrices sit at a multiple of this in the frame's UBO, selected with a dynamic offset.
+    uint32 m_UBOViewStride;
 
     VkRenderPass m_RenderPass;
     VkPipeline m_Pipeline;
     VkPipelineLayout m_PipelineLayout;
 
+    // Meshes drawn every frame, set by SetupCommandBuffers.  Their draw parameters come from the indirect buffers.
+    VulkanMesh* m_Meshes[MAX_DRAWS_PER_FRAME];
+    uint32 m_MeshCount;
+
+    // Every mesh is drawn once per view.
+    RenderView m_Views[MAX_RENDER_VIEWS];
+    uint32 m_ViewCount;
+
+    uint32 m_InstanceCount;
+    float m_LODPixelError;
+    RenderStats m_RenderStats;
+
+    // Device memory allocated through VulkanBuffer and for the offscreen target, counted until the owner is destroyed.
+    uint64 m_DeviceMemoryInUse;
+    uint64 m_PeakDeviceMemory;
+    uint32 m_DeviceAllocationCount;
+
 protected:
     virtual int ChooseDevice(int deviceCount, VkPhysicalDevice* devices);
+    // -1 if the device can't run the renderer, otherwise higher is better.
+    virtual int64 ScoreDevice(VkPhysicalDevice device);
+    bool MatchesPreferredDevice(VkPhysicalDevice device, const char* nameOrUUID);
     virtual int ChooseGraphicsQueueFamily(int queueFamilyCount, VkQueueFamilyProperties* queueFamilyProperties);
+    virtual int ChooseTransferQueueFamily(int queueFamilyCount, VkQueueFamilyProperties* queueFamilyProperties, int graphicsQueueFamily);
+    virtual int ChooseComputeQueueFamily(int queueFamilyCount, VkQueueFamilyProperties* queueFamilyProperties, int graphicsQueueFamily);
     virtual int ChooseSurfaceFormat(int formatCount, VkSurfaceFormatKHR* surfaceFormats);
+    virtual VkPresentModeKHR ChoosePresentMode(int presentModeCount, VkPresentModeKHR* presentModes);
 
     void NullEverything();
 
     void CreateInterface();
     void CreateSurface(const char* windowName, int width, int height);
     void CreateSwapchain();
+    void CreateOffscreenTarget(uint32 width, uint32 height);
+    void CreateFramebuffers();
+    void DestroySwapchainImageResources();
+    bool RecreateSwapchain();
+
+    void CreateFrameResources();
+    void DestroyFrameResources();
 
     void CreateCommandBufferPool();
 
     void CreateDescriptorPool();
-    void CreateDescriptorSets();
-
-    void CreateSemaphores();
-    void CreateRenderPassAndPipeline(VkDescriptorSetLayout uboLayout);
+    void CreateRenderPassAndPipeline(VkDescriptorSetLayout uboLayout, VkDescriptorSetLayout textureLayout);
 
     VkDescriptorSetLayout CreateUBODescriptorSetLayout();
+    VkDescriptorSetLayout CreateTextureDescriptorSetLayout();
     VkCommandBuffer CreateCommandBuffer();
+    void RecordCommandBuffer(FrameStuff* pFrame, uint32 imageIndex);
+    VkRect2D GetViewRect(const RenderView& view);
+    VkDescriptorSet GetTextureSet(VulkanMesh* pMesh);
 
     uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+    void TrackAllocation(VkDeviceSize size);
+    void TrackFree(VkDeviceSize size);
 
     VkDevice GetDevice() { return m_Device; }
+    VkPhysicalDevice GetPhysicalDevice() { return m_PhysicalDevice; }
+    VkDescriptorSetLayout GetTextureDescriptorSetLayout() { return m_TextureDescriptorSetLayout; }
+    VkDescriptorPool GetTextureDescriptorPool() { return m_TextureDescriptorPool; }
 
 public:
     VulkanInterface();
     virtual ~VulkanInterface();
 
+    // Call before Create to use a compressed vertex format, defaults to VertexFormat's layout.
+    void SetVertexLayout(const VertexLayout& layout);
+
+    // Call before Create.  Picks the first usable device whose name contains nameOrUUID, or whose UUID matches it (32 hex digits, dashes optional).
+    // Falls back to the VULKAN_DEVICE environment variable, then to the highest scoring device.
+    void SetPreferredDevice(const char* nameOrUUID);
+
     void Create(const char* windowName, int width, int height);
+    // No window or swapchain, frames are drawn to an offscreen image and Present does nothing.  Used by the benchmark.
+    void CreateHeadless(int width, int height);
     void Destroy();
+    bool IsHeadless() { return m_Headless; }
+    bool IsValidationEnabled() { return m_ValidationEnabled; }
+
+    // Does nothing unless VULKAN_OBJECT_NAMES is set and VK_EXT_debug_utils is available.
+#if VULKAN_OBJECT_NAMES
+    void SetObjectName(VkObjectType type, uint64 handle, const char* name);
+#else
+    void SetObjectName(VkObjectType type, uint64 handle, const char* name) {}
+#endif
 
     void SetupCommandBuffers(VulkanMesh* pMesh);
+    void SetupCommandBuffers(VulkanMesh** ppMeshes, uint32 meshCount);
+
+    // Split the screen into up to MAX_RENDER_VIEWS cameras, takes effect next frame.  Defaults to a single full screen view.
+    void SetViews(const RenderView* pViews, uint32 viewCount);
+    bool HasDynamicCullMode() { return m_pfnCmdSetCullMode != nullptr; }
+
+    // Draws every mesh this many times per view.
+    void SetInstanceCount(uint32 instanceCount) { m_InstanceCount = instanceCount; }
 
+    // Builds another pipeline identical to the one used for drawing, for measuring pipeline creation.
+    // The caller owns it, hand it to the deletion queue when done.
+    VkPipeline CreatePipeline();
+
+    // MAILBOX, IMMEDIATE and FIFO_RELAXED fall back to FIFO if the surface doesn't support them.
+    // imageCount of 0 picks one more than the surface minimum.  Can be called at any time, the swapchain is rebuilt.
+    void SetPresentMode(VkPresentModeKHR presentMode, uint32 imageCount = 0);
+    VkPresentModeKHR GetPresentMode() { return m_PresentMode; }
+    uint32 GetSwapchainImageCount() { return m_SwapchainImageCount; }
+
+    // Call before Create.  2 overlaps CPU and GPU work, more only helps if frame times are uneven.
+    void SetFramesInFlight(uint32 count);
+    uint32 GetFramesInFlight() { return m_FramesInFlight; }
+
+    // Call before reading input, blocks according to the pacing mode.  Render() calls it if the application doesn't.
+    void BeginFrame() { m_FramePacer.BeginFrame(); }
+    void SetFramePacing(FramePacingMode mode, uint32 maxQueuedFrames = 2) { m_FramePacer.SetMode( mode, maxQueuedFrames ); }
+    void GetLatencyStats(FrameLatencyStats* pStats) { m_FramePacer.GetLatencyStats( pStats ); }
+
+    // Render skips the frame while the window is minimized, Present does nothing after a skipped frame.
     void Render();
     void Present();
+    bool IsMinimized() { return m_Window != nullptr && m_Window->m_Minimized; }
+
+    // Pumps the window's message queue, returns false once the user closed it.  Always true when headless.
+    bool ProcessWindowEvents() { return m_Window == nullptr || m_Window->ProcessEvents(); }
+
+    // GPU progress, values come from GetLastSubmitValue() after a submission.
+    uint64 GetLastSubmitValue() { return m_GraphicsTimeline.GetLastSignalValue(); }
+    bool IsGPUComplete(uint64 value) { return m_GraphicsTimeline.IsComplete( value ); }
+    bool WaitForGPU(uint64 value, uint64 timeoutNanoseconds = UINT64_MAX) { return m_GraphicsTimeline.Wait( value, timeoutNanoseconds ); }
+    VulkanTimelineSemaphore* GetGraphicsTimeline() { return &m_GraphicsTimeline; }
+
+    VulkanGeometryPool* GetGeometryPool() { return m_GeometryPool; }
+    VulkanTransferQueue* GetTransferQueue() { return m_TransferQueue; }
+    VulkanDeletionQueue* GetDeletionQueue() { return m_DeletionQueue; }
+    VulkanTexturePool* GetTexturePool() { return m_TexturePool; }
+    VulkanSamplerCache* GetSamplerCache() { return m_SamplerCache; }
+    VulkanTexture* GetDefaultTexture() { return m_DefaultTexture; }
+    VulkanGPUProfiler* GetGPUProfiler() { return &m_GPUProfiler; }
+    bool HasAsyncComputeQueue() { return m_ComputeQueueFamilyIndex != m_GraphicsQueueFamilyIndex; }
+    const VkPhysicalDeviceProperties& GetDeviceProperties() { return m_DeviceProperties; }
+    const VkPhysicalDeviceFeatures& GetDeviceFeatures() { return m_DeviceFeatures; }
+    uint64 GetDeviceLocalMemorySize() { return m_DeviceLocalMemorySize; }
+    const VertexLayout& GetVertexLayout() { return m_VertexLayout; }
+
+    // How far, in pixels, a simplified LOD is allowed to deviate from the full mesh before a finer one is used.
+    void SetLODPixelError(float pixels) { m_LODPixelError = pixels; }
+    const RenderStats& GetRenderStats() { return m_RenderStats; }
+
+    uint64 GetDeviceMemoryInUse() { return m_DeviceMemoryInUse; }
+    uint64 GetPeakDeviceMemory() { return m_PeakDeviceMemory; }
+    uint32 GetDeviceAllocationCount() { return m_DeviceAllocationCount; }
 };
 
 #endif //__VulkanInterface_H__
@@ -9,35 +9,108 @@
 
 #include "vulkan/vulkan.h"
 #include "Math/MyTypes.h"
+#include "Math/MyMatrix.h"
 
 #include "VulkanMesh.h"
-#include "VulkanBuffer.h"
+#include "Mesh/MeshFile.h"
+#include "VulkanGeometryPool.h"
+#include "VulkanInterface.h"
+#include "VulkanTransferQueue.h"
 #include "Structs.h"
 
 VulkanMesh::VulkanMesh()
 {
-    m_VertexBuffer = nullptr;
-    m_IndexBuffer = nullptr;
+    m_pGeometryPool = nullptr;
+    m_VertexOffset = 0;
+    m_FirstIndex = 0;
+    m_IndexType = VK_INDEX_TYPE_UINT16;
+
+    m_VertexCount = 0;
+    m_IndexCount = 0;
+
+    m_LODCount = 0;
+    m_UploadSerial = 0;
+
+    m_BoundingCenter.Set( 0, 0, 0 );
+    m_BoundingRadius = 0;
+
+    m_QuantizationCenter.Set( 0, 0, 0 );
+    m_QuantizationExtents.Set( 1, 1, 1 );
+
+    m_pTexture = nullptr;
 }
 
 VulkanMesh::~VulkanMesh()
 {
-    assert( m_VertexBuffer == nullptr );
-    assert( m_IndexBuffer == nullptr );
+    assert( m_pGeometryPool == nullptr );
 }
 
-void VulkanMesh::Create(VulkanInterface* pInterface, const void* vertices, uint32 vertexCount, const void* indices, uint32 indexCount)
+VkIndexType VulkanMesh::ChooseIndexType(uint32 vertexCount)
 {
-    // Create a vertex and index buffer.
-    m_VertexBuffer = new VulkanBuffer();
-    m_IndexBuffer = new VulkanBuffer();
+    // Indices are relative to the mesh's vertexOffset, so 16-bit covers any mesh with up to 65536 vertices.
+    if( vertexCount <= 65536 )
+        return VK_INDEX_TYPE_UINT16;
+
+    return VK_INDEX_TYPE_UINT32;
+}
+
+bool VulkanMesh::Create(VulkanInterface* pInterface, const void* vertices, uint32 vertexCount, const unsigned short* indices, uint32 indexCount)
+{
+    return Create( pInterface->GetGeometryPool(), vertices, vertexCount, indices, indexCount, VK_INDEX_TYPE_UINT16 );
+}
+
+bool VulkanMesh::Create(VulkanInterface* pInterface, const void* vertices, uint32 vertexCount, const uint32* indices, uint32 indexCount)
+{
+    return Create( pInterface->GetGeometryPool(), vertices, vertexCount, indices, indexCount );
+}
+
+bool VulkanMesh::Create(VulkanGeometryPool* pGeometryPool, const void* vertices, uint32 vertexCount, const uint32* indices, uint32 indexCount)
+{
+    if( ChooseIndexType( vertexCount ) == VK_INDEX_TYPE_UINT32 )
+        return Create( pGeometryPool, vertices, vertexCount, indices, indexCount, VK_INDEX_TYPE_UINT32 );
+
+    // Narrow the indices to 16-bit to halve index bandwidth.
+    unsigned short* narrowIndices = new unsigned short[indexCount];
+    for( uint32 i=0; i<indexCount; i++ )
+    {
+        assert( indices[i] < vertexCount );
+        narrowIndices[i] = (unsigned short)indices[i];
+    }
+
+    bool created = Create( pGeometryPool, vertices, vertexCount, narrowIndices, indexCount, VK_INDEX_TYPE_UINT16 );
+
+    delete[] narrowIndices;
 
-    // Copy all data into buffers.
-    m_VertexBuffer->Create( pInterface, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertices, sizeof( VertexFormat ) * m_VertexCount );
-    m_IndexBuffer->Create( pInterface, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indices, sizeof( unsigned short ) * m_IndexCount );
+    return created;
 }
 
-void VulkanMesh::CreateCube(VulkanInterface* pInterface)
+bool VulkanMesh::Create(VulkanGeometryPool* pGeometryPool, const void* vertices, uint32 vertexCount, const void* indices, uint32 indexCount, VkIndexType indexType)
+{
+    assert( m_pGeometryPool == nullptr );
+    assert( pGeometryPool != nullptr );
+    assert( indexType == VK_INDEX_TYPE_UINT32 || vertexCount <= 65536 );
+
+    m_VertexCount = vertexCount;
+    m_IndexCount = indexCount;
+    m_IndexType = indexType;
+
+    m_QuantizationCenter.Set( 0, 0, 0 );
+    m_QuantizationExtents.Set( 1, 1, 1 );
+
+    m_LODs[0].m_FirstIndex = 0;
+    m_LODs[0].m_IndexCount = indexCount;
+    m_LODs[0].m_Error = 0;
+    m_LODCount = 1;
+
+    // Copy all data into the shared pool buffers.
+    if( pGeometryPool->Allocate( vertices, vertexCount, indices, indexCount, indexType, &m_VertexOffset, &m_FirstIndex, &m_UploadSerial ) == false )
+        return false;
+
+    m_pGeometryPool = pGeometryPool;
+    return true;
+}
+
+bool VulkanMesh::CreateCube(VulkanInterface* pInterface)
 {
     // Copy cube verts into a buffer.
     m_VertexCount = 24;
@@ -86,14 +159,148 @@ void VulkanMesh::CreateCube(VulkanInterface* pInterface)
         20,21,22,20,22,23,
     };
 
-    Create( pInterface, vertices, m_VertexCount, indices, m_IndexCount );
+    if( Create( pInterface, vertices, m_VertexCount, indices, m_IndexCount ) == false )
+        return false;
+
+    SetBounds( Vector3( 0, 0, 0 ), sqrtf( 3.0f ) );
+    return true;
+}
+
+bool VulkanMesh::CreateFromFile(VulkanInterface* pInterface, const char* filename)
+{
+    MeshFile file;
+    if( file.Open( filename ) == false )
+        return false;
+
+    return Create( pInterface, &file );
+}
+
+bool VulkanMesh::Create(VulkanInterface* pInterface, MeshFile* pFile)
+{
+    // Vertices are copied as stored, so the file must already be in the pipeline's layout.
+    VertexLayout fileLayout;
+    pFile->GetVertexLayout( &fileLayout );
+    if( fileLayout.Matches( pInterface->GetVertexLayout() ) == false )
+        return false;
+
+    const MeshFileHeader* pHeader = pFile->GetHeader();
+
+    // Copy straight from the mapped file into the pool.
+    if( Create( pInterface->GetGeometryPool(), pFile->GetVertexData(), pHeader->m_VertexCount, pFile->GetIndexData(), pHeader->m_IndexCount, pFile->GetIndexType() ) == false )
+        return false;
+
+    SetLODs( pHeader->m_LODs, pHeader->m_LODCount );
+    SetBounds( Vector3( pHeader->m_BoundingCenter[0], pHeader->m_BoundingCenter[1], pHeader->m_BoundingCenter[2] ), pHeader->m_BoundingRadius );
+
+    if( fileLayout.GetFormat( VertexAttribute_Position ) == VertexAttributeFormat_SNorm16x4 )
+    {
+        SetQuantization( Vector3( pHeader->m_QuantizationCenter[0], pHeader->m_QuantizationCenter[1], pHeader->m_QuantizationCenter[2] ),
+                         Vector3( pHeader->m_QuantizationExtents[0], pHeader->m_QuantizationExtents[1], pHeader->m_QuantizationExtents[2] ) );
+    }
+
+    return true;
+}
+
+bool VulkanMesh::IsResident()
+{
+    return m_pGeometryPool->GetInterface()->GetTransferQueue()->IsComplete( m_UploadSerial );
 }
 
 void VulkanMesh::Destroy()
 {
-    delete m_VertexBuffer;
-    delete m_IndexBuffer;
+    m_pGeometryPool->Free( m_VertexOffset, m_VertexCount, m_FirstIndex, m_IndexCount, m_IndexType );
+
+    m_pGeometryPool = nullptr;
+}
+
+void VulkanMesh::SetLODs(const MeshLOD* pLODs, uint32 lodCount)
+{
+    assert( lodCount > 0 && lodCount <= MAX_MESH_LODS );
+
+    for( uint32 i=0; i<lodCount; i++ )
+    {
+        assert( pLODs[i].m_FirstIndex + pLODs[i].m_IndexCount <= m_IndexCount );
+        m_LODs[i] = pLODs[i];
+    }
+    m_LODCount = lodCount;
+}
+
+uint32 VulkanMesh::SelectLOD(const MyMatrix& world, const MyMatrix& view, const MyMatrix& proj, float viewportHeight, float maxPixelError)
+{
+    if( m_LODCount == 1 )
+        return 0;
+
+    MyMatrix worldMatrix = world;
+    Vector3 scale = worldMatrix.GetScale();
+    float maxScale = scale.x > scale.y ? (scale.x > scale.z ? scale.x : scale.z) : (scale.y > scale.z ? scale.y : scale.z);
+
+    // Distance from the camera to the nearest point of the bounding sphere.
+    Vector3 viewCenter = (view * world) * m_BoundingCenter;
+    float distance = viewCenter.Length() - m_BoundingRadius * maxScale;
+    if( distance <= 0 )
+        return 0;
+
+    // Projected size of one object space unit at that distance.
+    // The y scale of the projection is negated for Vulkan's clip space, so use its magnitude.
+    float pixelsPerUnit = fabsf( proj.m22 ) * viewportHeight * 0.5f / distance * maxScale;
+
+    for( uint32 lod=m_LODCount-1; lod>0; lod-- )
+    {
+        if( m_LODs[lod].m_Error * pixelsPerUnit <= maxPixelError )
+            return lod;
+    }
+
+    return 0;
+}
+
+void VulkanMesh::GetDrawCommand(VkDrawIndexedIndirectCommand* pCommand, uint32 instanceCount, uint32 lod)
+{
+    assert( lod < m_LODCount );
+
+    pCommand->indexCount = m_LODs[lod].m_IndexCount;
+    pCommand->instanceCount = instanceCount;
+    pCommand->firstIndex = m_FirstIndex + m_LODs[lod].m_FirstIndex;
+    pCommand->vertexOffset = m_VertexOffset;
+    pCommand->firstInstance = 0;
+}
+
+void VulkanMesh::GetDrawConstants(PushConstants_Draw* pConstants)
+{
+    pConstants->m_QuantizationScale = Vector4( m_QuantizationExtents, 0 );
+    pConstants->m_QuantizationOffset = Vector4( m_QuantizationCenter, 0 );
+}
+
+void VulkanMesh::CalculateBoundingSphere(const void* vertices, uint32 vertexCount, uint32 vertexStride, uint32 positionOffset, Vector3* pCenter, float* pRadius)
+{
+    if( vertexCount == 0 )
+    {
+        pCenter->Set( 0, 0, 0 );
+        *pRadius = 0;
+        return;
+    }
+
+    // Sphere around the center of the axis aligned bounds, not minimal but cheap and stable.
+    const float* pFirst = (const float*)((const char*)vertices + positionOffset);
+    Vector3 minimum( pFirst[0], pFirst[1], pFirst[2] );
+    Vector3 maximum = minimum;
+    for( uint32 v=1; v<vertexCount; v++ )
+    {
+        const float* pPosition = (const float*)((const char*)vertices + v * vertexStride + positionOffset);
+        for( int axis=0; axis<3; axis++ )
+        {
+            DecreaseIfLower( minimum[axis], pPosition[axis] );
+            IncreaseIfBigger( maximum[axis], pPosition[axis] );
+        }
+    }
+
+    Vector3 center = (minimum + maximum) * 0.5f;
+    float radiusSquared = 0;
+    for( uint32 v=0; v<vertexCount; v++ )
+    {
+        const float* pPosition = (const float*)((const char*)vertices + v * vertexStride + positionOffset);
+        IncreaseIfBigger( radiusSquared, (Vector3( pPosition[0], pPosition[1], pPosition[2] ) - center).LengthSquared() );
+    }
 
-    m_VertexBuffer = nullptr;
-    m_IndexBuffer = nullptr;
+    *pCenter = center;
+    *pRadius = sqrtf( radiusSquared );
 }
@@ -11,33 +11,100 @@
 #define __VulkanMesh_H__
 
 #include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+#include "Math/Vector.h"
+#include "Mesh/MeshSimplifier.h"
 
 class VulkanInterface;
-class VulkanBuffer;
+class VulkanGeometryPool;
+class VulkanTexture;
+class MyMatrix;
+class MeshFile;
+struct PushConstants_Draw;
 
 class VulkanMesh
 {
     friend class VulkanInterface;
 
 protected:
-    VulkanBuffer* m_VertexBuffer;
-    VulkanBuffer* m_IndexBuffer;
+    VulkanGeometryPool* m_pGeometryPool;
+    int32 m_VertexOffset;
+    uint32 m_FirstIndex;
+    VkIndexType m_IndexType;
 
     uint32 m_VertexCount;
     uint32 m_IndexCount;
 
+    uint64 m_UploadSerial; // See VulkanTransferQueue::IsComplete.
+
+    // Index ranges are relative to m_FirstIndex, LOD 0 covers the whole index list unless SetLODs is called.
+    MeshLOD m_LODs[MAX_MESH_LODS];
+    uint32 m_LODCount;
+
+    Vector3 m_BoundingCenter;
+    float m_BoundingRadius;
+
+    // SNorm16 positions are stored relative to these, see VertexLayout::PackVertices.
+    Vector3 m_QuantizationCenter;
+    Vector3 m_QuantizationExtents;
+
+    VulkanTexture* m_pTexture; // Not owned, the interface's default texture is used if null.
+
 public:
     VulkanMesh();
     virtual ~VulkanMesh();
 
-    void Create(VulkanInterface* pInterface, const void* vertices, uint32 vertexCount, const void* indices, uint32 indexCount);
-    void CreateCube(VulkanInterface* pInterface);
+    // 32-bit indices are narrowed to 16-bit if the vertex count allows it.
+    // These fail if the geometry pool has no room left, the mesh is then left uncreated and must not be drawn or destroyed.
+    bool Create(VulkanInterface* pInterface, const void* vertices, uint32 vertexCount, const unsigned short* indices, uint32 indexCount);
+    bool Create(VulkanInterface* pInterface, const void* vertices, uint32 vertexCount, const uint32* indices, uint32 indexCount);
+    bool Create(VulkanGeometryPool* pGeometryPool, const void* vertices, uint32 vertexCount, const uint32* indices, uint32 indexCount);
+    bool Create(VulkanGeometryPool* pGeometryPool, const void* vertices, uint32 vertexCount, const void* indices, uint32 indexCount, VkIndexType indexType);
+    bool CreateCube(VulkanInterface* pInterface);
+    // Loads a mesh file, see Mesh/MeshFile.h.  Also fails if the file's vertex layout doesn't match the interface's.
+    bool CreateFromFile(VulkanInterface* pInterface, const char* filename);
+    bool Create(VulkanInterface* pInterface, MeshFile* pFile);
     void Destroy();
 
-    VulkanBuffer* GetVertexBuffer() { return m_VertexBuffer; }
-    VulkanBuffer* GetIndexBuffer() { return m_IndexBuffer; }
+    VulkanGeometryPool* GetGeometryPool() { return m_pGeometryPool; }
+    int32 GetVertexOffset() { return m_VertexOffset; }
+    uint32 GetFirstIndex() { return m_FirstIndex; }
+    VkIndexType GetIndexType() { return m_IndexType; }
     uint32 GetVertexCount() { return m_VertexCount; }
     uint32 GetIndexCount() { return m_IndexCount; }
+
+    // False until the geometry has finished uploading, the mesh can't be drawn before that.
+    bool IsResident();
+
+    // LODs, as generated by MeshSimplifier::GenerateLODs, index ranges must be inside the index list passed to Create.
+    void SetLODs(const MeshLOD* pLODs, uint32 lodCount);
+    uint32 GetLODCount() { return m_LODCount; }
+    const MeshLOD& GetLOD(uint32 lod) { return m_LODs[lod]; }
+    uint32 GetLODTriangleCount(uint32 lod) { return m_LODs[lod].m_IndexCount / 3; }
+
+    // Only sampled if the interface's vertex layout has UVs.  Meshes sharing a texture are drawn together.
+    void SetTexture(VulkanTexture* pTexture) { m_pTexture = pTexture; }
+    VulkanTexture* GetTexture() { return m_pTexture; }
+
+    void SetBounds(Vector3 center, float radius) { m_BoundingCenter = center; m_BoundingRadius = radius; }
+    Vector3 GetBoundingCenter() { return m_BoundingCenter; }
+    float GetBoundingRadius() { return m_BoundingRadius; }
+
+    // The vertex shader scales positions by the extents and adds the center.
+    // Create resets these to a center of 0 and extents of 1, which leaves unquantized positions as they are.
+    void SetQuantization(Vector3 center, Vector3 extents) { m_QuantizationCenter = center; m_QuantizationExtents = extents; }
+    Vector3 GetQuantizationCenter() { return m_QuantizationCenter; }
+    Vector3 GetQuantizationExtents() { return m_QuantizationExtents; }
+
+    // Picks the coarsest LOD whose simplification error projects to at most maxPixelError pixels on screen.
+    uint32 SelectLOD(const MyMatrix& world, const MyMatrix& view, const MyMatrix& proj, float viewportHeight, float maxPixelError);
+
+    // Fill in a draw command for this mesh, for use with vkCmdDrawIndexedIndirect.
+    void GetDrawCommand(VkDrawIndexedIndirectCommand* pCommand, uint32 instanceCount = 1, uint32 lod = 0);
+    void GetDrawConstants(PushConstants_Draw* pConstants);
+
+    static VkIndexType ChooseIndexType(uint32 vertexCount);
+    static void CalculateBoundingSphere(const void* vertices, uint32 vertexCount, uint32 vertexStride, uint32 positionOffset, Vector3* pCenter, float* pRadius);
 };
 
 #endif //__VulkanMesh_H__
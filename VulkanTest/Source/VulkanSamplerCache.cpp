@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+
+#include <assert.h>
+
+#include "vulkan/vulkan.h"
+
+#include "VulkanDeletionQueue.h"
+#include "VulkanInterface.h"
+#include "VulkanSamplerCache.h"
+
+VulkanSamplerCache::VulkanSamplerCache()
+{
+    m_pInterface = nullptr;
+
+    m_EntryCount = 0;
+    m_MaxAnisotropy = 1.0f;
+
+    m_RequestCount = 0;
+}
+
+VulkanSamplerCache::~VulkanSamplerCache()
+{
+    assert( m_EntryCount == 0 );
+}
+
+void VulkanSamplerCache::Create(VulkanInterface* pInterface)
+{
+    assert( pInterface != nullptr );
+
+    m_pInterface = pInterface;
+
+    // The interface only enables the feature if the device has it.
+    if( m_pInterface->GetDeviceFeatures().samplerAnisotropy )
+        m_MaxAnisotropy = m_pInterface->GetDeviceProperties().limits.maxSamplerAnisotropy;
+}
+
+void VulkanSamplerCache::Destroy()
+{
+    // Textures using these are gone, but frames in flight may still sample with them.
+    for( uint32 i=0; i<m_EntryCount; i++ )
+    {
+        m_pInterface->GetDeletionQueue()->Defer( VK_OBJECT_TYPE_SAMPLER, (uint64)m_Entries[i].m_Sampler );
+    }
+
+    m_EntryCount = 0;
+    m_MaxAnisotropy = 1.0f;
+    m_pInterface = nullptr;
+}
+
+SamplerDesc VulkanSamplerCache::GetDefaultDesc()
+{
+    SamplerDesc desc;
+    desc.m_Filter = VK_FILTER_LINEAR;
+    desc.m_MipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    desc.m_AddressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    desc.m_MaxAnisotropy = 16.0f;
+
+    return desc;
+}
+
+VkSampler VulkanSamplerCache::GetSampler(const SamplerDesc& desc)
+{
+    assert( m_pInterface != nullptr );
+
+    m_RequestCount++;
+
+    // Clamp first, so asking for 16x on an 8x device finds the 8x sampler.
+    SamplerDesc clampedDesc = desc;
+    if( clampedDesc.m_MaxAnisotropy > m_MaxAnisotropy )
+        clampedDesc.m_MaxAnisotropy = m_MaxAnisotropy;
+    if( clampedDesc.m_MaxAnisotropy < 1.0f )
+        clampedDesc.m_MaxAnisotropy = 1.0f;
+
+    for( uint32 i=0; i<m_EntryCount; i++ )
+    {
+        const SamplerDesc& cached = m_Entries[i].m_Desc;
+
+        if( cached.m_Filter == clampedDesc.m_Filter &&
+            cached.m_MipmapMode == clampedDesc.m_MipmapMode &&
+            cached.m_AddressMode == clampedDesc.m_AddressMode &&
+            cached.m_MaxAnisotropy == clampedDesc.m_MaxAnisotropy )
+        {
+            return m_Entries[i].m_Sampler;
+        }
+    }
+
+    assert( m_EntryCount < MAX_CACHED_SAMPLERS );
+
+    VkSamplerCreateInfo samplerCreateInfo = {};
+    samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerCreateInfo.pNext = nullptr;
+    samplerCreateInfo.flags = 0;
+    samplerCreateInfo.magFilter = clampedDesc.m_Filter;
+    samplerCreateInfo.minFilter = clampedDesc.m_Filter;
+    samplerCreateInfo.mipmapMode = clampedDesc.m_MipmapMode;
+    samplerCreateInfo.addressModeU = clampedDesc.m_AddressMode;
+    samplerCreateInfo.addressModeV = clampedDesc.m_AddressMode;
+    samplerCreateInfo.addressModeW = clampedDesc.m_AddressMode;
+    samplerCreateInfo.mipLodBias = 0.0f;
+    samplerCreateInfo.anisotropyEnable = clampedDesc.m_MaxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+    samplerCreateInfo.maxAnisotropy = clampedDesc.m_MaxAnisotropy;
+    samplerCreateInfo.compareEnable = VK_FALSE;
+    samplerCreateInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerCreateInfo.minLod = 0.0f;
+    samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+    samplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
+
+    Entry* pEntry = &m_Entries[m_EntryCount++];
+    pEntry->m_Desc = clampedDesc;
+
+    VkResult result = vkCreateSampler( m_pInterface->GetDevice(), &samplerCreateInfo, nullptr, &pEntry->m_Sampler );
+    assert( result == VK_SUCCESS );
+
+    return pEntry->m_Sampler;
+}
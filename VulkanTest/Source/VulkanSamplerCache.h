@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+
+#ifndef __VulkanSamplerCache_H__
+#define __VulkanSamplerCache_H__
+
+#include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+
+class VulkanInterface;
+
+static const int MAX_CACHED_SAMPLERS = 64;
+
+// Filtering and addressing for a texture, textures with the same description share one VkSampler.
+struct SamplerDesc
+{
+    VkFilter m_Filter;                  // Both magnification and minification.
+    VkSamplerMipmapMode m_MipmapMode;
+    VkSamplerAddressMode m_AddressMode; // U, V and W.
+    float m_MaxAnisotropy;              // 1 turns anisotropic filtering off.
+};
+
+// Creates each distinct sampler once and hands out the same handle after that.
+// Descriptions are clamped to what the device supports before they're compared, so requests that end up
+// identical share a sampler.  Samplers live until Destroy, there are only ever a handful.
+class VulkanSamplerCache
+{
+protected:
+    struct Entry
+    {
+        SamplerDesc m_Desc;
+        VkSampler m_Sampler;
+    };
+
+    VulkanInterface* m_pInterface;
+
+    Entry m_Entries[MAX_CACHED_SAMPLERS];
+    uint32 m_EntryCount;
+
+    float m_MaxAnisotropy; // 1 if the device doesn't support anisotropic filtering.
+
+    uint32 m_RequestCount;
+
+public:
+    VulkanSamplerCache();
+    virtual ~VulkanSamplerCache();
+
+    void Create(VulkanInterface* pInterface);
+    void Destroy();
+
+    VkSampler GetSampler(const SamplerDesc& desc);
+
+    // Trilinear, repeating and as anisotropic as the device allows.  Keeps minified textures sharp without aliasing.
+    static SamplerDesc GetDefaultDesc();
+
+    uint32 GetSamplerCount() { return m_EntryCount; }
+    uint32 GetRequestCount() { return m_RequestCount; }
+};
+
+#endif //__VulkanSamplerCache_H__
@@ -10,9 +10,9 @@
 #include <assert.h>
 #include <stdio.h>
 
-#define VK_USE_PLATFORM_WIN32_KHR
 #include "vulkan/vulkan.h"
 
+#include "Platform.h"
 #include "VulkanShader.h"
 
 char* LoadCompleteFile(const char* filename, long* length)
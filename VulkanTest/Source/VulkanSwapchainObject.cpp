@@ -25,12 +25,29 @@ void SwapchainStuff::NullEverything()
 {
     m_Images = VK_NULL_HANDLE;
     m_ImageViews = VK_NULL_HANDLE;
-    m_CommandBuffers = VK_NULL_HANDLE;
     m_Framebuffers = VK_NULL_HANDLE;
-    m_UBO_Matrices = nullptr;
-    m_DescriptorSets = VK_NULL_HANDLE;
+    m_DrawCompleteSemaphore = VK_NULL_HANDLE;
 }
 
 SwapchainStuff::~SwapchainStuff()
 {
 }
+
+FrameStuff::FrameStuff()
+{
+    NullEverything();
+}
+
+void FrameStuff::NullEverything()
+{
+    m_CommandBuffer = VK_NULL_HANDLE;
+    m_UBO_Matrices = nullptr;
+    m_DescriptorSet = VK_NULL_HANDLE;
+    m_IndirectCommands = nullptr;
+    m_ImageAcquiredSemaphore = VK_NULL_HANDLE;
+    m_LastSubmitValue = 0;
+}
+
+FrameStuff::~FrameStuff()
+{
+}
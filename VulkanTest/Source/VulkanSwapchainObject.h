@@ -11,10 +11,10 @@
 #define __VulkanSwapchainObject_H__
 
 #include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
 class VulkanBuffer;
 
-static const int MAX_SWAP_IMAGES = 3;
-
+// Resources tied to one swapchain image.  Sized from vkGetSwapchainImagesKHR and rebuilt with the swapchain.
 class SwapchainStuff
 {
     friend class VulkanInterface;
@@ -22,10 +22,8 @@ class SwapchainStuff
 protected:
     VkImage m_Images;
     VkImageView m_ImageViews;
-    VkCommandBuffer m_CommandBuffers;
     VkFramebuffer m_Framebuffers;
-    VulkanBuffer* m_UBO_Matrices;
-    VkDescriptorSet m_DescriptorSets;
+    VkSemaphore m_DrawCompleteSemaphore; // Waited on by the present of this image, so it's reused only once the image comes back.
 
 protected:
     void NullEverything();
@@ -35,4 +33,26 @@ public:
     ~SwapchainStuff();
 };
 
+// Resources the CPU writes while building a frame.  Each is reused every m_FramesInFlight frames,
+// independent of how many images the swapchain has.
+class FrameStuff
+{
+    friend class VulkanInterface;
+
+protected:
+    VkCommandBuffer m_CommandBuffer; // Recorded every frame for whichever image was acquired.
+    VulkanBuffer* m_UBO_Matrices;
+    VkDescriptorSet m_DescriptorSet;
+    VulkanBuffer* m_IndirectCommands; // One VkDrawIndexedIndirectCommand per mesh, rewritten each frame with the selected LOD.
+    VkSemaphore m_ImageAcquiredSemaphore;
+    uint64 m_LastSubmitValue; // Graphics timeline value of the last frame that used these.
+
+protected:
+    void NullEverything();
+
+public:
+    FrameStuff();
+    ~FrameStuff();
+};
+
 #endif //__VulkanSwapchainObject_H__
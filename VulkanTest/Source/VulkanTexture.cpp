@@ -0,0 +1,245 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+
+#include <assert.h>
+
+#include "vulkan/vulkan.h"
+
+#include "VulkanDeletionQueue.h"
+#include "VulkanInterface.h"
+#include "VulkanTexture.h"
+#include "VulkanTexturePool.h"
+#include "VulkanTransferQueue.h"
+
+VulkanTexture::VulkanTexture()
+{
+    m_pInterface = nullptr;
+
+    m_Image = VK_NULL_HANDLE;
+    m_ImageView = VK_NULL_HANDLE;
+    m_Sampler = VK_NULL_HANDLE;
+    m_DescriptorSet = VK_NULL_HANDLE;
+
+    m_Format = VK_FORMAT_UNDEFINED;
+    m_Width = 0;
+    m_Height = 0;
+    m_MipLevels = 0;
+
+    m_FirstPage = 0;
+    m_PageCount = 0;
+
+    m_UploadSerial = 0;
+}
+
+VulkanTexture::~VulkanTexture()
+{
+    assert( m_Image == VK_NULL_HANDLE );
+}
+
+uint32 VulkanTexture::GetFullMipCount(uint32 width, uint32 height)
+{
+    uint32 largest = width > height ? width : height;
+
+    uint32 levels = 1;
+    while( largest > 1 )
+    {
+        largest /= 2;
+        levels++;
+    }
+
+    return levels;
+}
+
+uint32 VulkanTexture::GetTexelSize(VkFormat format)
+{
+    switch( format )
+    {
+    case VK_FORMAT_R8_UNORM:            return 1;
+    case VK_FORMAT_R8G8_UNORM:          return 2;
+    case VK_FORMAT_R8G8B8A8_UNORM:      return 4;
+    case VK_FORMAT_R8G8B8A8_SRGB:       return 4;
+    case VK_FORMAT_B8G8R8A8_UNORM:      return 4;
+    case VK_FORMAT_B8G8R8A8_SRGB:       return 4;
+    case VK_FORMAT_R16G16B16A16_SFLOAT: return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT: return 16;
+    default:                            return 0;
+    }
+}
+
+bool VulkanTexture::Create(VulkanInterface* pInterface, uint32 width, uint32 height, VkFormat format, const void* pPixels, bool generateMips, const SamplerDesc* pSamplerDesc)
+{
+    assert( m_Image == VK_NULL_HANDLE );
+    assert( pInterface != nullptr && pPixels != nullptr );
+    assert( width > 0 && height > 0 );
+    assert( GetTexelSize( format ) != 0 );
+
+    VkDevice device = pInterface->GetDevice();
+    VkResult result;
+
+    if( pInterface->GetTransferQueue()->CanUploadImage( width, height, GetTexelSize( format ) ) == false )
+        return false;
+
+    // Mips are blitted with linear filtering, not every format supports that.
+    uint32 mipLevels = 1;
+    if( generateMips )
+    {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties( pInterface->GetPhysicalDevice(), format, &formatProperties );
+
+        VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        if( (formatProperties.optimalTilingFeatures & required) == required )
+            mipLevels = GetFullMipCount( width, height );
+    }
+
+    // Create the image.
+    VkImageCreateInfo imageCreateInfo = {};
+    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCreateInfo.pNext = nullptr;
+    imageCreateInfo.flags = 0;
+    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageCreateInfo.format = format;
+    imageCreateInfo.extent.width = width;
+    imageCreateInfo.extent.height = height;
+    imageCreateInfo.extent.depth = 1;
+    imageCreateInfo.mipLevels = mipLevels;
+    imageCreateInfo.arrayLayers = 1;
+    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageCreateInfo.queueFamilyIndexCount = 0;
+    imageCreateInfo.pQueueFamilyIndices = nullptr;
+    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkImage image;
+    result = vkCreateImage( device, &imageCreateInfo, nullptr, &image );
+    assert( result == VK_SUCCESS );
+
+    // Bind it to pool memory, the image hasn't been used so it can go right away if the pool is full.
+    if( pInterface->GetTexturePool()->Allocate( image, &m_FirstPage, &m_PageCount ) == false )
+    {
+        vkDestroyImage( device, image, nullptr );
+        return false;
+    }
+
+    m_pInterface = pInterface;
+    m_Image = image;
+    m_Format = format;
+    m_Width = width;
+    m_Height = height;
+    m_MipLevels = mipLevels;
+
+    // Create the image view, covering every mip.
+    VkImageViewCreateInfo imageViewCreateInfo = {};
+    imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewCreateInfo.pNext = nullptr;
+    imageViewCreateInfo.flags = 0;
+    imageViewCreateInfo.image = m_Image;
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = format;
+    imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_R;
+    imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_G;
+    imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_B;
+    imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_A;
+    imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+    imageViewCreateInfo.subresourceRange.levelCount = mipLevels;
+    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+    result = vkCreateImageView( device, &imageViewCreateInfo, nullptr, &m_ImageView );
+    assert( result == VK_SUCCESS );
+
+    // Textures with the same filtering share a sampler.
+    VulkanSamplerCache* pSamplerCache = pInterface->GetSamplerCache();
+    m_Sampler = pSamplerCache->GetSampler( pSamplerDesc ? *pSamplerDesc : VulkanSamplerCache::GetDefaultDesc() );
+
+    // Allocate and fill in the descriptor set.
+    {
+        VkDescriptorSetLayout layout = pInterface->GetTextureDescriptorSetLayout();
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.pNext = nullptr;
+        allocInfo.descriptorPool = pInterface->GetTextureDescriptorPool();
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        // The descriptor pool has a fixed number of sets, past that fail like a full texture pool.
+        // Nothing has been uploaded yet, so the view and image can go right away.
+        result = vkAllocateDescriptorSets( device, &allocInfo, &m_DescriptorSet );
+        if( result != VK_SUCCESS )
+        {
+            vkDestroyImageView( device, m_ImageView, nullptr );
+            vkDestroyImage( device, m_Image, nullptr );
+            pInterface->GetTexturePool()->Free( m_FirstPage, m_PageCount );
+
+            m_Image = VK_NULL_HANDLE;
+            m_ImageView = VK_NULL_HANDLE;
+            m_Sampler = VK_NULL_HANDLE;
+            m_DescriptorSet = VK_NULL_HANDLE;
+            m_pInterface = nullptr;
+            return false;
+        }
+
+        VkDescriptorImageInfo imageInfo = {};
+        imageInfo.sampler = m_Sampler;
+        imageInfo.imageView = m_ImageView;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkWriteDescriptorSet descriptorWrite = {};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.pNext = nullptr;
+        descriptorWrite.dstSet = m_DescriptorSet;
+        descriptorWrite.dstBinding = 0;
+        descriptorWrite.dstArrayElement = 0;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrite.pImageInfo = &imageInfo;
+        descriptorWrite.pBufferInfo = nullptr;
+        descriptorWrite.pTexelBufferView = nullptr;
+
+        vkUpdateDescriptorSets( device, 1, &descriptorWrite, 0, nullptr );
+    }
+
+    // Upload mip 0, the transfer queue generates the rest.
+    m_UploadSerial = pInterface->GetTransferQueue()->UploadImage( m_Image, width, height, mipLevels, GetTexelSize( format ), pPixels );
+
+    return true;
+}
+
+bool VulkanTexture::CreateSolidColor(VulkanInterface* pInterface, unsigned char r, unsigned char g, unsigned char b, unsigned char a)
+{
+    unsigned char pixel[4] = { r, g, b, a };
+
+    return Create( pInterface, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, pixel, false );
+}
+
+void VulkanTexture::Destroy()
+{
+    // Frames in flight may still sample the texture, everything is released once they're done.
+    // The pages go last, so the image is gone before its memory is reused.
+    VulkanDeletionQueue* pDeletionQueue = m_pInterface->GetDeletionQueue();
+    pDeletionQueue->DeferDescriptorSet( m_DescriptorSet );
+    pDeletionQueue->DeferImageView( m_ImageView );
+    pDeletionQueue->DeferImage( m_Image );
+    m_pInterface->GetTexturePool()->Free( m_FirstPage, m_PageCount );
+
+    m_Image = VK_NULL_HANDLE;
+    m_ImageView = VK_NULL_HANDLE;
+    m_Sampler = VK_NULL_HANDLE;
+    m_DescriptorSet = VK_NULL_HANDLE;
+    m_pInterface = nullptr;
+}
+
+bool VulkanTexture::IsResident()
+{
+    return m_pInterface->GetTransferQueue()->IsComplete( m_UploadSerial );
+}
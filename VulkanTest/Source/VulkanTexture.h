@@ -0,0 +1,74 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+
+#ifndef __VulkanTexture_H__
+#define __VulkanTexture_H__
+
+#include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+#include "VulkanSamplerCache.h"
+
+class VulkanInterface;
+
+// A sampled 2D image with a full mip chain, placed in the interface's texture pool.
+// Only mip 0 is uploaded, the GPU blits the smaller levels from it, see VulkanTransferQueue::UploadImage.
+// Each texture owns the descriptor set meshes bind to sample it, set 1 in the textured shaders.
+class VulkanTexture
+{
+protected:
+    VulkanInterface* m_pInterface;
+
+    VkImage m_Image;
+    VkImageView m_ImageView;
+    VkSampler m_Sampler; // Owned by the sampler cache.
+    VkDescriptorSet m_DescriptorSet;
+
+    VkFormat m_Format;
+    uint32 m_Width;
+    uint32 m_Height;
+    uint32 m_MipLevels;
+
+    // Page range in the texture pool.
+    uint32 m_FirstPage;
+    uint32 m_PageCount;
+
+    uint64 m_UploadSerial; // See VulkanTransferQueue::IsComplete.
+
+public:
+    VulkanTexture();
+    virtual ~VulkanTexture();
+
+    // Pixels are tightly packed rows of mip 0.  Mips are skipped if generateMips is false or the format can't be
+    // blitted with linear filtering.  Uses the default sampler if pSamplerDesc is null.
+    // Fails if the texture pool or the texture descriptor pool is full, or if the transfer queue can't stage an image this size.
+    bool Create(VulkanInterface* pInterface, uint32 width, uint32 height, VkFormat format, const void* pPixels, bool generateMips = true, const SamplerDesc* pSamplerDesc = nullptr);
+    // 1x1 RGBA8, used for meshes without a texture.
+    bool CreateSolidColor(VulkanInterface* pInterface, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+    void Destroy();
+
+    // False until the pixels and mips have finished uploading, the texture can't be sampled before that.
+    bool IsResident();
+
+    VkImage GetImage() { return m_Image; }
+    VkImageView GetImageView() { return m_ImageView; }
+    VkSampler GetSampler() { return m_Sampler; }
+    VkDescriptorSet GetDescriptorSet() { return m_DescriptorSet; }
+    VkFormat GetFormat() { return m_Format; }
+    uint32 GetWidth() { return m_Width; }
+    uint32 GetHeight() { return m_Height; }
+    uint32 GetMipLevels() { return m_MipLevels; }
+
+    // Levels down to 1x1.
+    static uint32 GetFullMipCount(uint32 width, uint32 height);
+    // Bytes per texel of the uncompressed formats textures support, 0 for anything else.
+    static uint32 GetTexelSize(VkFormat format);
+};
+
+#endif //__VulkanTexture_H__
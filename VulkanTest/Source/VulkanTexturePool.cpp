@@ -0,0 +1,160 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+
+#include <assert.h>
+
+#include "vulkan/vulkan.h"
+
+#include "VulkanDeletionQueue.h"
+#include "VulkanInterface.h"
+#include "VulkanTexturePool.h"
+
+VulkanTexturePool::VulkanTexturePool()
+{
+    m_pInterface = nullptr;
+
+    m_Memory = VK_NULL_HANDLE;
+    m_MemoryTypeIndex = 0;
+    m_PageCount = 0;
+}
+
+VulkanTexturePool::~VulkanTexturePool()
+{
+    assert( m_Memory == VK_NULL_HANDLE );
+}
+
+void VulkanTexturePool::Create(VulkanInterface* pInterface, uint32 sizeInBytes)
+{
+    assert( m_Memory == VK_NULL_HANDLE );
+    assert( pInterface != nullptr );
+    assert( sizeInBytes >= TEXTURE_POOL_PAGE_SIZE );
+
+    m_pInterface = pInterface;
+    m_PageCount = sizeInBytes / TEXTURE_POOL_PAGE_SIZE;
+
+    VkDevice device = m_pInterface->GetDevice();
+    VkResult result;
+
+    // Optimally tiled color images all report the same memory types, so a throwaway image tells us which to use.
+    {
+        VkImageCreateInfo imageCreateInfo = {};
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.pNext = nullptr;
+        imageCreateInfo.flags = 0;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        imageCreateInfo.extent.width = 1;
+        imageCreateInfo.extent.height = 1;
+        imageCreateInfo.extent.depth = 1;
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.queueFamilyIndexCount = 0;
+        imageCreateInfo.pQueueFamilyIndices = nullptr;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkImage image;
+        result = vkCreateImage( device, &imageCreateInfo, nullptr, &image );
+        assert( result == VK_SUCCESS );
+
+        VkMemoryRequirements memoryRequirements;
+        vkGetImageMemoryRequirements( device, image, &memoryRequirements );
+
+        vkDestroyImage( device, image, nullptr );
+
+        m_MemoryTypeIndex = m_pInterface->FindMemoryType( memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT );
+    }
+
+    // Allocate the memory every texture will share.
+    {
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.pNext = nullptr;
+        allocInfo.allocationSize = (VkDeviceSize)m_PageCount * TEXTURE_POOL_PAGE_SIZE;
+        allocInfo.memoryTypeIndex = m_MemoryTypeIndex;
+
+        result = vkAllocateMemory( device, &allocInfo, nullptr, &m_Memory );
+        assert( result == VK_SUCCESS );
+
+        m_pInterface->TrackAllocation( allocInfo.allocationSize );
+        m_pInterface->SetObjectName( VK_OBJECT_TYPE_DEVICE_MEMORY, (uint64)m_Memory, "Texture Pool" );
+    }
+
+    m_Pages.Init( m_PageCount );
+}
+
+void VulkanTexturePool::Destroy()
+{
+    // Run any frees still waiting on the GPU while the pool is alive, and let the images go before their memory.
+    VulkanDeletionQueue* pDeletionQueue = m_pInterface->GetDeletionQueue();
+    pDeletionQueue->Flush();
+
+    pDeletionQueue->DeferMemory( m_Memory );
+    m_pInterface->TrackFree( (VkDeviceSize)m_PageCount * TEXTURE_POOL_PAGE_SIZE );
+
+    m_Memory = VK_NULL_HANDLE;
+    m_PageCount = 0;
+    m_pInterface = nullptr;
+}
+
+bool VulkanTexturePool::Allocate(VkImage image, uint32* pFirstPage, uint32* pPageCount)
+{
+    assert( m_Memory != VK_NULL_HANDLE );
+    assert( pFirstPage != nullptr && pPageCount != nullptr );
+
+    VkDevice device = m_pInterface->GetDevice();
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements( device, image, &memoryRequirements );
+
+    if( (memoryRequirements.memoryTypeBits & (1 << m_MemoryTypeIndex)) == 0 )
+        return false;
+
+    // Alignments are powers of two, pages cover anything up to the page size.  Larger ones over-allocate and skip ahead.
+    uint32 alignmentInPages = 1;
+    if( memoryRequirements.alignment > TEXTURE_POOL_PAGE_SIZE )
+        alignmentInPages = (uint32)( memoryRequirements.alignment / TEXTURE_POOL_PAGE_SIZE );
+
+    uint32 pageCount = (uint32)( (memoryRequirements.size + TEXTURE_POOL_PAGE_SIZE - 1) / TEXTURE_POOL_PAGE_SIZE ) + alignmentInPages - 1;
+
+    uint32 firstPage;
+    if( m_Pages.Allocate( pageCount, &firstPage ) == false )
+        return false;
+
+    uint32 alignedPage = (firstPage + alignmentInPages - 1) / alignmentInPages * alignmentInPages;
+
+    VkResult result = vkBindImageMemory( device, image, m_Memory, (VkDeviceSize)alignedPage * TEXTURE_POOL_PAGE_SIZE );
+    assert( result == VK_SUCCESS );
+
+    *pFirstPage = firstPage;
+    *pPageCount = pageCount;
+
+    return true;
+}
+
+void VulkanTexturePool::Free(uint32 firstPage, uint32 pageCount)
+{
+    // Frames in flight may still sample from these pages, so they only return to the allocator once those are done.
+    uint32 data[2];
+    data[0] = firstPage;
+    data[1] = pageCount;
+
+    m_pInterface->GetDeletionQueue()->DeferCallback( FreePagesCallback, this, data, 2 );
+}
+
+void VulkanTexturePool::FreePagesCallback(void* pContext, const uint32* pData)
+{
+    VulkanTexturePool* pPool = (VulkanTexturePool*)pContext;
+
+    pPool->m_Pages.Free( pData[0], pData[1] );
+}
@@ -0,0 +1,55 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+
+#ifndef __VulkanTexturePool_H__
+#define __VulkanTexturePool_H__
+
+#include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+#include "VulkanGeometryPool.h"
+
+class VulkanInterface;
+
+// Images are placed on whole pages, ranges of pages come from the same first-fit allocator the geometry pool uses.
+static const uint32 TEXTURE_POOL_PAGE_SIZE = 4096;
+
+// One large device local allocation shared by every texture, each image is bound to a range of pages inside it.
+// Drivers cap the number of allocations and each one is slow to make, so textures don't get their own.
+class VulkanTexturePool
+{
+protected:
+    VulkanInterface* m_pInterface;
+
+    VkDeviceMemory m_Memory;
+    uint32 m_MemoryTypeIndex;
+    uint32 m_PageCount;
+
+    GeometryPoolRangeAllocator m_Pages;
+
+protected:
+    static void FreePagesCallback(void* pContext, const uint32* pData);
+
+public:
+    VulkanTexturePool();
+    virtual ~VulkanTexturePool();
+
+    void Create(VulkanInterface* pInterface, uint32 sizeInBytes);
+    void Destroy();
+
+    // Binds pool memory to an optimally tiled image, returns false if the pool is full.
+    // The page range is what Free takes back.
+    bool Allocate(VkImage image, uint32* pFirstPage, uint32* pPageCount);
+    // The pages are reused once the GPU is done with them, see VulkanDeletionQueue.
+    void Free(uint32 firstPage, uint32 pageCount);
+
+    uint32 GetPageCount() { return m_PageCount; }
+};
+
+#endif //__VulkanTexturePool_H__
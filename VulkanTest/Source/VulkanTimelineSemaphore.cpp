@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+
+#include "vulkan/vulkan.h"
+
+#include "VulkanInterface.h"
+#include "VulkanTimelineSemaphore.h"
+
+VulkanTimelineSemaphore::VulkanTimelineSemaphore()
+{
+    m_pInterface = nullptr;
+    m_Semaphore = VK_NULL_HANDLE;
+
+    m_LastSignalValue = 0;
+    m_CompletedValue = 0;
+}
+
+VulkanTimelineSemaphore::~VulkanTimelineSemaphore()
+{
+    assert( m_Semaphore == VK_NULL_HANDLE );
+}
+
+void VulkanTimelineSemaphore::Create(VulkanInterface* pInterface)
+{
+    assert( m_Semaphore == VK_NULL_HANDLE );
+    assert( pInterface != nullptr );
+
+    m_pInterface = pInterface;
+
+    VkSemaphoreTypeCreateInfo typeInfo = {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.pNext = nullptr;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    semaphoreInfo.flags = 0;
+
+    VkResult result = vkCreateSemaphore( m_pInterface->GetDevice(), &semaphoreInfo, nullptr, &m_Semaphore );
+    assert( result == VK_SUCCESS );
+
+    m_LastSignalValue = 0;
+    m_CompletedValue = 0;
+}
+
+void VulkanTimelineSemaphore::Destroy()
+{
+    vkDestroySemaphore( m_pInterface->GetDevice(), m_Semaphore, nullptr );
+
+    m_Semaphore = VK_NULL_HANDLE;
+    m_pInterface = nullptr;
+}
+
+uint64 VulkanTimelineSemaphore::GetCompletedValue()
+{
+    uint64_t value;
+    VkResult result = m_pInterface->m_pfnGetSemaphoreCounterValue( m_pInterface->GetDevice(), m_Semaphore, &value );
+    assert( result == VK_SUCCESS );
+
+    if( value > m_CompletedValue )
+        m_CompletedValue = value;
+
+    return m_CompletedValue;
+}
+
+bool VulkanTimelineSemaphore::IsComplete(uint64 value)
+{
+    // Only ask the driver if the cached value isn't far enough along.
+    if( value <= m_CompletedValue )
+        return true;
+
+    return value <= GetCompletedValue();
+}
+
+bool VulkanTimelineSemaphore::Wait(uint64 value, uint64 timeoutNanoseconds)
+{
+    assert( value <= m_LastSignalValue );
+
+    if( IsComplete( value ) )
+        return true;
+
+    uint64_t waitValue = value;
+
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.pNext = nullptr;
+    waitInfo.flags = 0;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_Semaphore;
+    waitInfo.pValues = &waitValue;
+
+    VkResult result = m_pInterface->m_pfnWaitSemaphores( m_pInterface->GetDevice(), &waitInfo, timeoutNanoseconds );
+    assert( result == VK_SUCCESS || result == VK_TIMEOUT );
+
+    if( result != VK_SUCCESS )
+        return false;
+
+    if( value > m_CompletedValue )
+        m_CompletedValue = value;
+
+    return true;
+}
@@ -0,0 +1,52 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __VulkanTimelineSemaphore_H__
+#define __VulkanTimelineSemaphore_H__
+
+#include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+
+class VulkanInterface;
+
+// A timeline semaphore used as a GPU progress counter for one queue.
+// Every submission to the queue signals the next value, so anything tagged with a value is finished
+// once the counter reaches it.  Only one thread submits, so values are handed out without locking.
+class VulkanTimelineSemaphore
+{
+protected:
+    VulkanInterface* m_pInterface;
+    VkSemaphore m_Semaphore;
+
+    uint64 m_LastSignalValue;   // Last value handed out by Next().
+    uint64 m_CompletedValue;    // Last value read back from the GPU, only ever increases.
+
+public:
+    VulkanTimelineSemaphore();
+    virtual ~VulkanTimelineSemaphore();
+
+    void Create(VulkanInterface* pInterface);
+    void Destroy();
+
+    // Returns the value the next submission should signal.
+    uint64 Next() { return ++m_LastSignalValue; }
+
+    uint64 GetLastSignalValue() { return m_LastSignalValue; }
+    uint64 GetCompletedValue();
+
+    bool IsComplete(uint64 value);
+
+    // Blocks until the GPU reaches value, returns false on timeout.
+    bool Wait(uint64 value, uint64 timeoutNanoseconds = UINT64_MAX);
+    void WaitIdle() { Wait( m_LastSignalValue ); }
+
+    VkSemaphore GetSemaphore() { return m_Semaphore; }
+};
+
+#endif //__VulkanTimelineSemaphore_H__
@@ -0,0 +1,758 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+
+#include "CPUProfiler.h"
+#include "VulkanBuffer.h"
+#include "VulkanInterface.h"
+#include "VulkanTransferQueue.h"
+
+// vkCmdCopyBuffer has no alignment requirements, but aligned copies are faster on most hardware.
+static const uint64 STAGING_ALIGNMENT = 16;
+
+VulkanTransferQueue::VulkanTransferQueue()
+{
+    NullEverything();
+}
+
+VulkanTransferQueue::~VulkanTransferQueue()
+{
+    assert( m_StagingBuffer == nullptr );
+}
+
+void VulkanTransferQueue::NullEverything()
+{
+    m_pInterface = nullptr;
+    m_Device = VK_NULL_HANDLE;
+
+    m_TransferQueue = VK_NULL_HANDLE;
+    m_TransferQueueFamilyIndex = UINT_MAX;
+    m_GraphicsQueue = VK_NULL_HANDLE;
+    m_GraphicsQueueFamilyIndex = UINT_MAX;
+    m_ImageRowGranularity = 1;
+
+    m_pGraphicsTimeline = nullptr;
+
+    m_TransferCommandPool = VK_NULL_HANDLE;
+    m_AcquireCommandPool = VK_NULL_HANDLE;
+
+    m_StagingBuffer = nullptr;
+    m_pStagingData = nullptr;
+    m_StagingSize = 0;
+    m_StagingHead = 0;
+    m_StagingTail = 0;
+
+    for( uint32 i=0; i<MAX_TRANSFER_BATCHES; i++ )
+    {
+        m_Batches[i].m_CommandBuffer = VK_NULL_HANDLE;
+        m_Batches[i].m_AcquireCommandBuffer = VK_NULL_HANDLE;
+        m_Batches[i].m_BarrierCount = 0;
+        m_Batches[i].m_DestinationStages = 0;
+        m_Batches[i].m_ImageCount = 0;
+        m_Batches[i].m_Serial = 0;
+        m_Batches[i].m_AcquireValue = 0;
+        m_Batches[i].m_StagingEnd = 0;
+        m_Batches[i].m_State = BatchState_Free;
+    }
+    m_OldestBatch = 0;
+    m_BatchesInUse = 0;
+    m_pRecordingBatch = nullptr;
+
+    // Timeline values start at 1, so anything created without an upload counts as complete.
+    m_CompletedSerial = 0;
+    m_RetiredSerial = 0;
+
+    m_TotalBytesUploaded = 0;
+}
+
+void VulkanTransferQueue::Create(VulkanInterface* pInterface, VkQueue transferQueue, uint32 transferQueueFamilyIndex, VkQueue graphicsQueue, uint32 graphicsQueueFamilyIndex,
+                                 VulkanTimelineSemaphore* pGraphicsTimeline, uint32 stagingSizeInBytes)
+{
+    assert( m_StagingBuffer == nullptr );
+    assert( pInterface != nullptr && pGraphicsTimeline != nullptr );
+    assert( stagingSizeInBytes >= STAGING_ALIGNMENT * 2 );
+
+    m_pInterface = pInterface;
+    m_Device = pInterface->GetDevice();
+
+    m_TransferQueue = transferQueue;
+    m_TransferQueueFamilyIndex = transferQueueFamilyIndex;
+    m_GraphicsQueue = graphicsQueue;
+    m_GraphicsQueueFamilyIndex = graphicsQueueFamilyIndex;
+    m_pGraphicsTimeline = pGraphicsTimeline;
+
+    // Image copies on the transfer family have to line up with its granularity, see UploadImage.
+    // Graphics and compute families are always 1x1x1, dedicated transfer families may not be.
+    {
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties( pInterface->GetPhysicalDevice(), &queueFamilyCount, nullptr );
+        if( queueFamilyCount > 128 )
+            queueFamilyCount = 128;
+        VkQueueFamilyProperties queueFamilyProperties[128];
+        vkGetPhysicalDeviceQueueFamilyProperties( pInterface->GetPhysicalDevice(), &queueFamilyCount, queueFamilyProperties );
+
+        assert( m_TransferQueueFamilyIndex < queueFamilyCount );
+        m_ImageRowGranularity = queueFamilyProperties[m_TransferQueueFamilyIndex].minImageTransferGranularity.height;
+    }
+
+    m_TransferTimeline.Create( pInterface );
+
+    VkResult result;
+
+    // Create the staging ring, it stays mapped for its whole life.
+    m_StagingSize = stagingSizeInBytes;
+    m_StagingBuffer = new VulkanBuffer();
+    m_StagingBuffer->Create( pInterface, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, nullptr, stagingSizeInBytes );
+    m_pStagingData = (unsigned char*)m_StagingBuffer->Map();
+
+    // Create command pools, batch command buffers are reset individually each time they're reused.
+    VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.pNext = nullptr;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = m_TransferQueueFamilyIndex;
+
+    result = vkCreateCommandPool( m_Device, &commandPoolCreateInfo, nullptr, &m_TransferCommandPool );
+    assert( result == VK_SUCCESS );
+
+    if( NeedsOwnershipTransfer() )
+    {
+        commandPoolCreateInfo.queueFamilyIndex = m_GraphicsQueueFamilyIndex;
+
+        result = vkCreateCommandPool( m_Device, &commandPoolCreateInfo, nullptr, &m_AcquireCommandPool );
+        assert( result == VK_SUCCESS );
+    }
+
+    // Create command buffers for each batch.
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.pNext = nullptr;
+    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = 1;
+
+    for( uint32 i=0; i<MAX_TRANSFER_BATCHES; i++ )
+    {
+        commandBufferAllocateInfo.commandPool = m_TransferCommandPool;
+        result = vkAllocateCommandBuffers( m_Device, &commandBufferAllocateInfo, &m_Batches[i].m_CommandBuffer );
+        assert( result == VK_SUCCESS );
+
+        if( NeedsOwnershipTransfer() )
+        {
+            commandBufferAllocateInfo.commandPool = m_AcquireCommandPool;
+            result = vkAllocateCommandBuffers( m_Device, &commandBufferAllocateInfo, &m_Batches[i].m_AcquireCommandBuffer );
+            assert( result == VK_SUCCESS );
+        }
+    }
+}
+
+void VulkanTransferQueue::Destroy()
+{
+    WaitIdle();
+
+    m_TransferTimeline.Destroy();
+
+    // Destroying the pools frees their command buffers.
+    vkDestroyCommandPool( m_Device, m_TransferCommandPool, nullptr );
+    vkDestroyCommandPool( m_Device, m_AcquireCommandPool, nullptr );
+
+    m_StagingBuffer->Unmap();
+    m_StagingBuffer->Destroy();
+    delete m_StagingBuffer;
+
+    NullEverything();
+}
+
+VulkanTransferQueue::Batch* VulkanTransferQueue::BeginBatch()
+{
+    if( m_pRecordingBatch )
+        return m_pRecordingBatch;
+
+    if( m_BatchesInUse == MAX_TRANSFER_BATCHES )
+        WaitForOldestBatch();
+
+    Batch* pBatch = &m_Batches[(m_OldestBatch + m_BatchesInUse) % MAX_TRANSFER_BATCHES];
+    assert( pBatch->m_State == BatchState_Free );
+    m_BatchesInUse++;
+
+    VkResult result = vkResetCommandBuffer( pBatch->m_CommandBuffer, 0 );
+    assert( result == VK_SUCCESS );
+
+    VkCommandBufferBeginInfo bufferBeginInfo = {};
+    bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bufferBeginInfo.pNext = nullptr;
+    bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    bufferBeginInfo.pInheritanceInfo = nullptr;
+
+    result = vkBeginCommandBuffer( pBatch->m_CommandBuffer, &bufferBeginInfo );
+    assert( result == VK_SUCCESS );
+
+    pBatch->m_BarrierCount = 0;
+    pBatch->m_DestinationStages = 0;
+    pBatch->m_ImageCount = 0;
+    pBatch->m_Serial = m_TransferTimeline.Next();
+    pBatch->m_AcquireValue = 0;
+    pBatch->m_State = BatchState_Recording;
+
+    m_pRecordingBatch = pBatch;
+
+    return pBatch;
+}
+
+void VulkanTransferQueue::RetireOldestBatch()
+{
+    assert( m_BatchesInUse > 0 );
+
+    Batch* pBatch = &m_Batches[m_OldestBatch];
+
+    // Batches retire in order, so everything up to this batch's end of the ring is free.
+    m_StagingTail = pBatch->m_StagingEnd;
+    m_RetiredSerial = pBatch->m_Serial;
+
+    pBatch->m_State = BatchState_Free;
+    m_OldestBatch = (m_OldestBatch + 1) % MAX_TRANSFER_BATCHES;
+    m_BatchesInUse--;
+}
+
+void VulkanTransferQueue::WaitForOldestBatch()
+{
+    assert( m_BatchesInUse > 0 );
+
+    Batch* pBatch = &m_Batches[m_OldestBatch];
+
+    if( pBatch->m_State == BatchState_Recording )
+        Flush();
+
+    while( pBatch->m_State != BatchState_Free )
+    {
+        if( pBatch->m_State == BatchState_Transferring )
+            m_TransferTimeline.Wait( pBatch->m_Serial );
+        else
+            m_pGraphicsTimeline->Wait( pBatch->m_AcquireValue );
+
+        Update();
+    }
+}
+
+VkDeviceSize VulkanTransferQueue::AllocateStaging(VkDeviceSize sizeInBytes)
+{
+    assert( sizeInBytes <= m_StagingSize );
+
+    uint64 alignedSize = (sizeInBytes + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+
+    while( true )
+    {
+        // Start over at the beginning of the ring whenever it's empty.
+        if( m_StagingHead == m_StagingTail && m_pRecordingBatch == nullptr )
+        {
+            m_StagingHead = 0;
+            m_StagingTail = 0;
+        }
+
+        // Allocations never wrap, skip the end of the ring if it's too small.
+        uint64 start = m_StagingHead;
+        uint64 offset = start % m_StagingSize;
+        if( offset + alignedSize > m_StagingSize )
+            start += m_StagingSize - offset;
+
+        if( start + alignedSize - m_StagingTail <= m_StagingSize )
+        {
+            m_StagingHead = start + alignedSize;
+            return start % m_StagingSize;
+        }
+
+        // Full, wait for the oldest upload to finish.  This submits the open batch if it's the only one.
+        WaitForOldestBatch();
+    }
+}
+
+uint64 VulkanTransferQueue::Upload(VulkanBuffer* pDestination, VkDeviceSize destinationOffset, const void* pData, VkDeviceSize sizeInBytes,
+                                   VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+{
+    PROFILE_FUNCTION();
+
+    assert( m_StagingBuffer != nullptr );
+    assert( pDestination != nullptr && pData != nullptr );
+    assert( destinationOffset + sizeInBytes <= pDestination->GetSize() );
+
+    // Large uploads are split so a single one can't take the whole ring.
+    VkDeviceSize maxChunkSize = m_StagingSize / 2;
+
+    const unsigned char* pSource = (const unsigned char*)pData;
+    uint64 serial = 0;
+
+    while( sizeInBytes > 0 )
+    {
+        VkDeviceSize chunkSize = sizeInBytes < maxChunkSize ? sizeInBytes : maxChunkSize;
+
+        // Allocate staging space first, it can submit the open batch while waiting for space.
+        VkDeviceSize stagingOffset = AllocateStaging( chunkSize );
+        memcpy( m_pStagingData + stagingOffset, pSource, (size_t)chunkSize );
+
+        Batch* pBatch = BeginBatch();
+
+        VkBufferCopy region = {};
+        region.srcOffset = stagingOffset;
+        region.dstOffset = destinationOffset;
+        region.size = chunkSize;
+        vkCmdCopyBuffer( pBatch->m_CommandBuffer, m_StagingBuffer->GetBuffer(), pDestination->GetBuffer(), 1, &region );
+
+        // Add a barrier for the range, contiguous copies into the same buffer share one.
+        VkBufferMemoryBarrier* pLastBarrier = pBatch->m_BarrierCount > 0 ? &pBatch->m_Barriers[pBatch->m_BarrierCount - 1] : nullptr;
+        if( pLastBarrier && pLastBarrier->buffer == pDestination->GetBuffer() && pLastBarrier->dstAccessMask == dstAccessMask &&
+            pLastBarrier->offset + pLastBarrier->size == destinationOffset )
+        {
+            pLastBarrier->size += chunkSize;
+        }
+        else
+        {
+            VkBufferMemoryBarrier* pBarrier = &pBatch->m_Barriers[pBatch->m_BarrierCount++];
+            pBarrier->sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            pBarrier->pNext = nullptr;
+            pBarrier->srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            pBarrier->dstAccessMask = dstAccessMask;
+            pBarrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; // Filled in by Flush.
+            pBarrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            pBarrier->buffer = pDestination->GetBuffer();
+            pBarrier->offset = destinationOffset;
+            pBarrier->size = chunkSize;
+        }
+        pBatch->m_DestinationStages |= dstStageMask;
+
+        serial = pBatch->m_Serial;
+
+        if( pBatch->m_BarrierCount == MAX_TRANSFER_COPIES_PER_BATCH )
+            Flush();
+
+        pSource += chunkSize;
+        destinationOffset += chunkSize;
+        sizeInBytes -= chunkSize;
+        m_TotalBytesUploaded += chunkSize;
+    }
+
+    return serial;
+}
+
+uint32 VulkanTransferQueue::GetMaxRowsPerImageChunk(uint32 width, uint32 height, uint32 texelSize)
+{
+    VkDeviceSize rowPitch = (VkDeviceSize)width * texelSize;
+
+    // Only whole images can be copied, so the image goes in one chunk if it fits the ring at all.
+    if( m_ImageRowGranularity == 0 )
+        return rowPitch * height <= m_StagingSize ? height : 0;
+
+    // Large images are split into bands of rows so a single one can't take the whole ring.
+    // Every band but the last is a multiple of the granularity, the last one ends on the image's edge, which copies allow.
+    VkDeviceSize maxRows = (m_StagingSize / 2) / rowPitch;
+    maxRows -= maxRows % m_ImageRowGranularity;
+
+    return maxRows < height ? (uint32)maxRows : height;
+}
+
+uint64 VulkanTransferQueue::UploadImage(VkImage image, uint32 width, uint32 height, uint32 mipLevels, uint32 texelSize, const void* pPixels)
+{
+    PROFILE_FUNCTION();
+
+    assert( m_StagingBuffer != nullptr );
+    assert( image != VK_NULL_HANDLE && pPixels != nullptr );
+    assert( width > 0 && height > 0 && mipLevels > 0 );
+
+    // See CanUploadImage.
+    VkDeviceSize rowPitch = width * texelSize;
+    uint32 maxRowsPerChunk = GetMaxRowsPerImageChunk( width, height, texelSize );
+    assert( maxRowsPerChunk > 0 );
+
+    const unsigned char* pSource = (const unsigned char*)pPixels;
+
+    for( uint32 row=0; row<height; )
+    {
+        uint32 rowCount = height - row < maxRowsPerChunk ? height - row : maxRowsPerChunk;
+        VkDeviceSize chunkSize = rowPitch * rowCount;
+
+        // Allocate staging space first, it can submit the open batch while waiting for space.
+        // The staging alignment is a multiple of every texel size, as copies into images require.
+        VkDeviceSize stagingOffset = AllocateStaging( chunkSize );
+        memcpy( m_pStagingData + stagingOffset, pSource, (size_t)chunkSize );
+
+        Batch* pBatch = BeginBatch();
+
+        // Move every level out of UNDEFINED before the first copy.  Later batches are on the same queue, so they're ordered behind it.
+        if( row == 0 )
+        {
+            VkImageMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.pNext = nullptr;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = mipLevels;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+
+            vkCmdPipelineBarrier( pBatch->m_CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                  0, nullptr, 0, nullptr, 1, &barrier );
+        }
+
+        // Copies always span the full width, and rows start on a multiple of the granularity, see GetMaxRowsPerImageChunk.
+        VkBufferImageCopy region = {};
+        region.bufferOffset = stagingOffset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset.x = 0;
+        region.imageOffset.y = (int32_t)row;
+        region.imageOffset.z = 0;
+        region.imageExtent.width = width;
+        region.imageExtent.height = rowCount;
+        region.imageExtent.depth = 1;
+        vkCmdCopyBufferToImage( pBatch->m_CommandBuffer, m_StagingBuffer->GetBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region );
+
+        pSource += chunkSize;
+        row += rowCount;
+        m_TotalBytesUploaded += chunkSize;
+    }
+
+    // Mips and the final transition are recorded with the batch holding the last copy, see Flush.
+    Batch* pBatch = BeginBatch();
+
+    ImageUpload* pUpload = &pBatch->m_Images[pBatch->m_ImageCount++];
+    pUpload->m_Image = image;
+    pUpload->m_Width = width;
+    pUpload->m_Height = height;
+    pUpload->m_MipLevels = mipLevels;
+    pBatch->m_DestinationStages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+    uint64 serial = pBatch->m_Serial;
+
+    if( pBatch->m_ImageCount == MAX_TRANSFER_IMAGES_PER_BATCH )
+        Flush();
+
+    return serial;
+}
+
+void VulkanTransferQueue::RecordMipGeneration(VkCommandBuffer commandBuffer, const ImageUpload& upload)
+{
+    VkImageMemoryBarrier barriers[2] = {};
+    for( uint32 i=0; i<2; i++ )
+    {
+        barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[i].pNext = nullptr;
+        barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].image = upload.m_Image;
+        barriers[i].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barriers[i].subresourceRange.levelCount = 1;
+        barriers[i].subresourceRange.baseArrayLayer = 0;
+        barriers[i].subresourceRange.layerCount = 1;
+    }
+
+    // Each level is filtered from the one above it, which was just written by the copy or the previous blit.
+    int32_t mipWidth = (int32_t)upload.m_Width;
+    int32_t mipHeight = (int32_t)upload.m_Height;
+    for( uint32 level=1; level<upload.m_MipLevels; level++ )
+    {
+        barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barriers[0].subresourceRange.baseMipLevel = level - 1;
+
+        vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                              0, nullptr, 0, nullptr, 1, &barriers[0] );
+
+        int32_t nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+        int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+
+        VkImageBlit blit = {};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.srcOffsets[1].x = mipWidth;
+        blit.srcOffsets[1].y = mipHeight;
+        blit.srcOffsets[1].z = 1;
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+        blit.dstOffsets[1].x = nextWidth;
+        blit.dstOffsets[1].y = nextHeight;
+        blit.dstOffsets[1].z = 1;
+
+        vkCmdBlitImage( commandBuffer, upload.m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, upload.m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        1, &blit, VK_FILTER_LINEAR );
+
+        mipWidth = nextWidth;
+        mipHeight = nextHeight;
+    }
+
+    // Every level but the last was a blit source, the last one was only written.
+    uint32 barrierCount = 0;
+    if( upload.m_MipLevels > 1 )
+    {
+        barriers[barrierCount].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barriers[barrierCount].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barriers[barrierCount].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barriers[barrierCount].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[barrierCount].subresourceRange.baseMipLevel = 0;
+        barriers[barrierCount].subresourceRange.levelCount = upload.m_MipLevels - 1;
+        barrierCount++;
+    }
+
+    barriers[barrierCount].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[barrierCount].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[barrierCount].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barriers[barrierCount].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[barrierCount].subresourceRange.baseMipLevel = upload.m_MipLevels - 1;
+    barriers[barrierCount].subresourceRange.levelCount = 1;
+    barrierCount++;
+
+    vkCmdPipelineBarrier( commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                          0, nullptr, 0, nullptr, barrierCount, barriers );
+}
+
+void VulkanTransferQueue::Flush()
+{
+    PROFILE_FUNCTION();
+
+    Batch* pBatch = m_pRecordingBatch;
+    if( pBatch == nullptr )
+        return;
+
+    VkResult result;
+
+    if( NeedsOwnershipTransfer() )
+    {
+        for( uint32 i=0; i<pBatch->m_BarrierCount; i++ )
+        {
+            pBatch->m_Barriers[i].srcQueueFamilyIndex = m_TransferQueueFamilyIndex;
+            pBatch->m_Barriers[i].dstQueueFamilyIndex = m_GraphicsQueueFamilyIndex;
+        }
+
+        // Images move between families whole and keep their layout, the graphics side writes the mips into it.
+        VkImageMemoryBarrier imageBarriers[MAX_TRANSFER_IMAGES_PER_BATCH];
+        for( uint32 i=0; i<pBatch->m_ImageCount; i++ )
+        {
+            VkImageMemoryBarrier* pBarrier = &imageBarriers[i];
+            pBarrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            pBarrier->pNext = nullptr;
+            pBarrier->srcAccessMask = 0;
+            pBarrier->dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+            pBarrier->oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            pBarrier->newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            pBarrier->srcQueueFamilyIndex = m_TransferQueueFamilyIndex;
+            pBarrier->dstQueueFamilyIndex = m_GraphicsQueueFamilyIndex;
+            pBarrier->image = pBatch->m_Images[i].m_Image;
+            pBarrier->subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            pBarrier->subresourceRange.baseMipLevel = 0;
+            pBarrier->subresourceRange.levelCount = pBatch->m_Images[i].m_MipLevels;
+            pBarrier->subresourceRange.baseArrayLayer = 0;
+            pBarrier->subresourceRange.layerCount = 1;
+        }
+
+        // Record the acquire half now, Update submits it on the graphics queue once the copies are done.
+        // The copies finished before it's submitted, so there's nothing for it to wait on.
+        {
+            for( uint32 i=0; i<pBatch->m_BarrierCount; i++ )
+                pBatch->m_Barriers[i].srcAccessMask = 0;
+
+            result = vkResetCommandBuffer( pBatch->m_AcquireCommandBuffer, 0 );
+            assert( result == VK_SUCCESS );
+
+            VkCommandBufferBeginInfo bufferBeginInfo = {};
+            bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            bufferBeginInfo.pNext = nullptr;
+            bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            bufferBeginInfo.pInheritanceInfo = nullptr;
+
+            result = vkBeginCommandBuffer( pBatch->m_AcquireCommandBuffer, &bufferBeginInfo );
+            assert( result == VK_SUCCESS );
+
+            // Images are acquired for the blits, RecordMipGeneration makes them visible to the shaders.
+            VkPipelineStageFlags acquireStages = pBatch->m_DestinationStages;
+            if( pBatch->m_ImageCount > 0 )
+                acquireStages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+            // A batch closed halfway through an image only has copies, there's nothing to hand over yet.
+            if( acquireStages != 0 )
+            {
+                vkCmdPipelineBarrier( pBatch->m_AcquireCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, acquireStages, 0,
+                                      0, nullptr, pBatch->m_BarrierCount, pBatch->m_Barriers, pBatch->m_ImageCount, imageBarriers );
+            }
+
+            for( uint32 i=0; i<pBatch->m_ImageCount; i++ )
+            {
+                RecordMipGeneration( pBatch->m_AcquireCommandBuffer, pBatch->m_Images[i] );
+            }
+
+            result = vkEndCommandBuffer( pBatch->m_AcquireCommandBuffer );
+            assert( result == VK_SUCCESS );
+        }
+
+        // Release half, the destination access is ignored for a release.
+        for( uint32 i=0; i<pBatch->m_BarrierCount; i++ )
+        {
+            pBatch->m_Barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            pBatch->m_Barriers[i].dstAccessMask = 0;
+        }
+        for( uint32 i=0; i<pBatch->m_ImageCount; i++ )
+        {
+            imageBarriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            imageBarriers[i].dstAccessMask = 0;
+        }
+
+        if( pBatch->m_BarrierCount > 0 || pBatch->m_ImageCount > 0 )
+        {
+            vkCmdPipelineBarrier( pBatch->m_CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                                  0, nullptr, pBatch->m_BarrierCount, pBatch->m_Barriers, pBatch->m_ImageCount, imageBarriers );
+        }
+    }
+    else
+    {
+        // Same queue as rendering, a regular barrier makes the copies visible to every later submission.
+        if( pBatch->m_BarrierCount > 0 )
+        {
+            vkCmdPipelineBarrier( pBatch->m_CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, pBatch->m_DestinationStages, 0,
+                                  0, nullptr, pBatch->m_BarrierCount, pBatch->m_Barriers, 0, nullptr );
+        }
+
+        // The family can blit, so the mips are generated right behind the copies.
+        for( uint32 i=0; i<pBatch->m_ImageCount; i++ )
+        {
+            RecordMipGeneration( pBatch->m_CommandBuffer, pBatch->m_Images[i] );
+        }
+    }
+
+    result = vkEndCommandBuffer( pBatch->m_CommandBuffer );
+    assert( result == VK_SUCCESS );
+
+    VkSemaphore signalSemaphore = m_TransferTimeline.GetSemaphore();
+    uint64_t signalValue = pBatch->m_Serial;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.pNext = nullptr;
+    timelineInfo.waitSemaphoreValueCount = 0;
+    timelineInfo.pWaitSemaphoreValues = nullptr;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = 0;
+    submitInfo.pWaitSemaphores = nullptr;
+    submitInfo.pWaitDstStageMask = nullptr;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &pBatch->m_CommandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &signalSemaphore;
+
+    result = vkQueueSubmit( m_TransferQueue, 1, &submitInfo, VK_NULL_HANDLE );
+    assert( result == VK_SUCCESS );
+
+    pBatch->m_StagingEnd = m_StagingHead;
+    pBatch->m_State = BatchState_Transferring;
+    m_pRecordingBatch = nullptr;
+
+    // On the graphics queue, anything submitted after this is ordered behind the copies.
+    if( NeedsOwnershipTransfer() == false )
+        m_CompletedSerial = pBatch->m_Serial;
+}
+
+void VulkanTransferQueue::Update()
+{
+    PROFILE_FUNCTION();
+
+    VkResult result;
+
+    // Batches finish in order, one read of the timeline covers all of them.
+    uint64 transferredSerial = m_TransferTimeline.GetCompletedValue();
+
+    // Hand every batch whose copies are done over to the graphics queue.
+    for( uint32 i=0; i<m_BatchesInUse; i++ )
+    {
+        Batch* pBatch = &m_Batches[(m_OldestBatch + i) % MAX_TRANSFER_BATCHES];
+
+        if( pBatch->m_State == BatchState_Acquiring )
+            continue;
+
+        if( pBatch->m_State != BatchState_Transferring || pBatch->m_Serial > transferredSerial )
+            break;
+
+        if( NeedsOwnershipTransfer() )
+        {
+            VkSemaphore signalSemaphore = m_pGraphicsTimeline->GetSemaphore();
+            uint64_t signalValue = m_pGraphicsTimeline->Next();
+
+            VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+            timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            timelineInfo.pNext = nullptr;
+            timelineInfo.signalSemaphoreValueCount = 1;
+            timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+            VkSubmitInfo submitInfo = {};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.pNext = &timelineInfo;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &pBatch->m_AcquireCommandBuffer;
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &signalSemaphore;
+
+            result = vkQueueSubmit( m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE );
+            assert( result == VK_SUCCESS );
+
+            pBatch->m_AcquireValue = signalValue;
+            pBatch->m_State = BatchState_Acquiring;
+            m_CompletedSerial = pBatch->m_Serial;
+        }
+    }
+
+    // Retire batches the GPU is completely done with, freeing their staging space.
+    while( m_BatchesInUse > 0 )
+    {
+        Batch* pBatch = &m_Batches[m_OldestBatch];
+
+        bool done;
+        if( pBatch->m_State == BatchState_Transferring && NeedsOwnershipTransfer() == false )
+            done = pBatch->m_Serial <= transferredSerial;
+        else if( pBatch->m_State == BatchState_Acquiring )
+            done = m_pGraphicsTimeline->IsComplete( pBatch->m_AcquireValue );
+        else
+            done = false;
+
+        if( done == false )
+            break;
+
+        RetireOldestBatch();
+    }
+}
+
+void VulkanTransferQueue::WaitIdle()
+{
+    Flush();
+
+    while( m_BatchesInUse > 0 )
+    {
+        WaitForOldestBatch();
+    }
+}
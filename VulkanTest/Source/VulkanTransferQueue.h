@@ -0,0 +1,162 @@
+//
+// Copyright (c) 2019 Jimmy Lord http://www.flatheadgames.com
+//
+// This software is provided 'as-is', without any express or implied warranty.  In no event will the authors be held liable for any damages arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef __VulkanTransferQueue_H__
+#define __VulkanTransferQueue_H__
+
+#include "vulkan/vulkan.h"
+#include "Math/MyTypes.h"
+#include "VulkanTimelineSemaphore.h"
+
+class VulkanInterface;
+class VulkanBuffer;
+
+static const int MAX_TRANSFER_BATCHES = 4;
+static const int MAX_TRANSFER_COPIES_PER_BATCH = 256;
+static const int MAX_TRANSFER_IMAGES_PER_BATCH = 64;
+
+// Copies data into device local buffers through a persistently mapped staging ring.
+// Copies run on a dedicated transfer queue if the device has one, so large uploads overlap rendering.
+//
+// Uploads are recorded into batches and Flush() submits the open batch.  Each batch's serial number is the value it
+// signals on the transfer queue's timeline, data from a batch is only safe to draw with once IsComplete() returns true.
+// If the transfer queue is from another family, Update() checks the timeline for finished copies, then submits the
+// matching queue family ownership acquire on the graphics queue.  Checking on the CPU instead of having the graphics
+// queue wait on the timeline means a frame never stalls on an upload it doesn't need yet.
+//
+// Images only have mip 0 copied on the transfer queue, blits need a graphics queue.  The rest of the mip chain is
+// generated after the acquire, or straight after the copies if both queues are in the same family.
+class VulkanTransferQueue
+{
+protected:
+    enum BatchState
+    {
+        BatchState_Free,
+        BatchState_Recording,
+        BatchState_Transferring,
+        BatchState_Acquiring,
+    };
+
+    struct ImageUpload
+    {
+        VkImage m_Image;
+        uint32 m_Width;
+        uint32 m_Height;
+        uint32 m_MipLevels;
+    };
+
+    struct Batch
+    {
+        VkCommandBuffer m_CommandBuffer;        // Transfer family, copies and release barriers.
+        VkCommandBuffer m_AcquireCommandBuffer; // Graphics family, acquire barriers.  Only used when the families differ.
+
+        VkBufferMemoryBarrier m_Barriers[MAX_TRANSFER_COPIES_PER_BATCH];
+        uint32 m_BarrierCount;
+        VkPipelineStageFlags m_DestinationStages;
+
+        ImageUpload m_Images[MAX_TRANSFER_IMAGES_PER_BATCH]; // Fully copied, waiting for mip generation.
+        uint32 m_ImageCount;
+
+        uint64 m_Serial;       // Transfer timeline value signaled by the copies.
+        uint64 m_AcquireValue; // Graphics timeline value signaled by the acquire.
+        uint64 m_StagingEnd; // Staging head when the batch was closed, everything before it is free once the batch retires.
+        BatchState m_State;
+    };
+
+    VulkanInterface* m_pInterface;
+    VkDevice m_Device;
+
+    VkQueue m_TransferQueue;
+    uint32 m_TransferQueueFamilyIndex;
+    VkQueue m_GraphicsQueue;
+    uint32 m_GraphicsQueueFamilyIndex;
+
+    // Image copy bands start on multiples of this many rows, from the transfer family's minImageTransferGranularity.
+    // 0 if the family can only copy whole images.
+    uint32 m_ImageRowGranularity;
+
+    VulkanTimelineSemaphore m_TransferTimeline;
+    VulkanTimelineSemaphore* m_pGraphicsTimeline;
+
+    VkCommandPool m_TransferCommandPool;
+    VkCommandPool m_AcquireCommandPool;
+
+    // Ring buffer, head and tail count bytes since creation and wrap with % m_StagingSize.
+    VulkanBuffer* m_StagingBuffer;
+    unsigned char* m_pStagingData;
+    uint64 m_StagingSize;
+    uint64 m_StagingHead;
+    uint64 m_StagingTail;
+
+    // Batches are used in order, m_OldestBatch is the first one not yet retired.
+    Batch m_Batches[MAX_TRANSFER_BATCHES];
+    uint32 m_OldestBatch;
+    uint32 m_BatchesInUse;
+    Batch* m_pRecordingBatch;
+
+    uint64 m_CompletedSerial;
+    uint64 m_RetiredSerial;  // Last batch the GPU is completely done with, including the acquire.
+
+    uint64 m_TotalBytesUploaded;
+
+protected:
+    void NullEverything();
+
+    bool NeedsOwnershipTransfer() { return m_TransferQueueFamilyIndex != m_GraphicsQueueFamilyIndex; }
+
+    Batch* BeginBatch();
+    void RetireOldestBatch();
+    void WaitForOldestBatch();
+    VkDeviceSize AllocateStaging(VkDeviceSize sizeInBytes);
+    uint32 GetMaxRowsPerImageChunk(uint32 width, uint32 height, uint32 texelSize);
+    void RecordMipGeneration(VkCommandBuffer commandBuffer, const ImageUpload& upload);
+
+public:
+    VulkanTransferQueue();
+    virtual ~VulkanTransferQueue();
+
+    // Pass the graphics queue as the transfer queue if the device has no separate transfer family.
+    // The graphics timeline is signaled by the acquire submissions, see VulkanInterface.
+    void Create(VulkanInterface* pInterface, VkQueue transferQueue, uint32 transferQueueFamilyIndex, VkQueue graphicsQueue, uint32 graphicsQueueFamilyIndex,
+                VulkanTimelineSemaphore* pGraphicsTimeline, uint32 stagingSizeInBytes);
+    void Destroy();
+
+    // Copies data into a range of a buffer created with VK_BUFFER_USAGE_TRANSFER_DST_BIT.
+    // dstAccessMask and dstStageMask describe how the graphics queue will read the data.
+    // Blocks if the staging ring is full until an earlier batch finishes.  Returns the serial to pass to IsComplete.
+    uint64 Upload(VulkanBuffer* pDestination, VkDeviceSize destinationOffset, const void* pData, VkDeviceSize sizeInBytes,
+                  VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+
+    // Copies tightly packed pixels into mip 0 of a 2D image created with VK_IMAGE_USAGE_TRANSFER_SRC_BIT and _DST_BIT,
+    // then blits the remaining mip levels down from it.  The image must not have been used yet, afterwards every level is
+    // in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL for fragment shaders.  Returns the serial to pass to IsComplete.
+    uint64 UploadImage(VkImage image, uint32 width, uint32 height, uint32 mipLevels, uint32 texelSize, const void* pPixels);
+    // False if UploadImage can't stage an image this size, only possible for rows wider than half the ring,
+    // or for images larger than the ring if the transfer family can only copy whole images.
+    bool CanUploadImage(uint32 width, uint32 height, uint32 texelSize) { return GetMaxRowsPerImageChunk( width, height, texelSize ) > 0; }
+
+    // Submits the open batch, if any.
+    void Flush();
+
+    // Retires finished batches and hands them over to the graphics queue, call once a frame before submitting it.
+    void Update();
+
+    // Flushes and blocks until every upload is complete.
+    void WaitIdle();
+
+    bool IsComplete(uint64 serial) { return serial <= m_CompletedSerial; }
+
+    // Buffers touched by an upload can't be destroyed until its batch retires, see VulkanDeletionQueue.
+    bool IsRetired(uint64 serial) { return serial <= m_RetiredSerial; }
+    uint64 GetLastSerial() { return m_TransferTimeline.GetLastSignalValue(); }
+    bool IsDedicated() { return m_TransferQueue != m_GraphicsQueue; }
+    uint64 GetTotalBytesUploaded() { return m_TotalBytesUploaded; }
+};
+
+#endif //__VulkanTransferQueue_H__
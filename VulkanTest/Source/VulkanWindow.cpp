@@ -7,20 +7,36 @@
 // 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
 // 3. This notice may not be removed or altered from any source distribution.
 
+#if _WIN32
 #include <Windows.h>
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
 #include <assert.h>
 
+#if _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
 #include "vulkan/vulkan.h"
 #include "vulkan/vulkan_win32.h"
+#else
+#define VK_USE_PLATFORM_XCB_KHR
+#include "vulkan/vulkan.h"
+#endif
 
 #include "VulkanInterface.h"
 #include "VulkanWindow.h"
 
+#if _WIN32
+
 VulkanWindow::VulkanWindow()
 {
     m_hInstance = 0;
     m_hWnd = 0;
+
+    m_Resized = false;
+    m_Minimized = false;
 }
 
 VulkanWindow::~VulkanWindow()
@@ -139,6 +155,21 @@ void VulkanWindow::Destroy()
     }
 }
 
+bool VulkanWindow::ProcessEvents()
+{
+    MSG msg;
+    while( PeekMessage( &msg, nullptr, 0, 0, PM_REMOVE ) )
+    {
+        if( msg.message == WM_QUIT )
+            return false;
+
+        TranslateMessage( &msg );
+        DispatchMessage( &msg );
+    }
+
+    return true;
+}
+
 // This is a static method.
 LRESULT CALLBACK VulkanWindow::StaticWndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
@@ -175,6 +206,13 @@ LRESULT CALLBACK VulkanWindow::WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPAR
         }
         return 0;
 
+    case WM_SIZE:
+        {
+            m_Minimized = (wParam == SIZE_MINIMIZED);
+            m_Resized = true;
+        }
+        return 0;
+
     case WM_CLOSE:
         {
             PostQuitMessage( 0 );
@@ -192,3 +230,177 @@ LRESULT CALLBACK VulkanWindow::WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPAR
     // Pass all unhandled messages to DefWindowProc.
     return DefWindowProc( hWnd, uMsg, wParam, lParam );
 }
+
+#else //_WIN32
+
+// Keycode of the escape key on X servers using evdev, which is all of them these days.
+static const xcb_keycode_t XCB_ESCAPE_KEYCODE = 9;
+
+VulkanWindow::VulkanWindow()
+{
+    m_pConnection = nullptr;
+    m_Window = 0;
+    m_DeleteWindowAtom = 0;
+    m_Width = 0;
+    m_Height = 0;
+
+    m_Resized = false;
+    m_Minimized = false;
+}
+
+VulkanWindow::~VulkanWindow()
+{
+}
+
+VkSurfaceKHR VulkanWindow::Create(VkInstance vulkanInstance, const char* windowTitle, int width, int height)
+{
+    assert( m_pConnection == nullptr );
+    assert( m_Window == 0 );
+
+    // Connect to the X server named by $DISPLAY.
+    {
+        m_pConnection = xcb_connect( nullptr, nullptr );
+        if( xcb_connection_has_error( m_pConnection ) )
+        {
+            fprintf( stderr, "Failed to connect to the X server.\n" );
+            Destroy();
+            return VK_NULL_HANDLE;
+        }
+    }
+
+    // Create a visible window.
+    {
+        xcb_screen_t* pScreen = xcb_setup_roots_iterator( xcb_get_setup( m_pConnection ) ).data;
+
+        m_Window = xcb_generate_id( m_pConnection );
+        m_Width = (uint32_t)width;
+        m_Height = (uint32_t)height;
+
+        uint32_t valueMask = XCB_CW_EVENT_MASK;
+        uint32_t values[] = { XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_STRUCTURE_NOTIFY };
+
+        xcb_create_window( m_pConnection, XCB_COPY_FROM_PARENT, m_Window, pScreen->root, 0, 0, (uint16_t)width, (uint16_t)height, 0,
+                           XCB_WINDOW_CLASS_INPUT_OUTPUT, pScreen->root_visual, valueMask, values );
+
+        xcb_change_property( m_pConnection, XCB_PROP_MODE_REPLACE, m_Window, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8,
+                             (uint32_t)strlen( windowTitle ), windowTitle );
+
+        // Ask the window manager for a message instead of killing the connection when the window is closed.
+        xcb_intern_atom_cookie_t protocolsCookie = xcb_intern_atom( m_pConnection, 1, 12, "WM_PROTOCOLS" );
+        xcb_intern_atom_cookie_t deleteCookie = xcb_intern_atom( m_pConnection, 0, 16, "WM_DELETE_WINDOW" );
+        xcb_intern_atom_reply_t* pProtocolsReply = xcb_intern_atom_reply( m_pConnection, protocolsCookie, nullptr );
+        xcb_intern_atom_reply_t* pDeleteReply = xcb_intern_atom_reply( m_pConnection, deleteCookie, nullptr );
+
+        if( pProtocolsReply && pDeleteReply )
+        {
+            m_DeleteWindowAtom = pDeleteReply->atom;
+            xcb_change_property( m_pConnection, XCB_PROP_MODE_REPLACE, m_Window, pProtocolsReply->atom, XCB_ATOM_ATOM, 32, 1, &m_DeleteWindowAtom );
+        }
+
+        free( pProtocolsReply );
+        free( pDeleteReply );
+
+        xcb_map_window( m_pConnection, m_Window );
+        xcb_flush( m_pConnection );
+    }
+
+    // Create Vulkan surface.
+    {
+        VkXcbSurfaceCreateInfoKHR surfaceCreateInfo = {};
+        surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_XCB_SURFACE_CREATE_INFO_KHR;
+        surfaceCreateInfo.pNext = nullptr;
+        surfaceCreateInfo.flags = 0;
+        surfaceCreateInfo.connection = m_pConnection;
+        surfaceCreateInfo.window = m_Window;
+
+        VkSurfaceKHR surface = VK_NULL_HANDLE;
+
+        VkResult result = vkCreateXcbSurfaceKHR( vulkanInstance, &surfaceCreateInfo, nullptr, &surface );
+        if( result != VK_SUCCESS )
+        {
+            fprintf( stderr, "Failed to create vulkan surface.\n" );
+            assert( false );
+        }
+
+        return surface;
+    }
+}
+
+void VulkanWindow::Destroy()
+{
+    if( m_pConnection == nullptr )
+        return;
+
+    if( m_Window )
+    {
+        xcb_destroy_window( m_pConnection, m_Window );
+        m_Window = 0;
+    }
+
+    xcb_disconnect( m_pConnection );
+    m_pConnection = nullptr;
+}
+
+bool VulkanWindow::ProcessEvents()
+{
+    bool running = true;
+
+    xcb_generic_event_t* pEvent;
+    while( (pEvent = xcb_poll_for_event( m_pConnection )) != nullptr )
+    {
+        switch( pEvent->response_type & 0x7f )
+        {
+        case XCB_CONFIGURE_NOTIFY:
+            {
+                // Also sent for moves, only a size change needs a new swapchain.
+                xcb_configure_notify_event_t* pConfigure = (xcb_configure_notify_event_t*)pEvent;
+                if( pConfigure->width != m_Width || pConfigure->height != m_Height )
+                {
+                    m_Width = pConfigure->width;
+                    m_Height = pConfigure->height;
+                    m_Resized = true;
+                }
+            }
+            break;
+
+        case XCB_UNMAP_NOTIFY:
+            {
+                m_Minimized = true;
+            }
+            break;
+
+        case XCB_MAP_NOTIFY:
+            {
+                m_Minimized = false;
+                m_Resized = true;
+            }
+            break;
+
+        case XCB_CLIENT_MESSAGE:
+            {
+                xcb_client_message_event_t* pMessage = (xcb_client_message_event_t*)pEvent;
+                if( pMessage->data.data32[0] == m_DeleteWindowAtom )
+                    running = false;
+            }
+            break;
+
+        case XCB_KEY_PRESS:
+            {
+                xcb_key_press_event_t* pKeyPress = (xcb_key_press_event_t*)pEvent;
+                if( pKeyPress->detail == XCB_ESCAPE_KEYCODE )
+                    running = false;
+            }
+            break;
+        }
+
+        free( pEvent );
+    }
+
+    // The X server went away.
+    if( xcb_connection_has_error( m_pConnection ) )
+        running = false;
+
+    return running;
+}
+
+#endif //_WIN32
@@ -10,7 +10,11 @@
 #ifndef __VulkanWindow_H__
 #define __VulkanWindow_H__
 
+#if _WIN32
 #include <Windows.h>
+#else
+#include <xcb/xcb.h>
+#endif
 
 class VulkanInterface;
 
@@ -19,8 +23,20 @@ class VulkanWindow
     friend class VulkanInterface;
 
 protected:
+#if _WIN32
     HINSTANCE m_hInstance;
     HWND m_hWnd;
+#else
+    xcb_connection_t* m_pConnection;
+    xcb_window_t m_Window;
+    xcb_atom_t m_DeleteWindowAtom;
+    uint32_t m_Width;
+    uint32_t m_Height;
+#endif
+
+    // Set by WM_SIZE or ConfigureNotify, VulkanInterface rebuilds the swapchain and clears m_Resized.
+    bool m_Resized;
+    bool m_Minimized;
 
 protected:
     VulkanWindow();
@@ -29,8 +45,13 @@ protected:
     VkSurfaceKHR Create(VkInstance vulkanInstance, const char* windowName, int width, int height);
     void Destroy();
 
+    // Handles pending window messages, returns false once the window was closed or escape was pressed.
+    bool ProcessEvents();
+
+#if _WIN32
     static LRESULT CALLBACK StaticWndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
     virtual LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+#endif
 };
 
 #endif //__VulkanWindow_H__
@@ -7,48 +7,144 @@
 // 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
 // 3. This notice may not be removed or altered from any source distribution.
 
+#if _WIN32
 #include <Windows.h>
+#endif
 #include <assert.h>
+#include <stdio.h>
+#include <chrono>
+#include <thread>
 
+#include "AssetLoader.h"
+#include "CPUProfiler.h"
 #include "VulkanInterface.h"
 #include "VulkanMesh.h"
 
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow)
+// Stats go to the debugger's output window on Windows, stdout elsewhere.
+static void LogMessage(const char* message)
 {
+#if _WIN32
+    OutputDebugStringA( message );
+#else
+    fputs( message, stdout );
+#endif
+}
+
+static int RunVulkanTest(const char* meshFilename)
+{
+    PROFILE_THREAD_NAME( "Main" );
+
     VulkanInterface* vulkanInterface = new VulkanInterface();
     vulkanInterface->Create( "Vulkan Test", 480, 270 );
 
+    AssetLoader* assetLoader = new AssetLoader();
+    assetLoader->Create( vulkanInterface );
+
+    // Draw a cube until the file named on the command line (OBJ, glTF or .vtm) has loaded.
     VulkanMesh* cube = new VulkanMesh();
     cube->CreateCube( vulkanInterface );
 
+    MeshAsset* loadingMesh = nullptr;
+    if( meshFilename && meshFilename[0] )
+    {
+        loadingMesh = assetLoader->LoadMesh( meshFilename );
+    }
+
     vulkanInterface->SetupCommandBuffers( cube );
 
-    MSG msg;
+    // Start each frame just in time for the GPU, so it's built from the freshest input.
+    vulkanInterface->SetFramePacing( FramePacingMode_LowLatency );
+
+    // Count vertex and fragment work alongside the GPU times.
+    vulkanInterface->GetGPUProfiler()->SetPipelineStatisticsEnabled( true );
+
     bool running = true;
+    uint32 frameCount = 0;
     while( running )
     {
-        if( PeekMessage( &msg, nullptr, 0, 0, PM_REMOVE ) )
+        PROFILE_SCOPE( "Frame" );
+
+        // Throttle before reading input.
+        vulkanInterface->BeginFrame();
+
+        running = vulkanInterface->ProcessWindowEvents();
+        if( running == false )
+            break;
+
+        assetLoader->Update();
+        if( loadingMesh && loadingMesh->IsReady() )
         {
-            if( msg.message == WM_QUIT )
-            {
-                running = false;
-            }
-            else
-            {
-                TranslateMessage( &msg );
-                DispatchMessage( &msg );
-            }
+            VulkanMesh* pMesh = loadingMesh->GetMesh();
+            vulkanInterface->SetupCommandBuffers( pMesh );
+            loadingMesh = nullptr;
         }
-        else
+
+        vulkanInterface->Render();
+        vulkanInterface->Present();
+
+        // Report latency every few seconds.
+        frameCount++;
+        if( frameCount % 300 == 0 )
         {
-            vulkanInterface->Render();
-            vulkanInterface->Present();
+            FrameLatencyStats stats;
+            vulkanInterface->GetLatencyStats( &stats );
+
+            char message[256];
+            snprintf( message, sizeof( message ), "Latency: %0.2fms avg, %0.2fms min, %0.2fms max.  CPU %0.2fms, GPU %0.2fms, slept %0.2fms.\n",
+                       stats.m_AverageMS, stats.m_MinMS, stats.m_MaxMS, stats.m_CPUFrameMS, stats.m_GPUFrameMS, stats.m_SleepMS );
+            LogMessage( message );
+
+            VulkanGPUProfiler* pGPUProfiler = vulkanInterface->GetGPUProfiler();
+            for( uint32 i=0; i<pGPUProfiler->GetScopeCount(); i++ )
+            {
+                GPUScopeStats gpuStats;
+                pGPUProfiler->GetScopeStats( i, &gpuStats );
+
+                snprintf( message, sizeof( message ), "GPU %s: %0.3fms avg, %0.3fms median, %0.3fms 95th, %0.3fms 99th, %0.3fms max.\n",
+                           gpuStats.m_Name, gpuStats.m_AverageMS, gpuStats.m_MedianMS, gpuStats.m_P95MS, gpuStats.m_P99MS, gpuStats.m_MaxMS );
+                LogMessage( message );
+
+                if( gpuStats.m_HasPipelineStatistics )
+                {
+                    uint64* counts = gpuStats.m_PipelineStatistics;
+                    snprintf( message, sizeof( message ), "    %llu vertices, %llu VS invocations, %llu primitives after clipping, %llu FS invocations.\n",
+                               (unsigned long long)counts[GPUPipelineStatistic_InputAssemblyVertices], (unsigned long long)counts[GPUPipelineStatistic_VertexShaderInvocations],
+                               (unsigned long long)counts[GPUPipelineStatistic_ClippingPrimitives], (unsigned long long)counts[GPUPipelineStatistic_FragmentShaderInvocations] );
+                    LogMessage( message );
+                }
+            }
         }
+
+        // Nothing is drawn while minimized, don't spin.
+        if( vulkanInterface->IsMinimized() )
+            std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
     }
 
+    assetLoader->Destroy();
+    delete assetLoader;
+
     cube->Destroy();
     delete cube;
 
     vulkanInterface->Destroy();
     delete vulkanInterface;
+
+    // Covers the last few seconds, older zones have been overwritten.
+#if CPU_PROFILER_ENABLED
+    CPUProfiler::ExportChromeTrace( "CPUProfile.json" );
+#endif
+
+    return 0;
+}
+
+#if _WIN32
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow)
+{
+    return RunVulkanTest( lpCmdLine );
+}
+#else
+int main(int argc, char** argv)
+{
+    return RunVulkanTest( argc > 1 ? argv[1] : nullptr );
 }
+#endif
@@ -1,13 +1,88 @@
+------------------------------------------------ Options
+newoption {
+    trigger     = "no-profiler",
+    description = "Compile out the CPU profiler's zones",
+}
+
+newoption {
+    trigger     = "validation",
+    description = "Enable the Vulkan validation layer by default in every configuration, not just Debug",
+}
+
+------------------------------------------------ Shared Settings
+-- Windows builds need the LunarG SDK, Linux uses the system's vulkan and xcb packages unless VULKAN_SDK points elsewhere.
+local VulkanSDK = os.getenv("VULKAN_SDK")
+
+function VulkanSettings()
+    if os.istarget("windows") then
+        includedirs { VulkanSDK .. "/Include" }
+        links { VulkanSDK .. "/lib/vulkan-1" }
+    else
+        if VulkanSDK then
+            includedirs { VulkanSDK .. "/include" }
+            libdirs { VulkanSDK .. "/lib" }
+        end
+        links { "vulkan", "xcb", "pthread" }
+    end
+end
+
+-- Profiles from PGOInstrument runs, see PGOTrain.sh/.bat.  The benchmark binaries are trained by running them, the game by playing it.
+local PGODir = path.getabsolute("build/pgo")
+
+function ConfigurationSettings()
+   filter "configurations:Debug"
+      defines { "DEBUG" }
+      symbols "On"
+
+   -- "Speed" is -O3 with gcc and clang.
+   filter "configurations:not Debug"
+      optimize "Speed"
+      flags { "LinkTimeOptimization" }
+
+   -- AVX2 and FMA on current CPUs, only run these binaries on the machine that built them or one like it.
+   filter { "configurations:ReleaseNative", "system:windows" }
+      vectorextensions "AVX2"
+   filter { "configurations:ReleaseNative", "system:not windows" }
+      buildoptions { "-march=native" }
+
+   filter { "configurations:PGOInstrument", "system:windows" }
+      linkoptions { "/GENPROFILE:PGD=" .. PGODir .. "/%{prj.name}.pgd" }
+   filter { "configurations:PGOOptimize", "system:windows" }
+      linkoptions { "/USEPROFILE:PGD=" .. PGODir .. "/%{prj.name}.pgd" }
+
+   -- gcc names profiles after the object files, strip each configuration's objdir so both configurations agree on the names.
+   -- The asset loader's worker threads run instrumented code too, so counters are updated atomically.
+   filter { "configurations:PGOInstrument", "system:not windows" }
+      buildoptions { "-fprofile-generate=" .. PGODir, "-fprofile-update=atomic", "-fprofile-prefix-path=" .. path.getabsolute("build/obj/PGOInstrument") }
+      linkoptions { "-fprofile-generate=" .. PGODir }
+   filter { "configurations:PGOOptimize", "system:not windows" }
+      buildoptions { "-fprofile-use=" .. PGODir, "-fprofile-correction", "-Wno-missing-profile", "-fprofile-prefix-path=" .. path.getabsolute("build/obj/PGOOptimize") }
+      linkoptions { "-fprofile-use=" .. PGODir }
+
+   filter "options:no-profiler"
+      defines { "CPU_PROFILER_ENABLED=0" }
+
+   filter "options:validation"
+      defines { "VULKAN_VALIDATION_DEFAULT=1" }
+
+   filter {}
+end
+
 ------------------------------------------------ Solution
 workspace "VulkanTest"
-    configurations  { "Debug", "Release" }
+    configurations  { "Debug", "Release", "ReleaseNative", "PGOInstrument", "PGOOptimize" }
+    platforms       { "x64" }
     location        "build"
+    targetdir       "build/bin/%{cfg.buildcfg}"
+    objdir          "build/obj/%{cfg.buildcfg}/%{prj.name}"
     startproject    "VulkanTest"
+    cppdialect      "C++14"
 
     filter "system:windows"
-        platforms       { "x64" }
         characterset    "MBCS"
 
+    filter {}
+
 ------------------------------------------------ Game Project
 project "VulkanTest"
     location    "build"
@@ -17,7 +92,6 @@ project "VulkanTest"
 
     includedirs {
         "VulkanTest/Source",
-        os.getenv("VULKAN_SDK") .. "/Include",
     }
 
     files {
@@ -27,6 +101,9 @@ project "VulkanTest"
         "VulkanTest/Data/Shaders/**.frag",
         "premake5.lua",
         "PremakeGenerateBuildFiles.bat",
+        "PremakeGenerateBuildFiles.sh",
+        "PGOTrain.bat",
+        "PGOTrain.sh",
         ".gitignore",
     }
 
@@ -39,10 +116,57 @@ project "VulkanTest"
         },
     }
 
-    links {
-        os.getenv("VULKAN_SDK") .. "/lib/vulkan-1",
+    VulkanSettings()
+    ConfigurationSettings()
+
+------------------------------------------------ Benchmark Project
+project "Benchmark"
+    location    "build"
+    kind        "ConsoleApp"
+    language    "C++"
+    debugdir    "VulkanTest"
+
+    includedirs {
+        "VulkanTest/Source",
     }
 
-   filter "configurations:Debug"
-      defines { "DEBUG" }
-      symbols "On"
+    files {
+        "VulkanTest/Source/**.cpp",
+        "VulkanTest/Source/**.h",
+        "VulkanTest/Benchmark/**.cpp",
+        "VulkanTest/Benchmark/**.h",
+    }
+
+    removefiles {
+        "VulkanTest/Source/main.cpp",
+    }
+
+    VulkanSettings()
+
+    filter "system:windows"
+        links { "psapi" }
+
+    filter {}
+
+    ConfigurationSettings()
+
+------------------------------------------------ Math Benchmark Project
+project "MathBenchmark"
+    location    "build"
+    kind        "ConsoleApp"
+    language    "C++"
+
+    includedirs {
+        "VulkanTest/Source",
+    }
+
+    files {
+        "VulkanTest/Source/Math/**.cpp",
+        "VulkanTest/Source/Math/**.h",
+        "VulkanTest/Source/CPUProfiler.cpp",
+        "VulkanTest/Source/CPUProfiler.h",
+        "VulkanTest/Source/Platform.h",
+        "VulkanTest/MathBenchmark/**.cpp",
+    }
+
+    ConfigurationSettings()